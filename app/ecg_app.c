@@ -0,0 +1,348 @@
+#include "ecg_app.h"
+
+#include "config/config.h"
+#include "channel/ecg_channel.h"
+#include "metrics/ecg_metrics.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+/* one channel at SAMPLE_FREQ and the beat ring slots - BIOS creates nothing at runtime */
+#define APP_ARENA_SIZE (ECG_CHANNEL_STORAGE(SAMPLE_FREQ) + ARENA_ROUND(BEAT_RING_SIZE * sizeof(ecg_wave_result_t)))
+
+/******************************************************************************
+ * GLOBAL VARIABLES
+ *****************************************************************************/
+
+/* buffers of the channel and the slots of the beat ring - carved at init, sealed after it */
+static uint8_t g_arena_block[ARENA_STATIC_SIZE(APP_ARENA_SIZE)];
+static arena_t g_arena;
+
+/* the single channel fed by the sampling ISR - the ISR writes the input
+ * buffer and each task only touches its own part after the semaphore handoff */
+static ecg_channel_t g_channel;
+
+/* detected waves for the logger and the subscribers of the platform - the
+ * feature detection task is the only producer */
+static beat_ring_t g_beats;
+static uint32_t g_logger_id;                                      /* subscriber id of the logger task */
+
+static ecg_app_config_t g_config;                                 /* semaphores and options from the platform */
+
+/* pipeline counters - each one has a single writer, the other tasks and the platform read them */
+static struct {
+  osal_atomic_u32_t samples_pushed;                               /* sampling ISR */
+  osal_atomic_u32_t samples_filtered;                             /* preprocessing task */
+  osal_atomic_u32_t waves_posted;                                 /* preprocessing task */
+  osal_atomic_u32_t waves_detected;                               /* feature detection task */
+  osal_atomic_u32_t waves_accepted;                               /* feature detection task */
+  osal_atomic_u32_t beats_published;                              /* feature detection task */
+  osal_atomic_u32_t beats_stalled;                                /* feature detection task */
+} g_stats;
+static osal_atomic_u32_t g_stop_requested;                        /* producer pushed its last sample */
+static osal_atomic_u32_t g_preprocessing_done;                    /* preprocessing task drained and returned */
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* adds to a counter of the calling task - the only writer, so no read-modify-write */
+static inline uint32_t counter_add(osal_atomic_u32_t* counter, uint32_t n)
+{
+  uint32_t value = osal_atomic_load_relaxed(counter) + n;
+  osal_atomic_store_release(counter, value);
+  return value;
+}
+
+/* prints the points, intervals, quality and heart rate of a wave */
+static void log_wave(const ecg_wave_result_t* result)
+{
+  const wave_points_t* wave_points = &result->points;
+  const wave_intervals_t* wave_intervals = &result->intervals;
+
+  /* print current wave */
+  osal_printf("\nWave %u:\n", (unsigned)(result->wave + 1));
+
+  /* print P Q R S T sample and amplitude - samples fit 32 bits for 1.7 years at 80 Hz */
+  osal_printf("P-wave: idx=%lu, V=%d mV\n", (unsigned long)wave_points->p_idx, (int)wave_points->p_val);
+  osal_printf("Q-wave: idx=%lu, V=%d mV\n", (unsigned long)wave_points->q_idx, (int)wave_points->q_val);
+  osal_printf("R-wave: idx=%lu, V=%d mV\n", (unsigned long)wave_points->r_idx, (int)wave_points->r_val);
+  osal_printf("S-wave: idx=%lu, V=%d mV\n", (unsigned long)wave_points->s_idx, (int)wave_points->s_val);
+  osal_printf("T-wave: idx=%lu, V=%d mV\n", (unsigned long)wave_points->t_idx, (int)wave_points->t_val);
+  osal_printf("P-previous-wave: idx=%lu, R-previous-wave: idx=%lu\n", (unsigned long)wave_points->prev_p_idx,
+              (unsigned long)wave_points->prev_r_idx);
+
+  /* print intervals */
+  osal_printf("Intervals: PR=%d ms, QRS=%d ms, QT=%d ms\n", (int)wave_intervals->pr_interval,
+              (int)wave_intervals->qrs_duration, (int)wave_intervals->qt_interval);
+  osal_printf("Intervals: RR=%d ms, PP=%d ms\n", (int)wave_intervals->rr_interval, (int)wave_intervals->pp_interval);
+
+  /* print quality and heart rate */
+  osal_printf("Quality=%d, Heart rate=%d\n", result->quality, (int)ecg_calculate_heart_rate(wave_intervals));
+  osal_flush();
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+uint8_t ecg_app_init(const ecg_app_config_t* config)
+{
+  g_config = *config;
+  if (g_config.frame_size == 0 || g_config.frame_size > BUFFER_SIZE) {
+    g_config.frame_size = FRAME_SIZE;
+  }
+
+  arena_init(&g_arena, g_arena_block, sizeof(g_arena_block));
+  if (!ecg_channel_init(&g_channel, 0, &g_arena)) {
+    return 0;
+  }
+  ecg_wave_result_t* beat_slots = (ecg_wave_result_t*)arena_alloc(&g_arena, BEAT_RING_SIZE * sizeof(ecg_wave_result_t));
+  if (!beat_slots) {
+    return 0;
+  }
+  arena_seal(&g_arena);
+  if (g_config.stages && !ecg_channel_set_preprocess(&g_channel, g_config.stages, g_config.num_stages)) {
+    osal_printf("preprocessing chain does not fit %d Hz, using the baseline wander filter\n", SAMPLE_FREQ);
+  }
+  /* QRS_IN is looped, the filter restarts at its loop point */
+  ecg_channel_set_filter_restart(&g_channel, 1);
+  ecg_channel_set_sqi(&g_channel, g_config.min_sqi);
+  ecg_metrics_init();
+
+  /* the logger is a drop oldest subscriber - console I/O may fall behind, detection does not wait for it */
+  beat_ring_init(&g_beats, beat_slots, BEAT_RING_SIZE);
+  if (g_config.log_results) {
+    beat_ring_subscribe(&g_beats, BEAT_RING_DROP_OLDEST, &g_logger_id);
+  }
+
+  osal_atomic_store_relaxed(&g_stats.samples_pushed, 0);
+  osal_atomic_store_relaxed(&g_stats.samples_filtered, 0);
+  osal_atomic_store_relaxed(&g_stats.waves_posted, 0);
+  osal_atomic_store_relaxed(&g_stats.waves_detected, 0);
+  osal_atomic_store_relaxed(&g_stats.waves_accepted, 0);
+  osal_atomic_store_relaxed(&g_stats.beats_published, 0);
+  osal_atomic_store_relaxed(&g_stats.beats_stalled, 0);
+  osal_atomic_store_relaxed(&g_stop_requested, 0);
+  osal_atomic_store_relaxed(&g_preprocessing_done, 0);
+  return 1;
+}
+
+void ecg_app_push_sample(float sample)
+{
+  ECG_PROBE_START(start);
+
+  /* write into the lock-free input ring - a full ring drops the sample and counts an overrun */
+  if (!ecg_channel_push_sample(&g_channel, sample)) {
+    ECG_METRICS_COUNT(ECG_COUNTER_SAMPLES_DROPPED, 1);
+    return;
+  }
+  /* signal once a frame is complete */
+  if (counter_add(&g_stats.samples_pushed, 1) % g_config.frame_size == 0) {
+    osal_sem_post(g_config.sample_ready_sem);
+  }
+  ECG_PROBE_STOP(ECG_STAGE_SAMPLE_ISR, start);
+}
+
+/*!
+ * conditions the raw ecg signal through high pass filtering of baseline wander noise
+ * runs continuously to process incoming samples and prepare them for feature detection.
+ *
+ * at the 80Hz sampling rate of the board the powerline noise at 50 Hz is aliased and
+ * according to FFT magnitude there are no aliased frequencies above 40 Hz, so the baseline
+ * wander filter is enough. inputs at 250-1000 Hz carry the 50/60 Hz line and EMG noise -
+ * config.stages adds a notch and a low-pass (and the detector's derivative, squaring and
+ * integrator) as one fused pass per frame, see ecg_channel_set_preprocess().
+ */
+void ecg_app_preprocessing_task(void)
+{
+  while (1) {
+    /* wait for signal that a new frame is ready */
+    osal_sem_pend(g_config.sample_ready_sem, OSAL_WAIT_FOREVER);
+    ECG_METRICS_COUNT(ECG_COUNTER_PREPROCESS_WAKEUPS, 1);
+    ECG_METRICS_GAUGE(ECG_GAUGE_INPUT_RING, ecg_channel_pending(&g_channel));
+
+    /* every complete frame in the input ring - after a stop request also the partial last frame */
+    uint32_t frames = 0;
+    while (1) {
+      uint32_t pending = ecg_channel_pending(&g_channel);
+      if (pending == 0 || (pending < g_config.frame_size && !osal_atomic_load_acquire(&g_stop_requested))) {
+        break;
+      }
+      ECG_PROBE_START(start);
+
+      /* apply baseline wander filter to the whole frame */
+      uint32_t filtered = g_channel.stats.samples_filtered;
+      uint32_t beats_dropped = g_channel.stats.beats_dropped;
+      uint8_t beats_ready = ecg_channel_preprocess_frame(&g_channel, (uint16_t)MIN(pending, g_config.frame_size));
+      counter_add(&g_stats.samples_filtered, g_channel.stats.samples_filtered - filtered);
+
+      /* one post per beat whose samples are all filtered */
+      for (; beats_ready > 0; beats_ready--) {
+        counter_add(&g_stats.waves_posted, 1);
+        osal_sem_post(g_config.wave_ready_sem);
+      }
+
+      /* every frame after the first of a wakeup was already waiting - the task is behind the timer */
+      ECG_METRICS_COUNT(ECG_COUNTER_FRAMES, 1);
+      ECG_METRICS_COUNT(ECG_COUNTER_FRAMES_LATE, frames > 0);
+      ECG_METRICS_COUNT(ECG_COUNTER_BEATS_DROPPED, g_channel.stats.beats_dropped - beats_dropped);
+      ECG_PROBE_STOP(ECG_STAGE_PREPROCESS, start);
+      frames++;
+    }
+
+    /* the producer pushed its last sample and everything is filtered */
+    if (osal_atomic_load_acquire(&g_stop_requested) &&
+        osal_atomic_load_relaxed(&g_stats.samples_filtered) == osal_atomic_load_acquire(&g_stats.samples_pushed)) {
+      break;
+    }
+  }
+
+  /* wake up the feature detection task so it can drain and return too */
+  osal_atomic_store_release(&g_preprocessing_done, 1);
+  osal_sem_post(g_config.wave_ready_sem);
+}
+
+/*!
+ * enteres each beat found by the streaming qrs detector and detects key ecg wave components and measures their timing
+ * processes one beat per wakeup, around the r peak the preprocessing task located
+ * to find p, q, s, and t waves and calculates important cardiac intervals
+ *
+ * processing steps:
+ * 1. collects the filtered samples around the r peak
+ * 2. finds wave peaks and valleys
+ * 3. calculates timing between waves
+ * 4. checks detection quality
+ * 5. publishes the wave to the subscribers - logging and other sinks run at their own pace
+ */
+void ecg_app_feature_detect_task(void)
+{
+  ecg_wave_result_t result; /* points, intervals and quality of the curr wave */
+
+  while (1) {
+    /* wait for filtered sample from signal conditioning task */
+    osal_sem_pend(g_config.wave_ready_sem, OSAL_WAIT_FOREVER);
+    ECG_METRICS_COUNT(ECG_COUNTER_FEATURE_WAKEUPS, 1);
+    ECG_METRICS_GAUGE(ECG_GAUGE_WAVE_BACKLOG, osal_atomic_load_acquire(&g_stats.waves_posted) -
+                                                  osal_atomic_load_relaxed(&g_stats.waves_detected));
+
+    /* the post following the last wave only wakes us up to return */
+    if (osal_atomic_load_acquire(&g_preprocessing_done) &&
+        osal_atomic_load_relaxed(&g_stats.waves_detected) == osal_atomic_load_acquire(&g_stats.waves_posted)) {
+      break;
+    }
+    ECG_PROBE_START(start);
+
+    /* perform PQRST detection, calculate intervals and validate detection */
+    uint8_t quality = ecg_channel_detect(&g_channel, &result);
+    counter_add(&g_stats.waves_detected, 1);
+    if (quality >= MIN_WAVE_QUALITY) {
+      counter_add(&g_stats.waves_accepted, 1);
+    }
+    ECG_PROBE_STOP(ECG_STAGE_FEATURE_DETECT, start);
+
+    /* every wave goes to the subscribers, the quality is part of the result. a backpressure
+     * subscriber a whole ring behind holds the task until it read a wave - the beat queue of
+     * the channel buffers the beats found meanwhile */
+    uint8_t published = beat_ring_publish(&g_beats, &result);
+    while (!published) {
+      counter_add(&g_stats.beats_stalled, 1);
+      ECG_METRICS_COUNT(ECG_COUNTER_BEATS_STALLED, 1);
+      if (!g_config.beat_space_sem) {
+        break;
+      }
+      osal_sem_pend(g_config.beat_space_sem, OSAL_WAIT_FOREVER);
+      published = beat_ring_publish(&g_beats, &result);
+    }
+    counter_add(&g_stats.beats_published, published);
+    ECG_METRICS_GAUGE(ECG_GAUGE_BEAT_LAG, beat_ring_lag(&g_beats));
+    if (g_config.beat_ready_sem) {
+      osal_sem_post(g_config.beat_ready_sem);
+    }
+  }
+
+  /* wake up the logger so it can drain and return too */
+  beat_ring_close(&g_beats);
+  if (g_config.beat_ready_sem) {
+    osal_sem_post(g_config.beat_ready_sem);
+  }
+}
+
+/*!
+ * prints the waves of good quality published by the feature detection task
+ * runs at its own pace - a logger a whole ring behind loses the oldest waves
+ * instead of stalling the detection.
+ */
+void ecg_app_logger_task(void)
+{
+  ecg_wave_result_t result;
+
+  if (!g_config.log_results) {
+    return;
+  }
+  while (1) {
+    /* one post per published wave, the drain below may already have read it */
+    if (g_config.beat_ready_sem) {
+      osal_sem_pend(g_config.beat_ready_sem, OSAL_WAIT_FOREVER);
+    }
+    uint8_t done = beat_ring_closed(&g_beats);
+    while (beat_ring_read(&g_beats, g_logger_id, &result)) {
+      if (result.quality >= MIN_WAVE_QUALITY) {
+        log_wave(&result);
+      }
+    }
+    if (done) {
+      break;
+    }
+    /* without a semaphore the logger polls */
+    if (!g_config.beat_ready_sem) {
+      osal_sleep_until_ns(osal_time_ns() + 1000000ull);
+    }
+  }
+}
+
+uint8_t ecg_app_subscribe(beat_ring_policy_t policy, uint32_t* id)
+{
+  return beat_ring_subscribe(&g_beats, policy, id);
+}
+
+uint8_t ecg_app_read_beat(uint32_t id, ecg_wave_result_t* result)
+{
+  if (!beat_ring_read(&g_beats, id, result)) {
+    return 0;
+  }
+  /* the producer may be waiting for this slot */
+  if (g_beats.subs[id].policy == BEAT_RING_BACKPRESSURE && g_config.beat_space_sem) {
+    osal_sem_post(g_config.beat_space_sem);
+  }
+  return 1;
+}
+
+uint8_t ecg_app_beats_done(void)
+{
+  return beat_ring_closed(&g_beats);
+}
+
+void ecg_app_get_beat_stats(uint32_t id, beat_ring_stats_t* stats)
+{
+  beat_ring_get_stats(&g_beats, id, stats);
+}
+
+void ecg_app_stop(void)
+{
+  osal_atomic_store_release(&g_stop_requested, 1);
+  osal_sem_post(g_config.sample_ready_sem);
+}
+
+void ecg_app_get_stats(ecg_app_stats_t* stats)
+{
+  stats->samples_pushed = osal_atomic_load_acquire(&g_stats.samples_pushed);
+  stats->samples_dropped = spsc_ring_overruns(&g_channel.input);
+  stats->samples_filtered = osal_atomic_load_acquire(&g_stats.samples_filtered);
+  stats->waves_posted = osal_atomic_load_acquire(&g_stats.waves_posted);
+  stats->waves_detected = osal_atomic_load_acquire(&g_stats.waves_detected);
+  stats->waves_accepted = osal_atomic_load_acquire(&g_stats.waves_accepted);
+  stats->beats_published = osal_atomic_load_acquire(&g_stats.beats_published);
+  stats->beats_stalled = osal_atomic_load_acquire(&g_stats.beats_stalled);
+}
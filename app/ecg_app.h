@@ -0,0 +1,142 @@
+#ifndef ECG_APP_H
+#define ECG_APP_H
+
+#include <stdint.h>
+
+#include "osal/osal.h"
+#include "channel/ecg_channel.h"
+#include "channel/beat_ring.h"
+#include "filters/preprocess.h"
+
+/* application configuration passed in by the platform entry point */
+typedef struct {
+  osal_sem_t sample_ready_sem;  /* posted by the sampling ISR for every complete frame */
+  osal_sem_t wave_ready_sem;    /* posted by preprocessing for every filtered wave */
+  uint16_t frame_size;          /* samples filtered per preprocessing wakeup (1..BUFFER_SIZE) */
+  osal_sem_t beat_ready_sem;    /* posted for every published beat, wakes the logger task (may be NULL) */
+  osal_sem_t beat_space_sem;    /* posted by backpressure subscribers, NULL drops the beats they refuse */
+  uint8_t log_results;          /* print detected waves to the console (logger task) */
+  const preprocess_stage_t* stages; /* preprocessing chain, NULL for the baseline wander filter */
+  uint8_t num_stages;           /* stages in the chain */
+  uint8_t min_sqi;              /* beats of blocks below this signal quality are not delineated, 0 without SQI */
+} ecg_app_config_t;
+
+/* pipeline counters - written by the tasks, read by the platform code */
+typedef struct {
+  uint32_t samples_pushed;      /* samples written by the sampling ISR */
+  uint32_t samples_dropped;     /* samples lost because the input ring was full */
+  uint32_t samples_filtered;    /* samples processed by the preprocessing task */
+  uint32_t waves_posted;        /* waves signaled to the feature detection task */
+  uint32_t waves_detected;      /* waves processed by the feature detection task */
+  uint32_t waves_accepted;      /* waves with quality >= 80 */
+  uint32_t beats_published;     /* waves published to the subscribers */
+  uint32_t beats_stalled;       /* publishes refused by a backpressure subscriber (retried or dropped) */
+} ecg_app_stats_t;
+
+/*!
+ * @brief Init the ECG application
+ *
+ * must be called before the sampling ISR or any of the tasks are started.
+ *
+ * @param config - semaphores and options used by the tasks
+ * @return 1 on success, 0 if the channel or the beat ring slots do not fit the arena
+ */
+uint8_t ecg_app_init(const ecg_app_config_t* config);
+
+/*!
+ * @brief Push a new raw ECG sample into the pipeline
+ *
+ * body of the sampling ISR: stores the sample in the lock-free input ring and
+ * signals the preprocessing task once a frame of frame_size samples is complete.
+ * kept short since it runs in interrupt context.
+ *
+ * @param sample - raw ECG sample in V
+ */
+void ecg_app_push_sample(float sample);
+
+/*!
+ * @brief ECG preprocessing task body
+ *
+ * filters every frame signaled by ecg_app_push_sample() in one block and signals the
+ * feature detection task once a complete wave is filtered.
+ * returns only after ecg_app_stop() was called and all pushed samples were filtered.
+ */
+void ecg_app_preprocessing_task(void);
+
+/*!
+ * @brief ECG feature detection task body
+ *
+ * detects PQRST points of every filtered wave, calculates the intervals and
+ * publishes the wave to the subscribers of the beat ring.
+ * returns only after the preprocessing task returned and all waves were published.
+ */
+void ecg_app_feature_detect_task(void);
+
+/*!
+ * @brief ECG logger task body
+ *
+ * prints the waves of good quality as a drop oldest subscriber of the beat ring,
+ * so slow console I/O never stalls the detection. returns right away without
+ * config.log_results, otherwise after the feature detection task returned and
+ * every beat was read.
+ */
+void ecg_app_logger_task(void);
+
+/*!
+ * @brief Subscribe to the detected waves
+ *
+ * must be called after ecg_app_init() and before the tasks are started.
+ * a backpressure subscriber stalls the feature detection task while it is a
+ * whole ring (BEAT_RING_SIZE waves) behind, so it should only be used with
+ * config.beat_space_sem and for sinks that must not lose waves (e.g. a beat file).
+ *
+ * @param policy - what happens when the subscriber falls a whole ring behind
+ * @param id     - filled with the subscriber id
+ * @return 1 on success, 0 if there are no free subscriber slots
+ */
+uint8_t ecg_app_subscribe(beat_ring_policy_t policy, uint32_t* id);
+
+/*!
+ * @brief Read the next wave of a subscriber
+ *
+ * never blocks - poll, or wait on a semaphore of your own.
+ *
+ * @param id     - subscriber id
+ * @param result - filled with the wave
+ * @return 1 if a wave was read, 0 if the subscriber is up to date
+ */
+uint8_t ecg_app_read_beat(uint32_t id, ecg_wave_result_t* result);
+
+/*!
+ * @brief Check if every wave was published
+ *
+ * check before ecg_app_read_beat() - done and nothing read means the subscriber saw every wave.
+ *
+ * @return 1 after the feature detection task returned
+ */
+uint8_t ecg_app_beats_done(void);
+
+/*!
+ * @brief Get the lag metrics of a subscriber
+ *
+ * @param id    - subscriber id
+ * @param stats - pointer to the stats structure to fill
+ */
+void ecg_app_get_beat_stats(uint32_t id, beat_ring_stats_t* stats);
+
+/*!
+ * @brief Request the tasks to finish
+ *
+ * called by the producer after its last ecg_app_push_sample(). the target
+ * build never stops, this is used by the host build to drain the pipeline.
+ */
+void ecg_app_stop(void);
+
+/*!
+ * @brief Get a copy of the pipeline counters
+ *
+ * @param stats - pointer to the stats structure to fill
+ */
+void ecg_app_get_stats(ecg_app_stats_t* stats);
+
+#endif /* ECG_APP_H */
@@ -0,0 +1,400 @@
+#include "ecg_batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_CHUNK_FRAMES 4096  /* samples decoded per ecg_channel_process() call */
+#define ZERO_PHASE_CHUNK_MIN 16384  /* smallest zero-phase chunk, the overlap is filtered twice per chunk */
+#define ZERO_PHASE_CHUNK_OVERLAPS 8 /* chunk length in overlaps - keeps the recomputed part below 25% */
+
+/* job shared by the pool threads */
+typedef struct {
+  ecg_channel_t* channels;
+  const ecg_batch_input_t* inputs;
+  ecg_wave_result_fn on_result;
+  void* user;
+} batch_job_t;
+
+/* record job - one channel per signal of the record */
+typedef struct {
+  ecg_channel_t* channels;
+  const ecg_record_t* record;
+  ecg_wave_result_fn on_result;
+  void* user;
+} record_job_t;
+
+/* zero-phase job - one window of every signal */
+typedef struct {
+  ecg_channel_t* channels;
+  const ecg_record_t* record;
+  const zero_phase_t* zp;
+  float* window;              /* filtered window of signal i at window[i * window_frames] */
+  float* scratch;             /* scratch_floats per (signal, chunk) item */
+  uint64_t scratch_floats;    /* zero_phase_scratch_floats() of a chunk */
+  uint64_t window_frames;     /* capacity of a signal window */
+  uint64_t first;             /* first frame of the current window */
+  uint64_t num_frames;        /* frames in the current window */
+  uint32_t chunk_frames;      /* frames per chunk */
+  uint32_t num_chunks;        /* chunks per signal window */
+  ecg_wave_result_fn on_result;
+  void* user;
+} zero_phase_job_t;
+
+/* one time shard of one signal */
+typedef struct {
+  ecg_channel_t seam;         /* state at the first sample of the shard, after the warm-up */
+  ecg_channel_t channel;      /* state at the end of the shard */
+  uint64_t first;             /* first frame of the shard */
+  uint64_t last;              /* frame after the shard */
+  ecg_wave_result_t* results; /* waves of the shard, in order */
+  uint32_t num_results;
+  uint32_t max_results;       /* allocated results */
+  uint8_t failed;             /* results could not be grown */
+  uint8_t rerun;              /* run again from the previous shard in the merge */
+} shard_t;
+
+/* sharded job - shard k of signal i at shards[i * num_shards + k] */
+typedef struct {
+  ecg_channel_t* channels;
+  const ecg_record_t* record;
+  shard_t* shards;
+  uint32_t num_shards;
+  uint64_t warmup_frames;
+  ecg_wave_result_fn on_result;
+  void* user;
+} sharded_job_t;
+
+/* zero_phase_read_fn over one signal of a record */
+typedef struct {
+  const ecg_record_t* record;
+  uint16_t signal;
+} signal_reader_t;
+
+static uint32_t read_signal(void* user, uint64_t first, float* out, uint32_t count)
+{
+  signal_reader_t* reader = (signal_reader_t*)user;
+  return ecg_record_read(reader->record, reader->signal, first, out, count);
+}
+
+static void process_channels(void* ctx, uint32_t begin, uint32_t end)
+{
+  batch_job_t* job = (batch_job_t*)ctx;
+  uint32_t i = begin;
+
+  for (; i < end; i++) {
+    ecg_channel_process(&job->channels[i], job->inputs[i].samples, job->inputs[i].num_samples,
+                        job->on_result, job->user);
+  }
+}
+
+/* runs frames [first, last) of one signal through a channel */
+static void process_signal_frames(ecg_channel_t* channel, const ecg_record_t* record, uint16_t signal,
+                                  uint64_t first, uint64_t last, ecg_wave_result_fn on_result, void* user)
+{
+  float chunk[RECORD_CHUNK_FRAMES];
+  uint64_t frame = first;
+
+  while (frame < last) {
+    /* mapped float data is fed in place, everything else is decoded one chunk at a time */
+    const float* samples = ecg_record_view(record, frame);
+    uint32_t n = (uint32_t)MIN(last - frame, (uint64_t)RECORD_CHUNK_FRAMES);
+    if (!samples) {
+      n = ecg_record_read(record, signal, frame, chunk, n);
+      samples = chunk;
+    }
+    if (n == 0) {
+      break;
+    }
+    ecg_channel_process(channel, samples, n, on_result, user);
+    frame += n;
+  }
+}
+
+static void process_record_signals(void* ctx, uint32_t begin, uint32_t end)
+{
+  record_job_t* job = (record_job_t*)ctx;
+  uint32_t i = begin;
+
+  for (; i < end; i++) {
+    process_signal_frames(&job->channels[i], job->record, (uint16_t)i, 0, job->record->num_frames, job->on_result,
+                          job->user);
+  }
+}
+
+/* ecg_wave_result_fn - buffers the waves of a shard until its seam is verified */
+static void collect_shard_result(void* user, const ecg_wave_result_t* result)
+{
+  shard_t* shard = (shard_t*)user;
+
+  if (shard->num_results == shard->max_results) {
+    uint32_t max_results = shard->max_results ? 2 * shard->max_results : 1024;
+    ecg_wave_result_t* results = (ecg_wave_result_t*)realloc(shard->results, max_results * sizeof(*results));
+    if (!results) {
+      shard->failed = 1;
+      return;
+    }
+    shard->results = results;
+    shard->max_results = max_results;
+  }
+  shard->results[shard->num_results++] = *result;
+}
+
+/* runs a shard from a copy of the state at its first sample */
+static void run_shard(shard_t* shard, const ecg_record_t* record, uint16_t signal, const ecg_channel_t* start)
+{
+  ecg_channel_copy(&shard->channel, start);
+  shard->num_results = 0;
+  process_signal_frames(&shard->channel, record, signal, shard->first, shard->last, collect_shard_result, shard);
+}
+
+static void process_shards(void* ctx, uint32_t begin, uint32_t end)
+{
+  sharded_job_t* job = (sharded_job_t*)ctx;
+  uint32_t item = begin;
+
+  for (; item < end; item++) {
+    shard_t* shard = &job->shards[item];
+    uint16_t signal = (uint16_t)(item / job->num_shards);
+    ecg_channel_t* channel = &job->channels[signal];
+    uint64_t warmup = 0;
+
+    /* warm up from a fresh channel on the filtered ring grid, the filter restarts there in a serial run too */
+    ecg_channel_copy(&shard->seam, channel);
+    if (shard->first > job->warmup_frames) {
+      warmup = shard->first - job->warmup_frames;
+      warmup -= warmup % channel->filtered_size;
+    }
+    ecg_channel_seek(&shard->seam, warmup);
+    process_signal_frames(&shard->seam, job->record, signal, warmup, shard->first, NULL, NULL);
+
+    run_shard(shard, job->record, signal, &shard->seam);
+  }
+}
+
+/* adds the counters of a shard, from its first sample to its end */
+static void add_shard_stats(ecg_channel_stats_t* total, const shard_t* shard)
+{
+  total->samples_pushed += shard->channel.stats.samples_pushed - shard->seam.stats.samples_pushed;
+  total->samples_filtered += shard->channel.stats.samples_filtered - shard->seam.stats.samples_filtered;
+  total->beats_dropped += shard->channel.stats.beats_dropped - shard->seam.stats.beats_dropped;
+  total->waves_detected += shard->channel.stats.waves_detected - shard->seam.stats.waves_detected;
+  total->waves_accepted += shard->channel.stats.waves_accepted - shard->seam.stats.waves_accepted;
+  total->blocks_scored += shard->channel.stats.blocks_scored - shard->seam.stats.blocks_scored;
+  total->blocks_unusable += shard->channel.stats.blocks_unusable - shard->seam.stats.blocks_unusable;
+  total->beats_skipped += shard->channel.stats.beats_skipped - shard->seam.stats.beats_skipped;
+  total->beats_late += shard->channel.stats.beats_late - shard->seam.stats.beats_late;
+}
+
+static void merge_shards(void* ctx, uint32_t begin, uint32_t end)
+{
+  sharded_job_t* job = (sharded_job_t*)ctx;
+  uint32_t i = begin;
+
+  for (; i < end; i++) {
+    ecg_channel_t* channel = &job->channels[i];
+    shard_t* shards = &job->shards[i * job->num_shards];
+    ecg_channel_stats_t total = channel->stats;
+    uint32_t wave = channel->curr_wave;
+    uint32_t k = 0;
+    uint32_t r = 0;
+
+    for (k = 0; k < job->num_shards; k++) {
+      shard_t* shard = &shards[k];
+
+      /* a seam is exact when the warm-up reached the state the previous shard ended in */
+      if (k > 0 && !ecg_channel_same_state(&shards[k - 1].channel, &shard->seam)) {
+        ecg_channel_copy(&shard->seam, &shards[k - 1].channel);
+        run_shard(shard, job->record, (uint16_t)i, &shard->seam);
+        shard->rerun = 1;
+      }
+      if (shard->failed) {
+        break;
+      }
+
+      /* the wave numbers continue across the seam */
+      for (r = 0; r < shard->num_results; r++) {
+        shard->results[r].wave = wave++;
+        if (job->on_result) {
+          job->on_result(job->user, &shard->results[r]);
+        }
+      }
+      add_shard_stats(&total, shard);
+    }
+
+    /* the channel ends like after a serial run */
+    if (k == job->num_shards) {
+      ecg_channel_copy(channel, &shards[k - 1].channel);
+      channel->stats = total;
+      channel->curr_wave = wave;
+    }
+  }
+}
+
+
+static void filter_window_chunks(void* ctx, uint32_t begin, uint32_t end)
+{
+  zero_phase_job_t* job = (zero_phase_job_t*)ctx;
+  uint32_t item = begin;
+
+  /* items are (signal, chunk) pairs, the chunk recomputes its edge states from the overlap */
+  for (; item < end; item++) {
+    signal_reader_t reader = { job->record, (uint16_t)(item / job->num_chunks) };
+    uint64_t offset = (uint64_t)(item % job->num_chunks) * job->chunk_frames;
+    if (offset >= job->num_frames) {
+      continue;
+    }
+    uint32_t n = (uint32_t)MIN(job->num_frames - offset, (uint64_t)job->chunk_frames);
+    zero_phase_filter(job->zp, read_signal, &reader, job->record->num_frames, job->first + offset, n,
+                      &job->scratch[item * job->scratch_floats],
+                      &job->window[reader.signal * job->window_frames + offset]);
+  }
+}
+
+static void detect_window(void* ctx, uint32_t begin, uint32_t end)
+{
+  zero_phase_job_t* job = (zero_phase_job_t*)ctx;
+  uint32_t i = begin;
+
+  for (; i < end; i++) {
+    ecg_channel_process(&job->channels[i], &job->window[i * job->window_frames], (uint32_t)job->num_frames,
+                        job->on_result, job->user);
+  }
+}
+
+void ecg_batch_run(thread_pool_t* pool, ecg_channel_t* channels, const ecg_batch_input_t* inputs,
+                   uint32_t num_channels, ecg_wave_result_fn on_result, void* user)
+{
+  batch_job_t job;
+  job.channels = channels;
+  job.inputs = inputs;
+  job.on_result = on_result;
+  job.user = user;
+
+  /* one channel per range - channels are coarse enough that finer
+   * splitting is never needed and stealing evens out different lengths */
+  thread_pool_parallel_for(pool, num_channels, 1, process_channels, &job);
+}
+
+void ecg_batch_run_record(thread_pool_t* pool, ecg_channel_t* channels, const ecg_record_t* record,
+                          ecg_wave_result_fn on_result, void* user)
+{
+  record_job_t job;
+  job.channels = channels;
+  job.record = record;
+  job.on_result = on_result;
+  job.user = user;
+
+  /* one signal per range - every thread reads its own signal out of the shared mapping */
+  thread_pool_parallel_for(pool, record->num_signals, 1, process_record_signals, &job);
+}
+
+uint8_t ecg_batch_run_record_zero_phase(thread_pool_t* pool, ecg_channel_t* channels, const ecg_record_t* record,
+                                        const zero_phase_t* zp, ecg_wave_result_fn on_result, void* user)
+{
+  zero_phase_job_t job;
+  uint32_t num_threads = thread_pool_size(pool);
+  uint16_t i = 0;
+
+  job.channels = channels;
+  job.record = record;
+  job.zp = zp;
+  job.chunk_frames = (uint32_t)MIN(MAX((uint64_t)zp->overlap * ZERO_PHASE_CHUNK_OVERLAPS,
+                                       (uint64_t)ZERO_PHASE_CHUNK_MIN), (uint64_t)UINT32_MAX / 2);
+  /* enough chunks per window for two per thread, so stealing evens out the last ones */
+  job.num_chunks = (2 * num_threads + record->num_signals - 1) / record->num_signals;
+  job.window_frames = (uint64_t)job.chunk_frames * job.num_chunks;
+  job.on_result = on_result;
+  job.user = user;
+  job.scratch_floats = zero_phase_scratch_floats(zp, job.chunk_frames);
+  job.window = (float*)malloc(record->num_signals * job.window_frames * sizeof(float));
+  job.scratch = (float*)malloc(record->num_signals * job.num_chunks * job.scratch_floats * sizeof(float));
+  if (!job.window || !job.scratch) {
+    free(job.window);
+    free(job.scratch);
+    return 0;
+  }
+
+  for (i = 0; i < record->num_signals; i++) {
+    ecg_channel_set_prefiltered(&channels[i], 1);
+  }
+
+  /* windows in order, the channels carry their detector state from one to the next */
+  for (job.first = 0; job.first < record->num_frames; job.first += job.num_frames) {
+    job.num_frames = MIN(record->num_frames - job.first, job.window_frames);
+    thread_pool_parallel_for(pool, record->num_signals * job.num_chunks, 1, filter_window_chunks, &job);
+    thread_pool_parallel_for(pool, record->num_signals, 1, detect_window, &job);
+  }
+  free(job.window);
+  free(job.scratch);
+  return 1;
+}
+
+uint8_t ecg_batch_run_record_sharded(thread_pool_t* pool, ecg_channel_t* channels, const ecg_record_t* record,
+                                     uint32_t num_shards, uint64_t warmup_frames, ecg_wave_result_fn on_result,
+                                     void* user, ecg_shard_stats_t* stats)
+{
+  sharded_job_t job;
+  arena_t arena;
+  uint32_t num_items = 0;
+  uint32_t item = 0;
+  uint8_t failed = 0;
+
+  /* a shard shorter than its warm-up costs more than it saves */
+  num_shards = (uint32_t)MIN((uint64_t)num_shards, record->num_frames / MAX(warmup_frames, 1));
+  num_shards = MAX(num_shards, 1);
+  num_items = record->num_signals * num_shards;
+
+  job.channels = channels;
+  job.record = record;
+  job.num_shards = num_shards;
+  job.warmup_frames = warmup_frames;
+  job.on_result = on_result;
+  job.user = user;
+
+  /* the shards and the buffers of their two channels come out of one zeroed block */
+  if (!arena_create(&arena, ARENA_ROUND((uint64_t)num_items * sizeof(shard_t)) +
+                              2 * (uint64_t)num_items * ECG_CHANNEL_STORAGE(record->sample_freq), 0)) {
+    return 0;
+  }
+  job.shards = (shard_t*)arena_alloc(&arena, (uint64_t)num_items * sizeof(shard_t));
+  for (item = 0; item < num_items; item++) {
+    uint32_t k = item % num_shards;
+    shard_t* shard = &job.shards[item];
+    shard->first = record->num_frames * k / num_shards;
+    shard->last = record->num_frames * (k + 1) / num_shards;
+    ecg_channel_init_rate(&shard->seam, 0, record->sample_freq, &arena);
+    ecg_channel_init_rate(&shard->channel, 0, record->sample_freq, &arena);
+  }
+  arena_seal(&arena);
+
+  /* shards of all signals at once, the first shard of a signal is the start of a serial run */
+  thread_pool_parallel_for(pool, num_items, 1, process_shards, &job);
+  for (item = 0; item < num_items; item++) {
+    failed |= job.shards[item].failed;
+  }
+
+  /* seams in order per signal - a rerun only delays the shards behind it */
+  if (!failed) {
+    thread_pool_parallel_for(pool, record->num_signals, 1, merge_shards, &job);
+    for (item = 0; item < num_items; item++) {
+      failed |= job.shards[item].failed;
+    }
+  }
+
+  if (stats) {
+    stats->num_shards = num_shards;
+    stats->seams_exact = 0;
+    stats->seams_rerun = 0;
+    for (item = 0; item < num_items; item++) {
+      if (item % num_shards > 0) {
+        stats->seams_exact += !job.shards[item].rerun;
+        stats->seams_rerun += job.shards[item].rerun;
+      }
+    }
+  }
+  for (item = 0; item < num_items; item++) {
+    free(job.shards[item].results);
+  }
+  arena_destroy(&arena);
+  return !failed;
+}
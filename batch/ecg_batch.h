@@ -0,0 +1,116 @@
+#ifndef ECG_BATCH_H
+#define ECG_BATCH_H
+
+#include <stdint.h>
+
+#include "channel/ecg_channel.h"
+#include "filters/zero_phase.h"
+#include "io/ecg_record.h"
+#include "sched/thread_pool.h"
+
+/* warm-up in front of every shard of ecg_batch_run_record_sharded() - a few
+ * hundred beats, the adaptive levels forget their start by 0.875 per beat */
+#define ECG_SHARD_WARMUP_S 300
+
+/* raw samples of one channel */
+typedef struct {
+  const float* samples;   /* raw ECG samples in V */
+  uint32_t num_samples;   /* number of samples */
+} ecg_batch_input_t;
+
+/*!
+ * @brief Process many channels concurrently
+ *
+ * shards the channels across the pool threads - every channel is processed
+ * start to end by a single thread, since its filter and detector state is
+ * sequential, and different channels share nothing so no locking is needed.
+ *
+ * @param pool         - thread pool to run on
+ * @param channels     - initialized channel contexts, one per input
+ * @param inputs       - raw samples of every channel
+ * @param num_channels - number of channels
+ * @param on_result    - called for every detected wave from the pool threads (may be NULL)
+ * @param user         - user pointer passed to on_result
+ */
+void ecg_batch_run(thread_pool_t* pool, ecg_channel_t* channels, const ecg_batch_input_t* inputs,
+                   uint32_t num_channels, ecg_wave_result_fn on_result, void* user);
+
+/*!
+ * @brief Process every signal of a mapped record concurrently
+ *
+ * like ecg_batch_run() with one channel per signal. the samples are decoded
+ * from the mapping in chunks straight into the channel pipeline, so the record
+ * is never loaded into the heap.
+ *
+ * @param pool      - thread pool to run on
+ * @param channels  - initialized channel contexts, one per record signal
+ * @param record    - opened record
+ * @param on_result - called for every detected wave from the pool threads (may be NULL)
+ * @param user      - user pointer passed to on_result
+ */
+void ecg_batch_run_record(thread_pool_t* pool, ecg_channel_t* channels, const ecg_record_t* record,
+                          ecg_wave_result_fn on_result, void* user);
+
+/*!
+ * @brief Process a mapped record with zero-phase filtering
+ *
+ * offline mode for morphology: the baseline wander filter runs forward and
+ * backward, so Q/S/T keep their position and the PR/QT intervals are not
+ * skewed by the filter phase. the record is filtered in windows of a few chunks
+ * per signal - the chunks of a window (of all signals) are filtered
+ * concurrently with their overlap read from the mapping, then every channel
+ * detects its window on one thread. memory stays at one window per signal
+ * plus the chunk scratch, whatever the record length.
+ *
+ * @param pool      - thread pool to run on
+ * @param channels  - initialized channel contexts, one per record signal - switched to prefiltered input
+ * @param record    - opened record
+ * @param zp        - zero-phase filter, usually the baseline wander filter of the channels
+ * @param on_result - called for every detected wave from the pool threads (may be NULL)
+ * @param user      - user pointer passed to on_result
+ * @return 1 on success, 0 if the window and scratch buffers cannot be allocated
+ */
+uint8_t ecg_batch_run_record_zero_phase(thread_pool_t* pool, ecg_channel_t* channels, const ecg_record_t* record,
+                                        const zero_phase_t* zp, ecg_wave_result_fn on_result, void* user);
+
+/* seams of a sharded run */
+typedef struct {
+  uint32_t num_shards;    /* shards per signal actually used */
+  uint32_t seams_exact;   /* seams where the warmed up state matched the previous shard */
+  uint32_t seams_rerun;   /* seams whose shard was run again from the previous shard */
+} ecg_shard_stats_t;
+
+/*!
+ * @brief Process a mapped record with every signal split into time shards
+ *
+ * for long recordings with fewer signals than threads. the shards of all
+ * signals run concurrently: every shard starts on a copy of its channel
+ * warmup_frames in front of its first sample (rounded down to the extended
+ * buffer), runs the filter and detector through the warm-up without reporting
+ * and snapshots the state at its first sample. the merge then walks the shards
+ * of a signal in order - where the snapshot is bit for bit the end state of
+ * the previous shard (ecg_channel_same_state()) the shard results are taken
+ * as they are, otherwise the shard is run again from the end state of the
+ * previous one. so every beat at a seam is reported once, its RR and PP come
+ * from the previous shard and the results, the wave numbers and the counters
+ * are identical to ecg_batch_run_record().
+ *
+ * the results of a shard are buffered until its seam is verified and
+ * on_result is called from the merge, in order per signal. shards are never
+ * shorter than the warm-up, prefiltered channels are not supported.
+ *
+ * @param pool          - thread pool to run on
+ * @param channels      - initialized channel contexts, one per record signal - left at the end of the record
+ * @param record        - opened record
+ * @param num_shards    - shards per signal
+ * @param warmup_frames - warm-up in front of every shard, e.g. ECG_SHARD_WARMUP_S seconds
+ * @param on_result     - called for every detected wave from the pool threads (may be NULL)
+ * @param user          - user pointer passed to on_result
+ * @param stats         - filled with the seam counters (may be NULL)
+ * @return 1 on success, 0 if the shard states or results cannot be allocated
+ */
+uint8_t ecg_batch_run_record_sharded(thread_pool_t* pool, ecg_channel_t* channels, const ecg_record_t* record,
+                                     uint32_t num_shards, uint64_t warmup_frames, ecg_wave_result_fn on_result,
+                                     void* user, ecg_shard_stats_t* stats);
+
+#endif /* ECG_BATCH_H */
@@ -0,0 +1,151 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* user headers */
+#include "QRS_Dat_in.h"
+#include "osal/osal.h"
+#include "filters/ecg_filters.h"
+#include "filters/biquad_bank.h"
+#include "filters/Baseline_Wander_Coeffs.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define DEFAULT_NUM_CHANNELS 64u     /* channels in the bank */
+#define DEFAULT_NUM_FRAMES   28800u  /* 6 minutes at 80 Hz */
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* QRS_IN with a different gain and offset per channel so lanes never match */
+static void make_input(float* frames, uint32_t stride, uint32_t num_channels, uint32_t num_frames)
+{
+  uint32_t frame = 0;
+  uint32_t ch = 0;
+
+  for (frame = 0; frame < num_frames; frame++) {
+    for (ch = 0; ch < stride; ch++) {
+      float gain = 0.5f + 0.01f * (float)ch;
+      float offset = 0.001f * (float)(ch % 17);
+      frames[(size_t)frame * stride + ch] =
+          (ch < num_channels) ? gain * QRS_IN[(frame + ch) % QRS_BUFFER_SIZE] + offset : 0.0f;
+    }
+  }
+}
+
+/* per channel, per sample iir_biquad_filter() - the reference the bank has to match */
+static double run_reference(const float* in, float* out, uint32_t stride, uint32_t num_channels, uint32_t num_frames)
+{
+  float d[BASELINE_FILTER_STAGES][2];
+  uint32_t frame = 0;
+  uint32_t ch = 0;
+
+  uint64_t start_ns = osal_time_ns();
+  for (ch = 0; ch < num_channels; ch++) {
+    memset(d, 0, sizeof(d));
+    for (frame = 0; frame < num_frames; frame++) {
+      /* index 1 - never take the reset path */
+      out[(size_t)frame * stride + ch] = iir_biquad_filter(baseline_num, baseline_den, d, BASELINE_FILTER_STAGES, 1,
+                                                           in[(size_t)frame * stride + ch]);
+    }
+  }
+  return (double)(osal_time_ns() - start_ns) / 1e9;
+}
+
+static void usage(const char* prog)
+{
+  fprintf(stderr,
+          "usage: %s [-c channels] [-n frames]\n"
+          "  -c channels  channels in the bank (default %u)\n"
+          "  -n frames    samples per channel (default %u)\n",
+          prog, DEFAULT_NUM_CHANNELS, DEFAULT_NUM_FRAMES);
+}
+
+/******************************************************************************
+ * MAIN FUNCTION
+ *****************************************************************************/
+int main(int argc, char** argv) {
+  static const biquad_isa_t isas[] = { BIQUAD_ISA_SCALAR, BIQUAD_ISA_SSE, BIQUAD_ISA_AVX2, BIQUAD_ISA_NEON };
+  uint32_t num_channels = DEFAULT_NUM_CHANNELS;
+  uint32_t num_frames = DEFAULT_NUM_FRAMES;
+  int failed = 0;
+  int opt;
+  uint32_t i = 0;
+
+  while ((opt = getopt(argc, argv, "c:n:h")) != -1) {
+    switch (opt) {
+      case 'c':
+        num_channels = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        num_frames = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+
+  uint32_t stride = BIQUAD_BANK_STRIDE(num_channels);
+  size_t frames_bytes = (size_t)num_frames * stride * sizeof(float);
+  size_t frames_alloc = (frames_bytes + BIQUAD_BANK_ALIGN - 1) / BIQUAD_BANK_ALIGN * BIQUAD_BANK_ALIGN;
+  size_t state_bytes = biquad_bank_state_bytes(BASELINE_FILTER_STAGES, num_channels);
+  float* in = (float*)aligned_alloc(BIQUAD_BANK_ALIGN, frames_alloc);
+  float* ref = (float*)aligned_alloc(BIQUAD_BANK_ALIGN, frames_alloc);
+  float* out = (float*)aligned_alloc(BIQUAD_BANK_ALIGN, frames_alloc);
+  void* state = aligned_alloc(BIQUAD_BANK_ALIGN, (state_bytes + BIQUAD_BANK_ALIGN - 1) / BIQUAD_BANK_ALIGN * BIQUAD_BANK_ALIGN);
+  if (!in || !ref || !out || !state) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  make_input(in, stride, num_channels, num_frames);
+  double total_samples = (double)num_channels * num_frames;
+  double ref_s = run_reference(in, ref, stride, num_channels, num_frames);
+  printf("%-10s %8.2f Msamples/s\n", "reference", total_samples / ref_s / 1e6);
+
+  for (i = 0; i < sizeof(isas) / sizeof(isas[0]); i++) {
+    biquad_bank_t bank;
+    uint32_t mismatches = 0;
+    uint32_t frame = 0;
+    uint32_t ch = 0;
+
+    if (!biquad_isa_supported(isas[i])) {
+      continue;
+    }
+    biquad_bank_init(&bank, baseline_num, baseline_den, BASELINE_FILTER_STAGES, num_channels, state);
+    biquad_bank_select_isa(&bank, isas[i]);
+
+    uint64_t start_ns = osal_time_ns();
+    biquad_bank_process(&bank, in, out, num_frames);
+    double elapsed_s = (double)(osal_time_ns() - start_ns) / 1e9;
+
+    /* bit-exact comparison against the scalar reference */
+    for (frame = 0; frame < num_frames; frame++) {
+      for (ch = 0; ch < num_channels; ch++) {
+        size_t idx = (size_t)frame * stride + ch;
+        if (memcmp(&out[idx], &ref[idx], sizeof(float)) != 0) {
+          mismatches++;
+        }
+      }
+    }
+    failed |= (mismatches != 0);
+
+    printf("%-10s %8.2f Msamples/s  speedup=%.2fx  mismatches=%u\n", biquad_isa_name(isas[i]),
+           total_samples / elapsed_s / 1e6, ref_s / elapsed_s, mismatches);
+  }
+
+  free(state);
+  free(out);
+  free(ref);
+  free(in);
+  return failed;
+}
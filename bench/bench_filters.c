@@ -0,0 +1,133 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* user headers */
+#include "QRS_Dat_in.h"
+#include "osal/osal.h"
+#include "filters/ecg_filters.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define DEFAULT_NUM_SAMPLES 2880000u /* 10 hours at 80 Hz */
+#define DEFAULT_REPEATS     5u       /* best of repeats is reported */
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* one baseline_wander_filter_r() call per sample - the path of the original task loop */
+static double run_per_sample(const float* in, float* out, uint32_t num_samples)
+{
+  baseline_wander_state_t state;
+  uint32_t i = 0;
+
+  baseline_wander_init(&state);
+  uint64_t start_ns = osal_time_ns();
+  for (; i < num_samples; i++) {
+    /* index 1 - never take the reset path */
+    out[i] = baseline_wander_filter_r(&state, 1, in[i]);
+  }
+  return (double)(osal_time_ns() - start_ns) / 1e9;
+}
+
+/* baseline_wander_filter_block() over frames of frame_size samples */
+static double run_block(const float* in, float* out, uint32_t num_samples, uint32_t frame_size)
+{
+  baseline_wander_state_t state;
+  uint32_t i = 0;
+
+  baseline_wander_init(&state);
+  uint64_t start_ns = osal_time_ns();
+  for (; i < num_samples; i += frame_size) {
+    uint32_t n = (num_samples - i < frame_size) ? num_samples - i : frame_size;
+    baseline_wander_filter_block(&state, &in[i], &out[i], n);
+  }
+  return (double)(osal_time_ns() - start_ns) / 1e9;
+}
+
+static void usage(const char* prog)
+{
+  fprintf(stderr,
+          "usage: %s [-n samples] [-r repeats]\n"
+          "  -n samples  number of samples (default %u)\n"
+          "  -r repeats  repeats per measurement, best is reported (default %u)\n",
+          prog, DEFAULT_NUM_SAMPLES, DEFAULT_REPEATS);
+}
+
+/******************************************************************************
+ * MAIN FUNCTION
+ *****************************************************************************/
+int main(int argc, char** argv) {
+  static const uint32_t frame_sizes[] = { 1, 5, 17, 85, 256, 1024, 4096 };
+  uint32_t num_samples = DEFAULT_NUM_SAMPLES;
+  uint32_t repeats = DEFAULT_REPEATS;
+  int failed = 0;
+  int opt;
+  uint32_t i = 0;
+  uint32_t r = 0;
+
+  while ((opt = getopt(argc, argv, "n:r:h")) != -1) {
+    switch (opt) {
+      case 'n':
+        num_samples = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        repeats = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+  if (repeats == 0) {
+    repeats = 1;
+  }
+
+  float* in = (float*)malloc(num_samples * sizeof(float));
+  float* ref = (float*)malloc(num_samples * sizeof(float));
+  float* out = (float*)malloc(num_samples * sizeof(float));
+  if (!in || !ref || !out) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  for (i = 0; i < num_samples; i++) {
+    in[i] = QRS_IN[i % QRS_BUFFER_SIZE];
+  }
+
+  double best = 1e30;
+  for (r = 0; r < repeats; r++) {
+    double t = run_per_sample(in, ref, num_samples);
+    best = (t < best) ? t : best;
+  }
+  double per_sample_s = best;
+  printf("%-12s %8.2f ns/sample %9.2f Msamples/s\n", "per-sample", per_sample_s * 1e9 / num_samples,
+         num_samples / per_sample_s / 1e6);
+
+  for (i = 0; i < sizeof(frame_sizes) / sizeof(frame_sizes[0]); i++) {
+    best = 1e30;
+    for (r = 0; r < repeats; r++) {
+      double t = run_block(in, out, num_samples, frame_sizes[i]);
+      best = (t < best) ? t : best;
+    }
+
+    /* the block path has to be bit-exact with the per-sample path */
+    uint8_t exact = (memcmp(ref, out, num_samples * sizeof(float)) == 0);
+    failed |= !exact;
+
+    printf("block/%-6u %8.2f ns/sample %9.2f Msamples/s  speedup=%.2fx  %s\n", frame_sizes[i],
+           best * 1e9 / num_samples, num_samples / best / 1e6, per_sample_s / best, exact ? "exact" : "MISMATCH");
+  }
+
+  free(out);
+  free(ref);
+  free(in);
+  return failed;
+}
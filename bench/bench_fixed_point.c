@@ -0,0 +1,313 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* user headers */
+#include "QRS_Dat_in.h"
+#include "osal/osal.h"
+#include "config/config.h"
+#include "filters/ecg_filters.h"
+#include "filters/biquad_bank.h"
+#include "filters/biquad_q15.h"
+#include "feature_extract/pqrst_detector.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define DEFAULT_NUM_CHANNELS 64u       /* channels in the bank */
+#define DEFAULT_SECONDS      60u       /* signal length per channel */
+#define VOLTS_PER_LSB        (1.0f / 8192.0f)   /* +-4 V full scale */
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void* alloc_aligned(size_t bytes)
+{
+  return aligned_alloc(BIQUAD_BANK_ALIGN, (bytes + BIQUAD_BANK_ALIGN - 1) / BIQUAD_BANK_ALIGN * BIQUAD_BANK_ALIGN);
+}
+
+/* QRS_IN resampled to the rate with a different gain, offset and baseline
+ * wander per channel, quantized to int16 ADC units */
+static void make_input(int16_t* frames, uint32_t stride, uint32_t num_channels, uint16_t sample_freq,
+                       uint32_t num_frames)
+{
+  uint32_t frame = 0;
+  uint32_t ch = 0;
+
+  for (frame = 0; frame < num_frames; frame++) {
+    double t = (double)frame / sample_freq;
+    double pos = fmod(t * SAMPLE_FREQ, (double)QRS_BUFFER_SIZE);
+    uint32_t i = (uint32_t)pos;
+    double frac = pos - i;
+    double beat = (1.0 - frac) * QRS_IN[i] + frac * QRS_IN[(i + 1) % QRS_BUFFER_SIZE];
+
+    for (ch = 0; ch < stride; ch++) {
+      double gain = 0.5 + 0.01 * ch;
+      double wander = 0.3 * sin(2.0 * M_PI * 0.15 * t + ch) + 0.05 * (ch % 7);
+      frames[(size_t)frame * stride + ch] =
+          (ch < num_channels) ? q15_from_float((float)(gain * beat + wander), VOLTS_PER_LSB) : 0;
+    }
+  }
+}
+
+/* the float path of today - int16 to V, then the float bank */
+static double run_float(biquad_bank_t* bank, const int16_t* in, uint32_t in_stride, float* frames,
+                        uint32_t num_channels, uint32_t num_frames)
+{
+  uint32_t frame = 0;
+  uint32_t ch = 0;
+
+  uint64_t start_ns = osal_time_ns();
+  for (frame = 0; frame < num_frames; frame++) {
+    for (ch = 0; ch < num_channels; ch++) {
+      frames[(size_t)frame * bank->stride + ch] = (float)in[(size_t)frame * in_stride + ch] * VOLTS_PER_LSB;
+    }
+  }
+  biquad_bank_process(bank, frames, frames, num_frames);
+  return (double)(osal_time_ns() - start_ns) / 1e9;
+}
+
+/* the channel kernel of the rate on one channel - double states above 80 Hz */
+static void run_channel(const baseline_wander_rate_t* rate, const int16_t* in, float* out, uint32_t num_frames)
+{
+  baseline_wander_state_t state;
+  uint32_t frame = 0;
+
+  for (frame = 0; frame < num_frames; frame++) {
+    out[frame] = (float)in[frame] * VOLTS_PER_LSB;
+  }
+  baseline_wander_init(&state);
+  baseline_wander_filter_block_rate(rate, &state, out, out, num_frames);
+}
+
+/* one channel of the frames */
+static void column_q15(const int16_t* frames, uint32_t stride, uint32_t ch, int16_t* out, uint32_t num_frames)
+{
+  uint32_t frame = 0;
+  for (; frame < num_frames; frame++) {
+    out[frame] = frames[(size_t)frame * stride + ch];
+  }
+}
+
+static void column_float(const float* frames, uint32_t stride, uint32_t ch, float* out, uint32_t num_frames)
+{
+  uint32_t frame = 0;
+  for (; frame < num_frames; frame++) {
+    out[frame] = frames[(size_t)frame * stride + ch];
+  }
+}
+
+/* the cascade in double on one channel - the reference both paths are measured against */
+static void run_double(const baseline_wander_rate_t* rate, const int16_t* in, double* out, uint32_t num_frames)
+{
+  double d[BASELINE_STATE_STAGES][2] = { { 0.0 } };
+  uint32_t frame = 0;
+  uint16_t s = 0;
+
+  for (frame = 0; frame < num_frames; frame++) {
+    double y = in[frame];
+    for (s = 0; s < BASELINE_STATE_STAGES; s++) {
+      double w = y - rate->den[s][1] * d[s][0] - rate->den[s][2] * d[s][1];
+      y = rate->num[s][0] * w + rate->num[s][1] * d[s][0] + rate->num[s][2] * d[s][1];
+      d[s][1] = d[s][0];
+      d[s][0] = w;
+    }
+    out[frame] = y;
+  }
+}
+
+static uint8_t same_points(const wave_points_t* a, const wave_points_t* b)
+{
+  return (uint8_t)(a->p_idx == b->p_idx && a->q_idx == b->q_idx && a->r_idx == b->r_idx && a->s_idx == b->s_idx &&
+                   a->t_idx == b->t_idx);
+}
+
+static void usage(const char* prog)
+{
+  fprintf(stderr,
+          "usage: %s [-c channels] [-s seconds]\n"
+          "  -c channels  channels in the bank (default %u)\n"
+          "  -s seconds   signal length per channel (default %u)\n",
+          prog, DEFAULT_NUM_CHANNELS, DEFAULT_SECONDS);
+}
+
+/******************************************************************************
+ * MAIN FUNCTION
+ *****************************************************************************/
+int main(int argc, char** argv) {
+  static const uint16_t rates[] = { 80, 250, 360, 500, 1000 };
+  static const biquad_isa_t isas[] = { BIQUAD_ISA_SCALAR, BIQUAD_ISA_SSE, BIQUAD_ISA_AVX2 };
+  uint32_t num_channels = DEFAULT_NUM_CHANNELS;
+  uint32_t seconds = DEFAULT_SECONDS;
+  int failed = 0;
+  int opt;
+  uint32_t r = 0;
+
+  while ((opt = getopt(argc, argv, "c:s:h")) != -1) {
+    switch (opt) {
+      case 'c':
+        num_channels = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        seconds = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+  if (num_channels == 0 || seconds == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+    uint16_t fs = rates[r];
+    uint32_t num_frames = seconds * fs;
+    uint32_t stride = BIQUAD_Q15_STRIDE(num_channels);
+    uint32_t float_stride = BIQUAD_BANK_STRIDE(num_channels);
+    uint32_t window = ECG_BUFFER_SIZE(fs);
+    baseline_wander_rate_t rate;
+    biquad_q15_t q;
+    biquad_bank_t bank;
+    double sig = 0.0, err_q = 0.0, err_f = 0.0, err_c = 0.0, max_q = 0.0, max_f = 0.0, max_c = 0.0;
+    uint32_t windows_total = 0, agree_q = 0, agree_f = 0, agree_c = 0;
+    uint32_t i = 0;
+    uint32_t ch = 0;
+
+    baseline_wander_rate_init(&rate, fs);
+    if (biquad_q15_init(&q, rate.num, rate.den, BASELINE_STATE_STAGES) != 0) {
+      fprintf(stderr, "%u Hz: baseline filter does not fit the fixed-point cascade\n", fs);
+      failed = 1;
+      continue;
+    }
+
+    int16_t* in = (int16_t*)alloc_aligned((size_t)num_frames * stride * sizeof(int16_t));
+    int16_t* out = (int16_t*)alloc_aligned((size_t)num_frames * stride * sizeof(int16_t));
+    float* frames = (float*)alloc_aligned((size_t)num_frames * float_stride * sizeof(float));
+    int16_t* col_in = (int16_t*)malloc((size_t)num_frames * sizeof(int16_t));
+    int16_t* col = (int16_t*)malloc((size_t)num_frames * sizeof(int16_t));
+    float* col_f = (float*)malloc((size_t)num_frames * sizeof(float));
+    float* col_c = (float*)malloc((size_t)num_frames * sizeof(float));
+    float* col_ref = (float*)malloc((size_t)num_frames * sizeof(float));
+    double* col_d = (double*)malloc((size_t)num_frames * sizeof(double));
+    void* state = alloc_aligned(biquad_bank_q15_state_bytes(&q, num_channels));
+    void* float_state = alloc_aligned(biquad_bank_state_bytes(BASELINE_STATE_STAGES, num_channels));
+    if (!in || !out || !frames || !col_in || !col || !col_f || !col_c || !col_ref || !col_d || !state || !float_state) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+
+    make_input(in, stride, num_channels, fs, num_frames);
+    biquad_bank_init(&bank, rate.num, rate.den, BASELINE_STATE_STAGES, num_channels, float_state);
+    double float_s = run_float(&bank, in, stride, frames, num_channels, num_frames);
+    double float_ch = (double)num_channels * num_frames / float_s / fs;   /* real-time channels per core */
+
+    printf("%u Hz, %u channels, %u s\n", fs, num_channels, seconds);
+    printf("  %-8s %10.0f channels/core\n", "float", float_ch);
+
+    /* every kernel against the single channel cascade, bit-exact */
+    for (i = 0; i < sizeof(isas) / sizeof(isas[0]); i++) {
+      biquad_bank_q15_t bank_q;
+      uint32_t mismatches = 0;
+
+      if (!biquad_isa_supported(isas[i])) {
+        continue;
+      }
+      biquad_bank_q15_init(&bank_q, &q, num_channels, state);
+      biquad_bank_q15_select_isa(&bank_q, isas[i]);
+
+      uint64_t start_ns = osal_time_ns();
+      biquad_bank_q15_process(&bank_q, in, out, num_frames);
+      double q15_s = (double)(osal_time_ns() - start_ns) / 1e9;
+      double q15_ch = (double)num_channels * num_frames / q15_s / fs;
+
+      for (ch = 0; ch < num_channels; ch++) {
+        biquad_q15_state_t st;
+        biquad_q15_reset(&st);
+        column_q15(in, stride, ch, col_in, num_frames);
+        biquad_q15_filter_block(&q, &st, col_in, col_in, num_frames);
+        column_q15(out, stride, ch, col, num_frames);
+        mismatches += (memcmp(col_in, col, (size_t)num_frames * sizeof(int16_t)) != 0);
+      }
+      failed |= (mismatches != 0);
+      printf("  q15 %-4s %10.0f channels/core  density=%.2fx  mismatches=%u\n", biquad_isa_name(isas[i]), q15_ch,
+             q15_ch / float_ch, mismatches);
+    }
+
+    /* every path against the double cascade, and their wave points against the points on its output */
+    for (ch = 0; ch < num_channels; ch++) {
+      uint32_t frame = 0;
+      uint32_t start = 0;
+
+      column_q15(in, stride, ch, col_in, num_frames);
+      run_double(&rate, col_in, col_d, num_frames);
+      column_q15(out, stride, ch, col, num_frames);
+      column_float(frames, float_stride, ch, col_f, num_frames);
+      run_channel(&rate, col_in, col_c, num_frames);
+      for (frame = 0; frame < num_frames; frame++) {
+        double e_q = col[frame] - col_d[frame];
+        double e_f = col_f[frame] / VOLTS_PER_LSB - col_d[frame];
+        double e_c = col_c[frame] / VOLTS_PER_LSB - col_d[frame];
+        sig += col_d[frame] * col_d[frame];
+        err_q += e_q * e_q;
+        err_f += e_f * e_f;
+        err_c += e_c * e_c;
+        max_q = fmax(max_q, fabs(e_q));
+        max_f = fmax(max_f, fabs(e_f));
+        max_c = fmax(max_c, fabs(e_c));
+        col_ref[frame] = (float)(col_d[frame] * VOLTS_PER_LSB);
+      }
+
+      for (start = 0; start + window <= num_frames; start += window) {
+        wave_thresholds_t thresholds;
+        wave_thresholds_q15_t thresholds_q;
+        wave_windows_t windows;
+        wave_points_t p_ref, p_f, p_c, p_q;
+
+        ecg_thresholds_init(&thresholds);
+        ecg_thresholds_q15(&thresholds, VOLTS_PER_LSB, &thresholds_q);
+        ecg_windows_init(&windows, fs);
+        ecg_init(&p_ref, NULL);
+        ecg_init(&p_f, NULL);
+        ecg_init(&p_c, NULL);
+        ecg_init(&p_q, NULL);
+        ecg_detect_pqrst(&col_ref[start], start, 0, window, &thresholds, &windows, &p_ref);
+        ecg_detect_pqrst(&col_f[start], start, 0, window, &thresholds, &windows, &p_f);
+        ecg_detect_pqrst(&col_c[start], start, 0, window, &thresholds, &windows, &p_c);
+        ecg_detect_pqrst_q15(&col[start], start, 0, window, &thresholds_q, &windows, &p_q);
+        windows_total++;
+        agree_q += same_points(&p_ref, &p_q);
+        agree_f += same_points(&p_ref, &p_f);
+        agree_c += same_points(&p_ref, &p_c);
+      }
+    }
+    printf("  error vs double: q15 snr=%.1f dB max=%.1f LSB, float bank snr=%.1f dB max=%.1f LSB, "
+           "channel snr=%.1f dB max=%.1f LSB\n",
+           10.0 * log10(sig / fmax(err_q, 1e-30)), max_q, 10.0 * log10(sig / fmax(err_f, 1e-30)), max_f,
+           10.0 * log10(sig / fmax(err_c, 1e-30)), max_c);
+    printf("  wave points equal to the double path: q15 %u, float bank %u, channel %u of %u windows\n", agree_q,
+           agree_f, agree_c, windows_total);
+
+    free(float_state);
+    free(state);
+    free(col_d);
+    free(col_ref);
+    free(col_f);
+    free(col_c);
+    free(col);
+    free(col_in);
+    free(frames);
+    free(out);
+    free(in);
+  }
+  return failed;
+}
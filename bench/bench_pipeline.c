@@ -0,0 +1,918 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* user headers */
+#include "QRS_Dat_in.h"
+#include "config/config.h"
+#include "osal/osal.h"
+#include "filters/ecg_filters.h"
+#include "filters/Baseline_Wander_Coeffs.h"
+#include "filters/filter_design.h"
+#include "filters/preprocess.h"
+#include "feature_extract/pqrst_detector.h"
+#include "feature_extract/hrv.h"
+#include "feature_extract/morphology.h"
+#include "feature_extract/sqi.h"
+#include "channel/ecg_channel.h"
+#include "io/ecg_record.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define DEFAULT_MIN_TIME_S    0.2   /* minimum time of one measurement */
+#define DEFAULT_REPEATS       3u    /* best of repeats is reported */
+#define DEFAULT_DURATION_S    600u  /* seconds of signal per channel in the pipeline runs */
+#define DEFAULT_MAX_CHANNELS  8u    /* channel counts 1, 2, 4 .. max */
+#define MAX_RATES             8u    /* sampling rates in one run */
+#define MICRO_SAMPLES         4096u /* samples cycled through by the filter micro benchmarks */
+#define PREPROCESS_BLOCK      256u  /* samples per preprocess_block() call in the chain micro benchmarks */
+#define PREPROCESS_STAGES     6u    /* stages of the benchmarked chain */
+#define HRV_BEATS             4096u /* RR intervals cycled through by the HRV micro benchmarks */
+#define HRV_RATE              250u  /* sampling rate of the R peaks in the HRV micro benchmarks */
+#define MORPH_BEATS           64u   /* beats cycled through by the morphology micro benchmarks */
+#define MORPH_RATE            360u  /* sampling rate of the morphology micro benchmarks */
+#define MORPH_SPACING         256u  /* samples from one beat to the next */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* micro benchmark body - runs the measured code iterations times */
+typedef void (*bench_fn_t)(void* ctx, uint64_t iterations);
+
+/* input of the detector micro benchmarks */
+typedef struct {
+  float filtered[EXTENDED_BUFFER_SIZE];   /* filtered QRS_IN, NUM_OF_WAVES waves */
+  const float* samples;                   /* MICRO_SAMPLES raw samples */
+  wave_thresholds_t thresholds;           /* initial thresholds */
+  wave_windows_t windows;                 /* search windows at SAMPLE_FREQ */
+  wave_points_t points;                   /* points of the first wave */
+  wave_intervals_t intervals;             /* intervals of the first wave */
+} micro_ctx_t;
+
+/* input of the preprocessing chain micro benchmarks - one op is one sample */
+typedef struct {
+  preprocess_chain_t fused;                         /* the whole chain */
+  preprocess_chain_t single[PREPROCESS_STAGES];     /* one chain per stage, a pass each */
+  float filtered[PREPROCESS_BLOCK];
+  float feature[PREPROCESS_BLOCK];
+  const float* samples;                             /* MICRO_SAMPLES raw samples */
+} preprocess_ctx_t;
+
+/* input of the HRV micro benchmarks - one op is one beat or one query */
+typedef struct {
+  hrv_t hrv;
+  uint32_t rr_samples[HRV_BEATS];                   /* RR intervals in samples at HRV_RATE */
+} hrv_ctx_t;
+
+/* input of the morphology micro benchmarks - one op is one beat */
+typedef struct {
+  morph_bank_t bank;
+  float storage[MORPH_STORAGE_FLOATS(MORPH_RATE)];  /* templates and windows of the bank */
+  buffer_view_t view;                               /* the whole signal */
+  biquad_isa_t isa;                                 /* kernel of the run */
+  float signal[MORPH_BEATS * MORPH_SPACING];        /* a beat in the middle of every MORPH_SPACING samples */
+} morph_ctx_t;
+
+/* input of the SQI micro benchmark - one op is one sample */
+typedef struct {
+  sqi_t sqi;
+  const float* samples;                             /* MICRO_SAMPLES raw samples, scored as their own filtered signal */
+} sqi_ctx_t;
+
+/* one pipeline dataset - a signal per channel at one sampling rate */
+typedef struct {
+  const char* name;         /* synthetic or the record file name */
+  uint32_t sample_freq;     /* sampling rate of the signals */
+  uint8_t looped;           /* QRS_IN looped - the channels restart the filter every block like the board */
+  uint32_t num_samples;     /* samples per signal */
+  uint32_t num_signals;     /* signals, channel n uses signal n % num_signals */
+  float** signals;          /* num_signals signals */
+} dataset_t;
+
+/* beat latency collection of one pipeline run */
+typedef struct {
+  uint64_t frame_start_ns;  /* time the current frame was handed to the channel */
+  uint32_t* latencies;      /* ns from the frame that completed a beat to its result */
+  uint32_t count;           /* latencies collected */
+  uint32_t capacity;        /* latency slots */
+} latency_ctx_t;
+
+/* results of one pipeline configuration */
+typedef struct {
+  double best_s;            /* best processing time over the repeats */
+  uint64_t beats;           /* results emitted in one run */
+  uint64_t allocs;          /* heap allocations while processing */
+  uint32_t p50_ns;          /* beat emission latency percentiles */
+  uint32_t p99_ns;
+  uint32_t p999_ns;
+  uint32_t max_ns;
+} pipeline_result_t;
+
+/******************************************************************************
+ * GLOBAL VARIABLES
+ *****************************************************************************/
+
+static uint64_t g_allocs = 0;        /* heap allocations made by the linked ecg_* code and this file */
+static volatile float g_sink = 0.0f; /* keeps the measured results alive */
+static FILE* g_json = NULL;          /* JSON report, NULL if not requested */
+static uint32_t g_json_entries = 0;  /* benchmarks written to the report */
+
+/* filter of the design micro benchmarks - a 4th order elliptic QRS band-pass at 360 Hz */
+static const filter_spec_t g_design_spec = { FILTER_ELLIPTIC, FILTER_BANDPASS, 4, 360.0f, 5.0f, 15.0f, 1.0f, 40.0f };
+
+/* chain of the preprocessing micro benchmarks, at 360 Hz */
+static const preprocess_stage_t g_preprocess_stages[PREPROCESS_STAGES] = {
+  { PREPROCESS_BASELINE, 0.0f }, { PREPROCESS_NOTCH, 50.0f },  { PREPROCESS_LOWPASS, 40.0f },
+  { PREPROCESS_DERIVATIVE, 0.0f }, { PREPROCESS_SQUARE, 0.0f }, { PREPROCESS_MWI, 150.0f },
+};
+
+/******************************************************************************
+ * ALLOCATION COUNTING
+ *****************************************************************************/
+
+#ifdef BENCH_COUNT_ALLOCS
+/* the executable is linked with -Wl,--wrap=malloc,... so every allocation of the
+ * statically linked ecg_* libraries goes through here */
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+  g_allocs++;
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+  g_allocs++;
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+  g_allocs++;
+  return __real_realloc(ptr, size);
+}
+#endif
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void bench_iir_biquad_filter(void* ctx, uint64_t iterations)
+{
+  const micro_ctx_t* micro = (const micro_ctx_t*)ctx;
+  float d[BASELINE_FILTER_STAGES][2] = {{0.0f}};
+  float acc = 0.0f;
+  uint64_t i = 0;
+
+  for (; i < iterations; i++) {
+    /* index 1 - never take the reset path */
+    acc += iir_biquad_filter(baseline_num, baseline_den, d, BASELINE_FILTER_STAGES, 1,
+                             micro->samples[i % MICRO_SAMPLES]);
+  }
+  g_sink = acc;
+}
+
+static void bench_baseline_wander_filter(void* ctx, uint64_t iterations)
+{
+  const micro_ctx_t* micro = (const micro_ctx_t*)ctx;
+  float acc = 0.0f;
+  uint64_t i = 0;
+
+  for (; i < iterations; i++) {
+    acc += baseline_wander_filter(1, micro->samples[i % MICRO_SAMPLES]);
+  }
+  g_sink = acc;
+}
+
+static void bench_detect_pqrst(void* ctx, uint64_t iterations)
+{
+  const micro_ctx_t* micro = (const micro_ctx_t*)ctx;
+  wave_points_t points;
+  float acc = 0.0f;
+  uint64_t i = 0;
+
+  ecg_init(&points, NULL);
+  for (; i < iterations; i++) {
+    /* a steady state window - the second wave, not affected by the filter start */
+    ecg_detect_pqrst(micro->filtered, 0, BUFFER_SIZE, 2 * BUFFER_SIZE, &micro->thresholds, &micro->windows,
+                     &points);
+    acc += points.r_val;
+  }
+  g_sink = acc;
+}
+
+static void bench_calculate_intervals(void* ctx, uint64_t iterations)
+{
+  const micro_ctx_t* micro = (const micro_ctx_t*)ctx;
+  wave_intervals_t intervals;
+  float acc = 0.0f;
+  uint64_t i = 0;
+
+  for (; i < iterations; i++) {
+    ecg_calculate_intervals(&micro->points, &micro->windows, &intervals);
+    acc += intervals.qt_interval;
+  }
+  g_sink = acc;
+}
+
+static void bench_validate_detection(void* ctx, uint64_t iterations)
+{
+  const micro_ctx_t* micro = (const micro_ctx_t*)ctx;
+  uint32_t acc = 0;
+  uint64_t i = 0;
+
+  for (; i < iterations; i++) {
+    acc += ecg_validate_detection(&micro->points, &micro->intervals);
+  }
+  g_sink = (float)acc;
+}
+
+static void bench_filter_design(void* ctx, uint64_t iterations)
+{
+  filter_sos_t sos;
+  float acc = 0.0f;
+  uint64_t i = 0;
+
+  (void)ctx;
+  for (; i < iterations; i++) {
+    acc += filter_design(&g_design_spec, &sos) ? sos.b[0][0] : 0.0f;
+  }
+  g_sink = acc;
+}
+
+static void bench_filter_design_cached(void* ctx, uint64_t iterations)
+{
+  static filter_design_cache_t cache;
+  float acc = 0.0f;
+  uint64_t i = 0;
+
+  (void)ctx;
+  filter_design_cache_init(&cache);
+  for (; i < iterations; i++) {
+    acc += filter_design_cached(&cache, &g_design_spec)->b[0][0];
+  }
+  g_sink = acc;
+}
+
+static void bench_preprocess_fused(void* ctx, uint64_t iterations)
+{
+  preprocess_ctx_t* pre = (preprocess_ctx_t*)ctx;
+  uint64_t i = 0;
+
+  for (; i < iterations; i += PREPROCESS_BLOCK) {
+    uint32_t n = (uint32_t)MIN(iterations - i, (uint64_t)PREPROCESS_BLOCK);
+    preprocess_block(&pre->fused, &pre->samples[i % MICRO_SAMPLES], pre->filtered, pre->feature, n);
+  }
+  g_sink = pre->feature[0];
+}
+
+static void bench_preprocess_per_stage(void* ctx, uint64_t iterations)
+{
+  preprocess_ctx_t* pre = (preprocess_ctx_t*)ctx;
+  uint64_t i = 0;
+  uint32_t s = 0;
+
+  /* the same stages as separate passes over the block, in place */
+  for (; i < iterations; i += PREPROCESS_BLOCK) {
+    uint32_t n = (uint32_t)MIN(iterations - i, (uint64_t)PREPROCESS_BLOCK);
+    memcpy(pre->feature, &pre->samples[i % MICRO_SAMPLES], n * sizeof(float));
+    for (s = 0; s < PREPROCESS_STAGES; s++) {
+      preprocess_block(&pre->single[s], pre->feature, pre->feature, pre->feature, n);
+    }
+  }
+  g_sink = pre->feature[0];
+}
+
+/* time of iterations runs in s */
+/* incremental window update and O(1) time-domain query per beat */
+static void bench_hrv_incremental(void* ctx, uint64_t iterations)
+{
+  hrv_ctx_t* h = (hrv_ctx_t*)ctx;
+  hrv_time_t time;
+  uint64_t r = 1;
+  float acc = 0.0f;
+  uint64_t i = 0;
+
+  hrv_init(&h->hrv, HRV_RATE, HRV_WINDOW_S);
+  for (; i < iterations; i++) {
+    uint32_t rr = h->rr_samples[i % HRV_BEATS];
+    r += rr;
+    hrv_add_beat(&h->hrv, r, rr * 1000.0f / HRV_RATE);
+    hrv_get_time(&h->hrv, &time);
+    acc += time.sdnn + time.rmssd;
+  }
+  g_sink = acc;
+}
+
+/* the same metrics by rescanning the window for every beat */
+static void bench_hrv_rescan(void* ctx, uint64_t iterations)
+{
+  hrv_ctx_t* h = (hrv_ctx_t*)ctx;
+  uint64_t r = 1;
+  float acc = 0.0f;
+  uint64_t i = 0;
+  uint32_t j = 0;
+
+  hrv_init(&h->hrv, HRV_RATE, HRV_WINDOW_S);
+  for (; i < iterations; i++) {
+    uint32_t rr = h->rr_samples[i % HRV_BEATS];
+    r += rr;
+    hrv_add_beat(&h->hrv, r, rr * 1000.0f / HRV_RATE);
+
+    double sum = 0.0;
+    double m2 = 0.0;
+    double diff_sq = 0.0;
+    for (j = 0; j < h->hrv.count; j++) {
+      const hrv_beat_t* beat = &h->hrv.beats[(h->hrv.head + j) & (HRV_MAX_BEATS - 1)];
+      sum += beat->rr;
+      diff_sq += (double)beat->diff * beat->diff;
+    }
+    double mean = sum / h->hrv.count;
+    for (j = 0; j < h->hrv.count; j++) {
+      double d = h->hrv.beats[(h->hrv.head + j) & (HRV_MAX_BEATS - 1)].rr - mean;
+      m2 += d * d;
+    }
+    acc += (float)(sqrt(m2 / MAX(h->hrv.count - 1, 1u)) + sqrt(diff_sq / h->hrv.count));
+  }
+  g_sink = acc;
+}
+
+/* Lomb-Scargle LF/HF of a full 5 min window, the cache is cleared so every query computes */
+static void bench_hrv_freq(void* ctx, uint64_t iterations)
+{
+  hrv_ctx_t* h = (hrv_ctx_t*)ctx;
+  hrv_freq_t freq;
+  float acc = 0.0f;
+  uint64_t i = 0;
+
+  for (; i < iterations; i++) {
+    h->hrv.freq_added = 0;
+    hrv_get_freq(&h->hrv, &freq);
+    acc += freq.lf_hf;
+  }
+  g_sink = acc;
+}
+
+/* window extraction, normalization, correlation with the learned templates and the template update */
+static void bench_morph_classify(void* ctx, uint64_t iterations)
+{
+  morph_ctx_t* m = (morph_ctx_t*)ctx;
+  morph_match_t match;
+  float acc = 0.0f;
+  uint64_t i = 0;
+
+  morph_init(&m->bank, MORPH_RATE, m->storage);
+  buffer_view_linear(&m->view, m->signal, MORPH_BEATS * MORPH_SPACING);
+  morph_select_isa(&m->bank, m->isa);
+  for (; i < iterations; i++) {
+    morph_classify(&m->bank, &m->view, (uint32_t)(i % MORPH_BEATS) * MORPH_SPACING + MORPH_SPACING / 2, &match);
+    acc += match.corr;
+  }
+  g_sink = acc;
+}
+
+/* running features of every sample, a block scored every PREPROCESS_BLOCK samples */
+static void bench_sqi_process(void* ctx, uint64_t iterations)
+{
+  sqi_ctx_t* q = (sqi_ctx_t*)ctx;
+  uint32_t acc = 0;
+  uint64_t i = 0;
+
+  sqi_init(&q->sqi, 360);
+  for (; i < iterations; i += PREPROCESS_BLOCK) {
+    uint32_t n = (uint32_t)MIN(iterations - i, (uint64_t)PREPROCESS_BLOCK);
+    const float* block = &q->samples[i % MICRO_SAMPLES];
+    sqi_process(&q->sqi, block, block, n);
+    acc += sqi_end_block(&q->sqi, NULL);
+  }
+  g_sink = (float)acc;
+}
+
+static double time_iterations(bench_fn_t fn, void* ctx, uint64_t iterations)
+{
+  uint64_t start_ns = osal_time_ns();
+  fn(ctx, iterations);
+  return (double)(osal_time_ns() - start_ns) / 1e9;
+}
+
+/* starts a JSON benchmark entry - entries are one line each so reports can be diffed */
+static void json_begin(const char* name)
+{
+  if (g_json) {
+    fprintf(g_json, "%s\n    {\"name\": \"%s\"", g_json_entries ? "," : "", name);
+    g_json_entries++;
+  }
+}
+
+static void json_end(void)
+{
+  if (g_json) {
+    fprintf(g_json, "}");
+  }
+}
+
+/* google benchmark style: double the iterations until a run takes min_time_s, then best of repeats */
+static void run_micro(const char* name, bench_fn_t fn, void* ctx, double min_time_s, uint32_t repeats)
+{
+  uint64_t iterations = 1;
+  double t = time_iterations(fn, ctx, iterations);
+  uint32_t r = 0;
+
+  while (t < min_time_s && iterations < (1ull << 40)) {
+    iterations *= 2;
+    t = time_iterations(fn, ctx, iterations);
+  }
+
+  double best = t;
+  uint64_t allocs_before = g_allocs;
+  for (r = 1; r < repeats; r++) {
+    t = time_iterations(fn, ctx, iterations);
+    best = (t < best) ? t : best;
+  }
+  uint64_t allocs = g_allocs - allocs_before;
+
+  double ns_per_op = best * 1e9 / (double)iterations;
+  printf("%-40s %12.2f ns/op %10.2f Mops/s  allocs=%llu\n", name, ns_per_op, (double)iterations / best / 1e6,
+         (unsigned long long)allocs);
+  json_begin(name);
+  if (g_json) {
+    fprintf(g_json, ", \"iterations\": %llu, \"ns_per_op\": %.3f, \"ops_per_second\": %.1f, \"allocs\": %llu",
+            (unsigned long long)iterations, ns_per_op, (double)iterations / best, (unsigned long long)allocs);
+  }
+  json_end();
+}
+
+static int compare_u32(const void* a, const void* b)
+{
+  uint32_t x = *(const uint32_t*)a;
+  uint32_t y = *(const uint32_t*)b;
+  return (x > y) - (x < y);
+}
+
+/* nearest rank percentile of sorted values */
+static uint32_t percentile(const uint32_t* sorted, uint32_t count, double fraction)
+{
+  if (count == 0) {
+    return 0;
+  }
+  uint32_t rank = (uint32_t)(fraction * (double)count + 0.999999);
+  rank = (rank == 0) ? 1 : MIN(rank, count);
+  return sorted[rank - 1];
+}
+
+static void on_beat_count(void* user, const ecg_wave_result_t* result)
+{
+  (void)result;
+  (*(uint64_t*)user)++;
+}
+
+static void on_beat_latency(void* user, const ecg_wave_result_t* result)
+{
+  latency_ctx_t* ctx = (latency_ctx_t*)user;
+  uint64_t latency_ns = osal_time_ns() - ctx->frame_start_ns;
+
+  (void)result;
+  if (ctx->count < ctx->capacity) {
+    ctx->latencies[ctx->count++] = (uint32_t)MIN(latency_ns, (uint64_t)UINT32_MAX);
+  }
+}
+
+/* every channel gets one frame after the other, like a multi-lead acquisition - returns the time in s */
+static double run_pipeline_once(ecg_channel_t* channels, uint32_t num_channels, const dataset_t* data,
+                                uint32_t frame_size, latency_ctx_t* latency, uint64_t* beats)
+{
+  uint32_t ch = 0;
+  uint32_t pos = 0;
+
+  for (ch = 0; ch < num_channels; ch++) {
+    ecg_channel_init_rate(&channels[ch], ch, (uint16_t)data->sample_freq, NULL);
+    ecg_channel_set_filter_restart(&channels[ch], data->looped);
+  }
+
+  uint64_t start_ns = osal_time_ns();
+  for (pos = 0; pos < data->num_samples; pos += frame_size) {
+    uint32_t n = MIN(frame_size, data->num_samples - pos);
+    for (ch = 0; ch < num_channels; ch++) {
+      const float* signal = data->signals[ch % data->num_signals];
+      if (latency) {
+        latency->frame_start_ns = osal_time_ns();
+        ecg_channel_process(&channels[ch], &signal[pos], n, on_beat_latency, latency);
+      } else {
+        ecg_channel_process(&channels[ch], &signal[pos], n, on_beat_count, beats);
+      }
+    }
+  }
+  return (double)(osal_time_ns() - start_ns) / 1e9;
+}
+
+/* throughput runs without timestamps, then one run that times every beat */
+static uint8_t run_pipeline(ecg_channel_t* channels, uint32_t num_channels, const dataset_t* data,
+                            uint32_t frame_size, uint32_t repeats, pipeline_result_t* result)
+{
+  latency_ctx_t latency;
+  uint32_t r = 0;
+
+  /* generous bound - 4 beats/s is 240 BPM */
+  latency.capacity = (uint32_t)MIN((uint64_t)num_channels * (4ull * data->num_samples / data->sample_freq + 16),
+                                   (uint64_t)UINT32_MAX);
+  latency.latencies = (uint32_t*)malloc((size_t)latency.capacity * sizeof(uint32_t));
+  latency.count = 0;
+  if (!latency.latencies) {
+    return 0;
+  }
+
+  result->best_s = 1e30;
+  uint64_t allocs_before = g_allocs;
+  for (r = 0; r < repeats; r++) {
+    uint64_t beats = 0;
+    double t = run_pipeline_once(channels, num_channels, data, frame_size, NULL, &beats);
+    result->best_s = (t < result->best_s) ? t : result->best_s;
+    result->beats = beats;
+  }
+  run_pipeline_once(channels, num_channels, data, frame_size, &latency, NULL);
+  result->allocs = g_allocs - allocs_before;
+
+  qsort(latency.latencies, latency.count, sizeof(uint32_t), compare_u32);
+  result->p50_ns = percentile(latency.latencies, latency.count, 0.50);
+  result->p99_ns = percentile(latency.latencies, latency.count, 0.99);
+  result->p999_ns = percentile(latency.latencies, latency.count, 0.999);
+  result->max_ns = latency.count ? latency.latencies[latency.count - 1] : 0;
+
+  free(latency.latencies);
+  return 1;
+}
+
+/* QRS_IN resampled to sample_freq by linear interpolation, looped for duration_s */
+static uint8_t dataset_synthetic(dataset_t* data, uint32_t sample_freq, uint32_t duration_s)
+{
+  uint32_t i = 0;
+
+  data->name = "synthetic";
+  data->sample_freq = sample_freq;
+  data->looped = 1;
+  data->num_samples = sample_freq * duration_s;
+  data->num_signals = 1;
+  data->signals = (float**)malloc(sizeof(float*));
+  if (!data->signals) {
+    return 0;
+  }
+  data->signals[0] = (float*)malloc((size_t)data->num_samples * sizeof(float));
+  if (!data->signals[0]) {
+    free(data->signals);
+    return 0;
+  }
+
+  for (i = 0; i < data->num_samples; i++) {
+    double pos = (double)i * SAMPLE_FREQ / sample_freq;
+    uint32_t idx = (uint32_t)pos;
+    float frac = (float)(pos - idx);
+    float a = QRS_IN[idx % QRS_BUFFER_SIZE];
+    float b = QRS_IN[(idx + 1) % QRS_BUFFER_SIZE];
+    data->signals[0][i] = a + frac * (b - a);
+  }
+  return 1;
+}
+
+/* the first duration_s of every signal of a record, at the record rate */
+static uint8_t dataset_record(dataset_t* data, const ecg_record_t* record, const char* path, uint32_t duration_s)
+{
+  uint32_t i = 0;
+
+  const char* base = strrchr(path, '/');
+  data->name = base ? base + 1 : path;
+  data->sample_freq = record->sample_freq;
+  data->looped = 0;
+  data->num_samples = (uint32_t)MIN(record->num_frames, (uint64_t)record->sample_freq * duration_s);
+  data->num_signals = record->num_signals;
+  data->signals = (float**)calloc(data->num_signals, sizeof(float*));
+  if (!data->signals) {
+    return 0;
+  }
+
+  for (i = 0; i < data->num_signals; i++) {
+    data->signals[i] = (float*)malloc((size_t)data->num_samples * sizeof(float));
+    if (!data->signals[i]) {
+      return 0;
+    }
+    ecg_record_read(record, (uint16_t)i, 0, data->signals[i], data->num_samples);
+  }
+  return 1;
+}
+
+static void dataset_free(dataset_t* data)
+{
+  uint32_t i = 0;
+
+  for (i = 0; data->signals && i < data->num_signals; i++) {
+    free(data->signals[i]);
+  }
+  free(data->signals);
+  data->signals = NULL;
+}
+
+/* every channel count of one dataset */
+static uint8_t run_dataset(const dataset_t* data, uint32_t max_channels, uint32_t frame_us, uint32_t repeats)
+{
+  uint32_t frame_size = MAX(1u, (uint32_t)(((uint64_t)data->sample_freq * frame_us + 500000u) / 1000000u));
+  uint32_t num_channels = 1;
+
+  if (data->sample_freq == 0 || data->sample_freq > ECG_MAX_SAMPLE_FREQ) {
+    fprintf(stderr, "skipping %s: %u Hz is above ECG_MAX_SAMPLE_FREQ (%u Hz)\n", data->name, data->sample_freq,
+            ECG_MAX_SAMPLE_FREQ);
+    return 1;
+  }
+
+  /* the channels of every run are carved out of one arena up front and re-initialised in place */
+  uint64_t footprint = ecg_channel_footprint(1, (uint16_t)data->sample_freq);
+  arena_t arena;
+  if (!arena_create(&arena, ecg_channel_footprint(max_channels, (uint16_t)data->sample_freq), 0)) {
+    return 0;
+  }
+  ecg_channel_t* channels = ecg_channels_create(&arena, max_channels, (uint16_t)data->sample_freq);
+  arena_seal(&arena);
+  if (!channels) {
+    arena_destroy(&arena);
+    return 0;
+  }
+
+  while (num_channels <= max_channels) {
+    pipeline_result_t result;
+    char name[256];
+
+    if (!run_pipeline(channels, num_channels, data, frame_size, repeats, &result)) {
+      arena_destroy(&arena);
+      return 0;
+    }
+
+    double total_samples = (double)data->num_samples * num_channels;
+    double ns_per_sample = result.best_s * 1e9 / total_samples;
+    double real_time = (double)data->num_samples / data->sample_freq / result.best_s;
+    snprintf(name, sizeof(name), "pipeline/%s/%uHz/%uch", data->name, data->sample_freq, num_channels);
+
+    printf("%-40s %8.2f ns/sample %9.2f Msamples/s %10.0fx rt  beats=%llu "
+           "latency p50=%u p99=%u p999=%u max=%u ns  allocs=%llu  mem=%.1f KB/ch\n",
+           name, ns_per_sample, total_samples / result.best_s / 1e6, real_time, (unsigned long long)result.beats,
+           result.p50_ns, result.p99_ns, result.p999_ns, result.max_ns, (unsigned long long)result.allocs,
+           footprint / 1024.0);
+    json_begin(name);
+    if (g_json) {
+      fprintf(g_json,
+              ", \"sample_freq\": %u, \"channels\": %u, \"frame_size\": %u, \"samples\": %.0f, \"beats\": %llu, "
+              "\"ns_per_sample\": %.3f, \"samples_per_second\": %.1f, \"real_time_factor\": %.1f, "
+              "\"latency_p50_ns\": %u, \"latency_p99_ns\": %u, \"latency_p999_ns\": %u, \"latency_max_ns\": %u, "
+              "\"allocs\": %llu, \"channel_bytes\": %llu",
+              data->sample_freq, num_channels, frame_size, total_samples, (unsigned long long)result.beats,
+              ns_per_sample, total_samples / result.best_s, real_time, result.p50_ns, result.p99_ns,
+              result.p999_ns, result.max_ns, (unsigned long long)result.allocs, (unsigned long long)footprint);
+    }
+    json_end();
+
+    /* the last doubling may skip max_channels itself */
+    if (num_channels < max_channels && num_channels * 2 > max_channels) {
+      num_channels = max_channels;
+      continue;
+    }
+    num_channels *= 2;
+  }
+
+  arena_destroy(&arena);
+  return 1;
+}
+
+/* comma separated rates, returns the number parsed */
+static uint32_t parse_rates(const char* text, uint32_t* rates)
+{
+  uint32_t count = 0;
+  char* end = NULL;
+
+  while (*text && count < MAX_RATES) {
+    uint32_t rate = (uint32_t)strtoul(text, &end, 0);
+    if (end == text) {
+      break;
+    }
+    if (rate > 0) {
+      rates[count++] = rate;
+    }
+    text = (*end == ',') ? end + 1 : end;
+  }
+  return count;
+}
+
+static void usage(const char* prog)
+{
+  fprintf(stderr,
+          "usage: %s [-j report.json] [-s rates] [-c channels] [-d seconds] [-f frame_ms] [-r repeats]\n"
+          "          [-m min_time] [-R record.hea] [-M | -P]\n"
+          "  -j file     write a JSON report (- for stdout)\n"
+          "  -s rates    comma separated synthetic sampling rates (default 80,250,360,1000)\n"
+          "  -c channels largest channel count, runs 1, 2, 4 .. channels (default %u)\n"
+          "  -d seconds  signal per channel in the pipeline runs (default %u)\n"
+          "  -f frame_ms frame handed to the channel at once (default %.1f ms, FRAME_SIZE at %u Hz)\n"
+          "  -r repeats  repeats per measurement, best is reported (default %u)\n"
+          "  -m min_time minimum seconds of one micro benchmark measurement (default %.1f)\n"
+          "  -R record   also run the pipeline over a WFDB record at its own rate\n"
+          "  -M          micro benchmarks only\n"
+          "  -P          pipeline only\n",
+          prog, DEFAULT_MAX_CHANNELS, DEFAULT_DURATION_S, FRAME_SIZE * 1000.0 / SAMPLE_FREQ, SAMPLE_FREQ,
+          DEFAULT_REPEATS, DEFAULT_MIN_TIME_S);
+}
+
+/******************************************************************************
+ * MAIN FUNCTION
+ *****************************************************************************/
+int main(int argc, char** argv) {
+  uint32_t rates[MAX_RATES] = { 80, 250, 360, 1000 };
+  uint32_t num_rates = 4;
+  uint32_t max_channels = DEFAULT_MAX_CHANNELS;
+  uint32_t duration_s = DEFAULT_DURATION_S;
+  uint32_t frame_us = FRAME_SIZE * 1000000u / SAMPLE_FREQ;
+  uint32_t repeats = DEFAULT_REPEATS;
+  double min_time_s = DEFAULT_MIN_TIME_S;
+  const char* json_path = NULL;
+  const char* record_path = NULL;
+  uint8_t run_micros = 1;
+  uint8_t run_pipelines = 1;
+  int failed = 0;
+  int opt;
+  uint32_t i = 0;
+
+  while ((opt = getopt(argc, argv, "j:s:c:d:f:r:m:R:MPh")) != -1) {
+    switch (opt) {
+      case 'j':
+        json_path = optarg;
+        break;
+      case 's':
+        num_rates = parse_rates(optarg, rates);
+        break;
+      case 'c':
+        max_channels = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'd':
+        duration_s = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'f':
+        frame_us = (uint32_t)(strtod(optarg, NULL) * 1000.0);
+        break;
+      case 'r':
+        repeats = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'm':
+        min_time_s = strtod(optarg, NULL);
+        break;
+      case 'R':
+        record_path = optarg;
+        break;
+      case 'M':
+        run_pipelines = 0;
+        break;
+      case 'P':
+        run_micros = 0;
+        break;
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+  repeats = MAX(repeats, 1u);
+  max_channels = MAX(max_channels, 1u);
+  duration_s = MAX(duration_s, 1u);
+
+  if (json_path) {
+    g_json = (strcmp(json_path, "-") == 0) ? stdout : fopen(json_path, "w");
+    if (!g_json) {
+      fprintf(stderr, "failed to create %s\n", json_path);
+      return 1;
+    }
+    fprintf(g_json, "{\n  \"context\": {\"compiler\": \"%s\", \"sample_freq\": %u, \"buffer_size\": %u, "
+            "\"frame_size\": %u, \"cpus\": %u, \"alloc_counting\": %s},\n  \"benchmarks\": [",
+#ifdef __VERSION__
+            __VERSION__,
+#else
+            "unknown",
+#endif
+            SAMPLE_FREQ, BUFFER_SIZE, FRAME_SIZE, osal_cpu_count(),
+#ifdef BENCH_COUNT_ALLOCS
+            "true"
+#else
+            "false"
+#endif
+            );
+  }
+
+  if (run_micros) {
+    static micro_ctx_t micro;
+    static float samples[MICRO_SAMPLES];
+    baseline_wander_state_t state;
+
+    for (i = 0; i < MICRO_SAMPLES; i++) {
+      samples[i] = QRS_IN[i % QRS_BUFFER_SIZE];
+    }
+    baseline_wander_init(&state);
+    baseline_wander_filter_block(&state, samples, micro.filtered, EXTENDED_BUFFER_SIZE);
+    micro.samples = samples;
+    ecg_thresholds_init(&micro.thresholds);
+    ecg_windows_init(&micro.windows, SAMPLE_FREQ);
+    ecg_init(&micro.points, &micro.intervals);
+    ecg_detect_pqrst(micro.filtered, 0, BUFFER_SIZE, 2 * BUFFER_SIZE, &micro.thresholds, &micro.windows, &micro.points);
+    ecg_calculate_intervals(&micro.points, &micro.windows, &micro.intervals);
+
+    run_micro("iir_biquad_filter", bench_iir_biquad_filter, &micro, min_time_s, repeats);
+    run_micro("baseline_wander_filter", bench_baseline_wander_filter, &micro, min_time_s, repeats);
+    run_micro("ecg_detect_pqrst", bench_detect_pqrst, &micro, min_time_s, repeats);
+    run_micro("ecg_calculate_intervals", bench_calculate_intervals, &micro, min_time_s, repeats);
+    run_micro("ecg_validate_detection", bench_validate_detection, &micro, min_time_s, repeats);
+    run_micro("filter_design", bench_filter_design, NULL, min_time_s, repeats);
+    run_micro("filter_design_cached", bench_filter_design_cached, NULL, min_time_s, repeats);
+
+    static preprocess_ctx_t pre;
+    pre.samples = samples;
+    preprocess_init(&pre.fused, 360, g_preprocess_stages, PREPROCESS_STAGES);
+    for (i = 0; i < PREPROCESS_STAGES; i++) {
+      preprocess_init(&pre.single[i], 360, &g_preprocess_stages[i], 1);
+    }
+    run_micro("preprocess_block fused (per sample)", bench_preprocess_fused, &pre, min_time_s, repeats);
+    run_micro("preprocess_block per stage (per sample)", bench_preprocess_per_stage, &pre, min_time_s, repeats);
+
+    static sqi_ctx_t sqi;
+    sqi.samples = samples;
+    run_micro("sqi_process (per sample)", bench_sqi_process, &sqi, min_time_s, repeats);
+
+    /* RR series around 75 bpm with a 0.1 Hz (LF) and a 0.25 Hz (HF) modulation */
+    static hrv_ctx_t hrv;
+    double t = 0.0;
+    for (i = 0; i < HRV_BEATS; i++) {
+      double rr_s = 0.8 + 0.04 * sin(6.283185307 * 0.1 * t) + 0.02 * sin(6.283185307 * 0.25 * t);
+      hrv.rr_samples[i] = (uint32_t)(rr_s * HRV_RATE + 0.5);
+      t += (double)hrv.rr_samples[i] / HRV_RATE;
+    }
+    run_micro("hrv_add_beat + hrv_get_time (per beat)", bench_hrv_incremental, &hrv, min_time_s, repeats);
+    run_micro("hrv window rescan (per beat)", bench_hrv_rescan, &hrv, min_time_s, repeats);
+    run_micro("hrv_get_freq (5 min window)", bench_hrv_freq, &hrv, min_time_s, repeats);
+
+    /* gaussian beats at 360 Hz - narrow ones of two heights and widths and every 5th a wide inverted one */
+    static morph_ctx_t morph;
+    for (i = 0; i < MORPH_BEATS * MORPH_SPACING; i++) {
+      uint32_t beat = i / MORPH_SPACING;
+      double x = ((double)(i % MORPH_SPACING) - MORPH_SPACING / 2) / MORPH_RATE;
+      double width = (beat % 5 == 4) ? 0.04 : 0.012 + 0.001 * (beat % 3);
+      double height = (beat % 5 == 4) ? -1.0 : 1.0 + 0.05 * (beat % 4);
+      morph.signal[i] = (float)(height * exp(-0.5 * (x / width) * (x / width)) - 0.2 * exp(-0.5 * ((x - 0.03) / 0.01) *
+                                                                                      ((x - 0.03) / 0.01)));
+    }
+    morph.isa = BIQUAD_ISA_SCALAR;
+    run_micro("morph_classify scalar (per beat)", bench_morph_classify, &morph, min_time_s, repeats);
+    morph.isa = BIQUAD_ISA_AUTO;
+    run_micro("morph_classify best isa (per beat)", bench_morph_classify, &morph, min_time_s, repeats);
+  }
+
+  if (run_pipelines) {
+    for (i = 0; i < num_rates && !failed; i++) {
+      dataset_t data;
+      if (!dataset_synthetic(&data, rates[i], duration_s)) {
+        fprintf(stderr, "out of memory\n");
+        failed = 1;
+        break;
+      }
+      failed |= !run_dataset(&data, max_channels, frame_us, repeats);
+      dataset_free(&data);
+    }
+
+    if (record_path && !failed) {
+      ecg_record_t record;
+      dataset_t data;
+      if (!ecg_record_open_wfdb(&record, record_path)) {
+        fprintf(stderr, "failed to open %s\n", record_path);
+        failed = 1;
+      } else {
+        data.signals = NULL;
+        failed |= !dataset_record(&data, &record, record_path, duration_s);
+        failed |= !failed && !run_dataset(&data, max_channels, frame_us, repeats);
+        dataset_free(&data);
+        ecg_record_close(&record);
+      }
+    }
+  }
+
+  if (g_json) {
+    fprintf(g_json, "\n  ]\n}\n");
+    if (g_json != stdout) {
+      fclose(g_json);
+    }
+  }
+  if (failed) {
+    fprintf(stderr, "benchmark failed\n");
+  }
+  return failed;
+}
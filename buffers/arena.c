@@ -0,0 +1,56 @@
+#include "arena.h"
+
+#include <string.h>
+
+#include "osal/osal.h"
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+void arena_init(arena_t* arena, void* block, uint64_t size)
+{
+  uintptr_t start = (uintptr_t)block;
+  uintptr_t aligned = (start + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+
+  memset(arena, 0, sizeof(*arena));
+  if (block && size > aligned - start) {
+    arena->base = (uint8_t*)aligned;
+    arena->size = size - (aligned - start);
+  }
+}
+
+uint8_t arena_create(arena_t* arena, uint64_t size, uint8_t hugepages)
+{
+  uint64_t map_size = size ? size : 1;
+
+  /* page aligned, so base is the start of the mapping */
+  void* map = osal_mem_map(&map_size, hugepages);
+  arena_init(arena, map, map_size);
+  arena->map = map;
+  arena->map_size = map_size;
+  return map != NULL;
+}
+
+void arena_destroy(arena_t* arena)
+{
+  osal_mem_unmap(arena->map, arena->map_size);
+  memset(arena, 0, sizeof(*arena));
+}
+
+void* arena_alloc(arena_t* arena, uint64_t size)
+{
+  uint64_t bytes = ARENA_ROUND(size);
+
+  if (arena->sealed || bytes > arena->size - arena->used) {
+    return NULL;
+  }
+  void* block = arena->base + arena->used;
+  arena->used += bytes;
+  return block;
+}
+
+void arena_seal(arena_t* arena)
+{
+  arena->sealed = 1;
+}
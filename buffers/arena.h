@@ -0,0 +1,91 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define ARENA_ALIGN 64    /* cache line - every block starts on a line of its own */
+
+/* bytes a block takes in an arena */
+#define ARENA_ROUND(bytes) ((((bytes) + ARENA_ALIGN - 1) / ARENA_ALIGN) * ARENA_ALIGN)
+
+/* size of a static array that holds an arena of bytes at any alignment of the array */
+#define ARENA_STATIC_SIZE(bytes) (ARENA_ROUND(bytes) + ARENA_ALIGN)
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/*!
+ * bump allocator over one memory block
+ *
+ * everything a set of channels needs is carved out of one block at init, in
+ * the order it is allocated, so the state of a channel is contiguous and
+ * nothing is freed one by one. the footprint functions of the modules
+ * (ecg_channel_footprint(), ...) size the block up front. arena_seal() after
+ * the init makes every later allocation fail, so a run that passed its init
+ * provably allocates nothing.
+ */
+typedef struct {
+  uint8_t* base;        /* first ARENA_ALIGN aligned byte of the block */
+  uint64_t size;        /* usable bytes from base */
+  uint64_t used;        /* bytes handed out */
+  uint8_t sealed;       /* allocations fail */
+  void* map;            /* mapping of arena_create(), NULL for a caller provided block */
+  uint64_t map_size;
+} arena_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Init an arena on a caller provided block, e.g. a static array
+ *
+ * @param arena - pointer to the arena
+ * @param block - memory block, e.g. uint8_t block[ARENA_STATIC_SIZE(bytes)]
+ * @param size  - block size in bytes
+ */
+void arena_init(arena_t* arena, void* block, uint64_t size);
+
+/*!
+ * @brief Create an arena on a mapped block (host only)
+ *
+ * @param arena     - pointer to the arena
+ * @param size      - usable bytes, e.g. a sum of footprints
+ * @param hugepages - back the block with 2 MB pages if the OS can (osal_mem_map())
+ * @return 1 on success, 0 on failure
+ */
+uint8_t arena_create(arena_t* arena, uint64_t size, uint8_t hugepages);
+
+/*!
+ * @brief Release the block of arena_create(), every allocation becomes invalid
+ *
+ * @param arena - pointer to the arena
+ */
+void arena_destroy(arena_t* arena);
+
+/*!
+ * @brief Carve a block out of the arena
+ *
+ * the block is ARENA_ALIGN aligned and takes ARENA_ROUND(size) bytes. it is
+ * zeroed only if the arena memory was (static arrays and mapped blocks are,
+ * until they are reused).
+ *
+ * @param arena - pointer to the arena
+ * @param size  - bytes
+ * @return the block, NULL if the arena is full or sealed
+ */
+void* arena_alloc(arena_t* arena, uint64_t size);
+
+/*!
+ * @brief Make every later allocation fail
+ *
+ * @param arena - pointer to the arena
+ */
+void arena_seal(arena_t* arena);
+
+#endif /* ARENA_H */
@@ -1,5 +1,7 @@
 #include "buffer.h"
 
+#include <string.h>
+
 void buffer_write(volatile float *buffer, volatile uint16_t* index, float value, uint16_t size)
 {
 	/* write value to current index */
@@ -23,3 +25,28 @@ float buffer_read(volatile float *buffer, uint16_t index, uint16_t size)
   /* return value at index */
   return buffer[index];
 }
+
+void buffer_view_init(buffer_view_t* view, const float* buffer, uint32_t size, uint32_t start, uint32_t len)
+{
+  view->head = &buffer[start];
+  view->tail = buffer;
+  view->split = (start + len > size) ? size - start : len;
+  view->len = len;
+}
+
+void buffer_view_linear(buffer_view_t* view, const float* samples, uint32_t len)
+{
+  view->head = samples;
+  view->tail = samples;
+  view->split = len;
+  view->len = len;
+}
+
+void buffer_view_copy(const buffer_view_t* view, uint32_t first, uint32_t count, float* out)
+{
+  /* the part in front of the wrap point, then the part behind it */
+  uint32_t head = (first >= view->split) ? 0 : (count < view->split - first) ? count : view->split - first;
+
+  memcpy(out, &view->head[first], head * sizeof(float));
+  memcpy(&out[head], &view->tail[first + head - view->split], (count - head) * sizeof(float));
+}
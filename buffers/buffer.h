@@ -3,6 +3,15 @@
 
 #include <stdint.h>
 
+/* window over a circular buffer without a copy - the samples from the window
+ * start up to the end of the buffer, the rest from the start of the buffer */
+typedef struct {
+  const float* head;            /* first sample of the window */
+  const float* tail;            /* start of the buffer, samples split .. len - 1 */
+  uint32_t split;               /* samples in front of the wrap point */
+  uint32_t len;                 /* samples in the window */
+} buffer_view_t;
+
 /*!
  * @brief Write to circular buffer
  *
@@ -29,4 +38,40 @@ void buffer_write(volatile float *buffer, volatile uint16_t* index, float value,
  */
 float buffer_read(volatile float *buffer, uint16_t index, uint16_t size);
 
+/*!
+ * @brief View a window of a circular buffer
+ *
+ * @param view   - filled with the view
+ * @param buffer - pointer to the circular buffer
+ * @param size   - size of the buffer
+ * @param start  - buffer index of the first sample of the window
+ * @param len    - samples in the window (<= size)
+ */
+void buffer_view_init(buffer_view_t* view, const float* buffer, uint32_t size, uint32_t start, uint32_t len);
+
+/*!
+ * @brief View contiguous samples, e.g. a whole recording
+ *
+ * @param view    - filled with the view
+ * @param samples - first sample of the window
+ * @param len     - samples in the window
+ */
+void buffer_view_linear(buffer_view_t* view, const float* samples, uint32_t len);
+
+/*!
+ * @brief Copy a part of a window out of the buffer
+ *
+ * @param view  - pointer to the view
+ * @param first - window index of the first sample
+ * @param count - samples to copy
+ * @param out   - count samples
+ */
+void buffer_view_copy(const buffer_view_t* view, uint32_t first, uint32_t count, float* out);
+
+/* sample i of a window - the searches read the buffer in place through it */
+static inline float buffer_view_at(const buffer_view_t* view, uint32_t i)
+{
+  return (i < view->split) ? view->head[i] : view->tail[i - view->split];
+}
+
 #endif // BUFFER_H
@@ -0,0 +1,139 @@
+#include "spsc_ring.h"
+
+#include <string.h>
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* free slots seen by the producer - refreshes the cached tail only when needed */
+static uint32_t producer_space(spsc_ring_t* ring, uint32_t head, uint32_t wanted)
+{
+  uint32_t capacity = ring->mask + 1;
+  uint32_t space = capacity - (head - ring->tail_cache);
+
+  if (space < wanted) {
+    ring->tail_cache = osal_atomic_load_acquire(&ring->tail);
+    space = capacity - (head - ring->tail_cache);
+  }
+  return space;
+}
+
+/* samples seen by the consumer - refreshes the cached head only when needed */
+static uint32_t consumer_count(spsc_ring_t* ring, uint32_t tail, uint32_t wanted)
+{
+  uint32_t count = ring->head_cache - tail;
+
+  if (count < wanted) {
+    ring->head_cache = osal_atomic_load_acquire(&ring->head);
+    count = ring->head_cache - tail;
+  }
+  return count;
+}
+
+/* only the producer writes overruns, others just read it */
+static void count_overruns(spsc_ring_t* ring, uint32_t dropped)
+{
+  osal_atomic_store_relaxed(&ring->overruns, osal_atomic_load_relaxed(&ring->overruns) + dropped);
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+uint8_t spsc_ring_init(spsc_ring_t* ring, float* storage, uint32_t capacity)
+{
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+    return 0;
+  }
+
+  ring->data = storage;
+  ring->mask = capacity - 1;
+  osal_atomic_store_relaxed(&ring->head, 0);
+  osal_atomic_store_relaxed(&ring->overruns, 0);
+  ring->tail_cache = 0;
+  osal_atomic_store_relaxed(&ring->tail, 0);
+  ring->head_cache = 0;
+  return 1;
+}
+
+uint8_t spsc_ring_push(spsc_ring_t* ring, float sample)
+{
+  uint32_t head = osal_atomic_load_relaxed(&ring->head);
+
+  if (producer_space(ring, head, 1) == 0) {
+    count_overruns(ring, 1);
+    return 0;
+  }
+  ring->data[head & ring->mask] = sample;
+
+  /* publish the sample */
+  osal_atomic_store_release(&ring->head, head + 1);
+  return 1;
+}
+
+uint32_t spsc_ring_push_bulk(spsc_ring_t* ring, const float* samples, uint32_t num_samples)
+{
+  uint32_t head = osal_atomic_load_relaxed(&ring->head);
+  uint32_t space = producer_space(ring, head, num_samples);
+  uint32_t n = (num_samples < space) ? num_samples : space;
+
+  /* up to the end of the storage, then from its start */
+  uint32_t start = head & ring->mask;
+  uint32_t first = ring->mask + 1 - start;
+  first = (n < first) ? n : first;
+  memcpy(&ring->data[start], samples, first * sizeof(float));
+  memcpy(&ring->data[0], &samples[first], (n - first) * sizeof(float));
+
+  osal_atomic_store_release(&ring->head, head + n);
+  if (n < num_samples) {
+    count_overruns(ring, num_samples - n);
+  }
+  return n;
+}
+
+uint32_t spsc_ring_count(spsc_ring_t* ring)
+{
+  uint32_t tail = osal_atomic_load_relaxed(&ring->tail);
+  return consumer_count(ring, tail, ring->mask + 1);
+}
+
+uint32_t spsc_ring_peek(spsc_ring_t* ring, uint32_t num_samples, spsc_span_t spans[2])
+{
+  uint32_t tail = osal_atomic_load_relaxed(&ring->tail);
+  uint32_t count = consumer_count(ring, tail, num_samples);
+  uint32_t n = (num_samples < count) ? num_samples : count;
+
+  uint32_t start = tail & ring->mask;
+  uint32_t first = ring->mask + 1 - start;
+  first = (n < first) ? n : first;
+  spans[0].data = &ring->data[start];
+  spans[0].count = first;
+  spans[1].data = &ring->data[0];
+  spans[1].count = n - first;
+  return n;
+}
+
+void spsc_ring_release(spsc_ring_t* ring, uint32_t num_samples)
+{
+  uint32_t tail = osal_atomic_load_relaxed(&ring->tail);
+
+  /* hand the slots back to the producer */
+  osal_atomic_store_release(&ring->tail, tail + num_samples);
+}
+
+uint32_t spsc_ring_pop_bulk(spsc_ring_t* ring, float* out, uint32_t num_samples)
+{
+  spsc_span_t spans[2];
+  uint32_t n = spsc_ring_peek(ring, num_samples, spans);
+
+  memcpy(out, spans[0].data, spans[0].count * sizeof(float));
+  memcpy(&out[spans[0].count], spans[1].data, spans[1].count * sizeof(float));
+  spsc_ring_release(ring, n);
+  return n;
+}
+
+uint32_t spsc_ring_overruns(spsc_ring_t* ring)
+{
+  return osal_atomic_load_relaxed(&ring->overruns);
+}
@@ -0,0 +1,136 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+
+#include "osal/osal.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define SPSC_RING_CACHE_LINE 64   /* producer and consumer indices live on different lines */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* contiguous part of the ring - a request wraps into at most two spans */
+typedef struct {
+  const float* data;
+  uint32_t count;
+} spsc_span_t;
+
+/*!
+ * single-producer/single-consumer lock-free ring of float samples
+ *
+ * head and tail are free running 32 bit counters, the capacity is a power of
+ * two so slots are picked with a mask and count = head - tail is correct
+ * across the wrap. the producer publishes samples with a release store of
+ * head, the consumer frees slots with a release store of tail. each side keeps
+ * a cached copy of the other index and only re-reads it when the cache says
+ * the ring is full/empty, so the shared lines are touched rarely.
+ *
+ * a full ring never blocks the producer (it may be an ISR): the samples that do
+ * not fit are dropped and counted in overruns.
+ */
+typedef struct {
+  /* read only after init */
+  float* data;                      /* capacity slots */
+  uint32_t mask;                    /* capacity - 1 */
+  uint8_t pad0[SPSC_RING_CACHE_LINE - sizeof(float*) - sizeof(uint32_t)];
+
+  /* producer side */
+  osal_atomic_u32_t head;           /* next slot to write */
+  osal_atomic_u32_t overruns;       /* samples dropped because the ring was full */
+  uint32_t tail_cache;              /* last tail seen by the producer */
+  uint8_t pad1[SPSC_RING_CACHE_LINE - 3 * sizeof(uint32_t)];
+
+  /* consumer side */
+  osal_atomic_u32_t tail;           /* next slot to read */
+  uint32_t head_cache;              /* last head seen by the consumer */
+  uint8_t pad2[SPSC_RING_CACHE_LINE - 2 * sizeof(uint32_t)];
+} spsc_ring_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Init a ring on caller provided storage
+ *
+ * @param ring     - pointer to the ring
+ * @param storage  - capacity floats, static on the board
+ * @param capacity - number of slots, power of two
+ * @return 1 on success, 0 if capacity is not a power of two
+ */
+uint8_t spsc_ring_init(spsc_ring_t* ring, float* storage, uint32_t capacity);
+
+/*!
+ * @brief Push one sample (producer)
+ *
+ * @param ring   - pointer to the ring
+ * @param sample - sample to push
+ * @return 1 if pushed, 0 if dropped because the ring is full
+ */
+uint8_t spsc_ring_push(spsc_ring_t* ring, float sample);
+
+/*!
+ * @brief Push a block of samples (producer)
+ *
+ * copies at most two spans and publishes them with one release store.
+ *
+ * @param ring        - pointer to the ring
+ * @param samples     - samples to push
+ * @param num_samples - number of samples
+ * @return number of samples pushed, the rest is dropped and counted as overruns
+ */
+uint32_t spsc_ring_push_bulk(spsc_ring_t* ring, const float* samples, uint32_t num_samples);
+
+/*!
+ * @brief Samples ready for the consumer (consumer)
+ *
+ * @param ring - pointer to the ring
+ * @return number of samples that can be read
+ */
+uint32_t spsc_ring_count(spsc_ring_t* ring);
+
+/*!
+ * @brief Zero-copy read access (consumer)
+ *
+ * the spans stay valid until spsc_ring_release() is called.
+ *
+ * @param ring        - pointer to the ring
+ * @param num_samples - maximum number of samples
+ * @param spans       - filled with up to two spans, unused spans have count 0
+ * @return number of samples in the spans
+ */
+uint32_t spsc_ring_peek(spsc_ring_t* ring, uint32_t num_samples, spsc_span_t spans[2]);
+
+/*!
+ * @brief Free samples read through spsc_ring_peek() (consumer)
+ *
+ * @param ring        - pointer to the ring
+ * @param num_samples - number of samples, at most the count returned by peek
+ */
+void spsc_ring_release(spsc_ring_t* ring, uint32_t num_samples);
+
+/*!
+ * @brief Copy a block of samples out of the ring (consumer)
+ *
+ * @param ring        - pointer to the ring
+ * @param out         - filled with the samples
+ * @param num_samples - maximum number of samples
+ * @return number of samples read
+ */
+uint32_t spsc_ring_pop_bulk(spsc_ring_t* ring, float* out, uint32_t num_samples);
+
+/*!
+ * @brief Samples dropped because the ring was full (any thread)
+ *
+ * @param ring - pointer to the ring
+ * @return number of dropped samples
+ */
+uint32_t spsc_ring_overruns(spsc_ring_t* ring);
+
+#endif /* SPSC_RING_H */
@@ -0,0 +1,173 @@
+#include "beat_ring.h"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* only the producer or only the subscriber writes each counter, others just read it */
+static void count(osal_atomic_u32_t* counter, uint32_t n)
+{
+  osal_atomic_store_relaxed(counter, osal_atomic_load_relaxed(counter) + n);
+}
+
+/* moves the tail of a drop oldest subscriber that is a whole ring behind so the
+ * next slot can be written - the subscriber may move it at the same time */
+static void drop_oldest(beat_ring_sub_t* sub, uint32_t head, uint32_t capacity)
+{
+  uint32_t tail = osal_atomic_load_acquire(&sub->tail);
+
+  while (head - tail >= capacity) {
+    uint32_t new_tail = head - capacity + 1;
+    if (osal_atomic_cas(&sub->tail, tail, new_tail)) {
+      count(&sub->dropped, new_tail - tail);
+      return;
+    }
+    /* the subscriber read a beat meanwhile - the tail only moves forward */
+    tail = osal_atomic_load_acquire(&sub->tail);
+  }
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+uint8_t beat_ring_init(beat_ring_t* ring, ecg_wave_result_t* storage, uint32_t capacity)
+{
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+    return 0;
+  }
+
+  ring->slots = storage;
+  ring->mask = capacity - 1;
+  osal_atomic_store_relaxed(&ring->head, 0);
+  osal_atomic_store_relaxed(&ring->closed, 0);
+  ring->lag = 0;
+  for (uint32_t i = 0; i < BEAT_RING_MAX_SUBSCRIBERS; i++) {
+    osal_atomic_store_relaxed(&ring->subs[i].active, 0);
+  }
+  return 1;
+}
+
+uint8_t beat_ring_subscribe(beat_ring_t* ring, beat_ring_policy_t policy, uint32_t* id)
+{
+  for (uint32_t i = 0; i < BEAT_RING_MAX_SUBSCRIBERS; i++) {
+    beat_ring_sub_t* sub = &ring->subs[i];
+    if (osal_atomic_load_acquire(&sub->active)) {
+      continue;
+    }
+    osal_atomic_store_relaxed(&sub->tail, osal_atomic_load_acquire(&ring->head));
+    osal_atomic_store_relaxed(&sub->delivered, 0);
+    osal_atomic_store_relaxed(&sub->dropped, 0);
+    osal_atomic_store_relaxed(&sub->stalls, 0);
+    osal_atomic_store_relaxed(&sub->max_lag, 0);
+    sub->policy = (uint32_t)policy;
+    osal_atomic_store_release(&sub->active, 1);
+    *id = i;
+    return 1;
+  }
+  return 0;
+}
+
+void beat_ring_unsubscribe(beat_ring_t* ring, uint32_t id)
+{
+  osal_atomic_store_release(&ring->subs[id].active, 0);
+}
+
+uint8_t beat_ring_publish(beat_ring_t* ring, const ecg_wave_result_t* result)
+{
+  uint32_t head = osal_atomic_load_relaxed(&ring->head);
+  uint32_t capacity = ring->mask + 1;
+
+  /* a backpressure subscriber a whole ring behind refuses the beat - checked
+   * first so nothing is dropped for the other subscribers */
+  for (uint32_t i = 0; i < BEAT_RING_MAX_SUBSCRIBERS; i++) {
+    beat_ring_sub_t* sub = &ring->subs[i];
+    if (!osal_atomic_load_acquire(&sub->active) || sub->policy != BEAT_RING_BACKPRESSURE) {
+      continue;
+    }
+    if (head - osal_atomic_load_acquire(&sub->tail) >= capacity) {
+      count(&sub->stalls, 1);
+      return 0;
+    }
+  }
+
+  /* free the slot for the drop oldest subscribers */
+  for (uint32_t i = 0; i < BEAT_RING_MAX_SUBSCRIBERS; i++) {
+    beat_ring_sub_t* sub = &ring->subs[i];
+    if (osal_atomic_load_acquire(&sub->active) && sub->policy == BEAT_RING_DROP_OLDEST) {
+      drop_oldest(sub, head, capacity);
+    }
+  }
+
+  ring->slots[head & ring->mask] = *result;
+
+  /* publish the beat */
+  osal_atomic_store_release(&ring->head, head + 1);
+
+  /* lag after the publish */
+  ring->lag = 0;
+  for (uint32_t i = 0; i < BEAT_RING_MAX_SUBSCRIBERS; i++) {
+    beat_ring_sub_t* sub = &ring->subs[i];
+    if (!osal_atomic_load_relaxed(&sub->active)) {
+      continue;
+    }
+    uint32_t lag = head + 1 - osal_atomic_load_relaxed(&sub->tail);
+    if (lag > osal_atomic_load_relaxed(&sub->max_lag)) {
+      osal_atomic_store_relaxed(&sub->max_lag, lag);
+    }
+    ring->lag = MAX(ring->lag, lag);
+  }
+  return 1;
+}
+
+void beat_ring_close(beat_ring_t* ring)
+{
+  osal_atomic_store_release(&ring->closed, 1);
+}
+
+uint32_t beat_ring_lag(beat_ring_t* ring)
+{
+  return ring->lag;
+}
+
+uint8_t beat_ring_read(beat_ring_t* ring, uint32_t id, ecg_wave_result_t* result)
+{
+  beat_ring_sub_t* sub = &ring->subs[id];
+
+  while (1) {
+    uint32_t tail = osal_atomic_load_acquire(&sub->tail);
+    if (tail == osal_atomic_load_acquire(&ring->head)) {
+      return 0;
+    }
+    *result = ring->slots[tail & ring->mask];
+
+    /* only this subscriber moves a backpressure tail */
+    if (sub->policy == BEAT_RING_BACKPRESSURE) {
+      osal_atomic_store_release(&sub->tail, tail + 1);
+      break;
+    }
+    /* the producer did not move the tail, so the slot was not overwritten during the copy */
+    if (osal_atomic_cas(&sub->tail, tail, tail + 1)) {
+      break;
+    }
+  }
+  count(&sub->delivered, 1);
+  return 1;
+}
+
+uint8_t beat_ring_closed(beat_ring_t* ring)
+{
+  return (uint8_t)osal_atomic_load_acquire(&ring->closed);
+}
+
+void beat_ring_get_stats(beat_ring_t* ring, uint32_t id, beat_ring_stats_t* stats)
+{
+  beat_ring_sub_t* sub = &ring->subs[id];
+  uint32_t head = osal_atomic_load_acquire(&ring->head);
+
+  stats->delivered = osal_atomic_load_relaxed(&sub->delivered);
+  stats->dropped = osal_atomic_load_relaxed(&sub->dropped);
+  stats->stalls = osal_atomic_load_relaxed(&sub->stalls);
+  stats->lag = head - osal_atomic_load_acquire(&sub->tail);
+  stats->max_lag = osal_atomic_load_relaxed(&sub->max_lag);
+}
@@ -0,0 +1,171 @@
+#ifndef BEAT_RING_H
+#define BEAT_RING_H
+
+#include <stdint.h>
+
+#include "osal/osal.h"
+#include "channel/ecg_channel.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define BEAT_RING_CACHE_LINE      64 /* producer and every subscriber live on different lines */
+#define BEAT_RING_MAX_SUBSCRIBERS 4  /* e.g. logger, trend, classifier, exporter */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* what happens when a subscriber is a whole ring behind the producer */
+typedef enum {
+  BEAT_RING_DROP_OLDEST = 0, /* the producer overwrites the subscriber's oldest beat and counts it as dropped */
+  BEAT_RING_BACKPRESSURE,    /* the producer can not publish until the subscriber read a beat */
+} beat_ring_policy_t;
+
+/* one subscriber - the tail is written by the subscriber (and by the producer
+ * when it drops beats), the counters by whoever the comment names */
+typedef struct {
+  osal_atomic_u32_t tail;      /* next beat to read */
+  osal_atomic_u32_t active;    /* subscribed */
+  osal_atomic_u32_t delivered; /* beats read - subscriber */
+  osal_atomic_u32_t dropped;   /* beats overwritten before they were read - producer */
+  osal_atomic_u32_t stalls;    /* publishes refused because of this subscriber - producer */
+  osal_atomic_u32_t max_lag;   /* most beats this subscriber was behind after a publish - producer */
+  uint32_t policy;             /* beat_ring_policy_t, fixed while subscribed */
+  uint8_t pad[BEAT_RING_CACHE_LINE - 7 * sizeof(uint32_t)];
+} beat_ring_sub_t;
+
+/* lag metrics of one subscriber */
+typedef struct {
+  uint32_t delivered;          /* beats read */
+  uint32_t dropped;            /* beats lost to drop oldest */
+  uint32_t stalls;             /* publishes this subscriber refused under backpressure */
+  uint32_t lag;                /* beats published but not read yet */
+  uint32_t max_lag;            /* high-water mark of lag */
+} beat_ring_stats_t;
+
+/*!
+ * single-producer/multi-consumer broadcast ring of detected beats
+ *
+ * every subscriber sees every beat published after it subscribed and reads at
+ * its own pace with its own tail. the producer (the feature detection task)
+ * never waits on a subscriber: a drop oldest subscriber that is a whole ring
+ * behind has its tail moved forward by the producer with a compare and swap,
+ * and a backpressure subscriber makes beat_ring_publish() fail so the producer
+ * decides whether to retry or give up.
+ *
+ * a drop oldest subscriber copies a beat and then moves its tail with a compare
+ * and swap - if the producer moved it during the copy the slot may have been
+ * overwritten, so the copy is thrown away and the next beat is read instead.
+ */
+typedef struct {
+  /* read only after init */
+  ecg_wave_result_t* slots;    /* capacity slots */
+  uint32_t mask;               /* capacity - 1 */
+  uint8_t pad0[BEAT_RING_CACHE_LINE - sizeof(ecg_wave_result_t*) - sizeof(uint32_t)];
+
+  /* producer side */
+  osal_atomic_u32_t head;      /* next slot to write */
+  osal_atomic_u32_t closed;    /* the producer published its last beat */
+  uint32_t lag;                /* most beats any subscriber was behind after the last publish */
+  uint8_t pad1[BEAT_RING_CACHE_LINE - 3 * sizeof(uint32_t)];
+
+  beat_ring_sub_t subs[BEAT_RING_MAX_SUBSCRIBERS];
+} beat_ring_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Init a ring on caller provided storage
+ *
+ * @param ring     - pointer to the ring
+ * @param storage  - capacity beats, static on the board
+ * @param capacity - number of slots, power of two
+ * @return 1 on success, 0 if capacity is not a power of two
+ */
+uint8_t beat_ring_init(beat_ring_t* ring, ecg_wave_result_t* storage, uint32_t capacity);
+
+/*!
+ * @brief Add a subscriber
+ *
+ * the subscriber starts at the next beat published. subscribe before the
+ * producer starts - subscribers are not added atomically with a publish.
+ *
+ * @param ring   - pointer to the ring
+ * @param policy - what the producer does when the subscriber is a whole ring behind
+ * @param id     - filled with the subscriber id
+ * @return 1 on success, 0 if BEAT_RING_MAX_SUBSCRIBERS are subscribed
+ */
+uint8_t beat_ring_subscribe(beat_ring_t* ring, beat_ring_policy_t policy, uint32_t* id);
+
+/*!
+ * @brief Remove a subscriber (subscriber)
+ *
+ * a backpressure subscriber that stops reading has to unsubscribe, otherwise
+ * the producer can not publish anymore.
+ *
+ * @param ring - pointer to the ring
+ * @param id   - subscriber id
+ */
+void beat_ring_unsubscribe(beat_ring_t* ring, uint32_t id);
+
+/*!
+ * @brief Publish a beat to every subscriber (producer)
+ *
+ * never blocks. drop oldest subscribers that are a whole ring behind lose
+ * their oldest beat.
+ *
+ * @param ring   - pointer to the ring
+ * @param result - beat to publish
+ * @return 1 if published, 0 if a backpressure subscriber is a whole ring behind (nothing is written)
+ */
+uint8_t beat_ring_publish(beat_ring_t* ring, const ecg_wave_result_t* result);
+
+/*!
+ * @brief Mark the end of the stream (producer)
+ *
+ * @param ring - pointer to the ring
+ */
+void beat_ring_close(beat_ring_t* ring);
+
+/*!
+ * @brief Most beats any subscriber was behind after the last publish (producer)
+ *
+ * @param ring - pointer to the ring
+ * @return lag in beats
+ */
+uint32_t beat_ring_lag(beat_ring_t* ring);
+
+/*!
+ * @brief Read the next beat (subscriber)
+ *
+ * @param ring   - pointer to the ring
+ * @param id     - subscriber id
+ * @param result - filled with the beat
+ * @return 1 if a beat was read, 0 if the subscriber is up to date
+ */
+uint8_t beat_ring_read(beat_ring_t* ring, uint32_t id, ecg_wave_result_t* result);
+
+/*!
+ * @brief Check if the producer closed the ring (subscriber)
+ *
+ * check before beat_ring_read() - closed and nothing read means every beat was seen.
+ *
+ * @param ring - pointer to the ring
+ * @return 1 if closed
+ */
+uint8_t beat_ring_closed(beat_ring_t* ring);
+
+/*!
+ * @brief Get the lag metrics of a subscriber (any thread)
+ *
+ * @param ring  - pointer to the ring
+ * @param id    - subscriber id
+ * @param stats - pointer to the stats structure to fill
+ */
+void beat_ring_get_stats(beat_ring_t* ring, uint32_t id, beat_ring_stats_t* stats);
+
+#endif /* BEAT_RING_H */
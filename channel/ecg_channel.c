@@ -0,0 +1,572 @@
+#include "ecg_channel.h"
+
+#include <string.h>
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* carves the buffers out of the storage block in the order of ECG_CHANNEL_STORAGE() */
+static void bind_storage(ecg_channel_t* channel, uint8_t* storage)
+{
+  uint16_t fs = channel->sample_freq;
+
+  channel->storage = storage;
+  channel->input_storage = (float*)storage;
+  storage += ARENA_ROUND(INPUT_RING_SIZE * sizeof(float));
+  channel->feature_buffer = (float*)storage;
+  storage += ARENA_ROUND(ECG_BUFFER_SIZE(fs) * sizeof(float));
+  channel->filtered_buffer = (float*)storage;
+  storage += ARENA_ROUND(ECG_BUFFER_SIZE(fs) * FILTERED_BLOCKS(fs) * sizeof(float));
+  channel->filtered_q15 = (int16_t*)storage;
+  storage += ARENA_ROUND(ECG_BUFFER_SIZE(fs) * FILTERED_BLOCKS(fs) * sizeof(int16_t));
+  channel->window_q15 = (int16_t*)storage;
+  storage += ARENA_ROUND(BEAT_WINDOW_MAX(fs) * sizeof(int16_t));
+  channel->morph_storage = (float*)storage;
+}
+
+/* index of the beat queue of a channel no other task touches, e.g. one the seam check compares */
+static inline uint32_t queue_index(const osal_atomic_u32_t* index)
+{
+  return osal_atomic_load_relaxed((osal_atomic_u32_t*)index);
+}
+
+/* reports a beat without delineation - the thresholds and the templates do not learn from it */
+static uint8_t skip_beat(ecg_channel_t* channel, const qrs_stream_beat_t* beat, ecg_wave_result_t* result,
+                         uint8_t late)
+{
+  memset(&result->points, 0, sizeof(result->points));
+  memset(&result->intervals, 0, sizeof(result->intervals));
+  result->points.r_idx = beat->r_sample;
+  result->points.r_val = beat->r_val * 1000.0f; /* V to mV, like the delineation */
+  result->intervals.rr_interval = beat->rr_samples * channel->windows.samples_to_ms;
+  result->quality = 0;
+  channel->stats.beats_skipped += !late;
+  channel->stats.beats_late += late;
+  channel->curr_wave++;
+  osal_atomic_store_release(&channel->beat_head, osal_atomic_load_relaxed(&channel->beat_head) + 1);
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+uint8_t ecg_channel_init(ecg_channel_t* channel, uint32_t id, arena_t* arena)
+{
+  return ecg_channel_init_rate(channel, id, SAMPLE_FREQ, arena);
+}
+
+uint8_t ecg_channel_init_rate(ecg_channel_t* channel, uint32_t id, uint16_t sample_freq, arena_t* arena)
+{
+  uint8_t* storage = NULL;
+  uint16_t i = 0;
+
+  if (sample_freq == 0 || sample_freq > ECG_MAX_SAMPLE_FREQ) {
+    return 0;
+  }
+  storage = arena ? (uint8_t*)arena_alloc(arena, ECG_CHANNEL_STORAGE(sample_freq)) : channel->storage;
+  if (!storage || (!arena && sample_freq != channel->sample_freq)) {
+    return 0;
+  }
+
+  channel->id = id;
+  channel->sample_freq = sample_freq;
+  channel->buffer_size = (uint16_t)ECG_BUFFER_SIZE(sample_freq);
+  channel->filtered_size = (uint16_t)(channel->buffer_size * FILTERED_BLOCKS(sample_freq));
+  bind_storage(channel, storage);
+  ecg_windows_init(&channel->windows, sample_freq);
+  channel->lookback = (uint16_t)BEAT_LOOKBACK(&channel->windows);
+  channel->lookahead = (uint16_t)BEAT_LOOKAHEAD(&channel->windows);
+  baseline_wander_rate_init(&channel->filter_rate, sample_freq);
+  baseline_wander_init(&channel->filter);
+  channel->restart_filter = 0;
+  channel->prefiltered = 0;
+  channel->use_preprocess = 0;
+  channel->use_q15 = 0;
+  channel->volts_per_lsb = 0.0f;
+
+  spsc_ring_init(&channel->input, channel->input_storage, INPUT_RING_SIZE);
+  for (i = 0; i < channel->filtered_size; i++) {
+    channel->filtered_buffer[i] = 0.0f;
+    channel->filtered_q15[i] = 0;
+  }
+  channel->filtered_index = 0;
+  osal_atomic_store_relaxed(&channel->filtered_claim, 0);
+
+  qrs_stream_init(&channel->qrs, sample_freq);
+  channel->sample_count = 0;
+  osal_atomic_store_relaxed(&channel->beat_head, 0);
+  osal_atomic_store_relaxed(&channel->beat_ready, 0);
+  osal_atomic_store_relaxed(&channel->beat_tail, 0);
+
+  ecg_thresholds_init(&channel->thresholds);
+
+  channel->curr_wave = 0;
+  ecg_init(&channel->points, &channel->intervals);
+  channel->use_morphology = 0;
+  memset(&channel->morph, 0, sizeof(channel->morph));
+  channel->min_sqi = 0;
+  for (i = 0; i < BEAT_QUEUE_SIZE; i++) {
+    channel->beat_sqi[i] = SQI_NONE;
+    channel->beat_late[i] = 0;
+  }
+
+  channel->stats.samples_pushed = 0;
+  channel->stats.samples_filtered = 0;
+  channel->stats.beats_dropped = 0;
+  channel->stats.waves_detected = 0;
+  channel->stats.waves_accepted = 0;
+  channel->stats.blocks_scored = 0;
+  channel->stats.blocks_unusable = 0;
+  channel->stats.beats_skipped = 0;
+  channel->stats.beats_late = 0;
+  return 1;
+}
+
+uint64_t ecg_channel_footprint(uint32_t num_channels, uint16_t sample_freq)
+{
+  return ARENA_ROUND((uint64_t)num_channels * sizeof(ecg_channel_t)) +
+         (uint64_t)num_channels * ECG_CHANNEL_STORAGE(sample_freq);
+}
+
+ecg_channel_t* ecg_channels_create(arena_t* arena, uint32_t num_channels, uint16_t sample_freq)
+{
+  uint32_t i = 0;
+
+  ecg_channel_t* channels = (ecg_channel_t*)arena_alloc(arena, (uint64_t)num_channels * sizeof(ecg_channel_t));
+  if (!channels) {
+    return NULL;
+  }
+  for (i = 0; i < num_channels; i++) {
+    if (!ecg_channel_init_rate(&channels[i], i, sample_freq, arena)) {
+      return NULL;
+    }
+  }
+  return channels;
+}
+
+uint8_t ecg_channel_set_preprocess(ecg_channel_t* channel, const preprocess_stage_t* stages, uint8_t num_stages)
+{
+  if (!stages) {
+    channel->use_preprocess = 0;
+    return 1;
+  }
+  if (!preprocess_init(&channel->preprocess, channel->sample_freq, stages, num_stages)) {
+    return 0;
+  }
+  channel->use_preprocess = 1;
+  return 1;
+}
+
+void ecg_channel_set_prefiltered(ecg_channel_t* channel, uint8_t prefiltered)
+{
+  channel->prefiltered = prefiltered;
+}
+
+uint8_t ecg_channel_set_q15(ecg_channel_t* channel, float volts_per_lsb)
+{
+  if (volts_per_lsb <= 0.0f) {
+    channel->use_q15 = 0;
+    return 1;
+  }
+  if (biquad_q15_init(&channel->filter_q15, channel->filter_rate.num, channel->filter_rate.den,
+                      BASELINE_STATE_STAGES) != 0) {
+    return 0;
+  }
+  biquad_q15_reset(&channel->filter_q15_state);
+  channel->use_q15 = 1;
+  channel->volts_per_lsb = volts_per_lsb;
+  return 1;
+}
+
+void ecg_channel_set_filter_restart(ecg_channel_t* channel, uint8_t enable)
+{
+  channel->restart_filter = enable;
+}
+
+void ecg_channel_set_morphology(ecg_channel_t* channel, uint8_t enable)
+{
+  channel->use_morphology = enable;
+  if (enable) {
+    morph_init(&channel->morph, channel->sample_freq, channel->morph_storage);
+  }
+}
+
+void ecg_channel_set_sqi(ecg_channel_t* channel, uint8_t min_sqi)
+{
+  channel->min_sqi = min_sqi;
+  if (min_sqi > 0) {
+    sqi_init(&channel->sqi, channel->sample_freq);
+    sqi_seek(&channel->sqi, channel->sample_count / channel->buffer_size);
+  }
+}
+
+void ecg_channel_copy(ecg_channel_t* dst, const ecg_channel_t* src)
+{
+  uint8_t* storage = dst->storage;
+
+  /* the copy points at its own buffers, the templates move with their storage */
+  memcpy(dst, src, sizeof(*dst));
+  bind_storage(dst, storage);
+  memcpy(storage, src->storage, ECG_CHANNEL_STORAGE(src->sample_freq));
+  if (src->morph.templates) {
+    dst->morph.templates = dst->morph_storage + (src->morph.templates - src->morph_storage);
+    dst->morph.average = dst->morph_storage + (src->morph.average - src->morph_storage);
+    dst->morph.beat = dst->morph_storage + (src->morph.beat - src->morph_storage);
+    dst->morph.ones = dst->morph_storage + (src->morph.ones - src->morph_storage);
+  }
+  spsc_ring_init(&dst->input, dst->input_storage, INPUT_RING_SIZE);
+}
+
+void ecg_channel_seek(ecg_channel_t* channel, uint64_t first_sample)
+{
+  channel->sample_count = first_sample;
+  channel->filtered_index = (uint16_t)(first_sample % channel->filtered_size);
+  osal_atomic_store_relaxed(&channel->filtered_claim, (uint32_t)first_sample);
+  if (channel->use_preprocess && channel->preprocess.mwi_len > 0) {
+    channel->preprocess.mwi_pos = (uint16_t)(first_sample % channel->preprocess.mwi_len);
+  }
+  qrs_stream_seek(&channel->qrs, first_sample);
+  if (channel->min_sqi > 0) {
+    sqi_seek(&channel->sqi, first_sample / channel->buffer_size);
+  }
+}
+
+uint8_t ecg_channel_same_state(const ecg_channel_t* a, const ecg_channel_t* b)
+{
+  uint32_t head_a = queue_index(&a->beat_head), head_b = queue_index(&b->beat_head);
+  uint32_t ready_a = queue_index(&a->beat_ready), ready_b = queue_index(&b->beat_ready);
+  uint32_t pending = queue_index(&a->beat_tail) - head_a;
+  uint32_t i = 0;
+
+  if (a->sample_count != b->sample_count || a->filtered_index != b->filtered_index ||
+      a->sample_freq != b->sample_freq || a->prefiltered != b->prefiltered || a->use_preprocess != b->use_preprocess ||
+      a->use_q15 != b->use_q15 || a->restart_filter != b->restart_filter || a->min_sqi != b->min_sqi ||
+      a->use_morphology != b->use_morphology) {
+    return 0;
+  }
+
+  /* filter state - the settings are the same when both come from one init */
+  if (a->use_preprocess
+          ? (memcmp(a->preprocess.d, b->preprocess.d, sizeof(a->preprocess.d)) != 0 ||
+             memcmp(a->preprocess.d64, b->preprocess.d64, sizeof(a->preprocess.d64)) != 0 ||
+             memcmp(a->preprocess.x, b->preprocess.x, sizeof(a->preprocess.x)) != 0 ||
+             memcmp(a->preprocess.mwi_ring, b->preprocess.mwi_ring, sizeof(a->preprocess.mwi_ring)) != 0 ||
+             a->preprocess.mwi_pos != b->preprocess.mwi_pos ||
+             memcmp(&a->preprocess.mwi_sum, &b->preprocess.mwi_sum, sizeof(float)) != 0)
+          : (a->use_q15 ? memcmp(&a->filter_q15_state, &b->filter_q15_state, sizeof(a->filter_q15_state)) != 0
+                        : memcmp(&a->filter, &b->filter, sizeof(a->filter)) != 0)) {
+    return 0;
+  }
+
+  /* the samples the pending and the next beats are delineated on */
+  if (memcmp(a->filtered_buffer, b->filtered_buffer, a->filtered_size * sizeof(float)) != 0 ||
+      (a->use_q15 && memcmp(a->filtered_q15, b->filtered_q15, a->filtered_size * sizeof(int16_t)) != 0) ||
+      !qrs_stream_same_state(&a->qrs, &b->qrs) || (a->min_sqi > 0 && !sqi_same_state(&a->sqi, &b->sqi)) ||
+      (a->use_morphology && !morph_same_state(&a->morph, &b->morph))) {
+    return 0;
+  }
+
+  /* pending beats field by field, their queue slots may differ */
+  if (pending != queue_index(&b->beat_tail) - head_b || ready_a - head_a != ready_b - head_b) {
+    return 0;
+  }
+  for (i = 0; i < pending; i++) {
+    const qrs_stream_beat_t* ba = &a->beats[(head_a + i) % BEAT_QUEUE_SIZE];
+    const qrs_stream_beat_t* bb = &b->beats[(head_b + i) % BEAT_QUEUE_SIZE];
+    if (ba->r_sample != bb->r_sample || ba->rr_samples != bb->rr_samples || ba->search_back != bb->search_back ||
+        memcmp(&ba->r_val, &bb->r_val, sizeof(float)) != 0 || memcmp(&ba->peak, &bb->peak, sizeof(float)) != 0) {
+      return 0;
+    }
+    if (i < ready_a - head_a &&
+        (a->beat_sqi[(head_a + i) % BEAT_QUEUE_SIZE] != b->beat_sqi[(head_b + i) % BEAT_QUEUE_SIZE] ||
+         a->beat_late[(head_a + i) % BEAT_QUEUE_SIZE] != b->beat_late[(head_b + i) % BEAT_QUEUE_SIZE])) {
+      return 0;
+    }
+  }
+
+  /* what the next beat carries over from the last one */
+  return memcmp(&a->thresholds, &b->thresholds, sizeof(a->thresholds)) == 0 &&
+         a->points.p_idx == b->points.p_idx && a->points.r_idx == b->points.r_idx;
+}
+
+uint8_t ecg_channel_push_sample(ecg_channel_t* channel, float sample)
+{
+  uint8_t pushed = spsc_ring_push(&channel->input, sample);
+  channel->stats.samples_pushed += pushed;
+  return pushed;
+}
+
+uint32_t ecg_channel_pending(ecg_channel_t* channel)
+{
+  return spsc_ring_count(&channel->input);
+}
+
+uint8_t ecg_channel_preprocess(ecg_channel_t* channel)
+{
+  return ecg_channel_preprocess_frame(channel, 1);
+}
+
+uint8_t ecg_channel_preprocess_frame(ecg_channel_t* channel, uint16_t num_samples)
+{
+  uint16_t start = channel->filtered_index;
+  uint16_t offset = start % channel->buffer_size;       /* position in the block */
+  float* filtered = &channel->filtered_buffer[start];   /* the frame in the filtered ring */
+
+  spsc_span_t spans[2];
+
+  /* frames never cross the end of a block - the blocks tile the filtered ring, so they never wrap either */
+  num_samples = (uint16_t)spsc_ring_peek(&channel->input, MIN(num_samples, channel->buffer_size - offset), spans);
+  if (num_samples == 0) {
+    return 0;
+  }
+
+  /* claim the slots of the frame before writing them, the detect side checks its window against the claim */
+  osal_atomic_store_relaxed(&channel->filtered_claim, (uint32_t)(channel->sample_count + num_samples));
+  osal_atomic_fence();
+
+  if (channel->prefiltered) {
+    /* filtered offline - copy the frame as is */
+    memcpy(filtered, spans[0].data, spans[0].count * sizeof(float));
+    memcpy(&filtered[spans[0].count], spans[1].data, spans[1].count * sizeof(float));
+  } else if (channel->use_preprocess) {
+    /* the whole stage chain in one pass per span, the state carries across the wrap */
+    float* feature = (channel->preprocess.num_ops > 0) ? channel->feature_buffer : NULL;
+    preprocess_block(&channel->preprocess, spans[0].data, filtered, feature, spans[0].count);
+    preprocess_block(&channel->preprocess, spans[1].data, &filtered[spans[0].count],
+                     feature ? &feature[spans[0].count] : NULL, spans[1].count);
+  } else if (channel->use_q15) {
+    /* fixed point - quantize the frame into the int16 ring and filter it there in place */
+    int16_t* filtered_q15 = &channel->filtered_q15[start];
+    uint16_t i = 0;
+    for (; i < spans[0].count; i++) {
+      filtered_q15[i] = q15_from_float(spans[0].data[i], channel->volts_per_lsb);
+    }
+    for (i = 0; i < spans[1].count; i++) {
+      filtered_q15[spans[0].count + i] = q15_from_float(spans[1].data[i], channel->volts_per_lsb);
+    }
+    if (channel->restart_filter && offset == 0) {
+      biquad_q15_reset(&channel->filter_q15_state);
+    }
+    biquad_q15_filter_block(&channel->filter_q15, &channel->filter_q15_state, filtered_q15, filtered_q15,
+                            num_samples);
+
+    /* the detector, the SQI and the thresholds follow the filtered samples in V */
+    for (i = 0; i < num_samples; i++) {
+      filtered[i] = q15_to_float(filtered_q15[i], channel->volts_per_lsb);
+    }
+  } else {
+    /* looped test signal - restart the filter with every block, like baseline_wander_filter() with every pass */
+    if (channel->restart_filter && offset == 0) {
+      baseline_wander_init(&channel->filter);
+    }
+
+    /* apply baseline wander filter to the whole frame - in place from the ring, the state carries across the wrap */
+    baseline_wander_filter_block_rate(&channel->filter_rate, &channel->filter, spans[0].data, filtered,
+                                      spans[0].count);
+    baseline_wander_filter_block_rate(&channel->filter_rate, &channel->filter, spans[1].data,
+                                      &filtered[spans[0].count], spans[1].count);
+  }
+
+  /* signal quality of the block, from the raw samples before they leave the ring */
+  if (channel->min_sqi > 0) {
+    sqi_process(&channel->sqi, spans[0].data, filtered, spans[0].count);
+    sqi_process(&channel->sqi, spans[1].data, &filtered[spans[0].count], spans[1].count);
+  }
+  spsc_ring_release(&channel->input, num_samples);
+  channel->filtered_index = (start + num_samples >= channel->filtered_size) ? 0 : start + num_samples;
+  channel->stats.samples_filtered += num_samples;
+  if (channel->min_sqi > 0 && offset + num_samples == channel->buffer_size) {
+    channel->stats.blocks_scored++;
+    channel->stats.blocks_unusable += sqi_end_block(&channel->sqi, NULL) < channel->min_sqi;
+  }
+
+  /* streaming R peak detection - constant work per sample, on the integrator of the chain if it has one */
+  uint8_t have_feature = channel->use_preprocess && !channel->prefiltered && channel->preprocess.num_ops > 0;
+  uint16_t i = 0;
+  for (; i < num_samples; i++) {
+    qrs_stream_beat_t beat;
+    uint8_t found = have_feature
+                        ? qrs_stream_process_feature(&channel->qrs, filtered[i], channel->feature_buffer[i], &beat)
+                        : qrs_stream_process(&channel->qrs, filtered[i], &beat);
+    if (!found) {
+      continue;
+    }
+    /* the detect side frees a slot with its release of beat_head, the slot is published with the release of
+     * beat_tail */
+    uint32_t tail = osal_atomic_load_relaxed(&channel->beat_tail);
+    if (tail - osal_atomic_load_acquire(&channel->beat_head) < BEAT_QUEUE_SIZE) {
+      channel->beats[tail % BEAT_QUEUE_SIZE] = beat;
+      osal_atomic_store_release(&channel->beat_tail, tail + 1);
+    } else {
+      channel->stats.beats_dropped++;
+    }
+  }
+  channel->sample_count += num_samples;
+
+  /* a beat is ready once the samples its T wave search needs are filtered, and its block is scored */
+  uint16_t to_block_end = (uint16_t)((channel->buffer_size - channel->filtered_index % channel->buffer_size) %
+                                     channel->buffer_size);
+  uint32_t next = osal_atomic_load_relaxed(&channel->beat_ready);
+  uint32_t tail = osal_atomic_load_acquire(&channel->beat_tail);
+  uint8_t ready = 0;
+  for (; next != tail; next++) {
+    const qrs_stream_beat_t* beat = &channel->beats[next % BEAT_QUEUE_SIZE];
+    uint8_t* sqi = &channel->beat_sqi[next % BEAT_QUEUE_SIZE];
+    if (beat->r_sample + channel->lookahead > channel->sample_count) {
+      break;
+    }
+    if (channel->min_sqi > 0) {
+      uint64_t block = beat->r_sample / channel->buffer_size;
+      if (block >= channel->sqi.block) {
+        break;
+      }
+      *sqi = sqi_block_score(&channel->sqi, block);
+    } else {
+      *sqi = SQI_NONE;
+    }
+
+    /* a search back beat may come so late that the ring overwrites the front of its window - checked at the
+     * end of the block, the frames never cross it, so the outcome does not depend on how the input is framed */
+    channel->beat_late[next % BEAT_QUEUE_SIZE] =
+        channel->sample_count + to_block_end + channel->lookback - beat->r_sample > channel->filtered_size;
+    ready++;
+  }
+  /* publishes the beats with their scores and flags to the detect side */
+  osal_atomic_store_release(&channel->beat_ready, next);
+  return ready;
+}
+
+uint8_t ecg_channel_detect(ecg_channel_t* channel, ecg_wave_result_t* result)
+{
+  const float samples_to_ms = channel->windows.samples_to_ms;
+  const uint32_t head = osal_atomic_load_relaxed(&channel->beat_head);
+  const qrs_stream_beat_t* beat = &channel->beats[head % BEAT_QUEUE_SIZE];
+  const uint16_t lookback = channel->lookback;
+  const uint16_t filtered_size = channel->filtered_size;
+  uint8_t sqi = 0;
+  uint8_t late = 0;
+  buffer_view_t window;                         /* the samples around the R peak, in place in the filtered ring */
+
+  /* pairs with the release of beat_ready - the beat, its score and its flag are complete from here on */
+  osal_atomic_load_acquire(&channel->beat_ready);
+  sqi = channel->beat_sqi[head % BEAT_QUEUE_SIZE];
+  late = channel->beat_late[head % BEAT_QUEUE_SIZE];
+
+  result->channel_id = channel->id;
+  result->wave = channel->curr_wave;
+  result->r_sample = beat->r_sample;
+  result->sqi = sqi;
+  memset(&result->morph, 0, sizeof(result->morph));
+
+  /* unusable block or a window the ring no longer holds - no delineation */
+  if ((sqi != SQI_NONE && sqi < channel->min_sqi) || late) {
+    return skip_beat(channel, beat, result, late);
+  }
+
+  /* absolute sample of window[0] - may be "negative" for the first beat, those samples fall on ring slots
+   * that were never written and are zero */
+  uint64_t first = beat->r_sample - lookback;
+  uint32_t start = (beat->r_sample >= lookback) ? (uint32_t)(first % filtered_size)
+                                                : filtered_size - (uint32_t)(lookback - beat->r_sample);
+  buffer_view_init(&window, channel->filtered_buffer, filtered_size, start, lookback + channel->lookahead);
+
+  /* the state the beat changes before its window is known to be intact */
+  wave_thresholds_t thresholds = channel->thresholds;
+  wave_points_t points = channel->points;
+
+  /* follow the gain of the channel - window[0] is in front of the PR window, on the baseline */
+  ecg_thresholds_update(&channel->thresholds, buffer_view_at(&window, lookback), buffer_view_at(&window, 0));
+
+  /* Q, S, P and T detection around the streamed R peak - the points come out as absolute samples */
+  channel->points.prev_p_idx = channel->points.p_idx;
+  channel->points.prev_r_idx = channel->points.r_idx;
+  if (channel->use_q15) {
+    /* the int16 searches take one contiguous window, copied out of the ring only where it wraps */
+    const int16_t* window_q15 = &channel->filtered_q15[start];
+    uint32_t len = lookback + channel->lookahead;
+    wave_thresholds_q15_t thresholds_q15;
+    if (start + len > filtered_size) {
+      memcpy(channel->window_q15, window_q15, (filtered_size - start) * sizeof(int16_t));
+      memcpy(&channel->window_q15[filtered_size - start], channel->filtered_q15,
+             (start + len - filtered_size) * sizeof(int16_t));
+      window_q15 = channel->window_q15;
+    }
+    ecg_thresholds_q15(&channel->thresholds, channel->volts_per_lsb, &thresholds_q15);
+    ecg_delineate_pqrst_q15(window_q15, first, lookback, len, &thresholds_q15, &channel->windows, &channel->points);
+  } else {
+    ecg_delineate_pqrst(&window, first, lookback, &channel->thresholds, &channel->windows, &channel->points);
+  }
+
+  /* shape of the beat around the delineated R peak, the streamed one if that does not leave room for the window */
+  if (channel->use_morphology) {
+    uint64_t r_idx = channel->points.r_idx - first;
+    if (channel->points.r_idx == 0 || r_idx < channel->morph.pre ||
+        r_idx > (uint32_t)(lookback + channel->lookahead - channel->morph.post)) {
+      r_idx = lookback;
+    }
+    morph_load_beat(&channel->morph, &window, (uint32_t)r_idx);
+  }
+
+  /* every read of the ring is done - a detect side that fell behind may have read a window the preprocessing
+   * overwrote meanwhile, the beat is then late and its reads are undone */
+  osal_atomic_fence();
+  if ((uint32_t)(osal_atomic_load_relaxed(&channel->filtered_claim) - (uint32_t)first) > filtered_size) {
+    channel->thresholds = thresholds;
+    channel->points = points;
+    return skip_beat(channel, beat, result, 1);
+  }
+  ecg_calculate_intervals(&channel->points, &channel->windows, &channel->intervals);
+
+  /* RR from the detector, it also counts the beats a full queue dropped */
+  channel->intervals.rr_interval = beat->rr_samples * samples_to_ms;
+  uint8_t quality = ecg_validate_detection(&channel->points, &channel->intervals);
+
+  channel->stats.waves_detected++;
+  if (quality >= MIN_WAVE_QUALITY) {
+    channel->stats.waves_accepted++;
+  }
+
+  result->points = channel->points;
+  result->intervals = channel->intervals;
+  result->quality = quality;
+  if (channel->use_morphology) {
+    morph_classify_beat(&channel->morph, &result->morph);
+  }
+
+  /* the beat is done, its slot goes back to the preprocessing */
+  channel->curr_wave++;
+  osal_atomic_store_release(&channel->beat_head, head + 1);
+
+  return quality;
+}
+
+uint32_t ecg_channel_process(ecg_channel_t* channel, const float* samples, uint32_t num_samples,
+                             ecg_wave_result_fn on_result, void* user)
+{
+  ecg_wave_result_t result;
+  uint32_t waves = 0;
+  uint32_t i = 0;
+
+  while (i < num_samples) {
+    /* push up to the end of the block and filter it as one frame */
+    uint16_t offset = channel->filtered_index % channel->buffer_size;
+    uint16_t frame = (uint16_t)MIN(num_samples - i, (uint32_t)(channel->buffer_size - offset));
+    frame = (uint16_t)spsc_ring_push_bulk(&channel->input, &samples[i], frame);
+    channel->stats.samples_pushed += frame;
+    i += frame;
+
+    /* delineate every beat the frame completed - drains whatever is pending */
+    uint8_t ready = ecg_channel_preprocess_frame(channel, channel->buffer_size);
+    for (; ready > 0; ready--) {
+      ecg_channel_detect(channel, &result);
+      waves++;
+      if (on_result) {
+        on_result(user, &result);
+      }
+    }
+  }
+
+  return waves;
+}
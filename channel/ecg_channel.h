@@ -0,0 +1,400 @@
+#ifndef ECG_CHANNEL_H
+#define ECG_CHANNEL_H
+
+#include <stdint.h>
+
+#include "config/config.h"
+#include "buffers/arena.h"
+#include "buffers/spsc_ring.h"
+#include "filters/biquad_q15.h"
+#include "filters/ecg_filters.h"
+#include "filters/preprocess.h"
+#include "feature_extract/pqrst_detector.h"
+#include "feature_extract/qrs_stream.h"
+#include "feature_extract/morphology.h"
+#include "feature_extract/sqi.h"
+
+/* samples of the filtered ring a beat is delineated on around its R peak -
+ * one spare sample in front so index 0 of the window is never a real point */
+#define BEAT_LOOKBACK(w)  ((w)->pr_window + (w)->qrs_window + 1)  /* samples before the R peak */
+#define BEAT_LOOKAHEAD(w) ((w)->qrs_window + (w)->qt_window)      /* samples from the R peak on */
+#define BEAT_QUEUE_SIZE 8                                      /* beats waiting for delineation */
+
+/* BEAT_LOOKBACK() + BEAT_LOOKAHEAD() of the windows of a rate, as a constant */
+#define BEAT_WINDOW_MAX(fs)                                                                              \
+  (ECG_MS_TO_SAMPLES(PR_WINDOW_MS, fs) + 2 * ECG_MS_TO_SAMPLES(QRS_WINDOW_MS, fs) +                      \
+   ECG_MS_TO_SAMPLES(QT_WINDOW_MS, fs) + 1)
+
+/* blocks (ECG_BUFFER_SIZE) of filtered samples a channel keeps at a rate - the lookback, the longest
+ * search back delay (QRS_STREAM_SEARCH_BACK_MAX()) and the lookahead in front of the end of the block a
+ * beat becomes ready in, rounded up (5 blocks at the common rates). a beat that needs no search back is
+ * ready a lookahead after its R peak, the rest of the ring is room for a detect side that lags */
+#define FILTERED_BLOCKS(fs) \
+  ((BEAT_WINDOW_MAX(fs) + QRS_STREAM_SEARCH_BACK_MAX(fs) + 2 * ECG_BUFFER_SIZE(fs) - 2) / ECG_BUFFER_SIZE(fs))
+
+/* bytes of the buffers of a channel at a rate - input ring, feature buffer, filtered ring, its
+ * fixed-point twin and beat window and morphology templates, each on its own cache lines */
+#define ECG_CHANNEL_STORAGE(fs)                                                                         \
+  (ARENA_ROUND(INPUT_RING_SIZE * sizeof(float)) + ARENA_ROUND(ECG_BUFFER_SIZE(fs) * sizeof(float)) +     \
+   ARENA_ROUND(ECG_BUFFER_SIZE(fs) * FILTERED_BLOCKS(fs) * sizeof(float)) +                              \
+   ARENA_ROUND(ECG_BUFFER_SIZE(fs) * FILTERED_BLOCKS(fs) * sizeof(int16_t)) +                            \
+   ARENA_ROUND(BEAT_WINDOW_MAX(fs) * sizeof(int16_t)) + ARENA_ROUND(MORPH_STORAGE_FLOATS(fs) * sizeof(float)))
+
+/* result of one detected wave - a copy, the channel overwrites its points
+ * and intervals with every beat */
+typedef struct {
+  uint32_t channel_id;        /* id of the channel the wave belongs to */
+  uint32_t wave;              /* beat number since the channel init */
+  uint64_t r_sample;          /* absolute sample of the R peak since the channel init */
+  wave_points_t points;       /* detected P Q R S T points */
+  wave_intervals_t intervals; /* calculated intervals */
+  uint8_t quality;            /* detection quality (0-100) */
+  morph_match_t morph;        /* beat class and template, MORPH_CLASS_NONE without morphology */
+  uint8_t sqi;                /* signal quality of the block of the R peak (0-100), SQI_NONE without SQI */
+} ecg_wave_result_t;
+
+/* called for every detected wave by ecg_channel_process() */
+typedef void (*ecg_wave_result_fn)(void* user, const ecg_wave_result_t* result);
+
+/* channel counters */
+typedef struct {
+  uint32_t samples_pushed;    /* raw samples written into the input buffer */
+  uint32_t samples_filtered;  /* samples passed through the baseline filter */
+  uint32_t beats_dropped;     /* beats lost because the beat queue was full */
+  uint32_t waves_detected;    /* waves passed through the detector */
+  uint32_t waves_accepted;    /* waves with quality >= MIN_WAVE_QUALITY */
+  uint32_t blocks_scored;     /* blocks the SQI scored */
+  uint32_t blocks_unusable;   /* blocks below the minimum SQI */
+  uint32_t beats_skipped;     /* beats in unusable blocks, reported without delineation */
+  uint32_t beats_late;        /* beats whose window left the filtered ring, reported without delineation */
+} ecg_channel_stats_t;
+
+/* per channel (lead/patient) context - everything one ECG stream needs,
+ * so any number of channels can be processed independently and concurrently */
+typedef struct {
+  uint32_t id;                                  /* channel id reported in the results */
+
+  /* rate dependent settings - fixed at init */
+  uint16_t sample_freq;                         /* sampling frequency in Hz */
+  uint16_t buffer_size;                         /* samples per block - SQI and the filter restart */
+  uint16_t filtered_size;                       /* slots of filtered_buffer, FILTERED_BLOCKS() blocks */
+  uint16_t lookback;                            /* BEAT_LOOKBACK() of the windows */
+  uint16_t lookahead;                           /* BEAT_LOOKAHEAD() of the windows */
+  baseline_wander_rate_t filter_rate;           /* baseline wander coefficients and kernel */
+  wave_windows_t windows;                       /* P, QRS and T search windows in samples */
+
+  baseline_wander_state_t filter;               /* baseline wander filter delay states */
+  uint8_t restart_filter;                       /* restart the filter every block, see ecg_channel_set_filter_restart() */
+  uint8_t prefiltered;                          /* input is already baseline filtered (zero-phase batch mode) */
+  uint8_t use_preprocess;                       /* preprocess replaces the baseline wander filter */
+  uint8_t use_q15;                              /* fixed-point filter and delineation, see ecg_channel_set_q15() */
+  float volts_per_lsb;                          /* V per ADC unit of the fixed-point path */
+  biquad_q15_t filter_q15;                      /* baseline wander cascade quantized for int16 samples */
+  biquad_q15_state_t filter_q15_state;          /* its delay states */
+  preprocess_chain_t preprocess;                /* runtime stage chain, see ecg_channel_set_preprocess() */
+  float* feature_buffer;                        /* integrator output of the chain for the frame, buffer_size */
+
+  /* buffers sized for the rate, carved out of one block of ECG_CHANNEL_STORAGE() bytes at init */
+  uint8_t* storage;
+
+  spsc_ring_t input;                            /* raw samples, producer (ISR) to preprocessing */
+  float* input_storage;                         /* INPUT_RING_SIZE slots of the input ring */
+
+  float* filtered_buffer;                       /* ring of filtered samples, every sample is written once */
+  uint16_t filtered_index;                      /* next slot of the ring - slot of sample n is n % filtered_size */
+  osal_atomic_u32_t filtered_claim;             /* low 32 bits of the samples written or being written */
+  int16_t* filtered_q15;                        /* the filtered ring in ADC units, fixed-point path only */
+  int16_t* window_q15;                          /* beat window copied out of filtered_q15 where it wraps (detect side) */
+
+  qrs_stream_t qrs;                             /* streaming R peak detector */
+  uint64_t sample_count;                        /* filtered samples so far - absolute sample number */
+  qrs_stream_beat_t beats[BEAT_QUEUE_SIZE];     /* detected beats waiting for delineation */
+  uint8_t beat_sqi[BEAT_QUEUE_SIZE];            /* SQI of the block of every ready beat */
+  uint8_t beat_late[BEAT_QUEUE_SIZE];           /* the window of the ready beat left the filtered ring */
+  osal_atomic_u32_t beat_head;                  /* next beat to delineate (detect side) */
+  osal_atomic_u32_t beat_ready;                 /* beats with all their samples filtered (preprocess side) */
+  osal_atomic_u32_t beat_tail;                  /* next free queue entry (preprocess side) */
+
+  wave_thresholds_t thresholds;                 /* adaptive R, Q and S thresholds of this channel */
+
+  uint32_t curr_wave;                           /* number of the next delineated beat */
+  wave_points_t points;                         /* points of the last detected wave, absolute samples */
+  wave_intervals_t intervals;                   /* intervals of the last detected wave */
+
+  uint8_t use_morphology;                       /* classify every beat, see ecg_channel_set_morphology() */
+  morph_bank_t morph;                           /* learned beat templates (detect side) */
+  float* morph_storage;                         /* MORPH_STORAGE_FLOATS() of the rate for the templates */
+
+  uint8_t min_sqi;                              /* SQI a block needs, 0 without SQI - see ecg_channel_set_sqi() */
+  sqi_t sqi;                                    /* signal quality of the blocks (preprocess side) */
+
+  ecg_channel_stats_t stats;                    /* channel counters */
+} ecg_channel_t;
+
+/*!
+ * @brief Init a channel at SAMPLE_FREQ
+ *
+ * @param channel - pointer to the channel context
+ * @param id      - channel id reported in the results
+ * @param arena   - arena the buffers are carved from, see ecg_channel_init_rate()
+ * @return 1 on success, 0 if the arena is full
+ */
+uint8_t ecg_channel_init(ecg_channel_t* channel, uint32_t id, arena_t* arena);
+
+/*!
+ * @brief Init a channel at any sampling rate
+ *
+ * buffers keep the time span they have at SAMPLE_FREQ and the search windows
+ * keep their length in ms. 80, 250, 360, 500 and 1000 Hz use baseline filter
+ * kernels compiled for the rate, other rates a filter designed at init.
+ *
+ * the buffers take ECG_CHANNEL_STORAGE(sample_freq) bytes of the arena and
+ * nothing is allocated after the init. a channel can be initialized again
+ * on its own buffers with a NULL arena, at the rate of its first init.
+ *
+ * @param channel     - pointer to the channel context
+ * @param id          - channel id reported in the results
+ * @param sample_freq - sampling frequency in Hz
+ * @param arena       - arena to carve the buffers from, NULL to keep the buffers of an earlier init
+ * @return 1 on success, 0 if sample_freq is 0 or above ECG_MAX_SAMPLE_FREQ or the arena is full
+ */
+uint8_t ecg_channel_init_rate(ecg_channel_t* channel, uint32_t id, uint16_t sample_freq, arena_t* arena);
+
+/*!
+ * @brief Bytes a set of channels takes in an arena - the contexts and their buffers
+ *
+ * @param num_channels - number of channels
+ * @param sample_freq  - sampling frequency in Hz
+ * @return footprint in bytes, the arena size for ecg_channels_create()
+ */
+uint64_t ecg_channel_footprint(uint32_t num_channels, uint16_t sample_freq);
+
+/*!
+ * @brief Carve a set of channels out of an arena and init them
+ *
+ * the contexts are one array, ids 0 .. num_channels - 1.
+ *
+ * @param arena        - arena of ecg_channel_footprint() bytes at least
+ * @param num_channels - number of channels
+ * @param sample_freq  - sampling frequency in Hz
+ * @return the channels, NULL if the rate is invalid or the arena is full
+ */
+ecg_channel_t* ecg_channels_create(arena_t* arena, uint32_t num_channels, uint16_t sample_freq);
+
+/*!
+ * @brief Replace the baseline wander filter of the channel with a stage chain
+ *
+ * the output of the filter stages is the filtered signal the beats are
+ * delineated on. a chain with feature stages hands their output to the
+ * streaming detector as its integrator signal (qrs_stream_process_feature()),
+ * so e.g. baseline, notch, low-pass, derivative, squaring and integrator run
+ * fused in one pass per frame. the chain is never restarted. call before the
+ * first sample is pushed.
+ *
+ * @param channel    - pointer to the channel context
+ * @param stages     - stages at the channel rate, NULL for the baseline wander filter
+ * @param num_stages - number of stages
+ * @return 1 on success, 0 if preprocess_init() refuses the chain (the channel is unchanged)
+ */
+uint8_t ecg_channel_set_preprocess(ecg_channel_t* channel, const preprocess_stage_t* stages, uint8_t num_stages);
+
+/*!
+ * @brief Skip the baseline wander filter of the channel
+ *
+ * for input that was filtered offline, e.g. zero-phase by
+ * ecg_batch_run_zero_phase(). call before the first sample is pushed.
+ *
+ * @param channel     - pointer to the channel context
+ * @param prefiltered - 1 if the pushed samples are already filtered
+ */
+void ecg_channel_set_prefiltered(ecg_channel_t* channel, uint8_t prefiltered);
+
+/*!
+ * @brief Run the baseline wander filter and the delineation in fixed point
+ *
+ * every pushed sample is quantized to int16 ADC units and filtered by the
+ * int16 cascade of the rate (biquad_q15_filter_block()) into a fixed-point
+ * twin of the filtered ring, the beats are delineated on it
+ * (ecg_delineate_pqrst_q15()) - the path of a DSP without an FPU. the streaming
+ * detector, the thresholds, the SQI and the morphology read the filtered
+ * samples converted back to V. a volts_per_lsb of the ADC of the input keeps
+ * the quantization exact. only replaces the baseline wander filter, a stage
+ * chain or prefiltered input take precedence. call before the first sample is
+ * pushed.
+ *
+ * @param channel       - pointer to the channel context
+ * @param volts_per_lsb - V per ADC unit, 0 for the float path
+ * @return 1 on success, 0 if the filter of the rate does not fit the int16 cascade (the channel is unchanged)
+ */
+uint8_t ecg_channel_set_q15(ecg_channel_t* channel, float volts_per_lsb);
+
+/*!
+ * @brief Restart the baseline wander filter with every block
+ *
+ * the filter state carries across the blocks after the init. the board loops
+ * QRS_IN, one beat with a step at its loop point, and restarts the filter with
+ * every block like baseline_wander_filter() with every pass over its buffer,
+ * which keeps the step out of the filtered beats. call before the first sample
+ * is pushed.
+ *
+ * @param channel - pointer to the channel context
+ * @param enable  - 1 to restart the filter at the start of every block, 0 to keep its state
+ */
+void ecg_channel_set_filter_restart(ecg_channel_t* channel, uint8_t enable);
+
+/*!
+ * @brief Classify every beat of the channel by its shape
+ *
+ * every delineated beat is aligned on its R peak and correlated with the
+ * templates the channel learned so far (morph_classify()), the class lands in
+ * the morph field of the result. off after the init. the templates are part
+ * of ecg_channel_same_state() - a shard of a long record learns its own from
+ * the warm-up on, its seam is exact only once its bank matches the serial one.
+ *
+ * @param channel - pointer to the channel context
+ * @param enable  - 1 to classify, 0 to leave the morph field at MORPH_CLASS_NONE
+ */
+void ecg_channel_set_morphology(ecg_channel_t* channel, uint8_t enable);
+
+/*!
+ * @brief Score the signal quality of every block and skip the unusable ones
+ *
+ * every block of buffer_size samples is scored from the raw and the filtered
+ * samples as they go through the preprocessing, O(1) per sample
+ * (sqi_process()). a beat becomes ready once its block is scored as
+ * well, so the results come up to a block later. the beats of a block below
+ * min_sqi are not delineated: their result carries the streamed R peak, the
+ * detector RR interval and quality 0. off after the init.
+ *
+ * @param channel - pointer to the channel context
+ * @param min_sqi - score a block needs for its beats to be delineated, e.g. SQI_MIN_USABLE, 0 to turn the SQI off
+ */
+void ecg_channel_set_sqi(ecg_channel_t* channel, uint8_t min_sqi);
+
+/*!
+ * @brief Copy a channel with all its state
+ *
+ * the copy owns its input ring, which starts empty - only copy a channel
+ * between ecg_channel_process() calls, when everything pushed is filtered.
+ * the copy keeps its own buffers, dst has to be initialized at the rate of src.
+ *
+ * @param dst - pointer to the copy
+ * @param src - pointer to the channel to copy
+ */
+void ecg_channel_copy(ecg_channel_t* dst, const ecg_channel_t* src);
+
+/*!
+ * @brief Start a fresh channel at an absolute sample number
+ *
+ * for a channel that joins a signal in the middle (a shard of a long record):
+ * r_sample and the points refer to the whole signal and a filter that restarts
+ * every block restarts where it would in a run from sample 0. call after the
+ * init and before the first sample is pushed.
+ *
+ * @param channel      - pointer to the channel context
+ * @param first_sample - absolute sample number of the first pushed sample
+ */
+void ecg_channel_seek(ecg_channel_t* channel, uint64_t first_sample);
+
+/*!
+ * @brief Check if two channels will emit the same waves from now on
+ *
+ * compares, bit for bit, every part of the state the later results depend on:
+ * filter, buffers, detector, pending beats, thresholds, the last points, the SQI
+ * and the morphology templates.
+ * the wave numbering and the counters are not compared.
+ *
+ * @param a - channel context
+ * @param b - channel context
+ * @return 1 if the states are the same, 0 otherwise
+ */
+uint8_t ecg_channel_same_state(const ecg_channel_t* a, const ecg_channel_t* b);
+
+/*!
+ * @brief Write a raw sample into the channel input ring
+ *
+ * producer side of the input ring, safe against a concurrent
+ * ecg_channel_preprocess_frame() on another thread or task.
+ *
+ * @param channel - pointer to the channel context
+ * @param sample  - raw ECG sample in V
+ * @return 1 if pushed, 0 if the ring was full and the sample was dropped
+ */
+uint8_t ecg_channel_push_sample(ecg_channel_t* channel, float sample);
+
+/*!
+ * @brief Raw samples waiting for preprocessing (consumer side)
+ *
+ * @param channel - pointer to the channel context
+ * @return number of samples in the input ring
+ */
+uint32_t ecg_channel_pending(ecg_channel_t* channel);
+
+/*!
+ * @brief Filter the next pushed sample
+ *
+ * applies the baseline wander filter to the next sample of the input buffer,
+ * stores it in the filtered ring and feeds it to the streaming QRS detector.
+ *
+ * @param channel - pointer to the channel context
+ * @return number of beats that became ready for ecg_channel_detect()
+ */
+uint8_t ecg_channel_preprocess(ecg_channel_t* channel);
+
+/*!
+ * @brief Filter the next frame of pushed samples
+ *
+ * block version of ecg_channel_preprocess(): filters up to num_samples pushed
+ * samples straight out of the input ring (one baseline_wander_filter_block()
+ * call per contiguous span) into the filtered ring. a frame never crosses the
+ * end of a block, so it is cut short there, and it is shorter if fewer samples
+ * are pending.
+ *
+ * a beat is ready once BEAT_LOOKAHEAD() samples after its R peak are filtered
+ * (and its block is scored with the SQI on), the latency from the R peak to
+ * its result is therefore bounded and does not depend on the heart rate.
+ *
+ * @param channel     - pointer to the channel context
+ * @param num_samples - number of samples to filter
+ * @return number of beats that became ready for ecg_channel_detect()
+ */
+uint8_t ecg_channel_preprocess_frame(ecg_channel_t* channel, uint16_t num_samples);
+
+/*!
+ * @brief Delineate the next ready beat
+ *
+ * runs P, Q, S and T detection around the R peak found by the streaming
+ * detector, interval calculation and validation. the searches read the window
+ * in place in the filtered ring. a beat whose window was already overwritten
+ * when it became ready is reported like the beats of unusable blocks and
+ * counted in beats_late - the ring is sized so a search back beat is never
+ * that late. a detect side that lags on another task may read a window while
+ * the preprocessing overwrites it: the window is checked again against the
+ * samples the preprocessing claimed once the reads are done, and a torn beat
+ * is reported late and leaves the thresholds, the points and the templates as
+ * they were. must only be called once for every beat reported ready by
+ * ecg_channel_preprocess_frame().
+ *
+ * @param channel - pointer to the channel context
+ * @param result  - filled with the detected wave
+ * @return detection quality (0-100)
+ */
+uint8_t ecg_channel_detect(ecg_channel_t* channel, ecg_wave_result_t* result);
+
+/*!
+ * @brief Run a block of raw samples through the whole channel pipeline
+ *
+ * push, preprocess and detect in one call - used when the samples are already
+ * in memory (batch processing) and no ISR/task handoff is needed.
+ *
+ * @param channel     - pointer to the channel context
+ * @param samples     - raw ECG samples in V
+ * @param num_samples - number of samples
+ * @param on_result   - called for every detected wave (may be NULL)
+ * @param user        - user pointer passed to on_result
+ * @return number of waves detected
+ */
+uint32_t ecg_channel_process(ecg_channel_t* channel, const float* samples, uint32_t num_samples,
+                             ecg_wave_result_fn on_result, void* user);
+
+#endif /* ECG_CHANNEL_H */
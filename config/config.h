@@ -7,12 +7,33 @@
  * DEFINES & MACROS
  *****************************************************************************/
 
-#define SAMPLE_FREQ 80              /* sampling frequency in Hz */
+#define SAMPLE_FREQ 80              /* sampling frequency in Hz of the board (QRS_IN) - channels can run at other rates */
 #define BUFFER_SIZE 85              /* number of samples in the input signal */
 #define NUM_OF_WAVES 4              /* number of repeated PQRST waves */
-#define EXTENDED_BUFFER_SIZE BUFFER_SIZE * NUM_OF_WAVES /* number of samples in the filtered signal */
-
-/* threshold levels for wave detection - based on percentage of R peak amplitude */
+#define EXTENDED_BUFFER_SIZE (BUFFER_SIZE * NUM_OF_WAVES) /* number of samples in the filtered signal */
+#define FRAME_SIZE 5                /* default samples filtered per preprocessing wakeup - divides BUFFER_SIZE */
+#define INPUT_RING_SIZE 128         /* raw samples between the ISR and preprocessing - power of two >= BUFFER_SIZE */
+#define BEAT_RING_SIZE 16           /* detected waves between feature detection and its subscribers - power of two */
+
+/* highest channel sampling rate - sizes the per channel buffers, the board only runs at SAMPLE_FREQ */
+#ifndef ECG_MAX_SAMPLE_FREQ
+#if defined(__TI_COMPILER_VERSION__)
+#define ECG_MAX_SAMPLE_FREQ SAMPLE_FREQ
+#else
+#define ECG_MAX_SAMPLE_FREQ 1000
+#endif
+#endif
+
+/* milliseconds to samples at a sampling rate, rounded */
+#define ECG_MS_TO_SAMPLES(ms, fs) (((uint32_t)(ms) * (fs) + 500u) / 1000u)
+
+/* buffers scale with the sampling rate - the same time span as BUFFER_SIZE at SAMPLE_FREQ */
+#define ECG_BUFFER_SIZE(fs) (((uint32_t)BUFFER_SIZE * (fs) + SAMPLE_FREQ / 2) / SAMPLE_FREQ)
+#define BUFFER_SIZE_MAX ECG_BUFFER_SIZE(ECG_MAX_SAMPLE_FREQ)
+#define EXTENDED_BUFFER_SIZE_MAX (BUFFER_SIZE_MAX * NUM_OF_WAVES)
+
+/* threshold levels for wave detection - fraction of the way from the running noise
+ * level to the running R peak level of the channel (absolute V before the first beat) */
 #define R_PEAK_THRESHOLD    0.6f    /* r wave must exceed 60% of max amplitude */
 #define Q_WAVE_THRESHOLD    0.1f    /* q wave minimum -10% of r peak */
 #define S_WAVE_THRESHOLD    0.2f    /* s wave minimum -20% of r peak */
@@ -21,10 +42,18 @@
 /*#define P_WAVE_THRESHOLD    0.15f    p wave typically 15% of r peak */
 /*#define T_WAVE_THRESHOLD    0.2f     t wave typically 20% of r peak */
 
-/* time windows for detecting wave components at 80hz sampling rate */
-#define PR_WINDOW_MAX       16      /* pr intterval max 200ms (16 samples) */
-#define QRS_WINDOW_MAX      8       /* qrs complex max 100ms (8 samples) */
-#define QT_WINDOW_MAX       32      /* qt interval max 400ms (32 samples) */
+/* time windows for detecting wave components - converted to samples per channel rate */
+#define PR_WINDOW_MS        200     /* pr intterval max 200ms */
+#define QRS_WINDOW_MS       100     /* qrs complex max 100ms */
+#define QT_WINDOW_MS        400     /* qt interval max 400ms */
+
+/* the windows at SAMPLE_FREQ (16, 8 and 32 samples at 80hz) */
+#define PR_WINDOW_MAX       ECG_MS_TO_SAMPLES(PR_WINDOW_MS, SAMPLE_FREQ)
+#define QRS_WINDOW_MAX      ECG_MS_TO_SAMPLES(QRS_WINDOW_MS, SAMPLE_FREQ)
+#define QT_WINDOW_MAX       ECG_MS_TO_SAMPLES(QT_WINDOW_MS, SAMPLE_FREQ)
+
+/* minimum quality score (0-100) for a detected wave to be accepted */
+#define MIN_WAVE_QUALITY    80
 
 /* helper macros for bounds checking */
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
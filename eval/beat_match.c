@@ -0,0 +1,133 @@
+#include "beat_match.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "config/config.h"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* moves past the reference annotations that are no scored beat */
+static void skip_other(beat_match_t* match)
+{
+  while (match->next < match->num_ref &&
+         (!wfdb_ann_is_beat(match->ref[match->next].type) || match->ref[match->next].sample < match->start)) {
+    match->next++;
+  }
+}
+
+/* the next reference beat has no detection */
+static void miss_next(beat_match_t* match)
+{
+  const wfdb_ann_t* ann = &match->ref[match->next];
+
+  match->counts.fn++;
+  match->counts.ref_v += wfdb_ann_is_ventricular(ann->type);
+  match->prev_ref = ann->sample;
+  match->last_matched = 0;
+  match->next++;
+  skip_other(match);
+}
+
+static double rate(uint64_t hits, uint64_t total)
+{
+  return total ? 100.0 * (double)hits / (double)total : 100.0;
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+void beat_match_init(beat_match_t* match, const wfdb_ann_t* ref, uint64_t num_ref, uint16_t sample_freq,
+                     uint32_t window_ms, uint64_t start)
+{
+  memset(match, 0, sizeof(*match));
+  match->ref = ref;
+  match->num_ref = num_ref;
+  match->window = (uint32_t)ECG_MS_TO_SAMPLES(window_ms, sample_freq);
+  match->start = start;
+  match->sample_period = 1.0 / (double)sample_freq;
+  match->prev_ref = UINT64_MAX;
+  skip_other(match);
+}
+
+void beat_match_add(beat_match_t* match, uint64_t sample)
+{
+  if (sample < match->start) {
+    return;
+  }
+
+  /* reference beats too early for this detection and every later one */
+  while (match->next < match->num_ref && match->ref[match->next].sample + match->window < sample) {
+    miss_next(match);
+  }
+
+  if (match->next == match->num_ref || match->ref[match->next].sample > sample + match->window) {
+    match->counts.fp++;
+    match->last_matched = 0;
+    return;
+  }
+
+  const wfdb_ann_t* ann = &match->ref[match->next];
+  double err = ((double)sample - (double)ann->sample) * match->sample_period;
+  match->counts.tp++;
+  match->counts.ref_v += wfdb_ann_is_ventricular(ann->type);
+  match->counts.tp_v += wfdb_ann_is_ventricular(ann->type);
+  match->counts.r_err_sum += err;
+  match->counts.r_err_sq += err * err;
+  match->counts.r_err_max = MAX(match->counts.r_err_max, fabs(err));
+
+  /* an RR interval is compared when both of its beats are consecutive matches */
+  if (match->last_matched && match->last_ref == match->prev_ref) {
+    double rr_err = ((double)(sample - match->last_det) - (double)(ann->sample - match->last_ref)) *
+                    match->sample_period;
+    match->counts.num_rr++;
+    match->counts.rr_err_sum += rr_err;
+    match->counts.rr_err_sq += rr_err * rr_err;
+  }
+  match->last_matched = 1;
+  match->last_det = sample;
+  match->last_ref = ann->sample;
+  match->prev_ref = ann->sample;
+  match->next++;
+  skip_other(match);
+}
+
+void beat_match_finish(beat_match_t* match)
+{
+  while (match->next < match->num_ref) {
+    miss_next(match);
+  }
+}
+
+void beat_match_merge(beat_match_counts_t* total, const beat_match_counts_t* counts)
+{
+  total->tp += counts->tp;
+  total->fn += counts->fn;
+  total->fp += counts->fp;
+  total->ref_v += counts->ref_v;
+  total->tp_v += counts->tp_v;
+  total->r_err_sum += counts->r_err_sum;
+  total->r_err_sq += counts->r_err_sq;
+  total->r_err_max = MAX(total->r_err_max, counts->r_err_max);
+  total->num_rr += counts->num_rr;
+  total->rr_err_sum += counts->rr_err_sum;
+  total->rr_err_sq += counts->rr_err_sq;
+}
+
+void beat_match_get_stats(const beat_match_counts_t* counts, beat_match_stats_t* stats)
+{
+  double tp = (double)MAX(counts->tp, 1ull);
+  double num_rr = (double)MAX(counts->num_rr, 1ull);
+
+  stats->se = rate(counts->tp, counts->tp + counts->fn);
+  stats->ppv = rate(counts->tp, counts->tp + counts->fp);
+  stats->se_v = rate(counts->tp_v, counts->ref_v);
+  stats->r_err_mean = 1000.0 * counts->r_err_sum / tp;
+  stats->r_err_rms = 1000.0 * sqrt(counts->r_err_sq / tp);
+  stats->r_err_max = 1000.0 * counts->r_err_max;
+  stats->rr_err_mean = 1000.0 * counts->rr_err_sum / num_rr;
+  stats->rr_err_rms = 1000.0 * sqrt(counts->rr_err_sq / num_rr);
+}
@@ -0,0 +1,120 @@
+#ifndef BEAT_MATCH_H
+#define BEAT_MATCH_H
+
+#include <stdint.h>
+
+#include "io/wfdb_annotation.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define BEAT_MATCH_WINDOW_MS 150    /* match window of ANSI/AAMI EC57 */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* counts and error sums, merged over signals and records by adding them up */
+typedef struct {
+  uint64_t tp;                  /* reference beats matched by a detection */
+  uint64_t fn;                  /* reference beats without a detection */
+  uint64_t fp;                  /* detections without a reference beat */
+  uint64_t ref_v;               /* ventricular ectopic reference beats */
+  uint64_t tp_v;                /* of those matched */
+  double r_err_sum;             /* detection - reference of the matches, in s */
+  double r_err_sq;
+  double r_err_max;             /* largest absolute error, in s */
+  uint64_t num_rr;              /* RR intervals between two consecutive matches */
+  double rr_err_sum;            /* detected - reference RR, in s */
+  double rr_err_sq;
+} beat_match_counts_t;
+
+/* derived statistics */
+typedef struct {
+  double se;                    /* sensitivity TP / (TP + FN), in % */
+  double ppv;                   /* positive predictivity TP / (TP + FP), in % */
+  double se_v;                  /* sensitivity for ventricular ectopic beats, in % */
+  double r_err_mean;            /* R timing error, in ms */
+  double r_err_rms;
+  double r_err_max;
+  double rr_err_mean;           /* RR interval error, in ms */
+  double rr_err_rms;
+} beat_match_stats_t;
+
+/*!
+ * @brief Streaming beat-by-beat comparison of detections against reference annotations
+ *
+ * the detections of one signal arrive in time order and are matched with a
+ * two-pointer walk over the reference, O(1) amortized per beat - a detection
+ * within the window of the next unmatched reference beat matches it, reference
+ * beats the detections have passed are missed. beats before the start (the
+ * learning period) are not scored. only beat labels (wfdb_ann_is_beat()) of
+ * the reference count, the other annotations are skipped.
+ */
+typedef struct {
+  const wfdb_ann_t* ref;        /* reference annotations, not owned */
+  uint64_t num_ref;
+  uint64_t next;                /* first reference annotation not matched or missed yet */
+  uint32_t window;              /* match window in samples */
+  uint64_t start;               /* first scored sample */
+  double sample_period;         /* s per sample */
+
+  /* last match, for the RR intervals */
+  uint8_t last_matched;         /* the previous detection matched */
+  uint64_t last_det;            /* its sample */
+  uint64_t last_ref;            /* sample of the reference beat it matched */
+  uint64_t prev_ref;            /* sample of the last reference beat passed, UINT64_MAX before the first */
+
+  beat_match_counts_t counts;
+} beat_match_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Start the comparison of one signal
+ *
+ * @param match       - pointer to the comparison
+ * @param ref         - reference annotations in time order, kept until the end
+ * @param num_ref     - number of reference annotations
+ * @param sample_freq - sampling frequency of the annotations and the detections
+ * @param window_ms   - match window in ms, e.g. BEAT_MATCH_WINDOW_MS
+ * @param start       - first scored sample
+ */
+void beat_match_init(beat_match_t* match, const wfdb_ann_t* ref, uint64_t num_ref, uint16_t sample_freq,
+                     uint32_t window_ms, uint64_t start);
+
+/*!
+ * @brief Add a detection
+ *
+ * @param match  - pointer to the comparison
+ * @param sample - sample of the detected R peak, not before the last one
+ */
+void beat_match_add(beat_match_t* match, uint64_t sample);
+
+/*!
+ * @brief End the comparison, the reference beats left are missed
+ *
+ * @param match - pointer to the comparison
+ */
+void beat_match_finish(beat_match_t* match);
+
+/*!
+ * @brief Add the counts of one comparison to a total
+ *
+ * @param total  - counts to add to
+ * @param counts - counts of one signal or record
+ */
+void beat_match_merge(beat_match_counts_t* total, const beat_match_counts_t* counts);
+
+/*!
+ * @brief Se, PPV and the error statistics of the counts
+ *
+ * @param counts - counts
+ * @param stats  - filled with the statistics, rates of empty sets are 100%
+ */
+void beat_match_get_stats(const beat_match_counts_t* counts, beat_match_stats_t* stats);
+
+#endif /* BEAT_MATCH_H */
@@ -0,0 +1,239 @@
+#include "hrv.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "config/config.h"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static hrv_beat_t* beat_at(hrv_t* hrv, uint32_t i)
+{
+  return &hrv->beats[(hrv->head + i) & (HRV_MAX_BEATS - 1)];
+}
+
+/* rebuilds the running sums from the ring - two pass, exact up to float rounding */
+static void rebuild_sums(hrv_t* hrv)
+{
+  double sum = 0.0;
+  double m2 = 0.0;
+  uint32_t i = 0;
+
+  hrv->diff_sq = 0.0;
+  hrv->num_diff = 0;
+  hrv->num_nn50 = 0;
+  for (; i < hrv->count; i++) {
+    const hrv_beat_t* beat = beat_at(hrv, i);
+    sum += beat->rr;
+    if (beat->has_diff) {
+      hrv->diff_sq += (double)beat->diff * beat->diff;
+      hrv->num_diff++;
+      hrv->num_nn50 += (fabsf(beat->diff) > HRV_NN50_MS);
+    }
+  }
+  hrv->mean = hrv->count ? sum / hrv->count : 0.0;
+  for (i = 0; i < hrv->count; i++) {
+    double d = beat_at(hrv, i)->rr - hrv->mean;
+    m2 += d * d;
+  }
+  hrv->m2 = m2;
+  hrv->removed = 0;
+}
+
+/* removes the oldest beat from the window and the running sums */
+static void remove_oldest(hrv_t* hrv)
+{
+  const hrv_beat_t* beat = beat_at(hrv, 0);
+
+  /* reverse Welford step */
+  if (hrv->count > 1) {
+    double delta = beat->rr - hrv->mean;
+    hrv->mean -= delta / (hrv->count - 1);
+    hrv->m2 -= delta * (beat->rr - hrv->mean);
+    hrv->m2 = MAX(hrv->m2, 0.0);
+  } else {
+    hrv->mean = 0.0;
+    hrv->m2 = 0.0;
+  }
+  if (beat->has_diff) {
+    hrv->diff_sq = MAX(hrv->diff_sq - (double)beat->diff * beat->diff, 0.0);
+    hrv->num_diff--;
+    hrv->num_nn50 -= (fabsf(beat->diff) > HRV_NN50_MS);
+  }
+  hrv->head = (hrv->head + 1) & (HRV_MAX_BEATS - 1);
+  hrv->count--;
+
+  /* rounding of the removals never outlives one pass over the ring */
+  if (++hrv->removed >= HRV_MAX_BEATS) {
+    rebuild_sums(hrv);
+  }
+}
+
+/*
+ * Lomb-Scargle periodogram of the NN series over the LF and HF bins
+ *
+ * for every beat the phases of a block of bins are stepped with one rotation
+ * (angle addition), so a beat costs two sin/cos pairs per block instead of two
+ * per bin, and the sums of a block stay small enough for a task stack. the
+ * periodogram is scaled to a one-sided PSD (2 * P * T / N, in ms^2/Hz) so the
+ * band powers are comparable to an FFT of the resampled series.
+ */
+static void lomb_scargle(hrv_t* hrv, hrv_freq_t* out)
+{
+  double yc[HRV_SPECTRUM_BLOCK];  /* sum y cos(wt) */
+  double ys[HRV_SPECTRUM_BLOCK];  /* sum y sin(wt) */
+  double c2[HRV_SPECTRUM_BLOCK];  /* sum cos(2wt) */
+  double s2[HRV_SPECTRUM_BLOCK];  /* sum sin(2wt) */
+  const double two_pi = 6.283185307179586;
+  uint64_t t0 = beat_at(hrv, 0)->r_sample;
+  double span_s = (double)(beat_at(hrv, hrv->count - 1)->r_sample - t0) / hrv->sample_freq;
+  uint32_t first = 0;
+  uint32_t i = 0;
+  uint32_t k = 0;
+
+  for (first = 0; first < HRV_SPECTRUM_BINS; first += HRV_SPECTRUM_BLOCK) {
+    memset(yc, 0, sizeof(yc));
+    memset(ys, 0, sizeof(ys));
+    memset(c2, 0, sizeof(c2));
+    memset(s2, 0, sizeof(s2));
+
+    for (i = 0; i < hrv->count; i++) {
+      const hrv_beat_t* beat = beat_at(hrv, i);
+      double t = (double)(beat->r_sample - t0) / hrv->sample_freq;
+      double y = beat->rr - hrv->mean;
+
+      /* phase of the first bin of the block and the rotation from one bin to the next */
+      double w0 = two_pi * (HRV_LF_LOW_HZ + (first + 0.5) * HRV_SPECTRUM_DF_HZ) * t;
+      double dw = two_pi * HRV_SPECTRUM_DF_HZ * t;
+      double c = cos(w0);
+      double s = sin(w0);
+      double dc = cos(dw);
+      double ds = sin(dw);
+      for (k = 0; k < HRV_SPECTRUM_BLOCK; k++) {
+        yc[k] += y * c;
+        ys[k] += y * s;
+        c2[k] += c * c - s * s;
+        s2[k] += 2.0 * c * s;
+        double next_c = c * dc - s * ds;
+        s = s * dc + c * ds;
+        c = next_c;
+      }
+    }
+
+    for (k = 0; k < HRV_SPECTRUM_BLOCK; k++) {
+      /* time offset tau that makes the sin and cos terms orthogonal: tan(2 w tau) = s2 / c2 */
+      double norm = sqrt(c2[k] * c2[k] + s2[k] * s2[k]);
+      double cos_2wt = (norm > 0.0) ? c2[k] / norm : 1.0;
+      double sin_2wt = (norm > 0.0) ? s2[k] / norm : 0.0;
+      double cos_wt = sqrt(0.5 * (1.0 + cos_2wt));
+      double sin_wt = (sin_2wt >= 0.0 ? 1.0 : -1.0) * sqrt(0.5 * (1.0 - cos_2wt));
+
+      double yc_tau = yc[k] * cos_wt + ys[k] * sin_wt;
+      double ys_tau = ys[k] * cos_wt - yc[k] * sin_wt;
+      double cc_tau = 0.5 * (hrv->count + norm);
+      double ss_tau = hrv->count - cc_tau;
+      double p = 0.5 * ((cc_tau > 0.0 ? yc_tau * yc_tau / cc_tau : 0.0) +
+                        (ss_tau > 0.0 ? ys_tau * ys_tau / ss_tau : 0.0));
+      float power = (float)(2.0 * p * span_s / hrv->count) * HRV_SPECTRUM_DF_HZ;
+
+      if (HRV_LF_LOW_HZ + (first + k + 0.5f) * HRV_SPECTRUM_DF_HZ < HRV_LF_HIGH_HZ) {
+        out->lf += power;
+      } else {
+        out->hf += power;
+      }
+    }
+  }
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+void hrv_init(hrv_t* hrv, uint16_t sample_freq, uint32_t window_s)
+{
+  memset(hrv, 0, sizeof(*hrv));
+  hrv->sample_freq = sample_freq;
+  hrv->window = (uint64_t)window_s * sample_freq;
+}
+
+uint8_t hrv_add_beat(hrv_t* hrv, uint64_t r_sample, float rr_ms)
+{
+  if (rr_ms < HRV_RR_MIN_MS || rr_ms > HRV_RR_MAX_MS) {
+    /* an artifact breaks the chain of successive differences */
+    hrv->rejected++;
+    hrv->last_r = 0;
+    return 0;
+  }
+
+  /* beats that left the window, and the oldest one if the ring is full */
+  while (hrv->count > 0 && r_sample - beat_at(hrv, 0)->r_sample > hrv->window) {
+    remove_oldest(hrv);
+  }
+  if (hrv->count == HRV_MAX_BEATS) {
+    remove_oldest(hrv);
+  }
+
+  /* the successive difference is only valid if this interval starts at the last accepted R peak */
+  hrv_beat_t* beat = beat_at(hrv, hrv->count);
+  float rr_samples = rr_ms * hrv->sample_freq / 1000.0f;
+  beat->r_sample = r_sample;
+  beat->rr = rr_ms;
+  beat->has_diff = hrv->last_r != 0 && fabsf((float)(r_sample - hrv->last_r) - rr_samples) < 0.5f;
+  beat->diff = beat->has_diff ? rr_ms - hrv->last_rr : 0.0f;
+  hrv->count++;
+
+  /* Welford step */
+  double delta = rr_ms - hrv->mean;
+  hrv->mean += delta / hrv->count;
+  hrv->m2 += delta * (rr_ms - hrv->mean);
+  if (beat->has_diff) {
+    hrv->diff_sq += (double)beat->diff * beat->diff;
+    hrv->num_diff++;
+    hrv->num_nn50 += (fabsf(beat->diff) > HRV_NN50_MS);
+  }
+
+  hrv->last_r = r_sample;
+  hrv->last_rr = rr_ms;
+  hrv->added++;
+  return 1;
+}
+
+void hrv_get_time(const hrv_t* hrv, hrv_time_t* out)
+{
+  memset(out, 0, sizeof(*out));
+  out->num_rr = hrv->count;
+  if (hrv->count > 0) {
+    out->mean_rr = (float)hrv->mean;
+    out->mean_hr = (float)(60000.0 / hrv->mean);
+  }
+  if (hrv->count > 1) {
+    out->sdnn = (float)sqrt(hrv->m2 / (hrv->count - 1));
+  }
+  if (hrv->num_diff > 0) {
+    out->rmssd = (float)sqrt(hrv->diff_sq / hrv->num_diff);
+    out->pnn50 = 100.0f * (float)hrv->num_nn50 / (float)hrv->num_diff;
+  }
+}
+
+uint8_t hrv_get_freq(hrv_t* hrv, hrv_freq_t* out)
+{
+  /* nothing changed since the last estimate */
+  if (hrv->freq_added == hrv->added && hrv->added > 0) {
+    *out = hrv->freq;
+    return hrv->freq_valid;
+  }
+
+  memset(&hrv->freq, 0, sizeof(hrv->freq));
+  hrv->freq_added = hrv->added;
+  hrv->freq_valid = hrv->count > 1 &&
+                    beat_at(hrv, hrv->count - 1)->r_sample - beat_at(hrv, 0)->r_sample >=
+                        (uint64_t)HRV_MIN_SPECTRUM_S * hrv->sample_freq;
+  if (hrv->freq_valid) {
+    lomb_scargle(hrv, &hrv->freq);
+    hrv->freq.lf_hf = (hrv->freq.hf > 0.0f) ? hrv->freq.lf / hrv->freq.hf : 0.0f;
+  }
+  *out = hrv->freq;
+  return hrv->freq_valid;
+}
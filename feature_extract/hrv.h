@@ -0,0 +1,140 @@
+#ifndef HRV_H
+#define HRV_H
+
+#include <stdint.h>
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define HRV_MAX_BEATS      1024    /* NN intervals kept - a 5 min window up to 200 bpm, power of two */
+#define HRV_WINDOW_S       300     /* default analysis window (short-term HRV) */
+#define HRV_RR_MIN_MS      300.0f  /* RR intervals outside 300..2000 ms (200..30 bpm) are artifacts */
+#define HRV_RR_MAX_MS      2000.0f
+#define HRV_NN50_MS        50.0f   /* successive difference counted by pNN50 */
+#define HRV_LF_LOW_HZ      0.04f   /* LF band 0.04-0.15 Hz, HF band 0.15-0.4 Hz */
+#define HRV_LF_HIGH_HZ     0.15f
+#define HRV_HF_HIGH_HZ     0.4f
+#define HRV_SPECTRUM_DF_HZ 0.001f  /* frequency step of the periodogram - finer than 1 / window */
+#define HRV_SPECTRUM_BINS  360     /* (HRV_HF_HIGH_HZ - HRV_LF_LOW_HZ) / HRV_SPECTRUM_DF_HZ */
+#define HRV_SPECTRUM_BLOCK 24      /* bins whose sums are kept at once - divides HRV_SPECTRUM_BINS */
+#define HRV_MIN_SPECTRUM_S 120     /* beats must span 2 min before LF is estimated */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* one NN interval of the window */
+typedef struct {
+  uint64_t r_sample;                  /* absolute sample of the R peak that ends the interval */
+  float rr;                           /* interval in ms */
+  float diff;                         /* rr minus the previous interval, valid if has_diff */
+  uint8_t has_diff;                   /* the previous interval ended where this one starts */
+} hrv_beat_t;
+
+/* time-domain metrics of the window */
+typedef struct {
+  uint32_t num_rr;                    /* NN intervals in the window */
+  float mean_rr;                      /* ms */
+  float mean_hr;                      /* bpm */
+  float sdnn;                         /* standard deviation of the NN intervals in ms */
+  float rmssd;                        /* root mean square of the successive differences in ms */
+  float pnn50;                        /* % of successive differences above 50 ms */
+} hrv_time_t;
+
+/* frequency-domain metrics of the window */
+typedef struct {
+  float lf;                           /* power in 0.04-0.15 Hz in ms^2 */
+  float hf;                           /* power in 0.15-0.4 Hz in ms^2 */
+  float lf_hf;                        /* lf / hf */
+} hrv_freq_t;
+
+/*!
+ * @brief Incremental heart rate variability of one RR stream
+ *
+ * the window is a ring of the NN intervals of the last window_s seconds.
+ * every interval that enters or leaves the window updates a Welford mean and
+ * sum of squared deviations (SDNN) and the sums of the successive differences
+ * (RMSSD, pNN50) in O(1). the running sums are rebuilt from the ring once per
+ * HRV_MAX_BEATS removals, so rounding does not build up over a long record.
+ *
+ * LF and HF come from a Lomb-Scargle periodogram of the uneven NN series,
+ * computed only when hrv_get_freq() is called and cached until the next beat.
+ */
+typedef struct {
+  /* configuration */
+  uint16_t sample_freq;               /* sampling frequency of r_sample in Hz */
+  uint64_t window;                    /* window length in samples */
+
+  /* NN intervals of the window */
+  hrv_beat_t beats[HRV_MAX_BEATS];
+  uint32_t head;                      /* oldest beat */
+  uint32_t count;                     /* beats in the window */
+  uint64_t last_r;                    /* R peak of the last accepted beat, 0 before the first */
+  float last_rr;                      /* interval of the last accepted beat */
+
+  /* running sums of the window */
+  double mean;                        /* Welford mean of rr */
+  double m2;                          /* Welford sum of squared deviations of rr */
+  double diff_sq;                     /* sum of diff^2 */
+  uint32_t num_diff;                  /* beats with has_diff */
+  uint32_t num_nn50;                  /* beats with |diff| > HRV_NN50_MS */
+  uint32_t removed;                   /* removals since the sums were rebuilt */
+
+  /* counters */
+  uint64_t added;                     /* beats accepted since init */
+  uint64_t rejected;                  /* intervals rejected as artifacts */
+
+  /* lazily computed spectrum */
+  uint64_t freq_added;                /* added when freq was computed, 0 if never */
+  uint8_t freq_valid;                 /* freq holds an estimate */
+  hrv_freq_t freq;
+} hrv_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Init the HRV state of one RR stream
+ *
+ * @param hrv         - pointer to the HRV state
+ * @param sample_freq - sampling frequency of the R peak samples in Hz
+ * @param window_s    - analysis window in seconds (HRV_WINDOW_S for short-term HRV)
+ */
+void hrv_init(hrv_t* hrv, uint16_t sample_freq, uint32_t window_s);
+
+/*!
+ * @brief Add the RR interval of a beat
+ *
+ * fed with the r_sample and the intervals.rr_interval of every accepted wave.
+ * intervals of 0 (first beat) and outside HRV_RR_MIN_MS..HRV_RR_MAX_MS are
+ * rejected. beats that left the window are removed, O(1) amortized.
+ *
+ * @param hrv      - pointer to the HRV state
+ * @param r_sample - absolute sample of the R peak
+ * @param rr_ms    - interval to the previous R peak in ms
+ * @return 1 if the interval was added, 0 if it was rejected
+ */
+uint8_t hrv_add_beat(hrv_t* hrv, uint64_t r_sample, float rr_ms);
+
+/*!
+ * @brief Get the time-domain metrics of the window, O(1)
+ *
+ * @param hrv - pointer to the HRV state
+ * @param out - filled with the metrics, zeros for metrics without enough intervals
+ */
+void hrv_get_time(const hrv_t* hrv, hrv_time_t* out);
+
+/*!
+ * @brief Get the frequency-domain metrics of the window
+ *
+ * O(beats * HRV_SPECTRUM_BINS) on the first call after a new beat, cached otherwise.
+ *
+ * @param hrv - pointer to the HRV state
+ * @param out - filled with the metrics
+ * @return 1 if the beats span HRV_MIN_SPECTRUM_S, 0 otherwise (out is zeroed)
+ */
+uint8_t hrv_get_freq(hrv_t* hrv, hrv_freq_t* out);
+
+#endif /* HRV_H */
@@ -0,0 +1,358 @@
+#include "morphology.h"
+
+#include <math.h>
+#include <string.h>
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* template with the most beats, the older one on a tie */
+static uint16_t dominant_template(const morph_bank_t* bank)
+{
+  uint16_t best = 0;
+  uint16_t t = 1;
+
+  for (; t < bank->num_templates; t++) {
+    if (bank->count[t] > bank->count[best]) {
+      best = t;
+    }
+  }
+  return best;
+}
+
+/* slot for a new template - a free one, else the least used one that is not dominant */
+static uint16_t free_template(const morph_bank_t* bank)
+{
+  uint16_t dominant = dominant_template(bank);
+  uint16_t slot = MORPH_NO_TEMPLATE;
+  uint16_t t = 0;
+
+  if (bank->num_templates < MORPH_MAX_TEMPLATES) {
+    return bank->num_templates;
+  }
+  for (; t < bank->num_templates; t++) {
+    if (t == dominant) {
+      continue;
+    }
+    if (slot == MORPH_NO_TEMPLATE || bank->count[t] < bank->count[slot] ||
+        (bank->count[t] == bank->count[slot] && bank->last_beat[t] < bank->last_beat[slot])) {
+      slot = t;
+    }
+  }
+  return slot;
+}
+
+static uint8_t same_amplitude(float a, float b)
+{
+  return a * MORPH_AMP_RATIO >= b && a <= b * MORPH_AMP_RATIO;
+}
+
+/* scales the average of a template to unit energy */
+static void normalize_template(morph_bank_t* bank, uint16_t t)
+{
+  const float* average = &bank->average[t * bank->len];
+  float* tmpl = &bank->templates[t * bank->len];
+  float energy = 0.0f;
+  uint16_t i = 0;
+
+  bank->kernel(average, average, 0, bank->len, 1, &energy);
+
+  /* an average of unit vectors is only zero if the beats cancel - keep the last shape then */
+  if (energy > 0.0f) {
+    float scale = 1.0f / sqrtf(energy);
+    for (i = 0; i < bank->len; i++) {
+      tmpl[i] = average[i] * scale;
+    }
+  }
+}
+
+/* moves a template towards the current beat */
+static void update_template(morph_bank_t* bank, uint16_t t, float rms)
+{
+  float* average = &bank->average[t * bank->len];
+  float weight = 0.0f;
+  uint16_t i = 0;
+
+  bank->count[t]++;
+  weight = 1.0f / (float)MIN(bank->count[t], (uint32_t)MORPH_ADAPT_BEATS);
+  for (i = 0; i < bank->len; i++) {
+    average[i] += (bank->beat[i] - average[i]) * weight;
+  }
+  bank->amplitude[t] += (rms - bank->amplitude[t]) * weight;
+  normalize_template(bank, t);
+}
+
+/*
+ * two templates that drifted onto the same shape become one, e.g. the two
+ * sample phases of a narrow QRS at a low rate - otherwise they split the beats
+ * of the dominant shape between them. returns the template t ended up in.
+ */
+static uint16_t merge_template(morph_bank_t* bank, uint16_t t)
+{
+  const uint16_t len = bank->len;
+  float corr[MORPH_MAX_TEMPLATES];
+  uint16_t other = 0;
+  uint16_t i = 0;
+
+  bank->kernel(&bank->templates[t * len], bank->templates, len, len, bank->num_templates, corr);
+  for (; other < bank->num_templates; other++) {
+    if (other != t && corr[other] >= MORPH_MATCH_CORR && same_amplitude(bank->amplitude[t], bank->amplitude[other])) {
+      break;
+    }
+  }
+  if (other == bank->num_templates) {
+    return t;
+  }
+
+  /* the template with more beats takes the other one, weighted like update_template() */
+  uint16_t keep = (bank->count[t] >= bank->count[other]) ? t : other;
+  uint16_t gone = (keep == t) ? other : t;
+  float wk = (float)MIN(bank->count[keep], (uint32_t)MORPH_ADAPT_BEATS);
+  float wg = (float)MIN(bank->count[gone], (uint32_t)MORPH_ADAPT_BEATS);
+  float* kept = &bank->average[keep * len];
+  const float* merged = &bank->average[gone * len];
+  for (i = 0; i < len; i++) {
+    kept[i] = (kept[i] * wk + merged[i] * wg) / (wk + wg);
+  }
+  bank->amplitude[keep] = (bank->amplitude[keep] * wk + bank->amplitude[gone] * wg) / (wk + wg);
+  bank->count[keep] += bank->count[gone];
+  bank->last_beat[keep] = MAX(bank->last_beat[keep], bank->last_beat[gone]);
+  normalize_template(bank, keep);
+
+  /* the last template moves into the free slot */
+  uint16_t last = bank->num_templates - 1;
+  if (gone != last) {
+    memcpy(&bank->templates[gone * len], &bank->templates[last * len], len * sizeof(float));
+    memcpy(&bank->average[gone * len], &bank->average[last * len], len * sizeof(float));
+    bank->amplitude[gone] = bank->amplitude[last];
+    bank->count[gone] = bank->count[last];
+    bank->last_beat[gone] = bank->last_beat[last];
+    keep = (keep == last) ? gone : keep;
+  }
+  bank->num_templates--;
+  return keep;
+}
+
+/* starts a template with the current beat */
+static void new_template(morph_bank_t* bank, uint16_t t, float rms)
+{
+  memcpy(&bank->templates[t * bank->len], bank->beat, bank->len * sizeof(float));
+  memcpy(&bank->average[t * bank->len], bank->beat, bank->len * sizeof(float));
+  bank->amplitude[t] = rms;
+  bank->count[t] = 1;
+  if (t == bank->num_templates) {
+    bank->num_templates++;
+  }
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+void morph_init(morph_bank_t* bank, uint16_t sample_freq, float* storage)
+{
+  memset(bank, 0, sizeof(*bank));
+  bank->pre = (uint16_t)ECG_MS_TO_SAMPLES(MORPH_PRE_MS, sample_freq);
+  bank->post = (uint16_t)(ECG_MS_TO_SAMPLES(MORPH_POST_MS, sample_freq) + 1);
+  bank->len = (uint16_t)MORPH_WINDOW_LEN(sample_freq);
+
+  /* rows of len floats - the padding stays zero */
+  memset(storage, 0, MORPH_STORAGE_FLOATS(sample_freq) * sizeof(float));
+  bank->templates = storage;
+  bank->average = &storage[MORPH_MAX_TEMPLATES * bank->len];
+  bank->beat = &storage[2 * MORPH_MAX_TEMPLATES * bank->len];
+  bank->ones = &storage[(2 * MORPH_MAX_TEMPLATES + 1) * bank->len];
+  for (uint16_t i = 0; i < bank->pre + bank->post; i++) {
+    bank->ones[i] = 1.0f;
+  }
+  morph_select_isa(bank, BIQUAD_ISA_AUTO);
+}
+
+biquad_isa_t morph_select_isa(morph_bank_t* bank, biquad_isa_t isa)
+{
+  /* best first */
+  static const biquad_isa_t preference[] = { BIQUAD_ISA_AVX2, BIQUAD_ISA_NEON, BIQUAD_ISA_SSE, BIQUAD_ISA_SCALAR };
+  uint16_t i = 0;
+
+  if (isa == BIQUAD_ISA_AUTO || !biquad_isa_supported(isa)) {
+    for (i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+      if (biquad_isa_supported(preference[i])) {
+        isa = preference[i];
+        break;
+      }
+    }
+  }
+
+  switch (isa) {
+#if defined(BIQUAD_BANK_HAVE_AVX2)
+    case BIQUAD_ISA_AVX2:
+      bank->kernel = morph_ncc_avx2;
+      break;
+#endif
+#if defined(BIQUAD_BANK_HAVE_SSE)
+    case BIQUAD_ISA_SSE:
+      bank->kernel = morph_ncc_sse;
+      break;
+#endif
+#if defined(BIQUAD_BANK_HAVE_NEON)
+    case BIQUAD_ISA_NEON:
+      bank->kernel = morph_ncc_neon;
+      break;
+#endif
+    default:
+      isa = BIQUAD_ISA_SCALAR;
+      bank->kernel = morph_ncc_scalar;
+      break;
+  }
+
+  bank->isa = isa;
+  return isa;
+}
+
+void morph_load_beat(morph_bank_t* bank, const buffer_view_t* signal, uint32_t r_idx)
+{
+  buffer_view_copy(signal, r_idx - bank->pre, bank->pre + bank->post, bank->beat);
+}
+
+morph_class_t morph_classify(morph_bank_t* bank, const buffer_view_t* signal, uint32_t r_idx, morph_match_t* match)
+{
+  morph_load_beat(bank, signal, r_idx);
+  return morph_classify_beat(bank, match);
+}
+
+morph_class_t morph_classify_beat(morph_bank_t* bank, morph_match_t* match)
+{
+  const uint16_t width = bank->pre + bank->post;
+  float corr[MORPH_MAX_TEMPLATES];
+  float mean = 0.0f;
+  float energy = 0.0f;
+  uint16_t closest = MORPH_NO_TEMPLATE;   /* highest correlation */
+  uint16_t taken = MORPH_NO_TEMPLATE;     /* highest correlation with a matching amplitude */
+  uint16_t i = 0;
+
+  bank->beats++;
+
+  /* mean removed, unit energy - the padding behind width stays zero. the sums
+   * go through the kernel too, a plain loop would wait on every add */
+  bank->kernel(bank->beat, bank->ones, 0, bank->len, 1, &mean);
+  mean /= (float)width;
+  for (i = 0; i < width; i++) {
+    bank->beat[i] -= mean;
+  }
+  bank->kernel(bank->beat, bank->beat, 0, bank->len, 1, &energy);
+  if (!(energy > 0.0f)) {
+    match->beat_class = MORPH_CLASS_ARTIFACT;
+    match->cluster = MORPH_NO_TEMPLATE;
+    match->corr = 0.0f;
+    return MORPH_CLASS_ARTIFACT;
+  }
+  float scale = 1.0f / sqrtf(energy);
+  float rms = sqrtf(energy / (float)width);
+  for (i = 0; i < width; i++) {
+    bank->beat[i] *= scale;
+  }
+
+  /* normalized cross-correlation with every template in one pass */
+  bank->kernel(bank->beat, bank->templates, bank->len, bank->len, bank->num_templates, corr);
+  for (i = 0; i < bank->num_templates; i++) {
+    if (closest == MORPH_NO_TEMPLATE || corr[i] > corr[closest]) {
+      closest = i;
+    }
+    if (same_amplitude(rms, bank->amplitude[i]) && (taken == MORPH_NO_TEMPLATE || corr[i] > corr[taken])) {
+      taken = i;
+    }
+  }
+
+  uint8_t matched = taken != MORPH_NO_TEMPLATE && corr[taken] >= MORPH_MATCH_CORR;
+  float best_corr = (closest != MORPH_NO_TEMPLATE) ? corr[closest] : 0.0f;
+  if (matched) {
+    match->corr = corr[taken];
+    update_template(bank, taken, rms);
+    bank->last_beat[taken] = bank->beats;
+    taken = merge_template(bank, taken);
+  } else {
+    taken = free_template(bank);
+    new_template(bank, taken, rms);
+    bank->last_beat[taken] = bank->beats;
+    match->corr = best_corr;
+  }
+  match->cluster = (uint8_t)taken;
+
+  uint16_t dominant = dominant_template(bank);
+  if (bank->count[dominant] < MORPH_LEARN_BEATS) {
+    match->beat_class = MORPH_CLASS_LEARNING;
+  } else if (matched && taken == dominant) {
+    match->beat_class = MORPH_CLASS_NORMAL;
+  } else if (!matched && best_corr < MORPH_ARTIFACT_CORR) {
+    match->beat_class = MORPH_CLASS_ARTIFACT;
+  } else {
+    match->beat_class = MORPH_CLASS_ECTOPIC;
+  }
+  return (morph_class_t)match->beat_class;
+}
+
+uint8_t morph_same_state(const morph_bank_t* a, const morph_bank_t* b)
+{
+  uint32_t rows = (uint32_t)a->num_templates * a->len;
+  uint16_t t = 0;
+
+  if (a->len != b->len || a->num_templates != b->num_templates ||
+      memcmp(a->count, b->count, a->num_templates * sizeof(uint32_t)) != 0 ||
+      memcmp(a->amplitude, b->amplitude, a->num_templates * sizeof(float)) != 0 ||
+      memcmp(a->templates, b->templates, rows * sizeof(float)) != 0 ||
+      memcmp(a->average, b->average, rows * sizeof(float)) != 0) {
+    return 0;
+  }
+
+  /* the beat numbers start at each init, only their age picks the template to replace */
+  for (t = 0; t < a->num_templates; t++) {
+    if (a->beats - a->last_beat[t] != b->beats - b->last_beat[t]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+const char* morph_class_name(uint8_t beat_class)
+{
+  switch (beat_class) {
+    case MORPH_CLASS_NONE:     return "none";
+    case MORPH_CLASS_LEARNING: return "learning";
+    case MORPH_CLASS_NORMAL:   return "normal";
+    case MORPH_CLASS_ECTOPIC:  return "ectopic";
+    case MORPH_CLASS_ARTIFACT: return "artifact";
+    default:                   return "unknown";
+  }
+}
+
+/* 16 partial sums - lane i % 8 of the even and of the odd blocks of 8, added
+ * up like the vector kernels reduce their registers, so every kernel returns
+ * the same bits. two sets halve the chain of dependent adds */
+void morph_ncc_scalar(const float* beat, const float* templates, uint32_t stride, uint16_t len, uint16_t num_templates,
+                      float* corr)
+{
+  uint16_t t = 0;
+  uint16_t i = 0;
+  uint16_t lane = 0;
+
+  for (t = 0; t < num_templates; t++) {
+    const float* tmpl = templates + (size_t)t * stride;
+    float acc[2][MORPH_LANES] = { { 0.0f } };
+
+    for (i = 0; i < len; i += MORPH_LANES) {
+      float* set = acc[(i / MORPH_LANES) & 1];
+      for (lane = 0; lane < MORPH_LANES; lane++) {
+        float product = beat[i + lane] * tmpl[i + lane];
+        set[lane] += product;
+      }
+    }
+    for (lane = 0; lane < MORPH_LANES; lane++) {
+      acc[0][lane] += acc[1][lane];
+    }
+    for (lane = 0; lane < 4; lane++) {
+      acc[0][lane] += acc[0][lane + 4];
+    }
+    corr[t] = (acc[0][0] + acc[0][2]) + (acc[0][1] + acc[0][3]);
+  }
+}
@@ -0,0 +1,187 @@
+#ifndef MORPHOLOGY_H
+#define MORPHOLOGY_H
+
+#include <stdint.h>
+
+#include "config/config.h"
+#include "buffers/buffer.h"
+#include "filters/biquad_bank.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define MORPH_PRE_MS          100    /* window in front of the R peak - Q wave and QRS onset */
+#define MORPH_POST_MS         150    /* window from the R peak on - S wave, wide ectopic QRS and ST onset */
+#define MORPH_LANES           8      /* window length is padded to a multiple of the widest vector */
+#define MORPH_MAX_TEMPLATES   8      /* templates (clusters) per channel */
+#define MORPH_MATCH_CORR      0.90f  /* a beat belongs to a template from this correlation on */
+#define MORPH_ARTIFACT_CORR   0.50f  /* a beat below this against every template is an artifact */
+#define MORPH_AMP_RATIO       2.0f   /* and its amplitude within 1/2..2 times the template amplitude */
+#define MORPH_ADAPT_BEATS     32     /* a template averages its beats, then follows the last ones */
+#define MORPH_LEARN_BEATS     8      /* beats of the dominant template before beats are classified */
+#define MORPH_NO_TEMPLATE     0xFF   /* cluster of a flat beat that no template took */
+
+/* window length at a sampling rate, padded with zeros to MORPH_LANES */
+#define MORPH_WINDOW_LEN(fs)                                                                          \
+  (((ECG_MS_TO_SAMPLES(MORPH_PRE_MS, fs) + ECG_MS_TO_SAMPLES(MORPH_POST_MS, fs) + 1 + MORPH_LANES - 1) / \
+    MORPH_LANES) * MORPH_LANES)
+#define MORPH_WINDOW_MAX MORPH_WINDOW_LEN(ECG_MAX_SAMPLE_FREQ)
+
+/* floats of the storage of a bank - templates and averages, the current beat and the ones */
+#define MORPH_STORAGE_FLOATS(fs) ((2 * MORPH_MAX_TEMPLATES + 2) * MORPH_WINDOW_LEN(fs))
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* class of a beat - 0 is a beat that was not classified */
+typedef enum {
+  MORPH_CLASS_NONE = 0,  /* morphology is off */
+  MORPH_CLASS_LEARNING,  /* the dominant template is not established yet */
+  MORPH_CLASS_NORMAL,    /* matches the dominant template */
+  MORPH_CLASS_ECTOPIC,   /* a recurring or QRS-like shape other than the dominant one */
+  MORPH_CLASS_ARTIFACT   /* flat, or unlike every template */
+} morph_class_t;
+
+/* morphology of one beat */
+typedef struct {
+  uint8_t beat_class;    /* morph_class_t */
+  uint8_t cluster;       /* template the beat was assigned to - slots are reused, so only valid in the short run */
+  float corr;            /* normalized cross-correlation with the closest template (-1..1) */
+} morph_match_t;
+
+/* correlates a normalized beat with num_templates normalized templates stride floats apart */
+typedef void (*morph_ncc_kernel_t)(const float* beat, const float* templates, uint32_t stride, uint16_t len,
+                                   uint16_t num_templates, float* corr);
+
+/*!
+ * @brief Template bank of the beat shapes of one channel
+ *
+ * a beat is cut out of the filtered signal around its R peak, mean removed and
+ * scaled to unit energy, so its dot product with an equally normalized template
+ * is the normalized cross-correlation. the closest template takes the beat if
+ * the correlation and the amplitude agree and moves its running average towards
+ * it - O(window) per beat, the history is never rescanned. a beat no template
+ * takes starts a new template, or replaces the least used one, and two
+ * templates that converge on the same shape are merged.
+ *
+ * the template with the most beats is the dominant (normal) shape. every
+ * kernel adds up the products in the same order, so the classes do not
+ * depend on the instruction set.
+ */
+typedef struct {
+  /* rate dependent settings - fixed at init */
+  uint16_t pre;                                          /* samples in front of the R peak */
+  uint16_t post;                                         /* samples from the R peak on, the R peak included */
+  uint16_t len;                                          /* pre + post padded to MORPH_LANES */
+
+  float* templates;                                      /* unit energy shapes, MORPH_MAX_TEMPLATES rows of len */
+  float* average;                                        /* running average of the normalized beats, rows of len */
+  float amplitude[MORPH_MAX_TEMPLATES];                  /* running average of the beat RMS */
+  uint32_t count[MORPH_MAX_TEMPLATES];                   /* beats taken by each template */
+  uint32_t last_beat[MORPH_MAX_TEMPLATES];               /* beat number of the last beat taken */
+  uint16_t num_templates;                                /* templates in use */
+  uint32_t beats;                                        /* beats classified since init */
+
+  float* beat;                                           /* normalized window of the current beat, len */
+  float* ones;                                           /* 1 over pre + post, 0 in the padding - sums by the kernel */
+  biquad_isa_t isa;                                      /* instruction set of the kernel */
+  morph_ncc_kernel_t kernel;                             /* kernel selected for isa */
+} morph_bank_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Init an empty template bank
+ *
+ * selects the fastest correlation kernel supported by the running CPU. the
+ * templates live in caller provided storage sized for the rate, so a bank
+ * at 80 Hz takes a twelfth of one at 1 kHz.
+ *
+ * @param bank        - pointer to the bank
+ * @param sample_freq - sampling frequency in Hz (<= ECG_MAX_SAMPLE_FREQ)
+ * @param storage     - MORPH_STORAGE_FLOATS(sample_freq) floats, 32 byte aligned, cleared here
+ */
+void morph_init(morph_bank_t* bank, uint16_t sample_freq, float* storage);
+
+/*!
+ * @brief Select the correlation kernel instruction set
+ *
+ * same fallback as biquad_bank_select_isa().
+ *
+ * @param bank - pointer to the bank
+ * @param isa  - requested instruction set
+ * @return instruction set actually selected
+ */
+biquad_isa_t morph_select_isa(morph_bank_t* bank, biquad_isa_t isa);
+
+/*!
+ * @brief Classify a beat and learn its shape
+ *
+ * the window is signal[r_idx - pre .. r_idx + post - 1], the caller makes sure
+ * those samples exist.
+ *
+ * @param bank   - pointer to the bank
+ * @param signal - filtered samples, e.g. a window of the ring of a channel
+ * @param r_idx  - index of the R peak in signal
+ * @param match  - filled with the class, the template and the correlation
+ * @return the beat class
+ */
+morph_class_t morph_classify(morph_bank_t* bank, const buffer_view_t* signal, uint32_t r_idx, morph_match_t* match);
+
+/*!
+ * @brief Copy the window of a beat into the bank - first half of morph_classify()
+ *
+ * the only read of the signal, so a caller can check that the samples were
+ * not overwritten meanwhile before the bank learns from them.
+ *
+ * @param bank   - pointer to the bank
+ * @param signal - filtered samples, e.g. a window of the ring of a channel
+ * @param r_idx  - index of the R peak in signal
+ */
+void morph_load_beat(morph_bank_t* bank, const buffer_view_t* signal, uint32_t r_idx);
+
+/*!
+ * @brief Classify the beat of morph_load_beat() and learn its shape - second half of morph_classify()
+ *
+ * @param bank  - pointer to the bank
+ * @param match - filled with the class, the template and the correlation
+ * @return the beat class
+ */
+morph_class_t morph_classify_beat(morph_bank_t* bank, morph_match_t* match);
+
+/*!
+ * @brief Check if two banks classify the next beats the same
+ *
+ * compares the templates in use, their averages, amplitudes and beat counts
+ * bit for bit, and the age of their last beats. the beat window is scratch and
+ * not compared.
+ *
+ * @param a - pointer to a bank
+ * @param b - pointer to a bank
+ * @return 1 if the banks are the same, 0 otherwise
+ */
+uint8_t morph_same_state(const morph_bank_t* a, const morph_bank_t* b);
+
+/*!
+ * @brief Name of a beat class
+ *
+ * @param beat_class - morph_class_t
+ * @return name string
+ */
+const char* morph_class_name(uint8_t beat_class);
+
+/* kernels - selected through morph_select_isa() */
+void morph_ncc_scalar(const float* beat, const float* templates, uint32_t stride, uint16_t len, uint16_t num_templates,
+                      float* corr);
+void morph_ncc_sse(const float* beat, const float* templates, uint32_t stride, uint16_t len, uint16_t num_templates,
+                   float* corr);
+void morph_ncc_avx2(const float* beat, const float* templates, uint32_t stride, uint16_t len, uint16_t num_templates,
+                    float* corr);
+void morph_ncc_neon(const float* beat, const float* templates, uint32_t stride, uint16_t len, uint16_t num_templates,
+                    float* corr);
+
+#endif /* MORPHOLOGY_H */
@@ -0,0 +1,68 @@
+#include "morphology.h"
+
+#if defined(BIQUAD_BANK_HAVE_AVX2)
+
+#include <immintrin.h>
+
+/* (s0 + s2) + (s1 + s3) with s = low + high half of the sum of both block sets */
+static inline float reduce(__m256 even, __m256 odd)
+{
+  __m256 acc = _mm256_add_ps(even, odd);
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+
+/* one register per set of blocks (even, odd) holds the 16 partial sums of morph_ncc_scalar()
+ * and is reduced in its order - compiled without -mfma, so the correlations
+ * are bit-exact with it */
+void morph_ncc_avx2(const float* beat, const float* templates, uint32_t stride, uint16_t len, uint16_t num_templates,
+                    float* corr)
+{
+  uint16_t t = 0;
+  uint16_t i = 0;
+
+  /* two templates at a time share the beat loads */
+  for (t = 0; t + 1 < num_templates; t += 2) {
+    const float* tmpl0 = templates + (size_t)t * stride;
+    const float* tmpl1 = tmpl0 + stride;
+    __m256 even0 = _mm256_setzero_ps();
+    __m256 odd0 = _mm256_setzero_ps();
+    __m256 even1 = _mm256_setzero_ps();
+    __m256 odd1 = _mm256_setzero_ps();
+
+    for (i = 0; i + 2 * MORPH_LANES <= len; i += 2 * MORPH_LANES) {
+      __m256 x = _mm256_loadu_ps(&beat[i]);
+      __m256 y = _mm256_loadu_ps(&beat[i + MORPH_LANES]);
+      even0 = _mm256_add_ps(even0, _mm256_mul_ps(x, _mm256_loadu_ps(&tmpl0[i])));
+      even1 = _mm256_add_ps(even1, _mm256_mul_ps(x, _mm256_loadu_ps(&tmpl1[i])));
+      odd0 = _mm256_add_ps(odd0, _mm256_mul_ps(y, _mm256_loadu_ps(&tmpl0[i + MORPH_LANES])));
+      odd1 = _mm256_add_ps(odd1, _mm256_mul_ps(y, _mm256_loadu_ps(&tmpl1[i + MORPH_LANES])));
+    }
+    if (i < len) {
+      __m256 x = _mm256_loadu_ps(&beat[i]);
+      even0 = _mm256_add_ps(even0, _mm256_mul_ps(x, _mm256_loadu_ps(&tmpl0[i])));
+      even1 = _mm256_add_ps(even1, _mm256_mul_ps(x, _mm256_loadu_ps(&tmpl1[i])));
+    }
+    corr[t] = reduce(even0, odd0);
+    corr[t + 1] = reduce(even1, odd1);
+  }
+
+  for (; t < num_templates; t++) {
+    const float* tmpl = templates + (size_t)t * stride;
+    __m256 even = _mm256_setzero_ps();
+    __m256 odd = _mm256_setzero_ps();
+
+    for (i = 0; i + 2 * MORPH_LANES <= len; i += 2 * MORPH_LANES) {
+      even = _mm256_add_ps(even, _mm256_mul_ps(_mm256_loadu_ps(&beat[i]), _mm256_loadu_ps(&tmpl[i])));
+      odd = _mm256_add_ps(odd, _mm256_mul_ps(_mm256_loadu_ps(&beat[i + MORPH_LANES]),
+                                             _mm256_loadu_ps(&tmpl[i + MORPH_LANES])));
+    }
+    if (i < len) {
+      even = _mm256_add_ps(even, _mm256_mul_ps(_mm256_loadu_ps(&beat[i]), _mm256_loadu_ps(&tmpl[i])));
+    }
+    corr[t] = reduce(even, odd);
+  }
+}
+
+#endif /* BIQUAD_BANK_HAVE_AVX2 */
@@ -0,0 +1,41 @@
+#include "morphology.h"
+
+#if defined(BIQUAD_BANK_HAVE_NEON)
+
+#include <arm_neon.h>
+
+/* two registers per set of blocks (even, odd) hold the 16 partial sums of morph_ncc_scalar()
+ * and are reduced in its order - vmulq/vaddq instead of vmlaq/vfmaq, so the
+ * correlations are bit-exact with it */
+void morph_ncc_neon(const float* beat, const float* templates, uint32_t stride, uint16_t len, uint16_t num_templates,
+                    float* corr)
+{
+  uint16_t t = 0;
+  uint16_t i = 0;
+
+  for (t = 0; t < num_templates; t++) {
+    const float* tmpl = templates + (size_t)t * stride;
+    float32x4_t lo_even = vdupq_n_f32(0.0f);
+    float32x4_t hi_even = vdupq_n_f32(0.0f);
+    float32x4_t lo_odd = vdupq_n_f32(0.0f);
+    float32x4_t hi_odd = vdupq_n_f32(0.0f);
+
+    for (i = 0; i + 2 * MORPH_LANES <= len; i += 2 * MORPH_LANES) {
+      lo_even = vaddq_f32(lo_even, vmulq_f32(vld1q_f32(&beat[i]), vld1q_f32(&tmpl[i])));
+      hi_even = vaddq_f32(hi_even, vmulq_f32(vld1q_f32(&beat[i + 4]), vld1q_f32(&tmpl[i + 4])));
+      lo_odd = vaddq_f32(lo_odd, vmulq_f32(vld1q_f32(&beat[i + 8]), vld1q_f32(&tmpl[i + 8])));
+      hi_odd = vaddq_f32(hi_odd, vmulq_f32(vld1q_f32(&beat[i + 12]), vld1q_f32(&tmpl[i + 12])));
+    }
+    if (i < len) {
+      lo_even = vaddq_f32(lo_even, vmulq_f32(vld1q_f32(&beat[i]), vld1q_f32(&tmpl[i])));
+      hi_even = vaddq_f32(hi_even, vmulq_f32(vld1q_f32(&beat[i + 4]), vld1q_f32(&tmpl[i + 4])));
+    }
+
+    /* (s0 + s2) + (s1 + s3) with s = lo + hi of the sum of both sets */
+    float32x4_t s = vaddq_f32(vaddq_f32(lo_even, lo_odd), vaddq_f32(hi_even, hi_odd));
+    float32x2_t pair = vadd_f32(vget_low_f32(s), vget_high_f32(s));
+    corr[t] = vget_lane_f32(vpadd_f32(pair, pair), 0);
+  }
+}
+
+#endif /* BIQUAD_BANK_HAVE_NEON */
@@ -0,0 +1,42 @@
+#include "morphology.h"
+
+#if defined(BIQUAD_BANK_HAVE_SSE)
+
+#include <emmintrin.h>
+
+/* two registers per set of blocks (even, odd) hold the 16 partial sums of morph_ncc_scalar()
+ * and are reduced in its order - SSE2 has no FMA, so the correlations are
+ * bit-exact with it */
+void morph_ncc_sse(const float* beat, const float* templates, uint32_t stride, uint16_t len, uint16_t num_templates,
+                   float* corr)
+{
+  uint16_t t = 0;
+  uint16_t i = 0;
+
+  for (t = 0; t < num_templates; t++) {
+    const float* tmpl = templates + (size_t)t * stride;
+    __m128 lo_even = _mm_setzero_ps();
+    __m128 hi_even = _mm_setzero_ps();
+    __m128 lo_odd = _mm_setzero_ps();
+    __m128 hi_odd = _mm_setzero_ps();
+
+    for (i = 0; i + 2 * MORPH_LANES <= len; i += 2 * MORPH_LANES) {
+      lo_even = _mm_add_ps(lo_even, _mm_mul_ps(_mm_loadu_ps(&beat[i]), _mm_loadu_ps(&tmpl[i])));
+      hi_even = _mm_add_ps(hi_even, _mm_mul_ps(_mm_loadu_ps(&beat[i + 4]), _mm_loadu_ps(&tmpl[i + 4])));
+      lo_odd = _mm_add_ps(lo_odd, _mm_mul_ps(_mm_loadu_ps(&beat[i + 8]), _mm_loadu_ps(&tmpl[i + 8])));
+      hi_odd = _mm_add_ps(hi_odd, _mm_mul_ps(_mm_loadu_ps(&beat[i + 12]), _mm_loadu_ps(&tmpl[i + 12])));
+    }
+    if (i < len) {
+      lo_even = _mm_add_ps(lo_even, _mm_mul_ps(_mm_loadu_ps(&beat[i]), _mm_loadu_ps(&tmpl[i])));
+      hi_even = _mm_add_ps(hi_even, _mm_mul_ps(_mm_loadu_ps(&beat[i + 4]), _mm_loadu_ps(&tmpl[i + 4])));
+    }
+
+    /* (s0 + s2) + (s1 + s3) with s = lo + hi of the sum of both sets */
+    __m128 s = _mm_add_ps(_mm_add_ps(lo_even, lo_odd), _mm_add_ps(hi_even, hi_odd));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+    corr[t] = _mm_cvtss_f32(s);
+  }
+}
+
+#endif /* BIQUAD_BANK_HAVE_SSE */
@@ -1,11 +1,7 @@
 #include "pqrst_detector.h"
 
 #include "config/config.h"
-
-/* temp variables to store indices */
-static uint16_t g_r_idx = 0;
-static uint16_t g_q_idx = 0;
-static uint16_t g_s_idx = 0;
+#include "filters/fixed_point.h"
 
 void ecg_init(wave_points_t* points, wave_intervals_t* intervals)
 {
@@ -32,126 +28,368 @@ void ecg_init(wave_points_t* points, wave_intervals_t* intervals)
     intervals->pp_interval = 0.0f;
   }
 }
-static uint16_t detect_r_peak(volatile const float* buffer, uint16_t start, uint16_t end) {
+/* places the thresholds at their fractions between noise and signal level */
+static void thresholds_place(wave_thresholds_t* thresholds)
+{
+  float span = MAX(thresholds->signal_level - thresholds->noise_level, 0.0f);
+
+  thresholds->r_threshold = thresholds->noise_level + R_PEAK_THRESHOLD * span;
+  thresholds->q_threshold = thresholds->noise_level + Q_WAVE_THRESHOLD * span;
+  thresholds->s_threshold = thresholds->noise_level + S_WAVE_THRESHOLD * span;
+}
+
+void ecg_thresholds_init(wave_thresholds_t* thresholds)
+{
+  thresholds->baseline = 0.0f;
+  thresholds->signal_level = 0.0f;
+  thresholds->noise_level = 0.0f;
+  thresholds->r_threshold = R_PEAK_THRESHOLD;
+  thresholds->q_threshold = Q_WAVE_THRESHOLD;
+  thresholds->s_threshold = S_WAVE_THRESHOLD;
+}
+
+void ecg_thresholds_q15(const wave_thresholds_t* thresholds, float volts_per_lsb, wave_thresholds_q15_t* out)
+{
+  out->baseline = q15_from_float(thresholds->baseline, volts_per_lsb);
+  out->r_threshold = q15_from_float(thresholds->r_threshold, volts_per_lsb);
+  out->q_threshold = q15_from_float(thresholds->q_threshold, volts_per_lsb);
+  out->s_threshold = q15_from_float(thresholds->s_threshold, volts_per_lsb);
+  out->mv_per_lsb = volts_per_lsb * 1000.0f;
+}
+
+void ecg_thresholds_update(wave_thresholds_t* thresholds, float r_val, float baseline)
+{
+  float amplitude = r_val - baseline;
+  float drift = baseline - thresholds->baseline;
+  float noise = (drift < 0.0f) ? -drift : drift;
+
+  if (thresholds->signal_level <= 0.0f) {
+    /* the first beat seeds the signal level, there is no earlier baseline to deviate from */
+    thresholds->signal_level = amplitude;
+    thresholds->noise_level = 0.0f;
+  } else {
+    /* running estimates, same 1/8 weight as the streaming QRS detector */
+    thresholds->signal_level = 0.125f * amplitude + 0.875f * thresholds->signal_level;
+    thresholds->noise_level = 0.125f * noise + 0.875f * thresholds->noise_level;
+  }
+  thresholds->baseline = baseline;
+  thresholds_place(thresholds);
+}
+
+/* absolute sample of a buffer index - index 0 is the "not found" of the searches */
+static inline uint64_t to_sample(uint64_t first_sample, uint32_t idx)
+{
+  return (idx > 0) ? first_sample + idx : 0;
+}
+
+/* time from sample a to sample b in ms - signed, 0 if one of them is missing */
+static inline float span_ms(uint64_t a, uint64_t b, float samples_to_ms)
+{
+  return (a > 0 && b > 0) ? (float)(int64_t)(b - a) * samples_to_ms : 0.0f;
+}
+
+/* the R, Q and S searches measure every sample from the baseline of the beat */
+static uint32_t detect_r_peak(const buffer_view_t* buffer, uint32_t start, uint32_t end, float baseline,
+                              float threshold) {
   float max_val = 0.0f;
-  uint16_t idx = 0;
+  uint32_t idx = 0;
 
   /* search for maximum value above r peak threshold */
-  uint16_t i = start;
+  uint32_t i = start;
   for(; i < end; i++) {
-    if(buffer[i] > max_val && buffer[i] > R_PEAK_THRESHOLD) {
-      max_val = buffer[i];
-      idx = i;
+    float x = buffer_view_at(buffer, i) - baseline;
+    if(x > max_val && x > threshold) {
+      max_val = x;
+      idx = (uint32_t)i;
     }
   }
   return idx;
 }
 
-static uint16_t detect_q_wave(volatile const float* buffer) {
+static inline uint32_t detect_q_wave(const buffer_view_t* buffer, uint32_t r_idx, float baseline, float threshold,
+                                     uint16_t qrs_window) {
   float min_val = 0.0f;
-  uint16_t idx = 0;
+  uint32_t idx = 0;
 
   /* search backwards from r peak within qrs window for local minimum */
-  int i = g_r_idx;
-  for(; i >= MAX(0, g_r_idx - QRS_WINDOW_MAX); i--) {
-    if(buffer[i] < min_val && buffer[i] < -Q_WAVE_THRESHOLD) {
-      min_val = buffer[i];
-      idx = i;
+  int64_t i = r_idx;
+  for(; i >= MAX(0, (int64_t)r_idx - (int64_t)qrs_window); i--) {
+    float x = buffer_view_at(buffer, (uint32_t)i) - baseline;
+    if(x < min_val && x < -threshold) {
+      min_val = x;
+      idx = (uint32_t)i;
     }
   }
   return idx;
 }
 
-static uint16_t detect_s_wave(volatile const float* buffer, uint16_t end) {
+static inline uint32_t detect_s_wave(const buffer_view_t* buffer, uint32_t r_idx, uint32_t end, float baseline,
+                                     float threshold, uint16_t qrs_window) {
   float min_val = 0.0f;
-  uint16_t idx = 0;
+  uint32_t idx = 0;
 
   /* search forwards from r peak within qrs window for local minimum */
-  uint16_t i = g_r_idx;
-  for(; i < MIN(end, g_r_idx + QRS_WINDOW_MAX); i++) {
-    if(buffer[i] < min_val && buffer[i] < -S_WAVE_THRESHOLD) {
-      min_val = buffer[i];
-      idx = i;
+  uint32_t i = r_idx;
+  for(; i < MIN(end, r_idx + qrs_window); i++) {
+    float x = buffer_view_at(buffer, i) - baseline;
+    if(x < min_val && x < -threshold) {
+      min_val = x;
+      idx = (uint32_t)i;
     }
   }
   return idx;
 }
 
-static uint16_t detect_p_wave(volatile const float* buffer) {
+static inline uint32_t detect_p_wave(const buffer_view_t* buffer, uint32_t q_idx, uint16_t pr_window) {
   float max_val = 0.0f;
-  uint16_t idx = 0;
+  uint32_t idx = 0;
 
   /* search backwards from q peak within pr window for local maximum */
-  int i = g_q_idx;
-  for(; i >= MAX(0, g_q_idx - PR_WINDOW_MAX); i--) {
-    if(buffer[i] > max_val && buffer[i] > 0.0f) {
-      max_val = buffer[i];
-      idx = i;
+  int64_t i = q_idx;
+  for(; i >= MAX(0, (int64_t)q_idx - (int64_t)pr_window); i--) {
+    float x = buffer_view_at(buffer, (uint32_t)i);
+    if(x > max_val && x > 0.0f) {
+      max_val = x;
+      idx = (uint32_t)i;
     }
   }
   return idx;
 }
 
-static uint16_t detect_t_wave(volatile const float* buffer, uint16_t end) {
+static inline uint32_t detect_t_wave(const buffer_view_t* buffer, uint32_t s_idx, uint32_t end,
+                                     uint16_t qt_window) {
   float max_val = 0.0f;
-  uint16_t idx = 0;
+  uint32_t idx = 0;
 
   /* search forwards from s peak within qt window for local maximum */
-  uint16_t i = g_s_idx;
-  for(; i < MIN(end, g_s_idx + QT_WINDOW_MAX); i++) {
-    if(buffer[i] > max_val && buffer[i] > 0.0f) {
+  uint32_t i = s_idx;
+  for(; i < MIN(end, s_idx + qt_window); i++) {
+    float x = buffer_view_at(buffer, i);
+    if(x > max_val && x > 0.0f) {
+      max_val = x;
+      idx = (uint32_t)i;
+    }
+  }
+  return idx;
+}
+
+/* detect waves in sequence - each search starts from the previous point.
+ * inlined with constant windows for the common rates */
+static inline void delineate(const buffer_view_t* buffer, uint64_t first_sample, uint32_t r_idx,
+                             const wave_thresholds_t* thresholds, uint16_t pr_window, uint16_t qrs_window,
+                             uint16_t qt_window, wave_points_t* points) {
+  const uint32_t end = buffer->len;
+  const float base = thresholds->baseline;
+  uint32_t q_idx = detect_q_wave(buffer, r_idx, base, thresholds->q_threshold, qrs_window);
+  uint32_t s_idx = detect_s_wave(buffer, r_idx, end, base, thresholds->s_threshold, qrs_window);
+  uint32_t p_idx = detect_p_wave(buffer, q_idx, pr_window);
+  uint32_t t_idx = detect_t_wave(buffer, s_idx, end, qt_window);
+
+  points->r_idx = to_sample(first_sample, r_idx);
+  points->r_val = buffer_view_at(buffer, r_idx) * 1000.0f; /* V to mV */
+  points->q_idx = to_sample(first_sample, q_idx);
+  points->q_val = buffer_view_at(buffer, q_idx) * 1000.0f;
+  points->s_idx = to_sample(first_sample, s_idx);
+  points->s_val = buffer_view_at(buffer, s_idx) * 1000.0f;
+  points->p_idx = to_sample(first_sample, p_idx);
+  points->p_val = buffer_view_at(buffer, p_idx) * 1000.0f;
+  points->t_idx = to_sample(first_sample, t_idx);
+  points->t_val = buffer_view_at(buffer, t_idx) * 1000.0f;
+}
+
+/* the same searches on int16 samples with thresholds in ADC units - the distance from the baseline in 32 bits */
+static uint32_t detect_r_peak_q15(volatile const int16_t* buffer, uint32_t start, uint32_t end, int16_t baseline,
+                                  int16_t threshold) {
+  int32_t max_val = 0;
+  uint32_t idx = 0;
+
+  uint32_t i = start;
+  for(; i < end; i++) {
+    int32_t x = (int32_t)buffer[i] - baseline;
+    if(x > max_val && x > threshold) {
+      max_val = x;
+      idx = (uint32_t)i;
+    }
+  }
+  return idx;
+}
+
+static inline uint32_t detect_q_wave_q15(volatile const int16_t* buffer, uint32_t r_idx, int16_t baseline,
+                                         int16_t threshold, uint16_t qrs_window) {
+  int32_t min_val = 0;
+  uint32_t idx = 0;
+
+  int64_t i = r_idx;
+  for(; i >= MAX(0, (int64_t)r_idx - (int64_t)qrs_window); i--) {
+    int32_t x = (int32_t)buffer[i] - baseline;
+    if(x < min_val && x < -threshold) {
+      min_val = x;
+      idx = (uint32_t)i;
+    }
+  }
+  return idx;
+}
+
+static inline uint32_t detect_s_wave_q15(volatile const int16_t* buffer, uint32_t r_idx, uint32_t end,
+                                         int16_t baseline, int16_t threshold, uint16_t qrs_window) {
+  int32_t min_val = 0;
+  uint32_t idx = 0;
+
+  uint32_t i = r_idx;
+  for(; i < MIN(end, r_idx + qrs_window); i++) {
+    int32_t x = (int32_t)buffer[i] - baseline;
+    if(x < min_val && x < -threshold) {
+      min_val = x;
+      idx = (uint32_t)i;
+    }
+  }
+  return idx;
+}
+
+static inline uint32_t detect_p_wave_q15(volatile const int16_t* buffer, uint32_t q_idx, uint16_t pr_window) {
+  int16_t max_val = 0;
+  uint32_t idx = 0;
+
+  int64_t i = q_idx;
+  for(; i >= MAX(0, (int64_t)q_idx - (int64_t)pr_window); i--) {
+    if(buffer[i] > max_val) {
+      max_val = buffer[i];
+      idx = (uint32_t)i;
+    }
+  }
+  return idx;
+}
+
+static inline uint32_t detect_t_wave_q15(volatile const int16_t* buffer, uint32_t s_idx, uint32_t end,
+                                         uint16_t qt_window) {
+  int16_t max_val = 0;
+  uint32_t idx = 0;
+
+  uint32_t i = s_idx;
+  for(; i < MIN(end, s_idx + qt_window); i++) {
+    if(buffer[i] > max_val) {
       max_val = buffer[i];
-      idx = i;
+      idx = (uint32_t)i;
     }
   }
   return idx;
 }
 
-void ecg_detect_pqrst(volatile const float* buffer, uint16_t start, uint16_t end, wave_points_t* points) {
+/* delineate() on int16 samples - only the five amplitudes are scaled to mV */
+static inline void delineate_q15(volatile const int16_t* buffer, uint64_t first_sample, uint32_t r_idx,
+                                 uint32_t end, const wave_thresholds_q15_t* thresholds, uint16_t pr_window,
+                                 uint16_t qrs_window, uint16_t qt_window, wave_points_t* points) {
+  const int16_t base = thresholds->baseline;
+  uint32_t q_idx = detect_q_wave_q15(buffer, r_idx, base, thresholds->q_threshold, qrs_window);
+  uint32_t s_idx = detect_s_wave_q15(buffer, r_idx, end, base, thresholds->s_threshold, qrs_window);
+  uint32_t p_idx = detect_p_wave_q15(buffer, q_idx, pr_window);
+  uint32_t t_idx = detect_t_wave_q15(buffer, s_idx, end, qt_window);
+
+  points->r_idx = to_sample(first_sample, r_idx);
+  points->r_val = buffer[r_idx] * thresholds->mv_per_lsb;
+  points->q_idx = to_sample(first_sample, q_idx);
+  points->q_val = buffer[q_idx] * thresholds->mv_per_lsb;
+  points->s_idx = to_sample(first_sample, s_idx);
+  points->s_val = buffer[s_idx] * thresholds->mv_per_lsb;
+  points->p_idx = to_sample(first_sample, p_idx);
+  points->p_val = buffer[p_idx] * thresholds->mv_per_lsb;
+  points->t_idx = to_sample(first_sample, t_idx);
+  points->t_val = buffer[t_idx] * thresholds->mv_per_lsb;
+}
+
+#define DELINEATE_RATE(fs)                                                                                     \
+  case fs:                                                                                                     \
+    delineate(window, first_sample, r_idx, thresholds, ECG_MS_TO_SAMPLES(PR_WINDOW_MS, fs),                    \
+              ECG_MS_TO_SAMPLES(QRS_WINDOW_MS, fs), ECG_MS_TO_SAMPLES(QT_WINDOW_MS, fs), points);              \
+    break;
+
+#define DELINEATE_RATE_Q15(fs)                                                                                 \
+  case fs:                                                                                                     \
+    delineate_q15(buffer, first_sample, r_idx, end, thresholds, ECG_MS_TO_SAMPLES(PR_WINDOW_MS, fs),           \
+                  ECG_MS_TO_SAMPLES(QRS_WINDOW_MS, fs), ECG_MS_TO_SAMPLES(QT_WINDOW_MS, fs), points);          \
+    break;
+
+void ecg_windows_init(wave_windows_t* windows, uint16_t sample_freq)
+{
+  windows->sample_freq = sample_freq;
+  windows->pr_window = (uint16_t)ECG_MS_TO_SAMPLES(PR_WINDOW_MS, sample_freq);
+  windows->qrs_window = (uint16_t)ECG_MS_TO_SAMPLES(QRS_WINDOW_MS, sample_freq);
+  windows->qt_window = (uint16_t)ECG_MS_TO_SAMPLES(QT_WINDOW_MS, sample_freq);
+  windows->samples_to_ms = 1000.0f / sample_freq;
+}
+
+void ecg_detect_pqrst(const float* buffer, uint64_t first_sample, uint32_t start, uint32_t end,
+                      const wave_thresholds_t* thresholds, const wave_windows_t* windows, wave_points_t* points) {
+  buffer_view_t window;
+
   /* store current positions for next calculation first */
   points->prev_r_idx = points->r_idx;
   points->prev_p_idx = points->p_idx;
 
-  /* detect waves in sequence */
-  g_r_idx = detect_r_peak(buffer, start, end);
-  points->r_idx = g_r_idx;
-  points->r_val = buffer[g_r_idx] * 1000.0f; /* V to mV */
+  /* locate the R peak in the window, then the rest of the wave around it */
+  buffer_view_linear(&window, buffer, end);
+  ecg_delineate_pqrst(&window, first_sample,
+                      detect_r_peak(&window, start, end, thresholds->baseline, thresholds->r_threshold), thresholds,
+                      windows, points);
+}
 
-  g_q_idx = detect_q_wave(buffer);
-  points->q_idx = g_q_idx;
-  points->q_val = buffer[g_q_idx] * 1000.0f;
+void ecg_delineate_pqrst(const buffer_view_t* window, uint64_t first_sample, uint32_t r_idx,
+                         const wave_thresholds_t* thresholds, const wave_windows_t* windows, wave_points_t* points) {
+  switch (windows->sample_freq) {
+    DELINEATE_RATE(80)
+    DELINEATE_RATE(250)
+    DELINEATE_RATE(360)
+    DELINEATE_RATE(500)
+    DELINEATE_RATE(1000)
+    default:
+      delineate(window, first_sample, r_idx, thresholds, windows->pr_window, windows->qrs_window, windows->qt_window,
+                points);
+      break;
+  }
+}
 
-  g_s_idx = detect_s_wave(buffer, end);
-  points->s_idx = g_s_idx;
-  points->s_val = buffer[g_s_idx] * 1000.0f;
+void ecg_detect_pqrst_q15(volatile const int16_t* buffer, uint64_t first_sample, uint32_t start, uint32_t end,
+                          const wave_thresholds_q15_t* thresholds, const wave_windows_t* windows, wave_points_t* points) {
+  points->prev_r_idx = points->r_idx;
+  points->prev_p_idx = points->p_idx;
 
-  points->p_idx = detect_p_wave(buffer);
-  points->p_val = buffer[points->p_idx] * 1000.0f;
+  ecg_delineate_pqrst_q15(buffer, first_sample,
+                          detect_r_peak_q15(buffer, start, end, thresholds->baseline, thresholds->r_threshold), end,
+                          thresholds, windows, points);
+}
 
-  points->t_idx = detect_t_wave(buffer, end);
-  points->t_val = buffer[points->t_idx] * 1000.0f;
+void ecg_delineate_pqrst_q15(volatile const int16_t* buffer, uint64_t first_sample, uint32_t r_idx, uint32_t end,
+                             const wave_thresholds_q15_t* thresholds, const wave_windows_t* windows,
+                             wave_points_t* points) {
+  switch (windows->sample_freq) {
+    DELINEATE_RATE_Q15(80)
+    DELINEATE_RATE_Q15(250)
+    DELINEATE_RATE_Q15(360)
+    DELINEATE_RATE_Q15(500)
+    DELINEATE_RATE_Q15(1000)
+    default:
+      delineate_q15(buffer, first_sample, r_idx, end, thresholds, windows->pr_window, windows->qrs_window, windows->qt_window,
+                    points);
+      break;
+  }
 }
 
-void ecg_calculate_intervals(const wave_points_t* points, wave_intervals_t* intervals)
+void ecg_calculate_intervals(const wave_points_t* points, const wave_windows_t* windows, wave_intervals_t* intervals)
 {
-  float samples_to_ms = 1000.0f / SAMPLE_FREQ;  /* conversion for 80Hz sampling rate */
+  float samples_to_ms = windows->samples_to_ms;  /* conversion for the sampling rate of the points */
 
   /* calculate pr interval (p start to q start) */
-  intervals->pr_interval = (points->q_idx - points->p_idx) * samples_to_ms;
+  intervals->pr_interval = span_ms(points->p_idx, points->q_idx, samples_to_ms);
 
   /* calculate qrs duration (q start to s end) */
-  intervals->qrs_duration = (points->s_idx - points->q_idx) * samples_to_ms;
+  intervals->qrs_duration = span_ms(points->q_idx, points->s_idx, samples_to_ms);
 
   /* calculate qt interval (q start to t end) */
-  intervals->qt_interval = (points->t_idx - points->q_idx) * samples_to_ms;
+  intervals->qt_interval = span_ms(points->q_idx, points->t_idx, samples_to_ms);
 
-  /* calculate pp and rr intervals if we have previous values */
-  if (points->prev_p_idx > 0) {
-		intervals->pp_interval = (points->p_idx - points->prev_p_idx) * samples_to_ms;
-  }
-  if (points->prev_r_idx > 0) {
-		intervals->rr_interval = (points->r_idx - points->prev_r_idx) * samples_to_ms;
-  }
+  /* calculate pp and rr intervals from the previous beat - absolute samples, so across any buffer wrap */
+  intervals->pp_interval = span_ms(points->prev_p_idx, points->p_idx, samples_to_ms);
+  intervals->rr_interval = span_ms(points->prev_r_idx, points->r_idx, samples_to_ms);
 }
 
 uint8_t ecg_validate_detection(const wave_points_t *points, const wave_intervals_t *intervals)
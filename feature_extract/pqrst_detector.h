@@ -3,20 +3,23 @@
 
 #include <stdint.h>
 
-/* ECG points structure */
+#include "buffers/buffer.h"
+
+/* ECG points structure - positions are absolute sample numbers of the stream,
+ * 0 if the point was not found. only the searches work on buffer indices */
 typedef struct {
-  uint16_t p_idx;       /* P wave position index */
+  uint64_t p_idx;       /* P wave sample */
   float p_val;          /* P wave amplitude */
-  uint16_t q_idx;       /* Q wave position index */
+  uint64_t q_idx;       /* Q wave sample */
   float q_val;          /* Q wave amplitude */
-  uint16_t r_idx;       /* R wave position index */
+  uint64_t r_idx;       /* R wave sample */
   float r_val;          /* R wave amplitude */
-  uint16_t s_idx;       /* S wave position index */
+  uint64_t s_idx;       /* S wave sample */
   float s_val;          /* S wave amplitude */
-  uint16_t t_idx;       /* T wave position index */
+  uint64_t t_idx;       /* T wave sample */
   float t_val;          /* T wave amplitude */
-  uint16_t prev_p_idx;  /* previous P wave position index */
-  uint16_t prev_r_idx;  /* previous R wave position index */
+  uint64_t prev_p_idx;  /* previous P wave sample */
+  uint64_t prev_r_idx;  /* previous R wave sample */
 } wave_points_t;
 
 /* ECG measurements structure */
@@ -28,6 +31,39 @@ typedef struct {
   float pp_interval;    /* PP interval duration (ms) */
 } wave_intervals_t;
 
+/* adaptive detection thresholds - a running signal (R amplitude) and noise
+ * (baseline deviation) level per channel, the thresholds sit at the config.h
+ * fractions between the two so they follow the gain of the channel. the R, Q
+ * and S searches measure the samples from the isoelectric level of the beat,
+ * so an offset the baseline filter passes does not move them */
+typedef struct {
+  float baseline;       /* isoelectric level of the current beat (V), 0 until the first beat */
+  float signal_level;   /* running R peak amplitude above the baseline (V), 0 until the first beat */
+  float noise_level;    /* running deviation of the baseline from beat to beat (V) */
+  float r_threshold;    /* R peak must exceed the baseline by r_threshold (V) */
+  float q_threshold;    /* Q wave must go below the baseline by q_threshold (V) */
+  float s_threshold;    /* S wave must go below the baseline by s_threshold (V) */
+} wave_thresholds_t;
+
+/* thresholds of the fixed-point detector - wave_thresholds_t converted to ADC
+ * units, so the searches compare int16 samples directly */
+typedef struct {
+  int16_t baseline;     /* isoelectric level of the current beat (ADC units) */
+  int16_t r_threshold;  /* R peak must exceed the baseline by r_threshold (ADC units) */
+  int16_t q_threshold;  /* Q wave must go below the baseline by q_threshold (ADC units) */
+  int16_t s_threshold;  /* S wave must go below the baseline by s_threshold (ADC units) */
+  float mv_per_lsb;     /* mV per ADC unit - applied to the located points only */
+} wave_thresholds_q15_t;
+
+/* search windows of one sampling rate - the config.h limits in ms converted to samples */
+typedef struct {
+  uint16_t sample_freq; /* sampling frequency in Hz */
+  uint16_t pr_window;   /* PR_WINDOW_MS in samples - P search before Q */
+  uint16_t qrs_window;  /* QRS_WINDOW_MS in samples - Q and S search around R */
+  uint16_t qt_window;   /* QT_WINDOW_MS in samples - T search after S */
+  float samples_to_ms;  /* ms per sample */
+} wave_windows_t;
+
 /*!
  * @brief init ECG wave detection structures
  *
@@ -36,6 +72,48 @@ typedef struct {
  */
 void ecg_init(wave_points_t* points, wave_intervals_t* intervals);
 
+/*!
+ * @brief Init the search windows of a sampling rate
+ *
+ * @param windows     - pointer to windows to initialize
+ * @param sample_freq - sampling frequency in Hz
+ */
+void ecg_windows_init(wave_windows_t* windows, uint16_t sample_freq);
+
+/*!
+ * @brief Init adaptive thresholds
+ *
+ * until the first update the thresholds are the config.h fractions as
+ * absolute values, i.e. relative to a 1 V R peak on a 0 V baseline.
+ *
+ * @param thresholds - pointer to thresholds to initialize
+ */
+void ecg_thresholds_init(wave_thresholds_t* thresholds);
+
+/*!
+ * @brief Update adaptive thresholds with a detected beat - O(1)
+ *
+ * the baseline sample becomes the level the thresholds of the beat are
+ * relative to. the signal level follows the R peak above it, the noise level
+ * how far the baseline moved since the last beat.
+ *
+ * @param thresholds - pointer to thresholds
+ * @param r_val      - R peak sample of the beat (V)
+ * @param baseline   - isoelectric sample in front of the beat (V)
+ */
+void ecg_thresholds_update(wave_thresholds_t* thresholds, float r_val, float baseline);
+
+/*!
+ * @brief Convert thresholds to ADC units for the fixed-point detector - O(1)
+ *
+ * call after every ecg_thresholds_update(), the levels themselves stay float.
+ *
+ * @param thresholds    - adaptive thresholds (V)
+ * @param volts_per_lsb - V per ADC unit of the int16 samples
+ * @param out           - filled with the thresholds in ADC units
+ */
+void ecg_thresholds_q15(const wave_thresholds_t* thresholds, float volts_per_lsb, wave_thresholds_q15_t* out);
+
 /*!
  * @brief Detect PQRST Wave Components
  *
@@ -45,11 +123,71 @@ void ecg_init(wave_points_t* points, wave_intervals_t* intervals);
  * - P wave detection in PR interval window
  * - T wave detection in QT interval window
  *
- * @param buffer - pointer to filtered signal buffer
- * @param size   - size of the signal buffer
- * @return wave_points_t Structure containing wave locations and amplitudes
+ * @param buffer       - pointer to filtered signal buffer
+ * @param first_sample - absolute sample number of buffer[0]
+ * @param start        - buffer index of the first sample of the window
+ * @param end          - buffer index of the end of the window (exclusive)
+ * @param thresholds   - R, Q and S thresholds
+ * @param windows      - search windows of the sampling rate
+ * @param points       - filled with the wave samples and amplitudes
+ */
+void ecg_detect_pqrst(const float* buffer, uint64_t first_sample, uint32_t start, uint32_t end,
+                      const wave_thresholds_t* thresholds, const wave_windows_t* windows, wave_points_t* points);
+
+/*!
+ * @brief Delineate a wave around a known R peak
+ *
+ * Q, S, P and T detection of ecg_detect_pqrst() for an R peak that was already
+ * located, e.g. by the streaming QRS detector. the prev_* fields are untouched.
+ * the common rates (80, 250, 360, 500 and 1000 Hz) run a copy of the searches
+ * compiled with constant windows, other rates use the windows at runtime.
+ * the searches read the samples in place through the view, across the wrap
+ * point of a ring.
+ *
+ * @param window       - filtered samples around the R peak, the searches stop at its end
+ * @param first_sample - absolute sample number of window index 0
+ * @param r_idx        - window index of the R peak
+ * @param thresholds   - Q and S thresholds
+ * @param windows      - search windows of the sampling rate
+ * @param points       - filled with the wave samples and amplitudes
+ */
+void ecg_delineate_pqrst(const buffer_view_t* window, uint64_t first_sample, uint32_t r_idx,
+                         const wave_thresholds_t* thresholds, const wave_windows_t* windows, wave_points_t* points);
+
+/*!
+ * @brief Detect PQRST wave components on int16 samples
+ *
+ * the searches of ecg_detect_pqrst() on the output of the fixed-point filters
+ * (biquad_q15_filter_block()) without converting the buffer - only the five
+ * located amplitudes are scaled to mV.
+ *
+ * @param buffer       - pointer to filtered signal buffer in ADC units
+ * @param first_sample - absolute sample number of buffer[0]
+ * @param start        - buffer index of the first sample of the window
+ * @param end          - buffer index of the end of the window (exclusive)
+ * @param thresholds   - R, Q and S thresholds in ADC units
+ * @param windows      - search windows of the sampling rate
+ * @param points       - filled with the wave samples and amplitudes (mV)
+ */
+void ecg_detect_pqrst_q15(volatile const int16_t* buffer, uint64_t first_sample, uint32_t start, uint32_t end,
+                          const wave_thresholds_q15_t* thresholds, const wave_windows_t* windows, wave_points_t* points);
+
+/*!
+ * @brief Delineate a wave around a known R peak on int16 samples
+ *
+ * ecg_delineate_pqrst() for the fixed-point path.
+ *
+ * @param buffer       - pointer to filtered signal buffer in ADC units
+ * @param first_sample - absolute sample number of buffer[0]
+ * @param r_idx        - buffer index of the R peak
+ * @param end          - buffer index of the end of the valid samples (exclusive)
+ * @param thresholds   - Q and S thresholds in ADC units
+ * @param windows      - search windows of the sampling rate
+ * @param points       - filled with the wave samples and amplitudes (mV)
  */
-void ecg_detect_pqrst(volatile const float* buffer, uint16_t start, uint16_t end, wave_points_t* points);
+void ecg_delineate_pqrst_q15(volatile const int16_t* buffer, uint64_t first_sample, uint32_t r_idx, uint32_t end,
+                             const wave_thresholds_q15_t* thresholds, const wave_windows_t* windows,
+                             wave_points_t* points);
 
 /*!
  * @brief Calculate ECG Wave Intervals
@@ -58,12 +196,15 @@ void ecg_detect_pqrst(volatile const float* buffer, uint16_t start, uint16_t end
  * - PR interval: time from P wave start to QRS start
  * - QRS duration: time from QRS onset to QRS end
  * - QT interval: time from QRS onset to T wave end
- * Note: RR and PP intervals require multiple beats to calculate
+ * - RR and PP intervals: from the points of the previous beat
+ * every interval is a signed difference of absolute samples, 0 if one of
+ * its points is missing.
  *
  * @param points            - pointer to detected wave points structure
+ * @param windows           - sampling rate of the points
  * @return wave_intervals_t structure containing calculated intervals in milliseconds
  */
-void ecg_calculate_intervals(const wave_points_t *points, wave_intervals_t* intervals);
+void ecg_calculate_intervals(const wave_points_t *points, const wave_windows_t* windows, wave_intervals_t* intervals);
 
 /*!
  * @brief Validate ECG Wave Detection
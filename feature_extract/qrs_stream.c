@@ -0,0 +1,364 @@
+#include "qrs_stream.h"
+
+#include <string.h>
+
+#include "config/config.h"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void update_thresholds(qrs_stream_t* stream)
+{
+  stream->threshold1 = stream->npki + 0.25f * (stream->spki - stream->npki);
+  stream->threshold2 = 0.5f * stream->threshold1;
+}
+
+/* records a beat and fills the emitted beat */
+static void accept_beat(qrs_stream_t* stream, uint64_t r_idx, float r_val, float peak, uint8_t search_back,
+                        qrs_stream_beat_t* beat)
+{
+  uint32_t rr = 0;
+  uint8_t i = 0;
+
+  if (stream->have_beat) {
+    rr = (uint32_t)(r_idx - stream->last_r);
+
+    /* running average of the recent RR intervals */
+    stream->rr_hist[stream->rr_pos] = rr;
+    stream->rr_pos = (stream->rr_pos + 1) % QRS_STREAM_RR_BEATS;
+    if (stream->rr_count < QRS_STREAM_RR_BEATS) {
+      stream->rr_count++;
+    }
+    uint32_t rr_sum = 0;
+    for (i = 0; i < stream->rr_count; i++) {
+      rr_sum += stream->rr_hist[i];
+    }
+    stream->rr_avg = MIN(rr_sum / stream->rr_count, (uint32_t)stream->sample_freq * QRS_STREAM_RR_MAX_MS / 1000);
+  }
+
+  stream->last_r = r_idx;
+  stream->have_beat = 1;
+  stream->sb_valid = 0;
+
+  beat->r_sample = r_idx;
+  beat->r_val = r_val;
+  beat->peak = peak;
+  beat->rr_samples = rr;
+  beat->search_back = search_back;
+}
+
+/* R peak candidate - the band signal maximum inside the integrator window */
+static qrs_stream_max_t window_max(const qrs_stream_t* stream)
+{
+  return stream->max_deque[stream->max_head];
+}
+
+/* flags the deque entry of a sample as a step - it is still there unless a later sample outgrew it */
+static void mark_step(qrs_stream_t* stream, uint64_t idx)
+{
+  const uint16_t cap = QRS_STREAM_MWI_MAX + 4;
+  uint16_t i = stream->max_count;
+
+  while (i > 0) {
+    qrs_stream_max_t* entry = &stream->max_deque[(stream->max_head + --i) % cap];
+    if (entry->idx == idx) {
+      entry->step = 1;
+      return;
+    }
+  }
+}
+
+/* follows the upstroke the newest sample is on - from its foot, the lowest sample before it, on until the
+ * signal falls back by half its height, so sample noise near a wide peak does not cut it short */
+static void rise_track(qrs_stream_t* stream, float sample)
+{
+  float height = stream->rise_top - stream->rise_base;
+
+  if (sample <= stream->rise_base || sample < stream->rise_top - QRS_STREAM_STEP_HOLD * height) {
+    /* falling - the next upstroke starts here, the top fell back so it was no step */
+    stream->rise_base = sample;
+    stream->rise_top = sample;
+    stream->rise_jump = 0.0f;
+    stream->rise = 0;
+    stream->step_watch = 0;
+    return;
+  }
+  if (stream->step_watch && stream->n - stream->rise_top_idx >= stream->step_hold) {
+    /* the signal stayed up behind the jump */
+    mark_step(stream, stream->rise_top_idx);
+    stream->step_watch = 0;
+  }
+  stream->rise_jump = MAX(stream->rise_jump, sample - stream->x[0]);
+  stream->rise++;
+  if (sample > stream->rise_top) {
+    /* a new top - one sample carried most of the upstroke, watch if the signal stays up */
+    stream->rise_top = sample;
+    stream->rise_top_idx = stream->n;
+    stream->step_watch = (uint8_t)(stream->rise_jump > QRS_STREAM_STEP_SHARE * (sample - stream->rise_base));
+  }
+}
+
+/* pushes the newest sample into the sliding maximum deque - amortized O(1) */
+static void window_max_push(qrs_stream_t* stream, float sample)
+{
+  const uint16_t cap = QRS_STREAM_MWI_MAX + 4;
+  const uint64_t window = (uint64_t)stream->mwi_len + 2; /* integrator + derivative delay */
+
+  /* drop smaller samples from the back, they can never be the maximum again */
+  while (stream->max_count > 0) {
+    uint16_t back = (stream->max_head + stream->max_count - 1) % cap;
+    if (stream->max_deque[back].val > sample) {
+      break;
+    }
+    stream->max_count--;
+  }
+  uint16_t slot = (stream->max_head + stream->max_count) % cap;
+  stream->max_deque[slot].idx = stream->n;
+  stream->max_deque[slot].val = sample;
+  stream->max_deque[slot].rise = stream->rise;
+  stream->max_deque[slot].step = 0;
+  stream->max_count++;
+
+  /* drop samples that left the window from the front */
+  while (stream->max_deque[stream->max_head].idx + window <= stream->n) {
+    stream->max_head = (stream->max_head + 1) % cap;
+    stream->max_count--;
+  }
+}
+
+/* beat detection on the integrator output of the sample */
+static uint8_t detect(qrs_stream_t* stream, float sample, float mwi, qrs_stream_beat_t* beat)
+{
+  uint8_t emitted = 0;
+
+  window_max_push(stream, sample);
+
+  if (stream->n < stream->learn_end) {
+    /* learning phase - initial signal and noise levels */
+    stream->learn_max = MAX(stream->learn_max, mwi);
+    stream->learn_sum += mwi;
+    if (stream->n + 1 == stream->learn_end) {
+      stream->spki = stream->learn_max / 3.0f;
+      stream->npki = 0.5f * stream->learn_sum / (float)stream->learn_len;
+      update_thresholds(stream);
+    }
+  } else {
+    /* integrator peak at the previous sample */
+    if (mwi < stream->mwi_prev && stream->rising) {
+      float peak = stream->mwi_prev;
+      qrs_stream_max_t r = window_max(stream);
+      stream->rising = 0;
+
+      if (stream->have_beat && r.idx <= stream->last_r + stream->refractory) {
+        /* inside the refractory period - the same QRS or its T wave */
+      } else if (r.rise < stream->min_rise || r.step) {
+        /* step artifact - neither a beat nor part of the noise level */
+      } else if (peak > stream->threshold1) {
+        accept_beat(stream, r.idx, r.val, peak, 0, beat);
+        stream->spki = 0.125f * peak + 0.875f * stream->spki;
+        emitted = 1;
+      } else {
+        stream->npki = 0.125f * peak + 0.875f * stream->npki;
+
+        /* remember the largest rejected peak for search back */
+        if (!stream->sb_valid || peak > stream->sb_peak) {
+          stream->sb_valid = 1;
+          stream->sb_peak = peak;
+          stream->sb_r = r.idx;
+          stream->sb_r_val = r.val;
+        }
+      }
+      update_thresholds(stream);
+    }
+    if (mwi > stream->mwi_prev) {
+      stream->rising = 1;
+    }
+
+    /* search back - no beat for 166% of the average RR */
+    if (!emitted && stream->have_beat && stream->rr_avg > 0 && stream->sb_valid &&
+        stream->n - stream->last_r > (uint64_t)stream->rr_avg * QRS_STREAM_SEARCH_BACK / 100 &&
+        stream->sb_peak > stream->threshold2) {
+      float peak = stream->sb_peak;
+      accept_beat(stream, stream->sb_r, stream->sb_r_val, peak, 1, beat);
+      stream->spki = 0.25f * peak + 0.75f * stream->spki;
+      update_thresholds(stream);
+      emitted = 1;
+    }
+  }
+
+  stream->mwi_prev = mwi;
+  stream->n++;
+  return emitted;
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+void qrs_stream_init(qrs_stream_t* stream, uint16_t sample_freq)
+{
+  uint16_t i = 0;
+
+  stream->sample_freq = sample_freq;
+  stream->mwi_len = (uint16_t)MAX(1, MIN(QRS_STREAM_MWI_MAX, (uint32_t)sample_freq * QRS_STREAM_MWI_MS / 1000));
+  stream->refractory = (uint16_t)((uint32_t)sample_freq * QRS_STREAM_REFRACTORY_MS / 1000);
+  stream->learn_len = (uint32_t)sample_freq * QRS_STREAM_LEARN_MS / 1000;
+  stream->min_rise = (uint16_t)MAX(QRS_STREAM_MIN_RISE, (uint32_t)sample_freq * QRS_STREAM_MIN_RISE_MS / 1000);
+  stream->step_hold = (uint16_t)MAX(1, (uint32_t)sample_freq * QRS_STREAM_STEP_HOLD_MS / 1000);
+  stream->learn_end = stream->learn_len;
+
+  for (i = 0; i < 4; i++) {
+    stream->x[i] = 0.0f;
+  }
+  stream->rise = 0;
+  stream->rise_base = 0.0f;
+  stream->rise_top = 0.0f;
+  stream->rise_jump = 0.0f;
+  stream->rise_top_idx = 0;
+  stream->step_watch = 0;
+  for (i = 0; i < QRS_STREAM_MWI_MAX; i++) {
+    stream->mwi_ring[i] = 0.0f;
+  }
+  stream->mwi_pos = 0;
+  stream->mwi_sum = 0.0f;
+  stream->mwi_prev = 0.0f;
+  stream->rising = 0;
+
+  stream->max_head = 0;
+  stream->max_count = 0;
+
+  stream->spki = 0.0f;
+  stream->npki = 0.0f;
+  stream->threshold1 = 0.0f;
+  stream->threshold2 = 0.0f;
+  stream->learn_max = 0.0f;
+  stream->learn_sum = 0.0f;
+
+  stream->n = 0;
+  stream->last_r = 0;
+  stream->have_beat = 0;
+  stream->rr_avg = 0;
+  stream->rr_count = 0;
+  stream->rr_pos = 0;
+
+  stream->sb_valid = 0;
+  stream->sb_peak = 0.0f;
+  stream->sb_r = 0;
+  stream->sb_r_val = 0.0f;
+}
+
+void qrs_stream_seek(qrs_stream_t* stream, uint64_t first_sample)
+{
+  stream->n = first_sample;
+  stream->learn_end = first_sample + stream->learn_len;
+  /* the integrator re-sums on the same samples as a detector started at 0 */
+  stream->mwi_pos = (uint16_t)(first_sample % stream->mwi_len);
+}
+
+uint8_t qrs_stream_same_state(const qrs_stream_t* a, const qrs_stream_t* b)
+{
+  const uint16_t cap = QRS_STREAM_MWI_MAX + 4;
+  uint16_t i = 0;
+
+  /* floats bit for bit - the detectors have to take the same branches forever */
+  if (a->n != b->n || a->mwi_len != b->mwi_len || a->rise != b->rise || a->mwi_pos != b->mwi_pos ||
+      a->rising != b->rising || memcmp(a->x, b->x, sizeof(a->x)) != 0 ||
+      memcmp(a->mwi_ring, b->mwi_ring, a->mwi_len * sizeof(float)) != 0 ||
+      memcmp(&a->mwi_sum, &b->mwi_sum, sizeof(float)) != 0 || memcmp(&a->mwi_prev, &b->mwi_prev, sizeof(float)) != 0) {
+    return 0;
+  }
+
+  if (memcmp(&a->rise_base, &b->rise_base, sizeof(float)) != 0 ||
+      memcmp(&a->rise_top, &b->rise_top, sizeof(float)) != 0 ||
+      memcmp(&a->rise_jump, &b->rise_jump, sizeof(float)) != 0 || a->step_watch != b->step_watch ||
+      (a->step_watch && a->rise_top_idx != b->rise_top_idx)) {
+    return 0;
+  }
+
+  /* RR history oldest first, its slots depend on the beats since the start */
+  if (a->rr_count != b->rr_count) {
+    return 0;
+  }
+  for (i = 0; i < a->rr_count; i++) {
+    uint16_t ia = (uint16_t)((a->rr_pos + QRS_STREAM_RR_BEATS - a->rr_count + i) % QRS_STREAM_RR_BEATS);
+    uint16_t ib = (uint16_t)((b->rr_pos + QRS_STREAM_RR_BEATS - b->rr_count + i) % QRS_STREAM_RR_BEATS);
+    if (a->rr_hist[ia] != b->rr_hist[ib]) {
+      return 0;
+    }
+  }
+
+  /* the learning phase only matters while one of them is in it */
+  if ((a->n < a->learn_end || b->n < b->learn_end) &&
+      (a->learn_end != b->learn_end || memcmp(&a->learn_max, &b->learn_max, sizeof(float)) != 0 ||
+       memcmp(&a->learn_sum, &b->learn_sum, sizeof(float)) != 0)) {
+    return 0;
+  }
+
+  if (memcmp(&a->spki, &b->spki, sizeof(float)) != 0 || memcmp(&a->npki, &b->npki, sizeof(float)) != 0 ||
+      memcmp(&a->threshold1, &b->threshold1, sizeof(float)) != 0 ||
+      memcmp(&a->threshold2, &b->threshold2, sizeof(float)) != 0) {
+    return 0;
+  }
+
+  if (a->have_beat != b->have_beat || (a->have_beat && a->last_r != b->last_r) || a->rr_avg != b->rr_avg) {
+    return 0;
+  }
+
+  if (a->sb_valid != b->sb_valid ||
+      (a->sb_valid && (a->sb_r != b->sb_r || memcmp(&a->sb_peak, &b->sb_peak, sizeof(float)) != 0 ||
+                       memcmp(&a->sb_r_val, &b->sb_r_val, sizeof(float)) != 0))) {
+    return 0;
+  }
+
+  /* the sliding maximum deque entry by entry, its head slot may differ */
+  if (a->max_count != b->max_count) {
+    return 0;
+  }
+  for (i = 0; i < a->max_count; i++) {
+    const qrs_stream_max_t* ma = &a->max_deque[(a->max_head + i) % cap];
+    const qrs_stream_max_t* mb = &b->max_deque[(b->max_head + i) % cap];
+    if (ma->idx != mb->idx || ma->rise != mb->rise || ma->step != mb->step ||
+        memcmp(&ma->val, &mb->val, sizeof(float)) != 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+uint8_t qrs_stream_process(qrs_stream_t* stream, float sample, qrs_stream_beat_t* beat)
+{
+  /* 5-point derivative: y[n] = (2x[n] + x[n-1] - x[n-3] - 2x[n-4]) / 8 */
+  float slope = (2.0f * sample + stream->x[0] - stream->x[2] - 2.0f * stream->x[3]) * 0.125f;
+  rise_track(stream, sample);
+  stream->x[3] = stream->x[2];
+  stream->x[2] = stream->x[1];
+  stream->x[1] = stream->x[0];
+  stream->x[0] = sample;
+
+  /* squaring and moving window integration with a running sum */
+  float squared = slope * slope;
+  stream->mwi_sum += squared - stream->mwi_ring[stream->mwi_pos];
+  stream->mwi_ring[stream->mwi_pos] = squared;
+  if (++stream->mwi_pos >= stream->mwi_len) {
+    /* re-sum once per window so float round off can not accumulate - O(1) amortized */
+    uint16_t i = 0;
+    stream->mwi_pos = 0;
+    stream->mwi_sum = 0.0f;
+    for (; i < stream->mwi_len; i++) {
+      stream->mwi_sum += stream->mwi_ring[i];
+    }
+  }
+  float mwi = stream->mwi_sum / (float)stream->mwi_len;
+
+  return detect(stream, sample, mwi, beat);
+}
+
+uint8_t qrs_stream_process_feature(qrs_stream_t* stream, float sample, float mwi, qrs_stream_beat_t* beat)
+{
+  /* the derivative history is only needed for the rise tracking */
+  rise_track(stream, sample);
+  stream->x[0] = sample;
+
+  return detect(stream, sample, mwi, beat);
+}
@@ -0,0 +1,186 @@
+#ifndef QRS_STREAM_H
+#define QRS_STREAM_H
+
+#include <stdint.h>
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define QRS_STREAM_MWI_MAX      160   /* moving window integrator length limit (150 ms at 1 kHz) */
+#define QRS_STREAM_MWI_MS       150   /* moving window integrator length in ms */
+#define QRS_STREAM_REFRACTORY_MS 200  /* no second beat within 200 ms of a beat */
+#define QRS_STREAM_LEARN_MS     2000  /* threshold learning phase at start up */
+#define QRS_STREAM_RR_BEATS     8     /* beats in the RR average used for search back */
+#define QRS_STREAM_RR_MAX_MS    2000  /* the RR average is capped at 30 bpm, longer pauses search back after 3.3 s */
+#define QRS_STREAM_SEARCH_BACK  166   /* search back after this % of the RR average without a beat */
+#define QRS_STREAM_MIN_RISE     2     /* samples of the upstroke to an R peak - a one sample jump is a step artifact */
+#define QRS_STREAM_MIN_RISE_MS  10    /* the same in ms at higher rates - the upstroke of a narrow QRS still spans it */
+#define QRS_STREAM_STEP_SHARE   0.5f  /* an upstroke one sample carries half of ... */
+#define QRS_STREAM_STEP_HOLD    0.5f  /* ... and that keeps half its height ... */
+#define QRS_STREAM_STEP_HOLD_MS 40    /* ... for 40 ms is a step, whatever its length - an R peak falls back sooner */
+
+/* most samples a search back beat is emitted after its R peak, at the longest RR average of a rate */
+#define QRS_STREAM_SEARCH_BACK_MAX(fs) \
+  ((uint32_t)(fs) * QRS_STREAM_RR_MAX_MS / 1000 * QRS_STREAM_SEARCH_BACK / 100 + 1)
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* beat emitted by the streaming detector */
+typedef struct {
+  uint64_t r_sample;      /* absolute sample number of the R peak */
+  float r_val;            /* filtered signal at the R peak */
+  float peak;             /* integrated (MWI) peak that confirmed the beat */
+  uint32_t rr_samples;    /* samples since the previous beat, 0 for the first beat */
+  uint8_t search_back;    /* 1 if found by search back with the lower threshold */
+} qrs_stream_beat_t;
+
+/* sample of the sliding maximum deque */
+typedef struct {
+  uint64_t idx;
+  float val;
+  uint16_t rise;                      /* samples from the foot of the upstroke to idx */
+  uint8_t step;                       /* the upstroke to idx is a step, known QRS_STREAM_STEP_HOLD_MS after idx */
+} qrs_stream_max_t;
+
+/*!
+ * @brief Streaming QRS detector state (Pan-Tompkins style)
+ *
+ * every sample costs O(1): 5-point derivative, squaring, a running sum moving
+ * window integrator, a local maximum test on the integrator and a monotonic
+ * deque for the R location. signal and noise peak levels adapt the threshold
+ * with every peak, a refractory period rejects double detections, peaks reached
+ * by a single sample jump are rejected as step artifacts (electrode pops, the
+ * seam of a looped recording). the upstroke is measured from its foot and only
+ * ends where the signal falls back by half, so noise does not cut a wide peak
+ * short. an upstroke one sample carries the larger part of and the signal stays
+ * up after is a step as well, also when noise or a slow drift adds samples in
+ * front of the jump - an R peak falls back. a search back with half the
+ * threshold recovers beats missed for 166% of the average RR, which is capped at
+ * QRS_STREAM_RR_MAX_MS so a search back beat is never later than
+ * QRS_STREAM_SEARCH_BACK_MAX().
+ */
+typedef struct {
+  /* configuration derived from the sampling frequency */
+  uint16_t sample_freq;               /* sampling frequency in Hz */
+  uint16_t mwi_len;                   /* integrator window in samples */
+  uint16_t refractory;                /* refractory period in samples */
+  uint16_t min_rise;                  /* samples from the foot of the upstroke an R peak needs */
+  uint16_t step_hold;                 /* samples a step keeps its height */
+  uint32_t learn_len;                 /* learning phase in samples */
+  uint64_t learn_end;                 /* absolute sample that ends the learning phase */
+
+  /* band signal history and derivative */
+  float x[4];                         /* x[n-1] .. x[n-4] */
+  uint16_t rise;                      /* samples from the foot of the upstroke to x[n-1], 0 while falling */
+  float rise_base;                    /* foot of the upstroke - its lowest sample */
+  float rise_top;                     /* highest sample of the upstroke so far */
+  float rise_jump;                    /* largest single sample increment of the upstroke */
+  uint64_t rise_top_idx;              /* absolute sample of rise_top */
+  uint8_t step_watch;                 /* one sample carried the upstroke to rise_top - a step if the signal stays up */
+
+  /* moving window integrator */
+  float mwi_ring[QRS_STREAM_MWI_MAX]; /* squared slopes inside the window */
+  uint16_t mwi_pos;                   /* oldest entry of mwi_ring */
+  float mwi_sum;                      /* running sum of mwi_ring */
+  float mwi_prev;                     /* integrator output of the previous sample */
+  uint8_t rising;                     /* integrator rising since the last peak */
+
+  /* sliding maximum of the band signal over the integrator window */
+  qrs_stream_max_t max_deque[QRS_STREAM_MWI_MAX + 4];
+  uint16_t max_head;                  /* oldest entry (the maximum) */
+  uint16_t max_count;                 /* entries in the deque */
+
+  /* adaptive thresholds */
+  float spki;                         /* running signal peak level */
+  float npki;                         /* running noise peak level */
+  float threshold1;                   /* detection threshold */
+  float threshold2;                   /* search back threshold (threshold1 / 2) */
+  float learn_max;                    /* max integrator output during learning */
+  float learn_sum;                    /* integrator sum during learning */
+
+  /* beat history */
+  uint64_t n;                         /* number of samples consumed */
+  uint64_t last_r;                    /* absolute sample of the last R peak */
+  uint8_t have_beat;                  /* last_r is valid */
+  uint32_t rr_avg;                    /* average of the recent RR intervals in samples, QRS_STREAM_RR_MAX_MS at most */
+  uint32_t rr_hist[QRS_STREAM_RR_BEATS];
+  uint8_t rr_count;                   /* valid entries in rr_hist */
+  uint8_t rr_pos;                     /* next entry to replace in rr_hist */
+
+  /* best rejected peak since the last beat - search back candidate */
+  uint8_t sb_valid;
+  float sb_peak;
+  uint64_t sb_r;
+  float sb_r_val;
+} qrs_stream_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Init streaming QRS detector
+ *
+ * @param stream      - pointer to detector state
+ * @param sample_freq - sampling frequency in Hz
+ */
+void qrs_stream_init(qrs_stream_t* stream, uint16_t sample_freq);
+
+/*!
+ * @brief Start a fresh detector at an absolute sample number
+ *
+ * for a detector that joins a signal in the middle (a shard of a long
+ * record): the first sample gets number first_sample and the learning phase
+ * starts there. call right after qrs_stream_init().
+ *
+ * @param stream       - pointer to detector state
+ * @param first_sample - absolute sample number of the next sample
+ */
+void qrs_stream_seek(qrs_stream_t* stream, uint64_t first_sample);
+
+/*!
+ * @brief Check if two detectors will emit the same beats from now on
+ *
+ * compares every field that influences later beats, bit for bit - two
+ * detectors that started at different samples of the same signal are equal
+ * once their adaptive levels have converged.
+ *
+ * @param a - detector state
+ * @param b - detector state
+ * @return 1 if the states are the same, 0 otherwise
+ */
+uint8_t qrs_stream_same_state(const qrs_stream_t* a, const qrs_stream_t* b);
+
+/*!
+ * @brief Feed one filtered sample to the detector
+ *
+ * the sample gets the next absolute sample number (0 for the first sample).
+ * a beat is emitted as soon as the integrator peak that belongs to it is
+ * confirmed, roughly half an integrator window after the R peak.
+ *
+ * @param stream - pointer to detector state
+ * @param sample - baseline filtered ECG sample
+ * @param beat   - filled when a beat is emitted
+ * @return 1 if a beat was emitted, 0 otherwise
+ */
+uint8_t qrs_stream_process(qrs_stream_t* stream, float sample, qrs_stream_beat_t* beat);
+
+/*!
+ * @brief Feed one filtered sample with its integrator output to the detector
+ *
+ * for a preprocessing chain that already ran the derivative, squaring and
+ * integration (preprocess_block()) - the same detection as qrs_stream_process()
+ * without its own integrator.
+ *
+ * @param stream - pointer to detector state
+ * @param sample - baseline filtered ECG sample
+ * @param mwi    - integrator output of the sample
+ * @param beat   - filled when a beat is emitted
+ * @return 1 if a beat was emitted, 0 otherwise
+ */
+uint8_t qrs_stream_process_feature(qrs_stream_t* stream, float sample, float mwi, qrs_stream_beat_t* beat);
+
+#endif /* QRS_STREAM_H */
@@ -0,0 +1,199 @@
+#include "sqi.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "config/config.h"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* restarts the running features, the first sample of a block only seeds them */
+static void start_block(sqi_t* sqi, float raw, float filtered)
+{
+  memset(&sqi->run, 0, sizeof(sqi->run));
+  sqi->run.prev = filtered;
+  sqi->run.prev2 = filtered;
+  sqi->run.prev_raw = raw;
+  sqi->run.raw_min = raw;
+  sqi->run.raw_max = raw;
+  sqi->run.baseline = raw;
+  sqi->run.baseline_min = raw;
+  sqi->run.baseline_max = raw;
+}
+
+/* median of the reference ring - sorted copy, so the order of the ring does not matter */
+static float median_ref(const sqi_t* sqi)
+{
+  float sorted[SQI_REF_BLOCKS];
+  uint32_t n = MIN(sqi->num_ref, (uint32_t)SQI_REF_BLOCKS);
+  uint32_t i = 0;
+
+  for (; i < n; i++) {
+    float v = sqi->ref[i];
+    uint32_t j = i;
+    for (; j > 0 && sorted[j - 1] > v; j--) {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = v;
+  }
+  return sorted[n / 2];
+}
+
+/* feature at its limit scores SQI_MIN_USABLE, twice the limit 0 */
+static float badness(float value, float limit)
+{
+  return (float)(100 - SQI_MIN_USABLE) * value / limit;
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+void sqi_init(sqi_t* sqi, uint16_t sample_freq)
+{
+  memset(sqi, 0, sizeof(*sqi));
+  sqi->flat_len = (uint16_t)ECG_MS_TO_SAMPLES(SQI_FLAT_MS, sample_freq);
+  sqi->flat_slope = SQI_FLAT_SLOPE / (float)sample_freq;
+  sqi->baseline_alpha = 1000.0f / ((float)SQI_BASELINE_MS * (float)sample_freq);
+}
+
+void sqi_seek(sqi_t* sqi, uint64_t block)
+{
+  sqi->block = block;
+  sqi->samples = 0;
+  sqi->num_closed = 0;
+}
+
+void sqi_process(sqi_t* sqi, const float* raw, const float* filtered, uint32_t num_samples)
+{
+  const float flat_eps = sqi->reference * sqi->flat_slope;
+  const float alpha = sqi->baseline_alpha;
+  const float keep = 1.0f - alpha;
+  const uint32_t flat_len = sqi->flat_len;
+  uint32_t i = 0;
+
+  if (num_samples == 0) {
+    return;
+  }
+  if (sqi->samples == 0) {
+    start_block(sqi, raw[0], filtered[0]);
+    i = 1;
+  }
+
+  /* a local copy stays in registers, the samples could alias the state */
+  sqi_running_t run = sqi->run;
+  for (; i < num_samples; i++) {
+    float x = raw[i];
+    float y = filtered[i];
+    float d = y - run.prev;
+    float dd = d - (run.prev - run.prev2);
+
+    /* high-frequency noise */
+    run.diff2_energy += dd * dd;
+    run.prev2 = run.prev;
+    run.prev = y;
+
+    /* flatline - a run counts from the sample that makes it long enough, with the samples before */
+    run.flat_run = (fabsf(d) <= flat_eps) ? run.flat_run + 1 : 0;
+    run.flat += (run.flat_run == flat_len) ? flat_len : (run.flat_run > flat_len);
+
+    /* saturation - the converter repeats its rail */
+    run.saturated += (x == run.prev_raw && (x >= run.raw_max || x <= run.raw_min));
+    run.raw_min = MIN(run.raw_min, x);
+    run.raw_max = MAX(run.raw_max, x);
+    run.prev_raw = x;
+
+    /* baseline excursion and the amplitude around the baseline */
+    run.baseline = run.baseline * keep + x * alpha;  /* shorter chain than b += (x - b) * alpha */
+    run.baseline_min = MIN(run.baseline_min, run.baseline);
+    run.baseline_max = MAX(run.baseline_max, run.baseline);
+    run.detail_min = MIN(run.detail_min, x - run.baseline);
+    run.detail_max = MAX(run.detail_max, x - run.baseline);
+  }
+  sqi->run = run;
+  sqi->samples += num_samples;
+}
+
+uint8_t sqi_end_block(sqi_t* sqi, sqi_block_t* out)
+{
+  sqi_block_t block;
+  float n = (float)MAX(sqi->samples, 1u);
+  float amplitude = sqi->run.detail_max - sqi->run.detail_min;
+  float reference = (sqi->reference > 0.0f) ? sqi->reference : amplitude;
+
+  block.flat = (float)sqi->run.flat / n;
+  block.saturated = (float)sqi->run.saturated / n;
+  block.noise = 0.0f;
+  block.excursion = 0.0f;
+  if (reference > 0.0f) {
+    block.noise = sqrtf(sqi->run.diff2_energy / (6.0f * n)) / reference;
+    block.excursion = (sqi->run.baseline_max - sqi->run.baseline_min) / reference;
+  }
+
+  /* the worst feature decides */
+  float worst = badness(block.flat, SQI_FLAT_LIMIT);
+  worst = MAX(worst, badness(block.saturated, SQI_SAT_LIMIT));
+  worst = MAX(worst, badness(block.noise, SQI_NOISE_LIMIT));
+  worst = MAX(worst, badness(block.excursion, SQI_EXCURSION_LIMIT));
+  block.score = (worst >= 100.0f) ? 0 : (uint8_t)(100.0f - worst);
+
+  /* only usable blocks move the reference, a noisy stretch does not raise it */
+  if (block.score >= SQI_MIN_USABLE && amplitude > 0.0f) {
+    sqi->ref[sqi->num_ref % SQI_REF_BLOCKS] = amplitude;
+    sqi->num_ref++;
+    sqi->reference = median_ref(sqi);
+  }
+
+  sqi->history[sqi->block % SQI_HISTORY] = block.score;
+  sqi->block++;
+  sqi->num_closed++;
+  sqi->samples = 0;
+  if (out) {
+    *out = block;
+  }
+  return block.score;
+}
+
+uint8_t sqi_block_score(const sqi_t* sqi, uint64_t block)
+{
+  uint64_t age = sqi->block - block;
+
+  if (block >= sqi->block || age > SQI_HISTORY || age > sqi->num_closed) {
+    return SQI_NONE;
+  }
+  return sqi->history[block % SQI_HISTORY];
+}
+
+uint8_t sqi_same_state(const sqi_t* a, const sqi_t* b)
+{
+  uint32_t num_ref = MIN(a->num_ref, (uint32_t)SQI_REF_BLOCKS);
+  uint64_t num_closed = MIN(a->num_closed, (uint64_t)SQI_HISTORY);
+  uint32_t i = 0;
+
+  if (a->block != b->block || a->samples != b->samples || num_ref != MIN(b->num_ref, (uint32_t)SQI_REF_BLOCKS) ||
+      num_closed != MIN(b->num_closed, (uint64_t)SQI_HISTORY) ||
+      memcmp(&a->reference, &b->reference, sizeof(float)) != 0) {
+    return 0;
+  }
+
+  /* running features of the current block - meaningless before its first sample */
+  if (a->samples > 0 && memcmp(&a->run, &b->run, sizeof(a->run)) != 0) {
+    return 0;
+  }
+
+  /* reference ring newest first and the scores of the last blocks - their slots may differ */
+  for (i = 1; i <= num_ref; i++) {
+    if (memcmp(&a->ref[(a->num_ref - i) % SQI_REF_BLOCKS], &b->ref[(b->num_ref - i) % SQI_REF_BLOCKS],
+               sizeof(float)) != 0) {
+      return 0;
+    }
+  }
+  for (i = 1; i <= num_closed; i++) {
+    if (sqi_block_score(a, a->block - i) != sqi_block_score(b, b->block - i)) {
+      return 0;
+    }
+  }
+  return 1;
+}
@@ -0,0 +1,152 @@
+#ifndef SQI_H
+#define SQI_H
+
+#include <stdint.h>
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define SQI_NONE            0xFF   /* score of a block that was not scored */
+#define SQI_MIN_USABLE      50     /* a feature at its limit scores 50 - blocks below are unusable */
+#define SQI_REF_BLOCKS      8      /* usable blocks the reference amplitude is the median of, power of two */
+#define SQI_HISTORY         4      /* scores of the last blocks kept for the beats in flight, power of two */
+#define SQI_FLAT_MS         300    /* flat runs from this length on count */
+#define SQI_FLAT_SLOPE      0.5f   /* flat below this slope, in reference amplitudes per second */
+#define SQI_FLAT_LIMIT      0.6f   /* fraction of the block in flat runs */
+#define SQI_SAT_LIMIT       0.1f   /* fraction of the block stuck at its extremes */
+#define SQI_NOISE_LIMIT     0.15f  /* high-frequency noise RMS in reference amplitudes */
+#define SQI_BASELINE_MS     250    /* time constant of the baseline estimate */
+#define SQI_EXCURSION_LIMIT 1.0f   /* baseline excursion in reference amplitudes */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* features and score of one block */
+typedef struct {
+  float flat;                         /* fraction of the samples in flat runs */
+  float saturated;                    /* fraction of the samples repeated at the extremes of the block */
+  float noise;                        /* high-frequency noise RMS in reference amplitudes */
+  float excursion;                    /* range of the baseline in reference amplitudes */
+  uint8_t score;                      /* 0-100, SQI_MIN_USABLE and up is usable */
+} sqi_block_t;
+
+/* running features of the current block */
+typedef struct {
+  float prev;                       /* last two filtered samples */
+  float prev2;
+  float prev_raw;                   /* last raw sample */
+  float raw_min;                    /* extremes of the raw samples */
+  float raw_max;
+  float baseline;                   /* moving baseline of the raw signal */
+  float baseline_min;               /* extremes of the baseline */
+  float baseline_max;
+  float detail_min;                 /* extremes of the raw signal minus the baseline */
+  float detail_max;
+  float diff2_energy;               /* sum of the squared second differences */
+  uint32_t flat_run;                /* length of the current flat run */
+  uint32_t flat;                    /* samples in flat runs of flat_len and up */
+  uint32_t saturated;               /* samples repeated at an extreme */
+} sqi_running_t;
+
+/*!
+ * @brief Incremental signal quality index of one channel
+ *
+ * scores the signal in blocks (a pass over the filtered buffer) before any
+ * beat of the block is delineated. every sample updates a handful of running
+ * features in O(1):
+ *   flatline  - runs of SQI_FLAT_MS with a slope below SQI_FLAT_SLOPE (lead off)
+ *   saturated - raw samples repeated at the running max or min of the block (clipping)
+ *   noise     - RMS of the second difference / sqrt(6), the standard deviation of white
+ *               noise - a narrow QRS adds to it at low rates, the ECG itself hardly at all
+ *   excursion - range of a SQI_BASELINE_MS moving baseline of the raw signal (motion)
+ * each feature maps its limit to a score of SQI_MIN_USABLE, the worst one is
+ * the block score. amplitudes are relative to the median peak-to-peak of the
+ * last SQI_REF_BLOCKS usable blocks (of the block itself before the first
+ * one), so the limits do not depend on the gain.
+ *
+ * the running features restart with every block, and the reference has a
+ * finite memory, so two runs that see the same blocks end in the same state.
+ */
+typedef struct {
+  /* rate dependent settings - fixed at init */
+  uint16_t flat_len;                  /* SQI_FLAT_MS in samples */
+  float flat_slope;                   /* SQI_FLAT_SLOPE per sample */
+  float baseline_alpha;               /* weight of a sample in the baseline */
+
+  /* current block */
+  uint64_t block;                     /* number of the current block */
+  uint32_t samples;                   /* samples of the block so far */
+  sqi_running_t run;                  /* running features, restarted with every block */
+
+  /* reference amplitude */
+  float ref[SQI_REF_BLOCKS];          /* peak-to-peak of the last usable blocks */
+  uint32_t num_ref;                   /* usable blocks since init */
+  float reference;                    /* median of ref, 0 before the first usable block */
+
+  /* scores of the closed blocks, by block number */
+  uint8_t history[SQI_HISTORY];
+  uint64_t num_closed;                /* blocks closed since init or seek */
+} sqi_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Init the SQI of one channel
+ *
+ * @param sqi         - pointer to the SQI state
+ * @param sample_freq - sampling frequency in Hz
+ */
+void sqi_init(sqi_t* sqi, uint16_t sample_freq);
+
+/*!
+ * @brief Start at a block number, for a channel that joins a signal in the middle
+ *
+ * @param sqi   - pointer to the SQI state
+ * @param block - number of the block of the next sample
+ */
+void sqi_seek(sqi_t* sqi, uint64_t block);
+
+/*!
+ * @brief Add samples to the current block, O(1) per sample
+ *
+ * @param sqi         - pointer to the SQI state
+ * @param raw         - raw samples
+ * @param filtered    - the same samples after the preprocessing
+ * @param num_samples - number of samples
+ */
+void sqi_process(sqi_t* sqi, const float* raw, const float* filtered, uint32_t num_samples);
+
+/*!
+ * @brief Score the current block and start the next one
+ *
+ * @param sqi - pointer to the SQI state
+ * @param out - filled with the features of the block (may be NULL)
+ * @return the block score (0-100)
+ */
+uint8_t sqi_end_block(sqi_t* sqi, sqi_block_t* out);
+
+/*!
+ * @brief Score of a closed block
+ *
+ * @param sqi   - pointer to the SQI state
+ * @param block - block number
+ * @return the score, SQI_NONE if the block is not closed, too old or before the start
+ */
+uint8_t sqi_block_score(const sqi_t* sqi, uint64_t block);
+
+/*!
+ * @brief Check if two SQI states score the next blocks the same
+ *
+ * compares the current block, the reference and the history bit for bit.
+ *
+ * @param a - SQI state
+ * @param b - SQI state
+ * @return 1 if the states are the same, 0 otherwise
+ */
+uint8_t sqi_same_state(const sqi_t* a, const sqi_t* b);
+
+#endif /* SQI_H */
@@ -28,8 +28,8 @@
 #define BASELINE_FILTER_STAGES 3
 
 /* numerator coefficients (b) */ 
-const int baseline_num_order[BASELINE_FILTER_STAGES] = { 1,3,1 };
-const float baseline_num[BASELINE_FILTER_STAGES][3] = {
+static const int baseline_num_order[BASELINE_FILTER_STAGES] = { 1,3,1 };
+static const float baseline_num[BASELINE_FILTER_STAGES][3] = {
   {
      0.9733407497,              0,              0     /* stage 1: 1st order */
   },
@@ -42,8 +42,8 @@ const float baseline_num[BASELINE_FILTER_STAGES][3] = {
 };
 
 /* denominator coefficients (a) */
-const int baseline_den_order[BASELINE_FILTER_STAGES] = { 1,3,1 };
-const float baseline_den[BASELINE_FILTER_STAGES][3] = {
+static const int baseline_den_order[BASELINE_FILTER_STAGES] = { 1,3,1 };
+static const float baseline_den[BASELINE_FILTER_STAGES][3] = {
   {
                 1,              0,              0     /* stage 1: 1st order */ 
   },
@@ -55,4 +55,22 @@ const float baseline_den[BASELINE_FILTER_STAGES][3] = {
   }
 };
 
+/*
+ * the same filter for the other common sampling rates - generated with
+ * scipy.signal.cheby2(2, 4, 0.9 / (fs / 2), 'high') and split into the
+ * stages above. other rates are designed at runtime by baseline_wander_rate_init().
+ */
+#define BASELINE_RATE_TABLE(fs, gain, b1, a1, a2)                        \
+  static const float baseline_num_##fs[BASELINE_FILTER_STAGES][3] = {   \
+    { gain, 0, 0 }, { 1, b1, 1 }, { 1, 0, 0 }                           \
+  };                                                                    \
+  static const float baseline_den_##fs[BASELINE_FILTER_STAGES][3] = {   \
+    { 1, 0, 0 }, { 1, a1, a2 }, { 1, 0, 0 }                             \
+  };
+
+BASELINE_RATE_TABLE(250, 0.9913880928f, -1.999744174f, -1.982448392f, 0.9828503567f)
+BASELINE_RATE_TABLE(360, 0.9940115077f, -1.999876629f, -1.987864519f, 0.9880588788f)
+BASELINE_RATE_TABLE(500, 0.9956846279f, -1.999936045f, -1.991286954f, 0.9913878786f)
+BASELINE_RATE_TABLE(1000, 0.9978399675f, -1.999984011f, -1.995659315f, 0.9956846008f)
+
 #endif /* Baseline_Wander_Coeffs_H_ */
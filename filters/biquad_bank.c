@@ -0,0 +1,145 @@
+#include "biquad_bank.h"
+
+#include <string.h>
+
+size_t biquad_bank_state_bytes(uint16_t num_stages, uint32_t num_channels)
+{
+  /* d1 and d2 planes */
+  return 2u * (size_t)num_stages * BIQUAD_BANK_STRIDE(num_channels) * sizeof(float);
+}
+
+int biquad_bank_init(biquad_bank_t* bank, const float (*b)[3], const float (*a)[3],
+                     uint16_t num_stages, uint32_t num_channels, void* state_mem)
+{
+  uint16_t curr_stage = 0;
+
+  if (num_stages == 0 || num_stages > BIQUAD_BANK_MAX_STAGES || num_channels == 0 || !state_mem ||
+      ((uintptr_t)state_mem % BIQUAD_BANK_ALIGN) != 0) {
+    return -1;
+  }
+
+  bank->num_stages = num_stages;
+  bank->num_channels = num_channels;
+  bank->stride = BIQUAD_BANK_STRIDE(num_channels);
+  for (; curr_stage < num_stages; curr_stage++) {
+    memcpy(bank->b[curr_stage], b[curr_stage], sizeof(bank->b[curr_stage]));
+    memcpy(bank->a[curr_stage], a[curr_stage], sizeof(bank->a[curr_stage]));
+  }
+
+  bank->d1 = (float*)state_mem;
+  bank->d2 = bank->d1 + (size_t)num_stages * bank->stride;
+  biquad_bank_reset(bank);
+  biquad_bank_select_isa(bank, BIQUAD_ISA_AUTO);
+  return 0;
+}
+
+void biquad_bank_reset(biquad_bank_t* bank)
+{
+  memset(bank->d1, 0, biquad_bank_state_bytes(bank->num_stages, bank->num_channels));
+}
+
+uint8_t biquad_isa_supported(biquad_isa_t isa)
+{
+  switch (isa) {
+    case BIQUAD_ISA_SCALAR:
+      return 1;
+#if defined(BIQUAD_BANK_HAVE_SSE)
+    case BIQUAD_ISA_SSE:
+      return 1; /* SSE2 is part of the x86-64 baseline */
+#endif
+#if defined(BIQUAD_BANK_HAVE_AVX2)
+    case BIQUAD_ISA_AVX2:
+      return (uint8_t)(__builtin_cpu_supports("avx2") != 0);
+#endif
+#if defined(BIQUAD_BANK_HAVE_NEON)
+    case BIQUAD_ISA_NEON:
+      return 1;
+#endif
+    default:
+      return 0;
+  }
+}
+
+const char* biquad_isa_name(biquad_isa_t isa)
+{
+  switch (isa) {
+    case BIQUAD_ISA_AUTO:   return "auto";
+    case BIQUAD_ISA_SCALAR: return "scalar";
+    case BIQUAD_ISA_SSE:    return "sse";
+    case BIQUAD_ISA_AVX2:   return "avx2";
+    case BIQUAD_ISA_NEON:   return "neon";
+    default:                return "unknown";
+  }
+}
+
+biquad_isa_t biquad_bank_select_isa(biquad_bank_t* bank, biquad_isa_t isa)
+{
+  /* best first */
+  static const biquad_isa_t preference[] = { BIQUAD_ISA_AVX2, BIQUAD_ISA_NEON, BIQUAD_ISA_SSE, BIQUAD_ISA_SCALAR };
+  uint16_t i = 0;
+
+  if (isa == BIQUAD_ISA_AUTO || !biquad_isa_supported(isa)) {
+    for (i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+      if (biquad_isa_supported(preference[i])) {
+        isa = preference[i];
+        break;
+      }
+    }
+  }
+
+  switch (isa) {
+#if defined(BIQUAD_BANK_HAVE_AVX2)
+    case BIQUAD_ISA_AVX2:
+      bank->kernel = biquad_bank_process_avx2;
+      break;
+#endif
+#if defined(BIQUAD_BANK_HAVE_SSE)
+    case BIQUAD_ISA_SSE:
+      bank->kernel = biquad_bank_process_sse;
+      break;
+#endif
+#if defined(BIQUAD_BANK_HAVE_NEON)
+    case BIQUAD_ISA_NEON:
+      bank->kernel = biquad_bank_process_neon;
+      break;
+#endif
+    default:
+      isa = BIQUAD_ISA_SCALAR;
+      bank->kernel = biquad_bank_process_scalar;
+      break;
+  }
+
+  bank->isa = isa;
+  return isa;
+}
+
+void biquad_bank_process_scalar(const biquad_bank_t* bank, const float* in, float* out, uint32_t num_frames)
+{
+  const uint32_t stride = bank->stride;
+  uint32_t frame = 0;
+  uint32_t ch = 0;
+  uint16_t curr_stage = 0;
+
+  for (frame = 0; frame < num_frames; frame++) {
+    const float* x = in + (size_t)frame * stride;
+    float* y = out + (size_t)frame * stride;
+
+    for (ch = 0; ch < stride; ch++) {
+      float output_y = x[ch];
+
+      /* same operation order as iir_biquad_filter() */
+      for (curr_stage = 0; curr_stage < bank->num_stages; curr_stage++) {
+        float* d1 = &bank->d1[(size_t)curr_stage * stride + ch];
+        float* d2 = &bank->d2[(size_t)curr_stage * stride + ch];
+
+        float intermediate = output_y - (bank->a[curr_stage][1] * *d1) - (bank->a[curr_stage][2] * *d2);
+        output_y = bank->b[curr_stage][0] * intermediate + (bank->b[curr_stage][1] * *d1) +
+                   (bank->b[curr_stage][2] * *d2);
+
+        *d2 = *d1;
+        *d1 = intermediate;
+      }
+      y[ch] = output_y;
+    }
+  }
+}
@@ -0,0 +1,149 @@
+#ifndef BIQUAD_BANK_H
+#define BIQUAD_BANK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define BIQUAD_BANK_MAX_STAGES 8   /* max cascaded stages of a bank */
+#define BIQUAD_BANK_LANES      8   /* channels are padded to a multiple of the widest vector */
+#define BIQUAD_BANK_ALIGN      64  /* required alignment of the state and sample memory */
+
+/* round a channel count up to the bank stride */
+#define BIQUAD_BANK_STRIDE(num_channels) \
+  ((((num_channels) + BIQUAD_BANK_LANES - 1) / BIQUAD_BANK_LANES) * BIQUAD_BANK_LANES)
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* instruction set used by the bank kernel */
+typedef enum {
+  BIQUAD_ISA_AUTO = 0,  /* best one supported by the running CPU */
+  BIQUAD_ISA_SCALAR,    /* portable C */
+  BIQUAD_ISA_SSE,       /* 4 channels per instruction (x86 SSE2) */
+  BIQUAD_ISA_AVX2,      /* 8 channels per instruction (x86 AVX2) */
+  BIQUAD_ISA_NEON       /* 4 channels per instruction (ARM NEON) */
+} biquad_isa_t;
+
+typedef struct biquad_bank biquad_bank_t;
+
+/* processes num_frames frames of the bank, see biquad_bank_process() */
+typedef void (*biquad_bank_kernel_t)(const biquad_bank_t* bank, const float* in, float* out,
+                                     uint32_t num_frames);
+
+/*!
+ * @brief Bank of identical Direct Form II biquad cascades, one per channel
+ *
+ * the recursion of a single biquad can not be vectorized, but independent
+ * channels can: the delay states are stored structure-of-arrays
+ * (d1[stage][channel], d2[stage][channel]) so one vector instruction advances
+ * BIQUAD_BANK_LANES channels by one sample.
+ *
+ * samples are exchanged in frames: frame f holds one sample of every channel
+ * at in[f * stride + channel], with stride = BIQUAD_BANK_STRIDE(num_channels).
+ */
+struct biquad_bank {
+  uint16_t num_stages;                        /* number of cascaded stages */
+  uint32_t num_channels;                      /* number of channels */
+  uint32_t stride;                            /* num_channels rounded up to BIQUAD_BANK_LANES */
+  float b[BIQUAD_BANK_MAX_STAGES][3];         /* numerator coeffs [b0,b1,b2] per stage */
+  float a[BIQUAD_BANK_MAX_STAGES][3];         /* denominator coeffs [1,a1,a2] per stage */
+  float* d1;                                  /* d[n-1] states [num_stages][stride] */
+  float* d2;                                  /* d[n-2] states [num_stages][stride] */
+  biquad_isa_t isa;                           /* instruction set of the kernel */
+  biquad_bank_kernel_t kernel;                /* kernel selected for isa */
+};
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Bytes of state memory needed by a bank
+ *
+ * @param num_stages   - number of cascaded stages
+ * @param num_channels - number of channels
+ * @return size in bytes of the memory passed to biquad_bank_init()
+ */
+size_t biquad_bank_state_bytes(uint16_t num_stages, uint32_t num_channels);
+
+/*!
+ * @brief Init a bank with the coefficients used by iir_biquad_filter()
+ *
+ * selects the fastest kernel supported by the running CPU and clears the states.
+ *
+ * @param bank         - pointer to the bank
+ * @param b            - numerator coeffs [b0,b1,b2] for each stage
+ * @param a            - denominator coeffs [1,a1,a2] for each stage
+ * @param num_stages   - number of cascaded stages (<= BIQUAD_BANK_MAX_STAGES)
+ * @param num_channels - number of channels
+ * @param state_mem    - BIQUAD_BANK_ALIGN aligned memory of biquad_bank_state_bytes()
+ * @return 0 on success, -1 on invalid arguments
+ */
+int biquad_bank_init(biquad_bank_t* bank, const float (*b)[3], const float (*a)[3],
+                     uint16_t num_stages, uint32_t num_channels, void* state_mem);
+
+/*!
+ * @brief Clear the delay states of every channel
+ *
+ * @param bank - pointer to the bank
+ */
+void biquad_bank_reset(biquad_bank_t* bank);
+
+/*!
+ * @brief Select the kernel instruction set
+ *
+ * falls back to the best supported instruction set if the requested one is
+ * not compiled in or not supported by the running CPU.
+ *
+ * @param bank - pointer to the bank
+ * @param isa  - requested instruction set
+ * @return instruction set actually selected
+ */
+biquad_isa_t biquad_bank_select_isa(biquad_bank_t* bank, biquad_isa_t isa);
+
+/*!
+ * @brief Check if an instruction set is compiled in and supported by the running CPU
+ *
+ * @param isa - instruction set
+ * @return 1 if supported, 0 otherwise
+ */
+uint8_t biquad_isa_supported(biquad_isa_t isa);
+
+/*!
+ * @brief Name of an instruction set
+ *
+ * @param isa - instruction set
+ * @return name string
+ */
+const char* biquad_isa_name(biquad_isa_t isa);
+
+/*!
+ * @brief Filter frames of all channels
+ *
+ * produces exactly the same output as calling iir_biquad_filter() for every
+ * channel and sample - the kernels keep the operation order and do not use FMA.
+ * in and out may be the same buffer. padding lanes are processed and ignored.
+ *
+ * @param bank       - pointer to the bank
+ * @param in         - input frames [num_frames][stride], BIQUAD_BANK_ALIGN aligned
+ * @param out        - output frames [num_frames][stride], BIQUAD_BANK_ALIGN aligned
+ * @param num_frames - number of frames
+ */
+static inline void biquad_bank_process(const biquad_bank_t* bank, const float* in, float* out,
+                                       uint32_t num_frames)
+{
+  bank->kernel(bank, in, out, num_frames);
+}
+
+/* kernels - selected through biquad_bank_select_isa() */
+void biquad_bank_process_scalar(const biquad_bank_t* bank, const float* in, float* out, uint32_t num_frames);
+void biquad_bank_process_sse(const biquad_bank_t* bank, const float* in, float* out, uint32_t num_frames);
+void biquad_bank_process_avx2(const biquad_bank_t* bank, const float* in, float* out, uint32_t num_frames);
+void biquad_bank_process_neon(const biquad_bank_t* bank, const float* in, float* out, uint32_t num_frames);
+
+#endif /* BIQUAD_BANK_H */
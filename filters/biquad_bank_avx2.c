@@ -0,0 +1,57 @@
+#include "biquad_bank.h"
+
+#if defined(BIQUAD_BANK_HAVE_AVX2)
+
+#include <immintrin.h>
+
+/* compiled with -mavx2 only (no -mfma) so every product is rounded before
+ * the add - this keeps the output bit-exact with iir_biquad_filter() */
+void biquad_bank_process_avx2(const biquad_bank_t* bank, const float* in, float* out, uint32_t num_frames)
+{
+  const uint32_t stride = bank->stride;
+  const uint16_t num_stages = bank->num_stages;
+  __m256 b0[BIQUAD_BANK_MAX_STAGES], b1[BIQUAD_BANK_MAX_STAGES], b2[BIQUAD_BANK_MAX_STAGES];
+  __m256 a1[BIQUAD_BANK_MAX_STAGES], a2[BIQUAD_BANK_MAX_STAGES];
+  __m256 d1[BIQUAD_BANK_MAX_STAGES], d2[BIQUAD_BANK_MAX_STAGES];
+  uint32_t ch = 0;
+  uint32_t frame = 0;
+  uint16_t s = 0;
+
+  for (s = 0; s < num_stages; s++) {
+    b0[s] = _mm256_set1_ps(bank->b[s][0]);
+    b1[s] = _mm256_set1_ps(bank->b[s][1]);
+    b2[s] = _mm256_set1_ps(bank->b[s][2]);
+    a1[s] = _mm256_set1_ps(bank->a[s][1]);
+    a2[s] = _mm256_set1_ps(bank->a[s][2]);
+  }
+
+  /* 8 channels at a time - their states stay in registers for the whole block */
+  for (ch = 0; ch < stride; ch += 8) {
+    for (s = 0; s < num_stages; s++) {
+      d1[s] = _mm256_load_ps(&bank->d1[(size_t)s * stride + ch]);
+      d2[s] = _mm256_load_ps(&bank->d2[(size_t)s * stride + ch]);
+    }
+
+    for (frame = 0; frame < num_frames; frame++) {
+      __m256 y = _mm256_load_ps(&in[(size_t)frame * stride + ch]);
+
+      for (s = 0; s < num_stages; s++) {
+        /* d[n] = x[n] - a1*d[n-1] - a2*d[n-2] */
+        __m256 w = _mm256_sub_ps(_mm256_sub_ps(y, _mm256_mul_ps(a1[s], d1[s])), _mm256_mul_ps(a2[s], d2[s]));
+        /* y[n] = b0*d[n] + b1*d[n-1] + b2*d[n-2] */
+        y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b0[s], w), _mm256_mul_ps(b1[s], d1[s])),
+                          _mm256_mul_ps(b2[s], d2[s]));
+        d2[s] = d1[s];
+        d1[s] = w;
+      }
+      _mm256_store_ps(&out[(size_t)frame * stride + ch], y);
+    }
+
+    for (s = 0; s < num_stages; s++) {
+      _mm256_store_ps(&bank->d1[(size_t)s * stride + ch], d1[s]);
+      _mm256_store_ps(&bank->d2[(size_t)s * stride + ch], d2[s]);
+    }
+  }
+}
+
+#endif /* BIQUAD_BANK_HAVE_AVX2 */
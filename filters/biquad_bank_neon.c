@@ -0,0 +1,57 @@
+#include "biquad_bank.h"
+
+#if defined(BIQUAD_BANK_HAVE_NEON)
+
+#include <arm_neon.h>
+
+/* vmulq/vaddq instead of vmlaq/vfmaq so every product is rounded before
+ * the add - this keeps the output bit-exact with iir_biquad_filter() */
+void biquad_bank_process_neon(const biquad_bank_t* bank, const float* in, float* out, uint32_t num_frames)
+{
+  const uint32_t stride = bank->stride;
+  const uint16_t num_stages = bank->num_stages;
+  float32x4_t b0[BIQUAD_BANK_MAX_STAGES], b1[BIQUAD_BANK_MAX_STAGES], b2[BIQUAD_BANK_MAX_STAGES];
+  float32x4_t a1[BIQUAD_BANK_MAX_STAGES], a2[BIQUAD_BANK_MAX_STAGES];
+  float32x4_t d1[BIQUAD_BANK_MAX_STAGES], d2[BIQUAD_BANK_MAX_STAGES];
+  uint32_t ch = 0;
+  uint32_t frame = 0;
+  uint16_t s = 0;
+
+  for (s = 0; s < num_stages; s++) {
+    b0[s] = vdupq_n_f32(bank->b[s][0]);
+    b1[s] = vdupq_n_f32(bank->b[s][1]);
+    b2[s] = vdupq_n_f32(bank->b[s][2]);
+    a1[s] = vdupq_n_f32(bank->a[s][1]);
+    a2[s] = vdupq_n_f32(bank->a[s][2]);
+  }
+
+  /* 4 channels at a time - their states stay in registers for the whole block */
+  for (ch = 0; ch < stride; ch += 4) {
+    for (s = 0; s < num_stages; s++) {
+      d1[s] = vld1q_f32(&bank->d1[(size_t)s * stride + ch]);
+      d2[s] = vld1q_f32(&bank->d2[(size_t)s * stride + ch]);
+    }
+
+    for (frame = 0; frame < num_frames; frame++) {
+      float32x4_t y = vld1q_f32(&in[(size_t)frame * stride + ch]);
+
+      for (s = 0; s < num_stages; s++) {
+        /* d[n] = x[n] - a1*d[n-1] - a2*d[n-2] */
+        float32x4_t w = vsubq_f32(vsubq_f32(y, vmulq_f32(a1[s], d1[s])), vmulq_f32(a2[s], d2[s]));
+        /* y[n] = b0*d[n] + b1*d[n-1] + b2*d[n-2] */
+        y = vaddq_f32(vaddq_f32(vmulq_f32(b0[s], w), vmulq_f32(b1[s], d1[s])),
+                          vmulq_f32(b2[s], d2[s]));
+        d2[s] = d1[s];
+        d1[s] = w;
+      }
+      vst1q_f32(&out[(size_t)frame * stride + ch], y);
+    }
+
+    for (s = 0; s < num_stages; s++) {
+      vst1q_f32(&bank->d1[(size_t)s * stride + ch], d1[s]);
+      vst1q_f32(&bank->d2[(size_t)s * stride + ch], d2[s]);
+    }
+  }
+}
+
+#endif /* BIQUAD_BANK_HAVE_NEON */
@@ -0,0 +1,247 @@
+#include "biquad_q15.h"
+
+#include <math.h>
+#include <string.h>
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* error feedback coeff - the integer nearest to a feedback coeff, at most 2 */
+static int16_t ef_coeff(double c)
+{
+  long k = lround(c);
+  return (int16_t)((k > 2) ? 2 : ((k < -2) ? -2 : k));
+}
+
+/* splits coeffs c (b0, b1, b2, -a1, -a2) into the hi and lo halves */
+static int quantize_section(biquad_q15_t* q, uint16_t s, const double* c)
+{
+  int64_t bound = 1 << (BIQUAD_Q15_HI_SHIFT - 1);   /* rounding of the output */
+  int64_t lo_sum = 0;
+  uint16_t i = 0;
+
+  for (; i < 5; i++) {
+    double scaled = ldexp(c[i], BIQUAD_Q15_HI_SHIFT + BIQUAD_Q15_LO_SHIFT);
+    int64_t full = 0;
+    int64_t hi = 0;
+
+    if (fabs(c[i]) >= 4.0) {
+      return -1;
+    }
+    full = (int64_t)llround(scaled);
+    hi = (int64_t)floor((double)(full + (1 << (BIQUAD_Q15_LO_SHIFT - 1))) / (double)(1 << BIQUAD_Q15_LO_SHIFT));
+    if (hi > Q15_MAX || hi < -Q15_MAX) {
+      return -1;
+    }
+    q->hi[s][i] = (int16_t)hi;
+    q->lo[s][i] = (int16_t)(full - hi * (1 << BIQUAD_Q15_LO_SHIFT));   /* in [-2^13, 2^13) */
+    bound += (hi < 0 ? -hi : hi) * 32768;
+    lo_sum += (q->lo[s][i] < 0 ? -q->lo[s][i] : q->lo[s][i]) * 32768;
+  }
+
+  /* error feedback with the nearest integers to the feedback coeffs, |e| <= 2^12 */
+  q->ef[s][0] = ef_coeff(c[3]);
+  q->ef[s][1] = ef_coeff(c[4]);
+  bound += ((q->ef[s][0] < 0 ? -q->ef[s][0] : q->ef[s][0]) + (q->ef[s][1] < 0 ? -q->ef[s][1] : q->ef[s][1])) *
+           (1 << (BIQUAD_Q15_HI_SHIFT - 1));
+  bound += (lo_sum >> BIQUAD_Q15_LO_SHIFT) + 1;
+
+  return (bound < INT32_MAX) ? 0 : -1;
+}
+
+/* one sample through section s - zi is the input history of the section, zo its
+ * output history. every kernel computes the same integer sums, in any order */
+static inline int16_t section(const biquad_q15_t* q, uint16_t s, int16_t x, int16_t* zi1, int16_t* zi2, int16_t zo1,
+                              int16_t zo2, int16_t* e1, int16_t* e2)
+{
+  const int16_t* hi = q->hi[s];
+  const int16_t* lo = q->lo[s];
+  int32_t acc_lo = lo[0] * x + lo[1] * *zi1 + lo[2] * *zi2 + lo[3] * zo1 + lo[4] * zo2;
+  int32_t acc = hi[0] * x + hi[1] * *zi1 + hi[2] * *zi2 + hi[3] * zo1 + hi[4] * zo2 + q->ef[s][0] * *e1 +
+                q->ef[s][1] * *e2 + (acc_lo >> BIQUAD_Q15_LO_SHIFT);
+  int32_t y = (acc + (1 << (BIQUAD_Q15_HI_SHIFT - 1))) >> BIQUAD_Q15_HI_SHIFT;
+
+  *e2 = *e1;
+  *e1 = q15_sat(acc - y * (1 << BIQUAD_Q15_HI_SHIFT));
+  *zi2 = *zi1;
+  *zi1 = x;
+  return q15_sat(y);
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+int biquad_q15_init(biquad_q15_t* q, const float (*b)[3], const float (*a)[3], uint16_t num_stages)
+{
+  double c[BIQUAD_Q15_MAX_STAGES][5];
+  double gain = 1.0;
+  uint16_t n = 0;
+  uint16_t s = 0;
+
+  if (num_stages == 0 || num_stages > BIQUAD_Q15_MAX_STAGES) {
+    return -1;
+  }
+
+  /* pure gains are carried into the next section, like preprocess_init() */
+  for (s = 0; s < num_stages; s++) {
+    if (b[s][1] == 0.0f && b[s][2] == 0.0f && a[s][1] == 0.0f && a[s][2] == 0.0f) {
+      gain *= b[s][0];
+      continue;
+    }
+    c[n][0] = gain * b[s][0];
+    c[n][1] = gain * b[s][1];
+    c[n][2] = gain * b[s][2];
+    c[n][3] = -(double)a[s][1];
+    c[n][4] = -(double)a[s][2];
+    gain = 1.0;
+    n++;
+  }
+
+  /* a gain behind the last section goes into its b, without sections it is a section of its own */
+  if (n == 0) {
+    c[0][0] = gain;
+    c[0][1] = c[0][2] = c[0][3] = c[0][4] = 0.0;
+    n = 1;
+  } else {
+    c[n - 1][0] *= gain;
+    c[n - 1][1] *= gain;
+    c[n - 1][2] *= gain;
+  }
+
+  q->num_stages = n;
+  for (s = 0; s < n; s++) {
+    if (quantize_section(q, s, c[s]) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void biquad_q15_reset(biquad_q15_state_t* state)
+{
+  memset(state, 0, sizeof(*state));
+}
+
+void biquad_q15_filter_block(const biquad_q15_t* q, biquad_q15_state_t* state, const int16_t* in, int16_t* out,
+                             uint32_t num_samples)
+{
+  const uint16_t num_stages = q->num_stages;
+  uint32_t i = 0;
+  uint16_t s = 0;
+
+  for (; i < num_samples; i++) {
+    int16_t x = in[i];
+
+    for (s = 0; s < num_stages; s++) {
+      x = section(q, s, x, &state->z[s][0], &state->z[s][1], state->z[s + 1][0], state->z[s + 1][1],
+                  &state->e[s][0], &state->e[s][1]);
+    }
+    state->z[num_stages][1] = state->z[num_stages][0];
+    state->z[num_stages][0] = x;
+    out[i] = x;
+  }
+}
+
+size_t biquad_bank_q15_state_bytes(const biquad_q15_t* q, uint32_t num_channels)
+{
+  /* z1 and z2 planes between the sections, e1 and e2 planes per section */
+  return (2u * ((size_t)q->num_stages + 1u) + 2u * q->num_stages) * BIQUAD_Q15_STRIDE(num_channels) *
+         sizeof(int16_t);
+}
+
+int biquad_bank_q15_init(biquad_bank_q15_t* bank, const biquad_q15_t* q, uint32_t num_channels, void* state_mem)
+{
+  size_t planes = 0;
+
+  if (q->num_stages == 0 || q->num_stages > BIQUAD_Q15_MAX_STAGES || num_channels == 0 || !state_mem ||
+      ((uintptr_t)state_mem % BIQUAD_BANK_ALIGN) != 0) {
+    return -1;
+  }
+
+  bank->coeffs = *q;
+  bank->num_channels = num_channels;
+  bank->stride = BIQUAD_Q15_STRIDE(num_channels);
+
+  planes = ((size_t)q->num_stages + 1u) * bank->stride;
+  bank->z1 = (int16_t*)state_mem;
+  bank->z2 = bank->z1 + planes;
+  bank->e1 = bank->z2 + planes;
+  bank->e2 = bank->e1 + (size_t)q->num_stages * bank->stride;
+  biquad_bank_q15_reset(bank);
+  biquad_bank_q15_select_isa(bank, BIQUAD_ISA_AUTO);
+  return 0;
+}
+
+void biquad_bank_q15_reset(biquad_bank_q15_t* bank)
+{
+  memset(bank->z1, 0, biquad_bank_q15_state_bytes(&bank->coeffs, bank->num_channels));
+}
+
+biquad_isa_t biquad_bank_q15_select_isa(biquad_bank_q15_t* bank, biquad_isa_t isa)
+{
+  /* best first */
+  static const biquad_isa_t preference[] = { BIQUAD_ISA_AVX2, BIQUAD_ISA_SSE, BIQUAD_ISA_SCALAR };
+  uint16_t i = 0;
+
+  if (isa == BIQUAD_ISA_AUTO || isa == BIQUAD_ISA_NEON || !biquad_isa_supported(isa)) {
+    for (i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+      if (biquad_isa_supported(preference[i])) {
+        isa = preference[i];
+        break;
+      }
+    }
+  }
+
+  switch (isa) {
+#if defined(BIQUAD_BANK_HAVE_AVX2)
+    case BIQUAD_ISA_AVX2:
+      bank->kernel = biquad_bank_q15_process_avx2;
+      break;
+#endif
+#if defined(BIQUAD_BANK_HAVE_SSE)
+    case BIQUAD_ISA_SSE:
+      bank->kernel = biquad_bank_q15_process_sse;
+      break;
+#endif
+    default:
+      isa = BIQUAD_ISA_SCALAR;
+      bank->kernel = biquad_bank_q15_process_scalar;
+      break;
+  }
+
+  bank->isa = isa;
+  return isa;
+}
+
+void biquad_bank_q15_process_scalar(const biquad_bank_q15_t* bank, const int16_t* in, int16_t* out,
+                                    uint32_t num_frames)
+{
+  const biquad_q15_t* q = &bank->coeffs;
+  const uint32_t stride = bank->stride;
+  const uint16_t num_stages = q->num_stages;
+  uint32_t frame = 0;
+  uint32_t ch = 0;
+  uint16_t s = 0;
+
+  for (frame = 0; frame < num_frames; frame++) {
+    const int16_t* x = in + (size_t)frame * stride;
+    int16_t* y = out + (size_t)frame * stride;
+
+    for (ch = 0; ch < stride; ch++) {
+      int16_t sample = x[ch];
+      size_t last = (size_t)num_stages * stride + ch;
+
+      for (s = 0; s < num_stages; s++) {
+        size_t zi = (size_t)s * stride + ch;
+        size_t zo = zi + stride;
+        sample = section(q, s, sample, &bank->z1[zi], &bank->z2[zi], bank->z1[zo], bank->z2[zo], &bank->e1[zi],
+                         &bank->e2[zi]);
+      }
+      bank->z2[last] = bank->z1[last];
+      bank->z1[last] = sample;
+      y[ch] = sample;
+    }
+  }
+}
@@ -0,0 +1,182 @@
+#ifndef BIQUAD_Q15_H
+#define BIQUAD_Q15_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "biquad_bank.h"
+#include "fixed_point.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define BIQUAD_Q15_MAX_STAGES BIQUAD_BANK_MAX_STAGES
+#define BIQUAD_Q15_LANES      16  /* int16 channels per AVX2 vector - channels are padded to a multiple */
+#define BIQUAD_Q15_HI_SHIFT   13  /* coeff = hi / 2^13 + lo / 2^27 */
+#define BIQUAD_Q15_LO_SHIFT   14  /* lo products are shifted by 14 more bits before the add */
+
+/* round a channel count up to the fixed-point bank stride */
+#define BIQUAD_Q15_STRIDE(num_channels) \
+  ((((num_channels) + BIQUAD_Q15_LANES - 1) / BIQUAD_Q15_LANES) * BIQUAD_Q15_LANES)
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/*!
+ * @brief Fixed-point biquad cascade - int16 samples, 32 bit accumulator
+ *
+ * Direct Form I on ADC units: y = b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2. every
+ * coefficient is split into two int16 halves, hi in Q13 and lo holding the
+ * remainder down to 2^-27, so all products are 16x16 bit (one multiply-add
+ * instruction per pair) while the poles keep 27 fractional bits - the baseline
+ * wander poles sit within 0.002 of z = 1 at 1 kHz, where 15 bit coefficients
+ * move the pass band by several dB. the rounding error of every output is fed
+ * back through ef (the integer nearest to -a1, -a2), which cancels most of the
+ * noise gain of poles close to the unit circle with 16 bit states.
+ *
+ * pure gain stages of the float design are folded into the next section and
+ * pass-through stages are dropped. products and sums can not overflow 32 bits
+ * (checked by biquad_q15_init()), outputs saturate to int16.
+ */
+typedef struct {
+  uint16_t num_stages;                        /* sections after folding */
+  int16_t hi[BIQUAD_Q15_MAX_STAGES][5];       /* b0, b1, b2, -a1, -a2 in Q13 */
+  int16_t lo[BIQUAD_Q15_MAX_STAGES][5];       /* remainder in Q27 */
+  int16_t ef[BIQUAD_Q15_MAX_STAGES][2];       /* error feedback of e[n-1], e[n-2] */
+} biquad_q15_t;
+
+/* one channel - section s reads its input history from z[s] and its output
+ * history from z[s + 1], which is the input history of the next section */
+typedef struct {
+  int16_t z[BIQUAD_Q15_MAX_STAGES + 1][2];    /* [n-1], [n-2] between the sections */
+  int16_t e[BIQUAD_Q15_MAX_STAGES][2];        /* rounding errors [n-1], [n-2] per section */
+} biquad_q15_state_t;
+
+typedef struct biquad_bank_q15 biquad_bank_q15_t;
+
+/* processes num_frames frames of the bank, see biquad_bank_q15_process() */
+typedef void (*biquad_bank_q15_kernel_t)(const biquad_bank_q15_t* bank, const int16_t* in, int16_t* out,
+                                         uint32_t num_frames);
+
+/*!
+ * @brief Bank of identical fixed-point cascades, one per channel
+ *
+ * the int16 counterpart of biquad_bank_t: states structure-of-arrays, frames
+ * of stride = BIQUAD_Q15_STRIDE(num_channels) samples, 16 channels per AVX2
+ * instruction. bit-exact with biquad_q15_filter_block() for every kernel.
+ */
+struct biquad_bank_q15 {
+  biquad_q15_t coeffs;                        /* cascade of every channel */
+  uint32_t num_channels;                      /* number of channels */
+  uint32_t stride;                            /* num_channels rounded up to BIQUAD_Q15_LANES */
+  int16_t* z1;                                /* [n-1] between the sections [num_stages + 1][stride] */
+  int16_t* z2;                                /* [n-2] between the sections [num_stages + 1][stride] */
+  int16_t* e1;                                /* rounding errors [n-1] [num_stages][stride] */
+  int16_t* e2;                                /* rounding errors [n-2] [num_stages][stride] */
+  biquad_isa_t isa;                           /* instruction set of the kernel */
+  biquad_bank_q15_kernel_t kernel;            /* kernel selected for isa */
+};
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Quantize a float cascade
+ *
+ * @param q          - filled with the fixed-point cascade
+ * @param b          - numerator coeffs [b0,b1,b2] for each stage
+ * @param a          - denominator coeffs [1,a1,a2] for each stage
+ * @param num_stages - number of cascaded stages (<= BIQUAD_Q15_MAX_STAGES)
+ * @return 0 on success, -1 if a coefficient is not below 4 or a section could
+ *         overflow the 32 bit accumulator
+ */
+int biquad_q15_init(biquad_q15_t* q, const float (*b)[3], const float (*a)[3], uint16_t num_stages);
+
+/*!
+ * @brief Clear the states of one channel
+ *
+ * @param state - pointer to the channel state
+ */
+void biquad_q15_reset(biquad_q15_state_t* state);
+
+/*!
+ * @brief Filter a block of one channel
+ *
+ * @param q           - fixed-point cascade
+ * @param state       - pointer to the channel state
+ * @param in          - input samples in ADC units
+ * @param out         - filtered samples (may be the same buffer as in)
+ * @param num_samples - number of samples
+ */
+void biquad_q15_filter_block(const biquad_q15_t* q, biquad_q15_state_t* state, const int16_t* in, int16_t* out,
+                             uint32_t num_samples);
+
+/*!
+ * @brief Bytes of state memory needed by a fixed-point bank
+ *
+ * @param q            - fixed-point cascade
+ * @param num_channels - number of channels
+ * @return size in bytes of the memory passed to biquad_bank_q15_init()
+ */
+size_t biquad_bank_q15_state_bytes(const biquad_q15_t* q, uint32_t num_channels);
+
+/*!
+ * @brief Init a fixed-point bank
+ *
+ * selects the fastest kernel supported by the running CPU and clears the states.
+ *
+ * @param bank         - pointer to the bank
+ * @param q            - fixed-point cascade, copied
+ * @param num_channels - number of channels
+ * @param state_mem    - BIQUAD_BANK_ALIGN aligned memory of biquad_bank_q15_state_bytes()
+ * @return 0 on success, -1 on invalid arguments
+ */
+int biquad_bank_q15_init(biquad_bank_q15_t* bank, const biquad_q15_t* q, uint32_t num_channels, void* state_mem);
+
+/*!
+ * @brief Clear the states of every channel
+ *
+ * @param bank - pointer to the bank
+ */
+void biquad_bank_q15_reset(biquad_bank_q15_t* bank);
+
+/*!
+ * @brief Select the kernel instruction set
+ *
+ * same fallback as biquad_bank_select_isa() - there is no NEON kernel yet,
+ * NEON runs the scalar one.
+ *
+ * @param bank - pointer to the bank
+ * @param isa  - requested instruction set
+ * @return instruction set actually selected
+ */
+biquad_isa_t biquad_bank_q15_select_isa(biquad_bank_q15_t* bank, biquad_isa_t isa);
+
+/*!
+ * @brief Filter frames of all channels
+ *
+ * in and out may be the same buffer. padding lanes are processed and ignored.
+ *
+ * @param bank       - pointer to the bank
+ * @param in         - input frames [num_frames][stride], BIQUAD_BANK_ALIGN aligned
+ * @param out        - output frames [num_frames][stride], BIQUAD_BANK_ALIGN aligned
+ * @param num_frames - number of frames
+ */
+static inline void biquad_bank_q15_process(const biquad_bank_q15_t* bank, const int16_t* in, int16_t* out,
+                                           uint32_t num_frames)
+{
+  bank->kernel(bank, in, out, num_frames);
+}
+
+/* kernels - selected through biquad_bank_q15_select_isa() */
+void biquad_bank_q15_process_scalar(const biquad_bank_q15_t* bank, const int16_t* in, int16_t* out,
+                                    uint32_t num_frames);
+void biquad_bank_q15_process_sse(const biquad_bank_q15_t* bank, const int16_t* in, int16_t* out,
+                                 uint32_t num_frames);
+void biquad_bank_q15_process_avx2(const biquad_bank_q15_t* bank, const int16_t* in, int16_t* out,
+                                  uint32_t num_frames);
+
+#endif /* BIQUAD_Q15_H */
@@ -0,0 +1,101 @@
+#include "biquad_q15.h"
+
+#if defined(BIQUAD_BANK_HAVE_AVX2)
+
+#include <immintrin.h>
+
+/* two int16 coeffs in every 32 bit lane - madd multiplies the pair (lo, hi) of
+ * an unpacklo/unpackhi(lo, hi) and adds the two products */
+static inline __m256i coeff_pair(int16_t lo, int16_t hi)
+{
+  return _mm256_set1_epi32((int32_t)(((uint32_t)(uint16_t)hi << 16) | (uint16_t)lo));
+}
+
+/* the 32 bit sums of section() for the 8 channels of one unpacklo or unpackhi */
+static inline __m256i accumulate(__m256i p0, __m256i p1, __m256i p2, __m256i p3, const __m256i* c)
+{
+  __m256i acc_lo = _mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(p0, c[4]), _mm256_madd_epi16(p1, c[5])),
+                                    _mm256_madd_epi16(p2, c[6]));
+  __m256i acc = _mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(p0, c[0]), _mm256_madd_epi16(p1, c[1])),
+                                 _mm256_add_epi32(_mm256_madd_epi16(p2, c[2]), _mm256_madd_epi16(p3, c[3])));
+  return _mm256_add_epi32(acc, _mm256_srai_epi32(acc_lo, BIQUAD_Q15_LO_SHIFT));
+}
+
+/* 16 channels per instruction: the int16 states are interleaved into
+ * (x, x1) (x2, y1) (y2, e1) (e2, 0) pairs, one madd per pair and coeff half.
+ * unpack and pack both work per 128 bit half, so the packed output is back in
+ * channel order. integer sums - bit-exact with the scalar kernel */
+void biquad_bank_q15_process_avx2(const biquad_bank_q15_t* bank, const int16_t* in, int16_t* out,
+                                  uint32_t num_frames)
+{
+  const biquad_q15_t* q = &bank->coeffs;
+  const uint32_t stride = bank->stride;
+  const uint16_t num_stages = q->num_stages;
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i round = _mm256_set1_epi32(1 << (BIQUAD_Q15_HI_SHIFT - 1));
+  __m256i c[BIQUAD_Q15_MAX_STAGES][7];
+  __m256i z1[BIQUAD_Q15_MAX_STAGES + 1], z2[BIQUAD_Q15_MAX_STAGES + 1];
+  __m256i e1[BIQUAD_Q15_MAX_STAGES], e2[BIQUAD_Q15_MAX_STAGES];
+  uint32_t ch = 0;
+  uint32_t frame = 0;
+  uint16_t s = 0;
+
+  for (s = 0; s < num_stages; s++) {
+    c[s][0] = coeff_pair(q->hi[s][0], q->hi[s][1]);
+    c[s][1] = coeff_pair(q->hi[s][2], q->hi[s][3]);
+    c[s][2] = coeff_pair(q->hi[s][4], q->ef[s][0]);
+    c[s][3] = coeff_pair(q->ef[s][1], 0);
+    c[s][4] = coeff_pair(q->lo[s][0], q->lo[s][1]);
+    c[s][5] = coeff_pair(q->lo[s][2], q->lo[s][3]);
+    c[s][6] = coeff_pair(q->lo[s][4], 0);
+  }
+
+  /* 16 channels at a time - their states stay in registers for the whole block */
+  for (ch = 0; ch < stride; ch += 16) {
+    for (s = 0; s <= num_stages; s++) {
+      z1[s] = _mm256_load_si256((const __m256i*)&bank->z1[(size_t)s * stride + ch]);
+      z2[s] = _mm256_load_si256((const __m256i*)&bank->z2[(size_t)s * stride + ch]);
+    }
+    for (s = 0; s < num_stages; s++) {
+      e1[s] = _mm256_load_si256((const __m256i*)&bank->e1[(size_t)s * stride + ch]);
+      e2[s] = _mm256_load_si256((const __m256i*)&bank->e2[(size_t)s * stride + ch]);
+    }
+
+    for (frame = 0; frame < num_frames; frame++) {
+      __m256i x = _mm256_load_si256((const __m256i*)&in[(size_t)frame * stride + ch]);
+
+      for (s = 0; s < num_stages; s++) {
+        __m256i acc_l = accumulate(_mm256_unpacklo_epi16(x, z1[s]), _mm256_unpacklo_epi16(z2[s], z1[s + 1]),
+                                   _mm256_unpacklo_epi16(z2[s + 1], e1[s]), _mm256_unpacklo_epi16(e2[s], zero),
+                                   c[s]);
+        __m256i acc_h = accumulate(_mm256_unpackhi_epi16(x, z1[s]), _mm256_unpackhi_epi16(z2[s], z1[s + 1]),
+                                   _mm256_unpackhi_epi16(z2[s + 1], e1[s]), _mm256_unpackhi_epi16(e2[s], zero),
+                                   c[s]);
+        __m256i y_l = _mm256_srai_epi32(_mm256_add_epi32(acc_l, round), BIQUAD_Q15_HI_SHIFT);
+        __m256i y_h = _mm256_srai_epi32(_mm256_add_epi32(acc_h, round), BIQUAD_Q15_HI_SHIFT);
+
+        /* rounding error of the output, fed back on the next samples */
+        e2[s] = e1[s];
+        e1[s] = _mm256_packs_epi32(_mm256_sub_epi32(acc_l, _mm256_slli_epi32(y_l, BIQUAD_Q15_HI_SHIFT)),
+                                   _mm256_sub_epi32(acc_h, _mm256_slli_epi32(y_h, BIQUAD_Q15_HI_SHIFT)));
+        z2[s] = z1[s];
+        z1[s] = x;
+        x = _mm256_packs_epi32(y_l, y_h);   /* saturating */
+      }
+      z2[num_stages] = z1[num_stages];
+      z1[num_stages] = x;
+      _mm256_store_si256((__m256i*)&out[(size_t)frame * stride + ch], x);
+    }
+
+    for (s = 0; s <= num_stages; s++) {
+      _mm256_store_si256((__m256i*)&bank->z1[(size_t)s * stride + ch], z1[s]);
+      _mm256_store_si256((__m256i*)&bank->z2[(size_t)s * stride + ch], z2[s]);
+    }
+    for (s = 0; s < num_stages; s++) {
+      _mm256_store_si256((__m256i*)&bank->e1[(size_t)s * stride + ch], e1[s]);
+      _mm256_store_si256((__m256i*)&bank->e2[(size_t)s * stride + ch], e2[s]);
+    }
+  }
+}
+
+#endif /* BIQUAD_BANK_HAVE_AVX2 */
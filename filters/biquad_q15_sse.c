@@ -0,0 +1,97 @@
+#include "biquad_q15.h"
+
+#if defined(BIQUAD_BANK_HAVE_SSE)
+
+#include <emmintrin.h>
+
+/* two int16 coeffs in every 32 bit lane - madd multiplies the pair (lo, hi) of
+ * an unpacklo/unpackhi(lo, hi) and adds the two products */
+static inline __m128i coeff_pair(int16_t lo, int16_t hi)
+{
+  return _mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)hi << 16) | (uint16_t)lo));
+}
+
+/* the 32 bit sums of section() for the 4 channels of one unpacklo or unpackhi */
+static inline __m128i accumulate(__m128i p0, __m128i p1, __m128i p2, __m128i p3, const __m128i* c)
+{
+  __m128i acc_lo = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(p0, c[4]), _mm_madd_epi16(p1, c[5])),
+                                 _mm_madd_epi16(p2, c[6]));
+  __m128i acc = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(p0, c[0]), _mm_madd_epi16(p1, c[1])),
+                              _mm_add_epi32(_mm_madd_epi16(p2, c[2]), _mm_madd_epi16(p3, c[3])));
+  return _mm_add_epi32(acc, _mm_srai_epi32(acc_lo, BIQUAD_Q15_LO_SHIFT));
+}
+
+/* 8 channels per instruction, same pairing as the AVX2 kernel. integer sums -
+ * bit-exact with the scalar kernel */
+void biquad_bank_q15_process_sse(const biquad_bank_q15_t* bank, const int16_t* in, int16_t* out,
+                                  uint32_t num_frames)
+{
+  const biquad_q15_t* q = &bank->coeffs;
+  const uint32_t stride = bank->stride;
+  const uint16_t num_stages = q->num_stages;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = _mm_set1_epi32(1 << (BIQUAD_Q15_HI_SHIFT - 1));
+  __m128i c[BIQUAD_Q15_MAX_STAGES][7];
+  __m128i z1[BIQUAD_Q15_MAX_STAGES + 1], z2[BIQUAD_Q15_MAX_STAGES + 1];
+  __m128i e1[BIQUAD_Q15_MAX_STAGES], e2[BIQUAD_Q15_MAX_STAGES];
+  uint32_t ch = 0;
+  uint32_t frame = 0;
+  uint16_t s = 0;
+
+  for (s = 0; s < num_stages; s++) {
+    c[s][0] = coeff_pair(q->hi[s][0], q->hi[s][1]);
+    c[s][1] = coeff_pair(q->hi[s][2], q->hi[s][3]);
+    c[s][2] = coeff_pair(q->hi[s][4], q->ef[s][0]);
+    c[s][3] = coeff_pair(q->ef[s][1], 0);
+    c[s][4] = coeff_pair(q->lo[s][0], q->lo[s][1]);
+    c[s][5] = coeff_pair(q->lo[s][2], q->lo[s][3]);
+    c[s][6] = coeff_pair(q->lo[s][4], 0);
+  }
+
+  /* 8 channels at a time - their states stay in registers for the whole block */
+  for (ch = 0; ch < stride; ch += 8) {
+    for (s = 0; s <= num_stages; s++) {
+      z1[s] = _mm_load_si128((const __m128i*)&bank->z1[(size_t)s * stride + ch]);
+      z2[s] = _mm_load_si128((const __m128i*)&bank->z2[(size_t)s * stride + ch]);
+    }
+    for (s = 0; s < num_stages; s++) {
+      e1[s] = _mm_load_si128((const __m128i*)&bank->e1[(size_t)s * stride + ch]);
+      e2[s] = _mm_load_si128((const __m128i*)&bank->e2[(size_t)s * stride + ch]);
+    }
+
+    for (frame = 0; frame < num_frames; frame++) {
+      __m128i x = _mm_load_si128((const __m128i*)&in[(size_t)frame * stride + ch]);
+
+      for (s = 0; s < num_stages; s++) {
+        __m128i acc_l = accumulate(_mm_unpacklo_epi16(x, z1[s]), _mm_unpacklo_epi16(z2[s], z1[s + 1]),
+                                _mm_unpacklo_epi16(z2[s + 1], e1[s]), _mm_unpacklo_epi16(e2[s], zero), c[s]);
+        __m128i acc_h = accumulate(_mm_unpackhi_epi16(x, z1[s]), _mm_unpackhi_epi16(z2[s], z1[s + 1]),
+                                _mm_unpackhi_epi16(z2[s + 1], e1[s]), _mm_unpackhi_epi16(e2[s], zero), c[s]);
+        __m128i y_l = _mm_srai_epi32(_mm_add_epi32(acc_l, round), BIQUAD_Q15_HI_SHIFT);
+        __m128i y_h = _mm_srai_epi32(_mm_add_epi32(acc_h, round), BIQUAD_Q15_HI_SHIFT);
+
+        /* rounding error of the output, fed back on the next samples */
+        e2[s] = e1[s];
+        e1[s] = _mm_packs_epi32(_mm_sub_epi32(acc_l, _mm_slli_epi32(y_l, BIQUAD_Q15_HI_SHIFT)),
+                                _mm_sub_epi32(acc_h, _mm_slli_epi32(y_h, BIQUAD_Q15_HI_SHIFT)));
+        z2[s] = z1[s];
+        z1[s] = x;
+        x = _mm_packs_epi32(y_l, y_h);   /* saturating */
+      }
+      z2[num_stages] = z1[num_stages];
+      z1[num_stages] = x;
+      _mm_store_si128((__m128i*)&out[(size_t)frame * stride + ch], x);
+    }
+
+    for (s = 0; s <= num_stages; s++) {
+      _mm_store_si128((__m128i*)&bank->z1[(size_t)s * stride + ch], z1[s]);
+      _mm_store_si128((__m128i*)&bank->z2[(size_t)s * stride + ch], z2[s]);
+    }
+    for (s = 0; s < num_stages; s++) {
+      _mm_store_si128((__m128i*)&bank->e1[(size_t)s * stride + ch], e1[s]);
+      _mm_store_si128((__m128i*)&bank->e2[(size_t)s * stride + ch], e2[s]);
+    }
+  }
+}
+
+#endif /* BIQUAD_BANK_HAVE_SSE */
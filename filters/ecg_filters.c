@@ -1,8 +1,18 @@
 #include "ecg_filters.h"
 
+#include <stddef.h>
+
 #include "config/config.h"
 #include "buffers/buffer.h"
 #include "Baseline_Wander_Coeffs.h"
+#include "filter_design.h"
+
+#define IIR_BLOCK_MAX_STAGES 8 /* stages kept in registers by the block filter */
+#define BASELINE_STOP_HZ 0.9f  /* stop-band edge of the baseline wander filter */
+#define BASELINE_STOP_DB 4.0f  /* stop-band attenuation of the baseline wander filter */
+
+/* the state struct in ecg_filters.h has to match the generated coefficients */
+typedef char baseline_state_stages_check[(BASELINE_STATE_STAGES == BASELINE_FILTER_STAGES) ? 1 : -1];
 
 float iir_biquad_filter(const float (*b)[3], const float (*a)[3], float (*d)[2],
                         uint16_t num_stages, uint16_t curr_index, float sample)
@@ -37,8 +47,246 @@ float iir_biquad_filter(const float (*b)[3], const float (*a)[3], float (*d)[2],
 	return output_y;
 }
 
+/* filters a block through up to IIR_BLOCK_MAX_STAGES stages, sample by sample.
+ * coefficients and states are copied to locals, so with a constant num_stages
+ * the compiler unrolls the stage loop and keeps everything in registers, and
+ * the stages of consecutive samples overlap in the pipeline */
+static inline void iir_biquad_cascade_block(const float (*b)[3], const float (*a)[3], float (*d)[2],
+                                            uint16_t num_stages, const float* in, float* out, uint32_t num_samples)
+{
+  float b0[IIR_BLOCK_MAX_STAGES], b1[IIR_BLOCK_MAX_STAGES], b2[IIR_BLOCK_MAX_STAGES];
+  float a1[IIR_BLOCK_MAX_STAGES], a2[IIR_BLOCK_MAX_STAGES];
+  float d1[IIR_BLOCK_MAX_STAGES], d2[IIR_BLOCK_MAX_STAGES];
+  uint16_t curr_stage = 0;
+  uint32_t i = 0;
+
+  for (curr_stage = 0; curr_stage < num_stages; curr_stage++) {
+    b0[curr_stage] = b[curr_stage][0];
+    b1[curr_stage] = b[curr_stage][1];
+    b2[curr_stage] = b[curr_stage][2];
+    a1[curr_stage] = a[curr_stage][1];
+    a2[curr_stage] = a[curr_stage][2];
+    d1[curr_stage] = d[curr_stage][0];
+    d2[curr_stage] = d[curr_stage][1];
+  }
+
+  for (i = 0; i < num_samples; i++) {
+    float output_y = in[i];
+
+    /* same operation order as iir_biquad_filter() */
+    for (curr_stage = 0; curr_stage < num_stages; curr_stage++) {
+      float intermediate = output_y - (a1[curr_stage] * d1[curr_stage]) - (a2[curr_stage] * d2[curr_stage]);
+      output_y = b0[curr_stage] * intermediate + (b1[curr_stage] * d1[curr_stage]) + (b2[curr_stage] * d2[curr_stage]);
+      d2[curr_stage] = d1[curr_stage];
+      d1[curr_stage] = intermediate;
+    }
+    out[i] = output_y;
+  }
+
+  for (curr_stage = 0; curr_stage < num_stages; curr_stage++) {
+    d[curr_stage][0] = d1[curr_stage];
+    d[curr_stage][1] = d2[curr_stage];
+  }
+}
+
+/* iir_biquad_cascade_block() on double delay states - float coefficients and samples */
+static inline void iir_biquad_cascade_block_f64(const float (*b)[3], const float (*a)[3], double (*d)[2],
+                                                uint16_t num_stages, const float* in, float* out, uint32_t num_samples)
+{
+  double b0[IIR_BLOCK_MAX_STAGES], b1[IIR_BLOCK_MAX_STAGES], b2[IIR_BLOCK_MAX_STAGES];
+  double a1[IIR_BLOCK_MAX_STAGES], a2[IIR_BLOCK_MAX_STAGES];
+  double d1[IIR_BLOCK_MAX_STAGES], d2[IIR_BLOCK_MAX_STAGES];
+  uint16_t curr_stage = 0;
+  uint32_t i = 0;
+
+  for (curr_stage = 0; curr_stage < num_stages; curr_stage++) {
+    b0[curr_stage] = b[curr_stage][0];
+    b1[curr_stage] = b[curr_stage][1];
+    b2[curr_stage] = b[curr_stage][2];
+    a1[curr_stage] = a[curr_stage][1];
+    a2[curr_stage] = a[curr_stage][2];
+    d1[curr_stage] = d[curr_stage][0];
+    d2[curr_stage] = d[curr_stage][1];
+  }
+
+  for (i = 0; i < num_samples; i++) {
+    double output_y = in[i];
+
+    for (curr_stage = 0; curr_stage < num_stages; curr_stage++) {
+      double intermediate = output_y - (a1[curr_stage] * d1[curr_stage]) - (a2[curr_stage] * d2[curr_stage]);
+      output_y = b0[curr_stage] * intermediate + (b1[curr_stage] * d1[curr_stage]) + (b2[curr_stage] * d2[curr_stage]);
+      d2[curr_stage] = d1[curr_stage];
+      d1[curr_stage] = intermediate;
+    }
+    out[i] = (float)output_y;
+  }
+
+  for (curr_stage = 0; curr_stage < num_stages; curr_stage++) {
+    d[curr_stage][0] = d1[curr_stage];
+    d[curr_stage][1] = d2[curr_stage];
+  }
+}
+
+void iir_biquad_filter_block(const float (*b)[3], const float (*a)[3], float (*d)[2],
+                             uint16_t num_stages, const float* in, float* out, uint32_t num_samples)
+{
+  uint16_t first = 0;
+  uint32_t i = 0;
+
+  /* longer cascades are run in groups of stages, the first group reads in
+   * and the following ones filter out in place */
+  for (; first < num_stages; first += IIR_BLOCK_MAX_STAGES) {
+    uint16_t group = MIN(num_stages - first, IIR_BLOCK_MAX_STAGES);
+    iir_biquad_cascade_block(&b[first], &a[first], &d[first], group, (first == 0) ? in : out, out, num_samples);
+  }
+
+  /* no stages - pass through */
+  if (num_stages == 0 && in != out) {
+    for (i = 0; i < num_samples; i++) {
+      out[i] = in[i];
+    }
+  }
+}
+
+void iir_biquad_filter_block_f64(const float (*b)[3], const float (*a)[3], double (*d)[2],
+                                 uint16_t num_stages, const float* in, float* out, uint32_t num_samples)
+{
+  uint16_t first = 0;
+  uint32_t i = 0;
+
+  /* grouped like iir_biquad_filter_block() */
+  for (; first < num_stages; first += IIR_BLOCK_MAX_STAGES) {
+    uint16_t group = MIN(num_stages - first, IIR_BLOCK_MAX_STAGES);
+    iir_biquad_cascade_block_f64(&b[first], &a[first], &d[first], group, (first == 0) ? in : out, out, num_samples);
+  }
+
+  /* no stages - pass through */
+  if (num_stages == 0 && in != out) {
+    for (i = 0; i < num_samples; i++) {
+      out[i] = in[i];
+    }
+  }
+}
+
 float baseline_wander_filter(uint16_t curr_index, float sample)
 {
-  static float d_baseline[BASELINE_FILTER_STAGES][2] = {{0.0f}};
-	return iir_biquad_filter(baseline_num, baseline_den, d_baseline, BASELINE_FILTER_STAGES, curr_index, sample);
+  static baseline_wander_state_t d_baseline = {{{0.0f}}, {{0.0}}};
+	return baseline_wander_filter_r(&d_baseline, curr_index, sample);
+}
+
+void baseline_wander_init(baseline_wander_state_t* state)
+{
+  uint16_t curr_stage = 0;
+  for (; curr_stage < BASELINE_FILTER_STAGES; curr_stage++) {
+    state->d[curr_stage][0] = 0.0f;
+    state->d[curr_stage][1] = 0.0f;
+    state->d64[curr_stage][0] = 0.0;
+    state->d64[curr_stage][1] = 0.0;
+  }
+}
+
+float baseline_wander_filter_r(baseline_wander_state_t* state, uint16_t curr_index, float sample)
+{
+	return iir_biquad_filter(baseline_num, baseline_den, state->d, BASELINE_FILTER_STAGES, curr_index, sample);
+}
+
+void baseline_wander_filter_block(baseline_wander_state_t* state, const float* in, float* out, uint32_t num_samples)
+{
+  /* constant number of stages - fully unrolled */
+	iir_biquad_cascade_block(baseline_num, baseline_den, state->d, BASELINE_FILTER_STAGES, in, out, num_samples);
+}
+
+/* kernels of the common rates - the coefficients are compile time constants,
+ * so the gain and pass-through stages fold away and the biquad is fully unrolled.
+ * 80 Hz keeps the float states of baseline_wander_filter(), the higher rates run on double states */
+static void baseline_wander_block_80(const baseline_wander_rate_t* rate, baseline_wander_state_t* state,
+                                     const float* in, float* out, uint32_t num_samples)
+{
+  (void)rate;
+  iir_biquad_cascade_block(baseline_num, baseline_den, state->d, BASELINE_FILTER_STAGES, in, out, num_samples);
+}
+
+#define BASELINE_WANDER_KERNEL(fs)                                                                            \
+  static void baseline_wander_block_##fs(const baseline_wander_rate_t* rate, baseline_wander_state_t* state,  \
+                                         const float* in, float* out, uint32_t num_samples)                   \
+  {                                                                                                           \
+    (void)rate;                                                                                               \
+    iir_biquad_cascade_block_f64(baseline_num_##fs, baseline_den_##fs, state->d64, BASELINE_FILTER_STAGES,    \
+                                 in, out, num_samples);                                                       \
+  }
+
+BASELINE_WANDER_KERNEL(250)
+BASELINE_WANDER_KERNEL(360)
+BASELINE_WANDER_KERNEL(500)
+BASELINE_WANDER_KERNEL(1000)
+
+/* any other rate - coefficients from the rate */
+static void baseline_wander_block_generic(const baseline_wander_rate_t* rate, baseline_wander_state_t* state,
+                                          const float* in, float* out, uint32_t num_samples)
+{
+  iir_biquad_cascade_block_f64(rate->num, rate->den, state->d64, BASELINE_FILTER_STAGES, in, out, num_samples);
+}
+
+/* baseline_wander_filter() at any rate - one designed section in the stage layout of Baseline_Wander_Coeffs.h */
+static void baseline_wander_design(uint16_t sample_freq, float (*num)[3], float (*den)[3])
+{
+  filter_spec_t spec = { FILTER_CHEBYSHEV2, FILTER_HIGHPASS, 2, 0.0f, BASELINE_STOP_HZ, 0.0f, 0.0f, BASELINE_STOP_DB };
+  filter_sos_t sos;
+  uint8_t designed = 0;
+  uint16_t curr_stage = 0;
+
+  spec.sample_freq = sample_freq;
+  designed = filter_design(&spec, &sos);
+
+  /* gain stage, normalized biquad (b0 == 1), pass-through stage - all pass-through if the rate is too low */
+  for (; curr_stage < BASELINE_FILTER_STAGES; curr_stage++) {
+    num[curr_stage][0] = 1.0f;
+    num[curr_stage][1] = 0.0f;
+    num[curr_stage][2] = 0.0f;
+    den[curr_stage][0] = 1.0f;
+    den[curr_stage][1] = 0.0f;
+    den[curr_stage][2] = 0.0f;
+  }
+  if (designed) {
+    num[0][0] = sos.b[0][0];
+    num[1][1] = sos.b[0][1] / sos.b[0][0];
+    num[1][2] = sos.b[0][2] / sos.b[0][0];
+    den[1][1] = sos.a[0][1];
+    den[1][2] = sos.a[0][2];
+  }
+}
+
+void baseline_wander_rate_init(baseline_wander_rate_t* rate, uint16_t sample_freq)
+{
+  uint16_t curr_stage = 0;
+  const float (*num)[3] = NULL;
+  const float (*den)[3] = NULL;
+
+  rate->sample_freq = sample_freq;
+  switch (sample_freq) {
+    case 80:   num = baseline_num;      den = baseline_den;      rate->block = baseline_wander_block_80;   break;
+    case 250:  num = baseline_num_250;  den = baseline_den_250;  rate->block = baseline_wander_block_250;  break;
+    case 360:  num = baseline_num_360;  den = baseline_den_360;  rate->block = baseline_wander_block_360;  break;
+    case 500:  num = baseline_num_500;  den = baseline_den_500;  rate->block = baseline_wander_block_500;  break;
+    case 1000: num = baseline_num_1000; den = baseline_den_1000; rate->block = baseline_wander_block_1000; break;
+    default:
+      baseline_wander_design(sample_freq, rate->num, rate->den);
+      rate->block = baseline_wander_block_generic;
+      return;
+  }
+
+  /* keep the table in the rate too, for callers that run their own cascade */
+  for (; curr_stage < BASELINE_FILTER_STAGES; curr_stage++) {
+    uint16_t k = 0;
+    for (; k < 3; k++) {
+      rate->num[curr_stage][k] = num[curr_stage][k];
+      rate->den[curr_stage][k] = den[curr_stage][k];
+    }
+  }
+}
+
+void baseline_wander_filter_block_rate(const baseline_wander_rate_t* rate, baseline_wander_state_t* state,
+                                       const float* in, float* out, uint32_t num_samples)
+{
+  rate->block(rate, state, in, out, num_samples);
 }
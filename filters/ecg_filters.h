@@ -3,6 +3,33 @@
 
 #include <stdint.h>
 
+/* number of cascaded stages in Baseline_Wander_Coeffs.h */
+#define BASELINE_STATE_STAGES 3
+
+/* baseline wander filter state - one [d1,d2] delay pair per stage. the kernels
+ * above 80 Hz keep theirs in double, their poles sit too close to 1 for float */
+typedef struct {
+  float d[BASELINE_STATE_STAGES][2];
+  double d64[BASELINE_STATE_STAGES][2];
+} baseline_wander_state_t;
+
+typedef struct baseline_wander_rate baseline_wander_rate_t;
+
+/* block kernel of one sampling rate */
+typedef void (*baseline_wander_block_fn)(const baseline_wander_rate_t* rate, baseline_wander_state_t* state,
+                                         const float* in, float* out, uint32_t num_samples);
+
+/* baseline wander filter for one sampling rate - the common rates (80, 250, 360,
+ * 500 and 1000 Hz) get a kernel compiled with their constant coefficients, any
+ * other rate runs the generic cascade on coefficients designed at init. every
+ * kernel but the 80 Hz one runs the cascade on double delay states */
+struct baseline_wander_rate {
+  uint16_t sample_freq;                       /* sampling frequency in Hz */
+  float num[BASELINE_STATE_STAGES][3];        /* numerator coeffs [b0,b1,b2] per stage */
+  float den[BASELINE_STATE_STAGES][3];        /* denominator coeffs [a0,a1,a2] per stage */
+  baseline_wander_block_fn block;             /* specialized or generic kernel */
+};
+
 /*!
  * @brief IIR Biquad filter - Direct Form II
  * @param sample - most recent sample
@@ -28,6 +55,45 @@
 float iir_biquad_filter(const float (*a)[3], const float (*b)[3], float (*d)[2],
                         uint16_t num_stages, uint16_t curr_index, float sample);
 
+/*!
+ * @brief IIR Biquad filter - Direct Form II, block version
+ *
+ * filters a whole block sample by sample through groups of up to eight
+ * stages. the coefficients and delay states of a group are copied to locals,
+ * so they stay in registers for the whole block instead of being reloaded for
+ * every sample, and the stages of consecutive samples overlap in the pipeline.
+ * the output is bit-exact with calling iir_biquad_filter() for every sample.
+ * unlike iir_biquad_filter() the states are never reset here.
+ *
+ * @param b           - pointer to array of numerator coeffs [b0,b1,b2] for each stage
+ * @param a           - pointer to array of denominator coeffs [a0,a1,a2] for each stage
+ * @param d           - pointer to array of delay states [d1,d2] for each stage
+ * @param num_stages  - number of cascaded biquad filter stages
+ * @param in          - input samples
+ * @param out         - output samples (may be the same buffer as in)
+ * @param num_samples - number of samples
+ */
+void iir_biquad_filter_block(const float (*b)[3], const float (*a)[3], float (*d)[2],
+                             uint16_t num_stages, const float* in, float* out, uint32_t num_samples);
+
+/*!
+ * @brief IIR Biquad filter - Direct Form II, block version on double delay states
+ *
+ * iir_biquad_filter_block() with the delay states and the arithmetic in double,
+ * for sections with poles too close to 1 for float states (the baseline wander
+ * high-pass above all).
+ *
+ * @param b           - pointer to array of numerator coeffs [b0,b1,b2] for each stage
+ * @param a           - pointer to array of denominator coeffs [a0,a1,a2] for each stage
+ * @param d           - pointer to array of double delay states [d1,d2] for each stage
+ * @param num_stages  - number of cascaded biquad filter stages
+ * @param in          - input samples
+ * @param out         - output samples (may be the same buffer as in)
+ * @param num_samples - number of samples
+ */
+void iir_biquad_filter_block_f64(const float (*b)[3], const float (*a)[3], double (*d)[2],
+                                 uint16_t num_stages, const float* in, float* out, uint32_t num_samples);
+
 /*!
  * @brief Baseline wander removal high-pass filter
  *
@@ -50,4 +116,68 @@ float iir_biquad_filter(const float (*a)[3], const float (*b)[3], float (*d)[2],
  */
 float baseline_wander_filter(uint16_t curr_index, float sample);
 
+/*!
+ * @brief Init baseline wander filter state
+ *
+ * @param state - pointer to the filter state to clear
+ */
+void baseline_wander_init(baseline_wander_state_t* state);
+
+/*!
+ * @brief Baseline wander removal high-pass filter - reentrant version
+ *
+ * same filter as baseline_wander_filter() but the delay states are kept in
+ * the caller owned state, so every channel can be filtered independently.
+ *
+ * @param state       - pointer to the channel filter state
+ * @param curr_index  - current buffer index
+ * @param sample      - the current input sample to filter
+ * @return filtered output sample
+ */
+float baseline_wander_filter_r(baseline_wander_state_t* state, uint16_t curr_index, float sample);
+
+/*!
+ * @brief Baseline wander removal high-pass filter - block version
+ *
+ * filters a frame of samples with iir_biquad_filter_block().
+ * the caller resets the state with baseline_wander_init() where the per-sample
+ * version would reset it (curr_index == 0).
+ *
+ * @param state       - pointer to the channel filter state
+ * @param in          - input samples
+ * @param out         - filtered samples (may be the same buffer as in)
+ * @param num_samples - number of samples
+ */
+void baseline_wander_filter_block(baseline_wander_state_t* state, const float* in, float* out, uint32_t num_samples);
+
+/*!
+ * @brief Select the baseline wander filter of a sampling rate
+ *
+ * same filter at every rate: 2nd order Chebyshev Type II high-pass with the
+ * stop-band edge at 0.9 Hz and 4 dB attenuation. rates without a compiled
+ * kernel are designed here with filter_design(), which matches the
+ * generated tables to float precision.
+ *
+ * @param rate        - filled with the coefficients and the kernel
+ * @param sample_freq - sampling frequency in Hz (> 1.8 Hz)
+ */
+void baseline_wander_rate_init(baseline_wander_rate_t* rate, uint16_t sample_freq);
+
+/*!
+ * @brief Baseline wander removal high-pass filter - block version for any rate
+ *
+ * at 80 Hz the output is bit-exact with baseline_wander_filter_block(). the
+ * other rates keep the delay states in double (d64): the 0.9 Hz poles move
+ * towards 1 with the rate, at 1000 Hz float states are off by up to 116 LSB
+ * of a 16 bit ADC while the double states stay within the input rounding.
+ *
+ * @param rate        - filter selected with baseline_wander_rate_init()
+ * @param state       - pointer to the channel filter state
+ * @param in          - input samples
+ * @param out         - filtered samples (may be the same buffer as in)
+ * @param num_samples - number of samples
+ */
+void baseline_wander_filter_block_rate(const baseline_wander_rate_t* rate, baseline_wander_state_t* state,
+                                       const float* in, float* out, uint32_t num_samples);
+
 #endif /* ECG_FILTERS_H */
@@ -0,0 +1,666 @@
+#include "filter_design.h"
+
+#include <math.h>
+#include <stddef.h>
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define MAX_ROOTS       (2 * FILTER_DESIGN_MAX_ORDER)  /* poles of a band-pass or notch design */
+#define LANDEN_MAX      16                             /* Landen steps, converges quadratically */
+#define RESPONSE_POINTS 256                            /* grid of the L-infinity scaling, 0 to fs/2 */
+#define REAL_TOLERANCE  1e-10                          /* relative imaginary part of a real root */
+#define PI              3.14159265358979323846
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+typedef struct {
+  double re;
+  double im;
+} cplx_t;
+
+/* filter as zeros, poles and gain - analog (s) or digital (z) */
+typedef struct {
+  cplx_t z[MAX_ROOTS];
+  cplx_t p[MAX_ROOTS];
+  uint16_t num_zeros;
+  uint16_t num_poles;
+  double k;
+} zpk_t;
+
+/* one second (or first) order factor of the poles or zeros */
+typedef struct {
+  double c1;        /* x^2 + c1 x + c2 */
+  double c2;
+  cplx_t root;      /* root with im >= 0, the one closest to the unit circle for two real roots */
+  uint8_t order;    /* 1 or 2 */
+} factor_t;
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* complex arithmetic - kept local so the TI compiler does not need complex.h */
+static cplx_t c_make(double re, double im)
+{
+  cplx_t c;
+  c.re = re;
+  c.im = im;
+  return c;
+}
+
+static cplx_t c_add(cplx_t a, cplx_t b) { return c_make(a.re + b.re, a.im + b.im); }
+static cplx_t c_sub(cplx_t a, cplx_t b) { return c_make(a.re - b.re, a.im - b.im); }
+static cplx_t c_scale(cplx_t a, double s) { return c_make(a.re * s, a.im * s); }
+static cplx_t c_mul(cplx_t a, cplx_t b) { return c_make(a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re); }
+static double c_abs(cplx_t a) { return hypot(a.re, a.im); }
+
+static cplx_t c_div(cplx_t a, cplx_t b)
+{
+  double den = b.re * b.re + b.im * b.im;
+  return c_make((a.re * b.re + a.im * b.im) / den, (a.im * b.re - a.re * b.im) / den);
+}
+
+/* principal square root */
+static cplx_t c_sqrt(cplx_t a)
+{
+  double r = c_abs(a);
+  double re = sqrt(0.5 * (r + a.re));
+  double im = sqrt(0.5 * (r - a.re));
+  return c_make(re, (a.im < 0.0) ? -im : im);
+}
+
+static cplx_t c_cos(cplx_t a) { return c_make(cos(a.re) * cosh(a.im), -sin(a.re) * sinh(a.im)); }
+static cplx_t c_sin(cplx_t a) { return c_make(sin(a.re) * cosh(a.im), cos(a.re) * sinh(a.im)); }
+
+/* acos(a) = -j ln(a + j sqrt(1 - a^2)) */
+static cplx_t c_acos(cplx_t a)
+{
+  cplx_t root = c_sqrt(c_sub(c_make(1.0, 0.0), c_mul(a, a)));
+  cplx_t w = c_add(a, c_make(-root.im, root.re));
+  return c_make(atan2(w.im, w.re), -log(c_abs(w)));
+}
+
+/* descending Landen sequence of the modulus k */
+static uint16_t landen(double k, double* v)
+{
+  uint16_t n = 0;
+
+  while (n < LANDEN_MAX) {
+    k = k / (1.0 + sqrt(1.0 - k * k));
+    k *= k;
+    v[n++] = k;
+    if (k < 1e-16) {
+      break;
+    }
+  }
+  return n;
+}
+
+/* Jacobi cd(u K, k) and sn(u K, k) by ascending Landen transformations of cos/sin */
+static cplx_t jacobi_landen(cplx_t w, double k)
+{
+  double v[LANDEN_MAX];
+  uint16_t n = landen(k, v);
+
+  while (n-- > 0) {
+    w = c_div(c_scale(w, 1.0 + v[n]), c_add(c_make(1.0, 0.0), c_scale(c_mul(w, w), v[n])));
+  }
+  return w;
+}
+
+static cplx_t cde(cplx_t u, double k) { return jacobi_landen(c_cos(c_scale(u, PI / 2.0)), k); }
+static cplx_t sne(cplx_t u, double k) { return jacobi_landen(c_sin(c_scale(u, PI / 2.0)), k); }
+
+/* inverse of sne() - u with sn(u K, k) = w */
+static cplx_t asne(cplx_t w, double k)
+{
+  double v[LANDEN_MAX];
+  uint16_t count = landen(k, v);
+  uint16_t n = 0;
+
+  for (; n < count; n++) {
+    double v1 = (n == 0) ? k : v[n - 1];
+    cplx_t root = c_sqrt(c_sub(c_make(1.0, 0.0), c_scale(c_mul(w, w), v1 * v1)));
+    w = c_scale(c_div(w, c_add(c_make(1.0, 0.0), root)), 2.0 / (1.0 + v[n]));
+  }
+  cplx_t u = c_scale(c_acos(w), 2.0 / PI);   /* inverse of cde() */
+  return c_sub(c_make(1.0, 0.0), u);
+}
+
+/* selectivity k of an elliptic filter of the order with the discrimination k1 */
+static double ellipdeg(uint16_t order, double k1)
+{
+  double kc1 = sqrt(1.0 - k1 * k1);
+  double prod = 1.0;
+  uint16_t i = 1;
+
+  for (; i <= order / 2; i++) {
+    prod *= sne(c_make((2.0 * i - 1.0) / order, 0.0), kc1).re;
+  }
+  double kc = pow(kc1, order) * pow(prod, 4.0);
+  return sqrt(1.0 - kc * kc);
+}
+
+static void add_root(cplx_t* roots, uint16_t* count, cplx_t root) { roots[(*count)++] = root; }
+
+static void add_conjugates(cplx_t* roots, uint16_t* count, cplx_t root)
+{
+  add_root(roots, count, root);
+  add_root(roots, count, c_make(root.re, -root.im));
+}
+
+/* normalized analog low-pass prototype (corner at 1 rad/s) */
+static void analog_prototype(const filter_spec_t* spec, zpk_t* zpk)
+{
+  uint16_t n = spec->order;
+  int32_t m = 0;
+
+  zpk->num_zeros = 0;
+  zpk->num_poles = 0;
+  zpk->k = 1.0;
+
+  switch (spec->type) {
+    case FILTER_BUTTERWORTH:
+      for (m = 1 - (int32_t)n; m < (int32_t)n; m += 2) {
+        double theta = PI * m / (2.0 * n);
+        add_root(zpk->p, &zpk->num_poles, c_make(-cos(theta), -sin(theta)));
+      }
+      break;
+
+    case FILTER_CHEBYSHEV1: {
+      double eps = sqrt(pow(10.0, 0.1 * spec->ripple_db) - 1.0);
+      double mu = asinh(1.0 / eps) / n;
+      cplx_t prod = c_make(1.0, 0.0);
+      for (m = 1 - (int32_t)n; m < (int32_t)n; m += 2) {
+        double theta = PI * m / (2.0 * n);
+        cplx_t p = c_make(-sinh(mu) * cos(theta), -cosh(mu) * sin(theta));
+        add_root(zpk->p, &zpk->num_poles, p);
+        prod = c_mul(prod, c_scale(p, -1.0));
+      }
+      zpk->k = prod.re;
+      if (n % 2 == 0) {
+        zpk->k /= sqrt(1.0 + eps * eps);
+      }
+      break;
+    }
+
+    case FILTER_CHEBYSHEV2: {
+      double de = 1.0 / sqrt(pow(10.0, 0.1 * spec->atten_db) - 1.0);
+      double mu = asinh(1.0 / de) / n;
+      cplx_t prod = c_make(1.0, 0.0);
+      for (m = 1 - (int32_t)n; m < (int32_t)n; m += 2) {
+        double theta = PI * m / (2.0 * n);
+        cplx_t p = c_div(c_make(1.0, 0.0), c_make(-sinh(mu) * cos(theta), -cosh(mu) * sin(theta)));
+        add_root(zpk->p, &zpk->num_poles, p);
+        prod = c_mul(prod, c_scale(p, -1.0));
+        if (m != 0) {
+          /* zeros on the imaginary axis, none at infinity's place for odd orders */
+          cplx_t z = c_make(0.0, 1.0 / sin(theta));
+          add_root(zpk->z, &zpk->num_zeros, z);
+          prod = c_div(prod, c_scale(z, -1.0));
+        }
+      }
+      zpk->k = prod.re;
+      break;
+    }
+
+    case FILTER_ELLIPTIC: {
+      /* Orfanidis, "Lecture notes on elliptic filter design" - pass-band edge at 1 rad/s */
+      double ep = sqrt(pow(10.0, 0.1 * spec->ripple_db) - 1.0);
+      double es = sqrt(pow(10.0, 0.1 * spec->atten_db) - 1.0);
+      double k1 = ep / es;
+      double k = ellipdeg(n, k1);
+      double v0 = asne(c_make(0.0, 1.0 / ep), k1).im / n;   /* -j asne(j / ep, k1) / n is real */
+      cplx_t prod = c_make(1.0, 0.0);
+      uint16_t i = 1;
+
+      for (; i <= n / 2; i++) {
+        double u = (2.0 * i - 1.0) / n;
+        double zeta = cde(c_make(u, 0.0), k).re;
+        cplx_t cd = cde(c_make(u, -v0), k);
+        cplx_t z = c_make(0.0, 1.0 / (k * zeta));
+        cplx_t p = c_make(-cd.im, cd.re);   /* j cd */
+        add_conjugates(zpk->z, &zpk->num_zeros, z);
+        add_conjugates(zpk->p, &zpk->num_poles, p);
+        prod = c_mul(prod, c_make(p.re * p.re + p.im * p.im, 0.0));
+        prod = c_scale(prod, 1.0 / (z.im * z.im));
+      }
+      if (n % 2) {
+        cplx_t sn = sne(c_make(0.0, v0), k);
+        cplx_t p = c_make(-sn.im, sn.re);   /* j sn, real */
+        add_root(zpk->p, &zpk->num_poles, c_make(p.re, 0.0));
+        prod = c_scale(prod, -p.re);
+      }
+      zpk->k = prod.re * ((n % 2) ? 1.0 : 1.0 / sqrt(1.0 + ep * ep));
+      break;
+    }
+  }
+}
+
+/* product of (x - roots) at x */
+static cplx_t roots_product(const cplx_t* roots, uint16_t count, cplx_t x)
+{
+  cplx_t prod = c_make(1.0, 0.0);
+  uint16_t i = 0;
+
+  for (; i < count; i++) {
+    prod = c_mul(prod, c_sub(x, roots[i]));
+  }
+  return prod;
+}
+
+/* low-pass prototype to the band of the spec, corners in prewarped rad/s */
+static void transform_band(filter_band_t band, double w1, double w2, zpk_t* zpk)
+{
+  uint16_t degree = zpk->num_poles - zpk->num_zeros;
+  double wo = (band == FILTER_BANDPASS || band == FILTER_NOTCH) ? sqrt(w1 * w2) : w1;
+  double bw = w2 - w1;
+  cplx_t z[MAX_ROOTS];
+  cplx_t p[MAX_ROOTS];
+  uint16_t i = 0;
+
+  switch (band) {
+    case FILTER_LOWPASS:
+      for (i = 0; i < zpk->num_zeros; i++) {
+        zpk->z[i] = c_scale(zpk->z[i], wo);
+      }
+      for (i = 0; i < zpk->num_poles; i++) {
+        zpk->p[i] = c_scale(zpk->p[i], wo);
+      }
+      zpk->k *= pow(wo, degree);
+      return;
+
+    case FILTER_HIGHPASS:
+      /* gain first, from the prototype roots: k real(prod(-z) / prod(-p)) */
+      zpk->k *= c_div(roots_product(zpk->z, zpk->num_zeros, c_make(0.0, 0.0)),
+                      roots_product(zpk->p, zpk->num_poles, c_make(0.0, 0.0))).re;
+      for (i = 0; i < zpk->num_zeros; i++) {
+        zpk->z[i] = c_div(c_make(wo, 0.0), zpk->z[i]);
+      }
+      for (i = 0; i < zpk->num_poles; i++) {
+        zpk->p[i] = c_div(c_make(wo, 0.0), zpk->p[i]);
+      }
+      for (i = 0; i < degree; i++) {
+        add_root(zpk->z, &zpk->num_zeros, c_make(0.0, 0.0));
+      }
+      return;
+
+    case FILTER_BANDPASS:
+    case FILTER_NOTCH:
+      break;
+  }
+
+  /* every root splits in two: r +- sqrt(r^2 - wo^2) */
+  if (band == FILTER_BANDPASS) {
+    for (i = 0; i < zpk->num_zeros; i++) {
+      z[i] = c_scale(zpk->z[i], bw / 2.0);
+    }
+    for (i = 0; i < zpk->num_poles; i++) {
+      p[i] = c_scale(zpk->p[i], bw / 2.0);
+    }
+    zpk->k *= pow(bw, degree);
+  } else {
+    zpk->k *= c_div(roots_product(zpk->z, zpk->num_zeros, c_make(0.0, 0.0)),
+                    roots_product(zpk->p, zpk->num_poles, c_make(0.0, 0.0))).re;
+    for (i = 0; i < zpk->num_zeros; i++) {
+      z[i] = c_div(c_make(bw / 2.0, 0.0), zpk->z[i]);
+    }
+    for (i = 0; i < zpk->num_poles; i++) {
+      p[i] = c_div(c_make(bw / 2.0, 0.0), zpk->p[i]);
+    }
+  }
+  for (i = 0; i < zpk->num_zeros; i++) {
+    cplx_t root = c_sqrt(c_sub(c_mul(z[i], z[i]), c_make(wo * wo, 0.0)));
+    zpk->z[2 * i] = c_add(z[i], root);
+    zpk->z[2 * i + 1] = c_sub(z[i], root);
+  }
+  for (i = 0; i < zpk->num_poles; i++) {
+    cplx_t root = c_sqrt(c_sub(c_mul(p[i], p[i]), c_make(wo * wo, 0.0)));
+    zpk->p[2 * i] = c_add(p[i], root);
+    zpk->p[2 * i + 1] = c_sub(p[i], root);
+  }
+  zpk->num_zeros *= 2;
+  zpk->num_poles *= 2;
+
+  /* the zeros at infinity move to 0 (band-pass) or to +-j wo (notch) */
+  for (i = 0; i < degree; i++) {
+    if (band == FILTER_BANDPASS) {
+      add_root(zpk->z, &zpk->num_zeros, c_make(0.0, 0.0));
+    } else {
+      add_conjugates(zpk->z, &zpk->num_zeros, c_make(0.0, wo));
+    }
+  }
+}
+
+/* s to z, the zeros at infinity land on z = -1 */
+static void bilinear(double sample_freq, zpk_t* zpk)
+{
+  cplx_t fs2 = c_make(2.0 * sample_freq, 0.0);
+  uint16_t degree = zpk->num_poles - zpk->num_zeros;
+  uint16_t i = 0;
+
+  zpk->k *= c_div(roots_product(zpk->z, zpk->num_zeros, fs2), roots_product(zpk->p, zpk->num_poles, fs2)).re;
+  for (i = 0; i < zpk->num_zeros; i++) {
+    zpk->z[i] = c_div(c_add(fs2, zpk->z[i]), c_sub(fs2, zpk->z[i]));
+  }
+  for (i = 0; i < zpk->num_poles; i++) {
+    zpk->p[i] = c_div(c_add(fs2, zpk->p[i]), c_sub(fs2, zpk->p[i]));
+  }
+  for (i = 0; i < degree; i++) {
+    add_root(zpk->z, &zpk->num_zeros, c_make(-1.0, 0.0));
+  }
+}
+
+static uint8_t is_real(cplx_t root) { return fabs(root.im) <= REAL_TOLERANCE * (1.0 + c_abs(root)); }
+
+static double circle_distance(cplx_t root) { return fabs(1.0 - c_abs(root)); }
+
+/* splits roots into conjugate pairs (upper root kept) and real roots, reals sorted closest to the circle first */
+static uint8_t split_roots(const cplx_t* roots, uint16_t count, cplx_t* pairs, uint16_t* num_pairs, double* reals,
+                           uint16_t* num_reals)
+{
+  uint16_t i = 0;
+
+  *num_pairs = 0;
+  *num_reals = 0;
+  for (i = 0; i < count; i++) {
+    if (is_real(roots[i])) {
+      /* insertion sort by distance to the unit circle */
+      uint16_t j = (*num_reals)++;
+      while (j > 0 && circle_distance(c_make(reals[j - 1], 0.0)) > circle_distance(c_make(roots[i].re, 0.0))) {
+        reals[j] = reals[j - 1];
+        j--;
+      }
+      reals[j] = roots[i].re;
+    } else if (roots[i].im > 0.0) {
+      pairs[(*num_pairs)++] = roots[i];
+    }
+  }
+  return (2 * *num_pairs + *num_reals) == count;
+}
+
+/* pole factors ordered from the furthest from the unit circle to the closest */
+static uint16_t pole_factors(const zpk_t* zpk, factor_t* factors)
+{
+  cplx_t pairs[MAX_ROOTS];
+  double reals[MAX_ROOTS];
+  uint16_t num_pairs = 0;
+  uint16_t num_reals = 0;
+  uint16_t count = 0;
+  uint16_t i = 0;
+
+  if (!split_roots(zpk->p, zpk->num_poles, pairs, &num_pairs, reals, &num_reals) ||
+      num_pairs + (num_reals + 1) / 2 > FILTER_DESIGN_MAX_STAGES) {
+    return 0;
+  }
+  for (i = 0; i < num_pairs; i++) {
+    factors[count].c1 = -2.0 * pairs[i].re;
+    factors[count].c2 = pairs[i].re * pairs[i].re + pairs[i].im * pairs[i].im;
+    factors[count].root = pairs[i];
+    factors[count++].order = 2;
+  }
+  /* neighbouring real poles share a section, a single one is left for the furthest */
+  for (i = 0; i + 1 < num_reals; i += 2) {
+    factors[count].c1 = -(reals[i] + reals[i + 1]);
+    factors[count].c2 = reals[i] * reals[i + 1];
+    factors[count].root = c_make(reals[i], 0.0);
+    factors[count++].order = 2;
+  }
+  if (i < num_reals) {
+    factors[count].c1 = -reals[i];
+    factors[count].c2 = 0.0;
+    factors[count].root = c_make(reals[i], 0.0);
+    factors[count++].order = 1;
+  }
+
+  for (i = 1; i < count; i++) {
+    factor_t factor = factors[i];
+    uint16_t j = i;
+    while (j > 0 && circle_distance(factors[j - 1].root) < circle_distance(factor.root)) {
+      factors[j] = factors[j - 1];
+      j--;
+    }
+    factors[j] = factor;
+  }
+  return count;
+}
+
+/* index of the remaining real root nearest to x, count if none is left */
+static uint16_t nearest_real(const double* reals, const uint8_t* taken, uint16_t count, cplx_t x)
+{
+  uint16_t best = count;
+  uint16_t i = 0;
+
+  for (; i < count; i++) {
+    if (!taken[i] && (best == count || c_abs(c_sub(c_make(reals[i], 0.0), x)) <
+                                           c_abs(c_sub(c_make(reals[best], 0.0), x)))) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+/* numerator of every pole section - the zeros nearest to its poles, closest poles to the unit circle first */
+static uint8_t zero_factors(const zpk_t* zpk, const factor_t* poles, uint16_t num_sections, factor_t* zeros)
+{
+  cplx_t pairs[MAX_ROOTS];
+  double reals[MAX_ROOTS];
+  uint8_t pair_taken[MAX_ROOTS] = { 0 };
+  uint8_t real_taken[MAX_ROOTS] = { 0 };
+  uint16_t num_pairs = 0;
+  uint16_t num_reals = 0;
+  uint16_t s = 0;
+
+  if (!split_roots(zpk->z, zpk->num_zeros, pairs, &num_pairs, reals, &num_reals)) {
+    return 0;
+  }
+
+  /* the first order section takes one real zero, the others are then paired up */
+  for (s = 0; s < num_sections; s++) {
+    if (poles[s].order == 1) {
+      uint16_t r = nearest_real(reals, real_taken, num_reals, poles[s].root);
+      if (r == num_reals) {
+        return 0;
+      }
+      real_taken[r] = 1;
+      zeros[s].c1 = -reals[r];
+      zeros[s].c2 = 0.0;
+      zeros[s].order = 1;
+    }
+  }
+
+  for (s = num_sections; s-- > 0;) {
+    cplx_t pole = poles[s].root;
+    uint16_t best_pair = num_pairs;
+    uint16_t i = 0;
+
+    if (poles[s].order == 1) {
+      continue;
+    }
+    for (i = 0; i < num_pairs; i++) {
+      if (!pair_taken[i] &&
+          (best_pair == num_pairs || c_abs(c_sub(pairs[i], pole)) < c_abs(c_sub(pairs[best_pair], pole)))) {
+        best_pair = i;
+      }
+    }
+    uint16_t r1 = nearest_real(reals, real_taken, num_reals, pole);
+
+    if (best_pair < num_pairs &&
+        (r1 == num_reals || c_abs(c_sub(pairs[best_pair], pole)) <= c_abs(c_sub(c_make(reals[r1], 0.0), pole)))) {
+      pair_taken[best_pair] = 1;
+      zeros[s].c1 = -2.0 * pairs[best_pair].re;
+      zeros[s].c2 = pairs[best_pair].re * pairs[best_pair].re + pairs[best_pair].im * pairs[best_pair].im;
+    } else {
+      if (r1 == num_reals) {
+        return 0;
+      }
+      real_taken[r1] = 1;
+      uint16_t r2 = nearest_real(reals, real_taken, num_reals, pole);
+      if (r2 == num_reals) {
+        return 0;
+      }
+      real_taken[r2] = 1;
+      zeros[s].c1 = -(reals[r1] + reals[r2]);
+      zeros[s].c2 = reals[r1] * reals[r2];
+    }
+    zeros[s].order = 2;
+  }
+  return 1;
+}
+
+/* |B(z) / A(z)| of one section at z = e^jw, given e^-jw and e^-2jw */
+static double section_gain(const double* b, const double* a, cplx_t z1, cplx_t z2)
+{
+  cplx_t num = c_add(c_make(b[0], 0.0), c_add(c_scale(z1, b[1]), c_scale(z2, b[2])));
+  cplx_t den = c_add(c_make(a[0], 0.0), c_add(c_scale(z1, a[1]), c_scale(z2, a[2])));
+  return c_abs(num) / c_abs(den);
+}
+
+static uint8_t spec_valid(const filter_spec_t* spec)
+{
+  float nyquist = spec->sample_freq / 2.0f;
+  uint8_t band_filter = (spec->band == FILTER_BANDPASS || spec->band == FILTER_NOTCH);
+
+  if (spec->order < 1 || spec->order > FILTER_DESIGN_MAX_ORDER || !(spec->sample_freq > 0.0f)) {
+    return 0;
+  }
+  if (!(spec->f1 > 0.0f && spec->f1 < nyquist) || (band_filter && !(spec->f2 > spec->f1 && spec->f2 < nyquist))) {
+    return 0;
+  }
+  if ((spec->type == FILTER_CHEBYSHEV1 || spec->type == FILTER_ELLIPTIC) && !(spec->ripple_db > 0.0f)) {
+    return 0;
+  }
+  if ((spec->type == FILTER_CHEBYSHEV2 || spec->type == FILTER_ELLIPTIC) && !(spec->atten_db > 0.0f)) {
+    return 0;
+  }
+  return (spec->type != FILTER_ELLIPTIC) || (spec->atten_db > spec->ripple_db);
+}
+
+static uint8_t spec_equal(const filter_spec_t* a, const filter_spec_t* b)
+{
+  return a->type == b->type && a->band == b->band && a->order == b->order && a->sample_freq == b->sample_freq &&
+         a->f1 == b->f1 && a->f2 == b->f2 && a->ripple_db == b->ripple_db && a->atten_db == b->atten_db;
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+uint8_t filter_design(const filter_spec_t* spec, filter_sos_t* sos)
+{
+  zpk_t zpk;
+  factor_t poles[FILTER_DESIGN_MAX_STAGES];
+  factor_t zeros[FILTER_DESIGN_MAX_STAGES];
+  double b[FILTER_DESIGN_MAX_STAGES][3];
+  double a[FILTER_DESIGN_MAX_STAGES][3];
+  double peak[FILTER_DESIGN_MAX_STAGES] = { 0 };
+  uint16_t num_sections = 0;
+  uint16_t s = 0;
+  uint16_t i = 0;
+
+  if (!spec_valid(spec)) {
+    return 0;
+  }
+
+  /* prototype, band and bilinear transform at the prewarped corners */
+  double fs = spec->sample_freq;
+  double w1 = 2.0 * fs * tan(PI * spec->f1 / fs);
+  double w2 = (spec->band == FILTER_BANDPASS || spec->band == FILTER_NOTCH) ? 2.0 * fs * tan(PI * spec->f2 / fs) : w1;
+  analog_prototype(spec, &zpk);
+  transform_band(spec->band, w1, w2, &zpk);
+  bilinear(fs, &zpk);
+
+  /* pair the poles and zeros into sections */
+  num_sections = pole_factors(&zpk, poles);
+  if (num_sections == 0 || !zero_factors(&zpk, poles, num_sections, zeros)) {
+    return 0;
+  }
+  for (s = 0; s < num_sections; s++) {
+    b[s][0] = 1.0;
+    b[s][1] = zeros[s].c1;
+    b[s][2] = zeros[s].c2;
+    a[s][0] = 1.0;
+    a[s][1] = poles[s].c1;
+    a[s][2] = poles[s].c2;
+  }
+
+  /* peak of the cascade up to every section, one pass over the frequency grid */
+  for (i = 0; i < RESPONSE_POINTS; i++) {
+    double w = PI * i / (RESPONSE_POINTS - 1);
+    cplx_t z1 = c_make(cos(w), -sin(w));
+    cplx_t z2 = c_make(cos(2.0 * w), -sin(2.0 * w));
+    double gain = 1.0;
+    for (s = 0; s < num_sections; s++) {
+      gain *= section_gain(b[s], a[s], z1, z2);
+      peak[s] = (gain > peak[s]) ? gain : peak[s];
+    }
+  }
+
+  /* L-infinity scaling: the cascade up to section s peaks at 1, the last section takes the rest of k */
+  double applied = 1.0;
+  for (s = 0; s < num_sections; s++) {
+    double scale = (s + 1 < num_sections && peak[s] > 0.0) ? 1.0 / (peak[s] * applied) : zpk.k / applied;
+    applied *= scale;
+    for (i = 0; i < 3; i++) {
+      sos->b[s][i] = (float)(b[s][i] * scale);
+      sos->a[s][i] = (float)a[s][i];
+    }
+  }
+  sos->num_stages = num_sections;
+  return 1;
+}
+
+float filter_sos_gain(const filter_sos_t* sos, float freq, float sample_freq)
+{
+  double w = 2.0 * PI * freq / sample_freq;
+  cplx_t z1 = c_make(cos(w), -sin(w));
+  cplx_t z2 = c_make(cos(2.0 * w), -sin(2.0 * w));
+  double gain = 1.0;
+  uint16_t s = 0;
+
+  for (; s < sos->num_stages; s++) {
+    double b[3] = { sos->b[s][0], sos->b[s][1], sos->b[s][2] };
+    double a[3] = { 1.0, sos->a[s][1], sos->a[s][2] };
+    gain *= section_gain(b, a, z1, z2);
+  }
+  return (float)gain;
+}
+
+void filter_design_cache_init(filter_design_cache_t* cache)
+{
+  uint16_t i = 0;
+
+  for (; i < FILTER_DESIGN_CACHE_SIZE; i++) {
+    cache->used[i] = 0;
+  }
+  cache->next = 0;
+  cache->hits = 0;
+  cache->misses = 0;
+}
+
+const filter_sos_t* filter_design_cached(filter_design_cache_t* cache, const filter_spec_t* spec)
+{
+  uint16_t i = 0;
+
+  for (; i < FILTER_DESIGN_CACHE_SIZE; i++) {
+    if (cache->used[i] && spec_equal(&cache->specs[i], spec)) {
+      cache->hits++;
+      return &cache->sos[i];
+    }
+  }
+
+  /* miss - design into the oldest entry */
+  uint32_t entry = cache->next;
+  cache->misses++;
+  if (!filter_design(spec, &cache->sos[entry])) {
+    return NULL;
+  }
+  cache->specs[entry] = *spec;
+  cache->used[entry] = 1;
+  cache->next = (entry + 1) % FILTER_DESIGN_CACHE_SIZE;
+  return &cache->sos[entry];
+}
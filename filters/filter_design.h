@@ -0,0 +1,119 @@
+#ifndef FILTER_DESIGN_H
+#define FILTER_DESIGN_H
+
+#include <stdint.h>
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define FILTER_DESIGN_MAX_ORDER  8    /* prototype order - band-pass and notch filters have twice the poles */
+#define FILTER_DESIGN_MAX_STAGES 8    /* second order sections of the largest design */
+#define FILTER_DESIGN_CACHE_SIZE 8    /* designs kept by a filter_design_cache_t */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* analog prototype of the design */
+typedef enum {
+  FILTER_BUTTERWORTH,   /* maximally flat - the corners are the -3 dB points */
+  FILTER_CHEBYSHEV1,    /* pass-band ripple - the corners are the pass-band edges */
+  FILTER_CHEBYSHEV2,    /* stop-band ripple - the corners are the stop-band edges */
+  FILTER_ELLIPTIC       /* ripple in both bands - the corners are the pass-band edges */
+} filter_type_t;
+
+/* frequency band kept (or removed for the notch) */
+typedef enum {
+  FILTER_LOWPASS,       /* below f1 */
+  FILTER_HIGHPASS,      /* above f1 */
+  FILTER_BANDPASS,      /* between f1 and f2 */
+  FILTER_NOTCH          /* all but f1 to f2 (band-stop) */
+} filter_band_t;
+
+/* what to design - also the key of the design cache */
+typedef struct {
+  filter_type_t type;   /* analog prototype */
+  filter_band_t band;   /* low/high/band-pass or notch */
+  uint16_t order;       /* prototype order, 1 .. FILTER_DESIGN_MAX_ORDER */
+  float sample_freq;    /* sampling frequency in Hz */
+  float f1;             /* corner in Hz, lower corner of band-pass and notch */
+  float f2;             /* upper corner in Hz of band-pass and notch, unused otherwise */
+  float ripple_db;      /* pass-band ripple in dB (Chebyshev I and elliptic) */
+  float atten_db;       /* stop-band attenuation in dB (Chebyshev II and elliptic) */
+} filter_spec_t;
+
+/*!
+ * cascade of second order sections in the layout of iir_biquad_filter()
+ *
+ * the sections are ordered from the poles furthest from the unit circle to
+ * the closest ones, and every section is scaled so the response of the cascade
+ * up to it peaks at 1 (L-infinity scaling) - no stage amplifies the signal on
+ * its way through, so the float states keep their precision. the last section
+ * gets the remaining gain, so the response of the whole cascade is exact.
+ */
+typedef struct {
+  uint16_t num_stages;                          /* number of sections */
+  float b[FILTER_DESIGN_MAX_STAGES][3];         /* numerator coeffs [b0,b1,b2] per section */
+  float a[FILTER_DESIGN_MAX_STAGES][3];         /* denominator coeffs [1,a1,a2] per section */
+} filter_sos_t;
+
+/* designed filters keyed by their spec - one per thread, it is not locked */
+typedef struct {
+  filter_spec_t specs[FILTER_DESIGN_CACHE_SIZE];
+  filter_sos_t sos[FILTER_DESIGN_CACHE_SIZE];
+  uint8_t used[FILTER_DESIGN_CACHE_SIZE];       /* entries holding a design */
+  uint32_t next;                                /* entry replaced on the next miss */
+  uint32_t hits;                                /* lookups answered from the cache */
+  uint32_t misses;                              /* lookups that ran the designer */
+} filter_design_cache_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Design a digital IIR filter as second order sections
+ *
+ * analog prototype (poles, zeros and gain), frequency transformation to the
+ * prewarped corners, bilinear transform, then each pole pair is matched with
+ * the zeros nearest to it. computed in double, the coefficients are rounded
+ * to float at the end. Chebyshev II at 0.9 Hz, 4 dB and order 2 is the
+ * baseline wander filter of Baseline_Wander_Coeffs.h.
+ *
+ * @param spec - filter to design
+ * @param sos  - filled with the sections
+ * @return 1 on success, 0 if the spec is invalid
+ */
+uint8_t filter_design(const filter_spec_t* spec, filter_sos_t* sos);
+
+/*!
+ * @brief Magnitude response of a cascade
+ *
+ * @param sos         - sections to evaluate
+ * @param freq        - frequency in Hz
+ * @param sample_freq - sampling frequency in Hz
+ * @return |H| at freq
+ */
+float filter_sos_gain(const filter_sos_t* sos, float freq, float sample_freq);
+
+/*!
+ * @brief Init an empty design cache
+ *
+ * @param cache - pointer to the cache
+ */
+void filter_design_cache_init(filter_design_cache_t* cache);
+
+/*!
+ * @brief Design a filter or return the cached design of the same spec
+ *
+ * a miss replaces the oldest entry. the returned sections stay valid until
+ * FILTER_DESIGN_CACHE_SIZE further misses.
+ *
+ * @param cache - pointer to the cache
+ * @param spec  - filter to design
+ * @return the sections, NULL if the spec is invalid
+ */
+const filter_sos_t* filter_design_cached(filter_design_cache_t* cache, const filter_spec_t* spec);
+
+#endif /* FILTER_DESIGN_H */
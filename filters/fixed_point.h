@@ -0,0 +1,70 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define Q15_MAX  32767
+#define Q15_MIN  (-32768)
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* raw ADC sample or 1.15 fraction - the fixed-point path keeps samples in ADC units */
+typedef int16_t q15_t;
+
+/* 1.31 fraction or 32 bit accumulator */
+typedef int32_t q31_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Saturate a 32 bit value to 16 bits
+ *
+ * @param x - value
+ * @return x clamped to [Q15_MIN, Q15_MAX]
+ */
+static inline q15_t q15_sat(int32_t x)
+{
+  return (q15_t)((x > Q15_MAX) ? Q15_MAX : ((x < Q15_MIN) ? Q15_MIN : x));
+}
+
+/*!
+ * @brief Convert a physical value to ADC units, rounded and saturated
+ *
+ * @param x     - value (e.g. V)
+ * @param scale - value per ADC unit (e.g. V per LSB)
+ * @return x / scale as int16
+ */
+static inline q15_t q15_from_float(float x, float scale)
+{
+  float v = x / scale;
+
+  if (v >= (float)Q15_MAX) {
+    return Q15_MAX;
+  }
+  if (v <= (float)Q15_MIN) {
+    return Q15_MIN;
+  }
+  return (q15_t)(v + ((v < 0.0f) ? -0.5f : 0.5f));
+}
+
+/*!
+ * @brief Convert ADC units to a physical value
+ *
+ * @param x     - sample in ADC units
+ * @param scale - value per ADC unit
+ * @return x * scale
+ */
+static inline float q15_to_float(q15_t x, float scale)
+{
+  return (float)x * scale;
+}
+
+#endif /* FIXED_POINT_H */
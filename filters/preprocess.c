@@ -0,0 +1,351 @@
+#include "preprocess.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "config/config.h"
+#include "ecg_filters.h"
+#include "filter_design.h"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* param of a stage, the default where it is not set */
+static float stage_param(const preprocess_stage_t* stage)
+{
+  if (stage->param > 0.0f) {
+    return stage->param;
+  }
+  switch (stage->type) {
+    case PREPROCESS_NOTCH:
+      return PREPROCESS_NOTCH_HZ;
+    case PREPROCESS_LOWPASS:
+      return PREPROCESS_LOWPASS_HZ;
+    case PREPROCESS_MWI:
+      return PREPROCESS_MWI_MS;
+    default:
+      return stage->param;
+  }
+}
+
+/* appends a section to the cascade - pass-through sections are dropped and pure
+ * gains are carried in gain until the next real section takes them into its b */
+static uint8_t append_section(preprocess_chain_t* chain, const float* b, const float* a, float* gain)
+{
+  uint16_t s = chain->num_sections;
+
+  if (b[1] == 0.0f && b[2] == 0.0f && a[1] == 0.0f && a[2] == 0.0f) {
+    *gain *= b[0];
+    return 1;
+  }
+  if (s >= PREPROCESS_MAX_SECTIONS) {
+    return 0;
+  }
+  chain->b[s][0] = b[0] * *gain;
+  chain->b[s][1] = b[1] * *gain;
+  chain->b[s][2] = b[2] * *gain;
+  chain->a[s][0] = 1.0f;
+  chain->a[s][1] = a[1];
+  chain->a[s][2] = a[2];
+  chain->num_sections++;
+  *gain = 1.0f;
+  return 1;
+}
+
+/* adds the sections of one filter stage */
+static uint8_t add_filter_stage(preprocess_chain_t* chain, const preprocess_stage_t* stage, float* gain)
+{
+  float param = stage_param(stage);
+  filter_spec_t spec = { FILTER_BUTTERWORTH, FILTER_LOWPASS, PREPROCESS_LOWPASS_ORDER, chain->sample_freq,
+                         param, 0.0f, 0.0f, 0.0f };
+  filter_sos_t sos;
+  uint16_t s = 0;
+
+  if (stage->type == PREPROCESS_BASELINE) {
+    baseline_wander_rate_t rate;
+    baseline_wander_rate_init(&rate, chain->sample_freq);
+    chain->baseline_first = chain->num_sections;
+    for (s = 0; s < BASELINE_STATE_STAGES; s++) {
+      if (!append_section(chain, rate.num[s], rate.den[s], gain)) {
+        return 0;
+      }
+    }
+    chain->baseline_sections = chain->num_sections - chain->baseline_first;
+    return 1;
+  }
+
+  /* a second order notch is the first order band-stop around the line frequency */
+  if (stage->type == PREPROCESS_NOTCH) {
+    spec.band = FILTER_NOTCH;
+    spec.order = 1;
+    spec.f1 = param - 0.5f * PREPROCESS_NOTCH_WIDTH;
+    spec.f2 = param + 0.5f * PREPROCESS_NOTCH_WIDTH;
+  }
+  if (!filter_design(&spec, &sos)) {
+    return 0;
+  }
+  for (s = 0; s < sos.num_stages; s++) {
+    if (!append_section(chain, sos.b[s], sos.a[s], gain)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* one feature stage on one sample - same arithmetic as qrs_stream_process() */
+static inline float apply_op(preprocess_chain_t* chain, uint8_t op, float* x, float sample)
+{
+  switch (op) {
+    case PREPROCESS_DERIVATIVE: {
+      float slope = (2.0f * sample + x[0] - x[2] - 2.0f * x[3]) * 0.125f;
+      x[3] = x[2];
+      x[2] = x[1];
+      x[1] = x[0];
+      x[0] = sample;
+      return slope;
+    }
+    case PREPROCESS_SQUARE:
+      return sample * sample;
+    default: {
+      chain->mwi_sum += sample - chain->mwi_ring[chain->mwi_pos];
+      chain->mwi_ring[chain->mwi_pos] = sample;
+      if (++chain->mwi_pos >= chain->mwi_len) {
+        /* re-sum once per window so float round off can not accumulate - O(1) amortized */
+        uint16_t i = 0;
+        chain->mwi_pos = 0;
+        chain->mwi_sum = 0.0f;
+        for (; i < chain->mwi_len; i++) {
+          chain->mwi_sum += chain->mwi_ring[i];
+        }
+      }
+      return chain->mwi_sum / (float)chain->mwi_len;
+    }
+  }
+}
+
+/* the last PREPROCESS_FUSED_SECTIONS sections and the feature stages in one pass -
+ * the sections are copied to locals like iir_biquad_filter_block(), every sample
+ * leaves the cascade straight into the feature stages */
+static void fused_pass(preprocess_chain_t* chain, uint16_t first, const float* in, float* filtered, float* feature,
+                       uint32_t num_samples)
+{
+  float b0[PREPROCESS_FUSED_SECTIONS], b1[PREPROCESS_FUSED_SECTIONS], b2[PREPROCESS_FUSED_SECTIONS];
+  float a1[PREPROCESS_FUSED_SECTIONS], a2[PREPROCESS_FUSED_SECTIONS];
+  float d1[PREPROCESS_FUSED_SECTIONS], d2[PREPROCESS_FUSED_SECTIONS];
+  uint16_t num_sections = chain->num_sections - first;
+  uint8_t num_ops = feature ? chain->num_ops : 0;
+  uint16_t s = 0;
+  uint8_t k = 0;
+  uint32_t i = 0;
+
+  for (s = 0; s < num_sections; s++) {
+    b0[s] = chain->b[first + s][0];
+    b1[s] = chain->b[first + s][1];
+    b2[s] = chain->b[first + s][2];
+    a1[s] = chain->a[first + s][1];
+    a2[s] = chain->a[first + s][2];
+    d1[s] = chain->d[first + s][0];
+    d2[s] = chain->d[first + s][1];
+  }
+
+  for (i = 0; i < num_samples; i++) {
+    float y = in[i];
+
+    /* same operation order as iir_biquad_filter() */
+    for (s = 0; s < num_sections; s++) {
+      float w = y - (a1[s] * d1[s]) - (a2[s] * d2[s]);
+      y = b0[s] * w + (b1[s] * d1[s]) + (b2[s] * d2[s]);
+      d2[s] = d1[s];
+      d1[s] = w;
+    }
+    filtered[i] = y;
+
+    for (k = 0; k < num_ops; k++) {
+      y = apply_op(chain, chain->ops[k], chain->x[k], y);
+    }
+    if (feature) {
+      feature[i] = y;
+    }
+  }
+
+  for (s = 0; s < num_sections; s++) {
+    chain->d[first + s][0] = d1[s];
+    chain->d[first + s][1] = d2[s];
+  }
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+uint8_t preprocess_init(preprocess_chain_t* chain, uint16_t sample_freq, const preprocess_stage_t* stages,
+                        uint8_t num_stages)
+{
+  float gain = 1.0f;
+  uint8_t num_baseline = 0;
+  uint8_t num_mwi = 0;
+  uint8_t i = 0;
+
+  if (num_stages > PREPROCESS_MAX_STAGES || sample_freq == 0) {
+    return 0;
+  }
+  chain->sample_freq = sample_freq;
+  chain->num_stages = num_stages;
+  chain->num_sections = 0;
+  chain->baseline_first = 0;
+  chain->baseline_sections = 0;
+  chain->num_ops = 0;
+  chain->mwi_len = 1;
+
+  for (; i < num_stages; i++) {
+    const preprocess_stage_t* stage = &stages[i];
+    chain->stages[i] = *stage;
+    chain->stages[i].param = stage_param(stage);
+
+    switch (stage->type) {
+      case PREPROCESS_BASELINE:
+        /* one set of double states */
+        if (num_baseline++ > 0) {
+          return 0;
+        }
+        /* fall through */
+      case PREPROCESS_NOTCH:
+      case PREPROCESS_LOWPASS:
+        /* the filtered signal is tapped in front of the feature stages */
+        if (chain->num_ops > 0 || !add_filter_stage(chain, stage, &gain)) {
+          return 0;
+        }
+        break;
+      case PREPROCESS_MWI:
+        if (num_mwi++ > 0) {
+          return 0;
+        }
+        chain->mwi_len =
+            (uint16_t)MAX(1, MIN(PREPROCESS_MWI_MAX, (uint32_t)(sample_freq * stage_param(stage) / 1000.0f)));
+        chain->ops[chain->num_ops++] = (uint8_t)stage->type;
+        break;
+      case PREPROCESS_DERIVATIVE:
+      case PREPROCESS_SQUARE:
+        chain->ops[chain->num_ops++] = (uint8_t)stage->type;
+        break;
+      default:
+        return 0;
+    }
+  }
+
+  /* a gain behind the last section goes into its b, without sections it is a section of its own */
+  if (gain != 1.0f) {
+    if (chain->num_sections > 0) {
+      uint16_t last = chain->num_sections - 1;
+      chain->b[last][0] *= gain;
+      chain->b[last][1] *= gain;
+      chain->b[last][2] *= gain;
+    } else {
+      chain->b[0][0] = gain;
+      chain->b[0][1] = 0.0f;
+      chain->b[0][2] = 0.0f;
+      chain->a[0][0] = 1.0f;
+      chain->a[0][1] = 0.0f;
+      chain->a[0][2] = 0.0f;
+      chain->num_sections = 1;
+    }
+  }
+
+  preprocess_reset(chain);
+  return 1;
+}
+
+void preprocess_reset(preprocess_chain_t* chain)
+{
+  uint16_t i = 0;
+
+  for (i = 0; i < PREPROCESS_MAX_SECTIONS; i++) {
+    chain->d[i][0] = 0.0f;
+    chain->d[i][1] = 0.0f;
+  }
+  for (i = 0; i < BASELINE_STATE_STAGES; i++) {
+    chain->d64[i][0] = 0.0;
+    chain->d64[i][1] = 0.0;
+  }
+  for (i = 0; i < PREPROCESS_MAX_STAGES; i++) {
+    chain->x[i][0] = 0.0f;
+    chain->x[i][1] = 0.0f;
+    chain->x[i][2] = 0.0f;
+    chain->x[i][3] = 0.0f;
+  }
+  for (i = 0; i < PREPROCESS_MWI_MAX; i++) {
+    chain->mwi_ring[i] = 0.0f;
+  }
+  chain->mwi_pos = 0;
+  chain->mwi_sum = 0.0f;
+}
+
+void preprocess_block(preprocess_chain_t* chain, const float* in, float* filtered, float* feature,
+                      uint32_t num_samples)
+{
+  uint16_t first = 0;
+
+  /* the baseline sections and the float sections in front of them run ahead of the fused pass, in place in filtered */
+  if (chain->baseline_sections > 0) {
+    first = chain->baseline_first + chain->baseline_sections;
+    if (chain->baseline_first > 0) {
+      iir_biquad_filter_block(chain->b, chain->a, chain->d, chain->baseline_first, in, filtered, num_samples);
+      in = filtered;
+    }
+    iir_biquad_filter_block_f64(&chain->b[chain->baseline_first], &chain->a[chain->baseline_first], chain->d64,
+                                chain->baseline_sections, in, filtered, num_samples);
+    in = filtered;
+  }
+
+  /* sections that do not fit the fused pass run ahead of it as well */
+  if (chain->num_sections - first > PREPROCESS_FUSED_SECTIONS) {
+    uint16_t ahead = chain->num_sections - first - PREPROCESS_FUSED_SECTIONS;
+    iir_biquad_filter_block(&chain->b[first], &chain->a[first], &chain->d[first], ahead, in, filtered, num_samples);
+    first += ahead;
+    in = filtered;
+  }
+  fused_pass(chain, first, in, filtered, feature, num_samples);
+}
+
+uint8_t preprocess_parse(const char* text, preprocess_stage_t* stages, uint8_t* num_stages)
+{
+  static const struct {
+    const char* name;
+    preprocess_stage_type_t type;
+  } names[] = {
+    { "hp", PREPROCESS_BASELINE }, { "notch", PREPROCESS_NOTCH }, { "lp", PREPROCESS_LOWPASS },
+    { "diff", PREPROCESS_DERIVATIVE }, { "sq", PREPROCESS_SQUARE }, { "mwi", PREPROCESS_MWI },
+  };
+  uint8_t count = 0;
+
+  while (*text) {
+    size_t len = strcspn(text, ",:");
+    uint8_t found = 0;
+    size_t i = 0;
+
+    if (count >= PREPROCESS_MAX_STAGES) {
+      return 0;
+    }
+    for (; i < sizeof(names) / sizeof(names[0]) && !found; i++) {
+      if (strlen(names[i].name) == len && strncmp(text, names[i].name, len) == 0) {
+        stages[count].type = names[i].type;
+        found = 1;
+      }
+    }
+    if (!found) {
+      return 0;
+    }
+    text += len;
+    stages[count].param = (*text == ':') ? strtof(text + 1, (char**)&text) : 0.0f;
+    stages[count].param = stage_param(&stages[count]);
+    count++;
+    if (*text == ',') {
+      text++;
+    } else if (*text) {
+      return 0;
+    }
+  }
+  *num_stages = count;
+  return count > 0;
+}
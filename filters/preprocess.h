@@ -0,0 +1,136 @@
+#ifndef PREPROCESS_H
+#define PREPROCESS_H
+
+#include <stdint.h>
+
+#include "ecg_filters.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define PREPROCESS_MAX_STAGES   8     /* stages of a chain */
+#define PREPROCESS_MAX_SECTIONS 16    /* biquad sections of all filter stages together */
+#define PREPROCESS_FUSED_SECTIONS 8   /* sections kept in registers by the fused pass */
+#define PREPROCESS_MWI_MAX      160   /* integrator length limit (150 ms at 1 kHz) */
+#define PREPROCESS_NOTCH_WIDTH  2.0f  /* -3 dB width of the power line notch in Hz */
+#define PREPROCESS_LOWPASS_ORDER 4    /* Butterworth order of the anti-EMG low-pass */
+#define PREPROCESS_NOTCH_HZ     50.0f /* notch without a param - european power line */
+#define PREPROCESS_LOWPASS_HZ   40.0f /* low-pass corner without a param */
+#define PREPROCESS_MWI_MS       150.0f /* integrator window without a param */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* stage of the preprocessing chain */
+typedef enum {
+  /* filter stages - linear, the output keeps the ECG morphology */
+  PREPROCESS_BASELINE,      /* baseline wander high-pass of the rate, as the channel filter */
+  PREPROCESS_NOTCH,         /* power line band-stop centered on param Hz (50 or 60) */
+  PREPROCESS_LOWPASS,       /* anti-EMG Butterworth low-pass with the corner at param Hz */
+
+  /* feature stages - the QRS energy signal of the streaming detector */
+  PREPROCESS_DERIVATIVE,    /* 5-point derivative (2x[n] + x[n-1] - x[n-3] - 2x[n-4]) / 8 */
+  PREPROCESS_SQUARE,        /* squaring */
+  PREPROCESS_MWI            /* moving window integrator (mean) over param ms */
+} preprocess_stage_type_t;
+
+/* one configured stage */
+typedef struct {
+  preprocess_stage_type_t type;
+  float param;              /* Hz for the notch and the low-pass, ms for the integrator, 0 for the default */
+} preprocess_stage_t;
+
+/*!
+ * preprocessing chain built at runtime
+ *
+ * the filter stages come first, the feature stages after them. all filter
+ * stages are merged into one cascade of biquad sections (pass-through sections
+ * dropped, pure gains folded into the next section) and the feature stages run
+ * on the cascade output of the same sample, so the whole chain is a single pass
+ * over a block. the cascade output is tapped as the filtered signal, the output
+ * of the last stage is the feature signal.
+ *
+ * the sections of the baseline stage keep their delay states in double like
+ * baseline_wander_filter_block_rate() - their 0.9 Hz poles sit too close to 1
+ * for float states - and run ahead of the float sections behind them.
+ */
+typedef struct {
+  uint16_t sample_freq;                         /* sampling frequency in Hz */
+  uint8_t num_stages;                           /* configured stages */
+  preprocess_stage_t stages[PREPROCESS_MAX_STAGES];
+
+  /* filter stages as one cascade */
+  uint16_t num_sections;                        /* sections of all filter stages */
+  float b[PREPROCESS_MAX_SECTIONS][3];          /* numerator coeffs [b0,b1,b2] per section */
+  float a[PREPROCESS_MAX_SECTIONS][3];          /* denominator coeffs [1,a1,a2] per section */
+  float d[PREPROCESS_MAX_SECTIONS][2];          /* delay states per section */
+  uint16_t baseline_first;                      /* first section of the baseline stage */
+  uint16_t baseline_sections;                   /* sections of the baseline stage, 0 without one */
+  double d64[BASELINE_STATE_STAGES][2];         /* delay states of the baseline sections */
+
+  /* feature stages in order */
+  uint8_t num_ops;                              /* feature stages */
+  uint8_t ops[PREPROCESS_MAX_STAGES];           /* preprocess_stage_type_t of each */
+  float x[PREPROCESS_MAX_STAGES][4];            /* input history of each derivative */
+  float mwi_ring[PREPROCESS_MWI_MAX];           /* inputs inside the integrator window - one integrator per chain */
+  uint16_t mwi_len;                             /* integrator window in samples */
+  uint16_t mwi_pos;                             /* oldest entry of mwi_ring */
+  float mwi_sum;                                /* running sum of mwi_ring */
+} preprocess_chain_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Build a preprocessing chain
+ *
+ * designs the notch and low-pass at the sampling rate (filter_design()) and
+ * takes the baseline wander filter of the rate (baseline_wander_rate_init()).
+ *
+ * @param chain       - filled with the chain, states cleared
+ * @param sample_freq - sampling frequency in Hz
+ * @param stages      - stages in processing order, filter stages before feature stages
+ * @param num_stages  - number of stages, at most PREPROCESS_MAX_STAGES
+ * @return 1 on success, 0 if a corner is above Nyquist, a filter stage follows
+ *         a feature stage, there is more than one baseline stage or integrator or too many sections
+ */
+uint8_t preprocess_init(preprocess_chain_t* chain, uint16_t sample_freq, const preprocess_stage_t* stages,
+                        uint8_t num_stages);
+
+/*!
+ * @brief Clear the filter and feature states of a chain
+ *
+ * @param chain - pointer to the chain
+ */
+void preprocess_reset(preprocess_chain_t* chain);
+
+/*!
+ * @brief Run a block of samples through the chain
+ *
+ * @param chain       - pointer to the chain
+ * @param in          - raw samples
+ * @param filtered    - output of the filter stages (may be the same buffer as in)
+ * @param feature     - output of the last feature stage, NULL to skip the feature stages
+ * @param num_samples - number of samples
+ */
+void preprocess_block(preprocess_chain_t* chain, const float* in, float* filtered, float* feature,
+                      uint32_t num_samples);
+
+/*!
+ * @brief Parse a comma separated stage list like "hp,notch:50,lp:40,diff,sq,mwi:150"
+ *
+ * names: hp (baseline), notch, lp, diff, sq and mwi, each with an optional
+ * ":param". the notch defaults to 50 Hz, the low-pass to 40 Hz and the
+ * integrator to 150 ms.
+ *
+ * @param text       - stage list
+ * @param stages     - filled with PREPROCESS_MAX_STAGES stages at most
+ * @param num_stages - filled with the number of stages
+ * @return 1 on success, 0 on an unknown name, a stray character or too many stages
+ */
+uint8_t preprocess_parse(const char* text, preprocess_stage_t* stages, uint8_t* num_stages);
+
+#endif /* PREPROCESS_H */
@@ -0,0 +1,164 @@
+#include "zero_phase.h"
+
+#include <math.h>
+
+#include "config/config.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define ZERO_PHASE_MAX_OVERLAP (1u << 24)   /* poles this close to the unit circle are refused */
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* largest pole radius of the cascade */
+static double pole_radius(const float (*a)[3], uint16_t num_stages)
+{
+  double radius = 0.0;
+  uint16_t curr_stage = 0;
+
+  for (; curr_stage < num_stages; curr_stage++) {
+    double a1 = a[curr_stage][1];
+    double a2 = a[curr_stage][2];
+    double disc = a1 * a1 - 4.0 * a2;
+    double r = 0.0;
+
+    if (disc < 0.0) {
+      r = sqrt(a2);   /* complex pair - |p|^2 = a2 */
+    } else {
+      double root = sqrt(disc);
+      r = MAX(fabs(-a1 + root), fabs(-a1 - root)) / 2.0;
+    }
+    radius = MAX(radius, r);
+  }
+  return radius;
+}
+
+/* Direct Form II cascade in place like iir_biquad_filter_block(), from zero states
+ * kept in double - the baseline filter poles are close to 1 at high rates and
+ * float states drift by up to 1e-2 there, too much for the offline mode */
+static void cascade(const zero_phase_t* zp, float* samples, uint64_t count)
+{
+  double d[ZERO_PHASE_MAX_STAGES][2] = { { 0.0 } };
+  uint64_t i = 0;
+  uint16_t curr_stage = 0;
+
+  for (; i < count; i++) {
+    double y = samples[i];
+    for (curr_stage = 0; curr_stage < zp->num_stages; curr_stage++) {
+      const float* b = zp->b[curr_stage];
+      const float* a = zp->a[curr_stage];
+      double w = y - a[1] * d[curr_stage][0] - a[2] * d[curr_stage][1];
+      y = b[0] * w + b[1] * d[curr_stage][0] + b[2] * d[curr_stage][1];
+      d[curr_stage][1] = d[curr_stage][0];
+      d[curr_stage][0] = w;
+    }
+    samples[i] = (float)y;
+  }
+}
+
+static void reverse(float* samples, uint64_t count)
+{
+  uint64_t i = 0;
+
+  for (; i < count / 2; i++) {
+    float tmp = samples[i];
+    samples[i] = samples[count - 1 - i];
+    samples[count - 1 - i] = tmp;
+  }
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+uint8_t zero_phase_init(zero_phase_t* zp, const float (*b)[3], const float (*a)[3], uint16_t num_stages,
+                        float tolerance)
+{
+  double radius = pole_radius(a, num_stages);
+  double overlap = 0.0;
+
+  if (num_stages > ZERO_PHASE_MAX_STAGES || radius >= 1.0) {
+    return 0;
+  }
+  if (tolerance <= 0.0f) {
+    tolerance = ZERO_PHASE_TOLERANCE;
+  }
+
+  /* r^n < tolerance, plus the FIR part of every stage */
+  overlap = (radius > 0.0) ? ceil(log(tolerance) / log(radius)) : 0.0;
+  overlap += 2.0 * num_stages;
+  if (overlap > ZERO_PHASE_MAX_OVERLAP) {
+    return 0;
+  }
+
+  zp->b = b;
+  zp->a = a;
+  zp->num_stages = num_stages;
+  zp->overlap = (uint32_t)overlap;
+  return 1;
+}
+
+uint64_t zero_phase_scratch_floats(const zero_phase_t* zp, uint32_t count)
+{
+  return (uint64_t)count + 2ull * zp->overlap;
+}
+
+void zero_phase_filter(const zero_phase_t* zp, zero_phase_read_fn read, void* user, uint64_t num_samples,
+                       uint64_t start, uint32_t count, float* scratch, float* out)
+{
+  int64_t n = (int64_t)num_samples;
+  int64_t pad = MIN((int64_t)zp->overlap, n - 1);   /* odd reflection at the signal edges */
+  int64_t lo = MAX((int64_t)start - (int64_t)zp->overlap, -pad);
+  int64_t hi = MIN((int64_t)(start + count) + (int64_t)zp->overlap, n + pad);
+  uint64_t len = (uint64_t)(hi - lo);
+  uint64_t i = 0;
+
+  if (count == 0) {
+    return;
+  }
+
+  /* the signal part of the extended chunk */
+  int64_t inner_lo = MAX(lo, 0);
+  int64_t inner_hi = MIN(hi, n);
+  read(user, (uint64_t)inner_lo, &scratch[inner_lo - lo], (uint32_t)(inner_hi - inner_lo));
+
+  /* x[-i] = 2 x[0] - x[i] in front of the signal */
+  if (lo < 0) {
+    uint64_t m = (uint64_t)-lo;
+    float edge = 0.0f;
+    read(user, 0, &edge, 1);
+    read(user, 1, scratch, (uint32_t)m);
+    reverse(scratch, m);
+    for (i = 0; i < m; i++) {
+      scratch[i] = 2.0f * edge - scratch[i];
+    }
+  }
+
+  /* x[n - 1 + i] = 2 x[n - 1] - x[n - 1 - i] behind it */
+  if (hi > n) {
+    uint64_t m = (uint64_t)(hi - n);
+    float* tail = &scratch[n - lo];
+    float edge = 0.0f;
+    read(user, (uint64_t)(n - 1), &edge, 1);
+    read(user, (uint64_t)n - 1 - m, tail, (uint32_t)m);
+    reverse(tail, m);
+    for (i = 0; i < m; i++) {
+      tail[i] = 2.0f * edge - tail[i];
+    }
+  }
+
+  /* forward pass, then the backward pass over the reversed forward output */
+  cascade(zp, scratch, len);
+  reverse(scratch, len);
+  cascade(zp, scratch, len);
+
+  /* scratch is reversed - sample start + i is at len - 1 - (start - lo) - i */
+  float* last = &scratch[len - 1 - ((int64_t)start - lo)];
+  for (i = 0; i < count; i++) {
+    out[i] = *(last - i);
+  }
+}
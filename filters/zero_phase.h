@@ -0,0 +1,90 @@
+#ifndef ZERO_PHASE_H
+#define ZERO_PHASE_H
+
+#include <stdint.h>
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define ZERO_PHASE_MAX_STAGES 8       /* sections of the filtered cascade */
+#define ZERO_PHASE_TOLERANCE  1e-6f   /* default decay of the edge transients, relative to the impulse peak */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* reads samples [first, first + count) of a signal into out - returns the number read */
+typedef uint32_t (*zero_phase_read_fn)(void* user, uint64_t first, float* out, uint32_t count);
+
+/*!
+ * forward-backward (zero-phase) filter of a long signal in chunks
+ *
+ * the whole-signal result is the cascade run forward over the signal with
+ * odd reflections of pad samples at both ends, and backward over that output
+ * (like scipy.signal.sosfiltfilt). a chunk needs the filter states at its two
+ * edges, they are rebuilt by running the passes over overlap extra samples on
+ * each side, so chunks are independent: any number of them can be filtered
+ * concurrently and only their scratch memory is needed at a time. the
+ * transients of the rebuilt states have decayed below the tolerance by the
+ * chunk edges.
+ *
+ * the magnitude response is the square of the cascade's.
+ */
+typedef struct {
+  const float (*b)[3];        /* numerator coeffs [b0,b1,b2] per stage */
+  const float (*a)[3];        /* denominator coeffs [1,a1,a2] per stage */
+  uint16_t num_stages;        /* number of stages */
+  uint32_t overlap;           /* warm-up samples on both sides of a chunk */
+} zero_phase_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Init a zero-phase filter
+ *
+ * the overlap is the number of samples the impulse response of the slowest
+ * pole takes to decay to the tolerance. the coefficients are not copied.
+ *
+ * @param zp         - filled with the filter
+ * @param b          - numerator coeffs [b0,b1,b2] for each stage
+ * @param a          - denominator coeffs [1,a1,a2] for each stage
+ * @param num_stages - number of stages, at most ZERO_PHASE_MAX_STAGES
+ * @param tolerance  - relative size of the edge transients, 0 for ZERO_PHASE_TOLERANCE
+ * @return 1 on success, 0 if the cascade is unstable or too long
+ */
+uint8_t zero_phase_init(zero_phase_t* zp, const float (*b)[3], const float (*a)[3], uint16_t num_stages,
+                        float tolerance);
+
+/*!
+ * @brief Floats of scratch memory needed to filter a chunk
+ *
+ * @param zp    - zero-phase filter
+ * @param count - chunk length
+ * @return scratch size in floats
+ */
+uint64_t zero_phase_scratch_floats(const zero_phase_t* zp, uint32_t count);
+
+/*!
+ * @brief Filter one chunk of a signal
+ *
+ * reads the chunk and its overlap through read, runs the forward and the
+ * backward pass in scratch and writes the zero-phase output of the chunk.
+ * reentrant - chunks of one signal can be filtered on several threads, each
+ * with its own scratch.
+ *
+ * @param zp          - zero-phase filter
+ * @param read        - reads samples of the signal
+ * @param user        - user pointer passed to read
+ * @param num_samples - length of the whole signal
+ * @param start       - first sample of the chunk
+ * @param count       - chunk length (start + count <= num_samples)
+ * @param scratch     - zero_phase_scratch_floats() floats
+ * @param out         - filled with count filtered samples
+ */
+void zero_phase_filter(const zero_phase_t* zp, zero_phase_read_fn read, void* user, uint64_t num_samples,
+                       uint64_t start, uint32_t count, float* scratch, float* out);
+
+#endif /* ZERO_PHASE_H */
@@ -0,0 +1,158 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* user headers */
+#include "QRS_Dat_in.h"
+#include "config/config.h"
+#include "osal/osal.h"
+#include "channel/ecg_channel.h"
+#include "batch/ecg_batch.h"
+#include "sched/thread_pool.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define DEFAULT_NUM_CHANNELS 1024u /* channels processed concurrently */
+#define DEFAULT_NUM_WAVES    100u  /* waves of QRS_IN per channel */
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* runs every channel once on a pool of num_threads and returns the time in s */
+static double run_batch(uint32_t num_threads, ecg_channel_t* channels, const ecg_batch_input_t* inputs,
+                        uint32_t num_channels, uint32_t* accepted)
+{
+  thread_pool_t* pool = thread_pool_create(num_threads);
+  uint32_t i = 0;
+
+  if (!pool) {
+    fprintf(stderr, "failed to create thread pool\n");
+    exit(1);
+  }
+
+  for (i = 0; i < num_channels; i++) {
+    ecg_channel_init(&channels[i], i, NULL);
+    ecg_channel_set_filter_restart(&channels[i], 1);
+  }
+
+  uint64_t start_ns = osal_time_ns();
+  ecg_batch_run(pool, channels, inputs, num_channels, NULL, NULL);
+  uint64_t elapsed_ns = osal_time_ns() - start_ns;
+
+  *accepted = 0;
+  for (i = 0; i < num_channels; i++) {
+    *accepted += channels[i].stats.waves_accepted;
+  }
+
+  thread_pool_destroy(pool);
+  return (double)elapsed_ns / 1e9;
+}
+
+static void usage(const char* prog)
+{
+  fprintf(stderr,
+          "usage: %s [-c channels] [-w waves] [-t threads] [-s] [-L]\n"
+          "  -c channels  number of channels (default %u)\n"
+          "  -w waves     waves of QRS_IN per channel (default %u)\n"
+          "  -t threads   number of threads, 0 uses every core (default 0)\n"
+          "  -s           sweep 1, 2, 4 .. threads and report the scaling\n"
+          "  -L           back the channels with huge pages\n",
+          prog, DEFAULT_NUM_CHANNELS, DEFAULT_NUM_WAVES);
+}
+
+/******************************************************************************
+ * MAIN FUNCTION
+ *****************************************************************************/
+int main(int argc, char** argv) {
+  uint32_t num_channels = DEFAULT_NUM_CHANNELS;
+  uint32_t num_waves = DEFAULT_NUM_WAVES;
+  uint32_t num_threads = 0;
+  uint8_t sweep = 0;
+  uint8_t hugepages = 0;
+  arena_t arena;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "c:w:t:sLh")) != -1) {
+    switch (opt) {
+      case 'c':
+        num_channels = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'w':
+        num_waves = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 't':
+        num_threads = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        sweep = 1;
+        break;
+      case 'L':
+        hugepages = 1;
+        break;
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+  if (num_threads == 0) {
+    num_threads = osal_cpu_count();
+  }
+
+  /* every channel replays the same recording - the input is read-only */
+  uint32_t num_samples = num_waves * QRS_BUFFER_SIZE;
+  float* recording = (float*)malloc(num_samples * sizeof(float));
+  ecg_batch_input_t* inputs = (ecg_batch_input_t*)malloc(num_channels * sizeof(ecg_batch_input_t));
+  ecg_channel_t* channels = NULL;
+  uint32_t i = 0;
+
+  /* every channel is carved out of one block, runs re-init them in place */
+  if (arena_create(&arena, ecg_channel_footprint(num_channels, SAMPLE_FREQ), hugepages)) {
+    channels = ecg_channels_create(&arena, num_channels, SAMPLE_FREQ);
+    arena_seal(&arena);
+  }
+  if (!recording || !channels || !inputs) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  printf("channel footprint=%.1f KB total=%.1f MB\n", ecg_channel_footprint(1, SAMPLE_FREQ) / 1024.0,
+         arena.used / 1048576.0);
+  for (i = 0; i < num_samples; i++) {
+    recording[i] = QRS_IN[i % QRS_BUFFER_SIZE];
+  }
+  for (i = 0; i < num_channels; i++) {
+    inputs[i].samples = recording;
+    inputs[i].num_samples = num_samples;
+  }
+
+  double total_samples = (double)num_samples * num_channels;
+  double base_time = 0.0;
+  uint32_t threads = sweep ? 1 : num_threads;
+
+  while (threads <= num_threads) {
+    uint32_t accepted = 0;
+    double elapsed_s = run_batch(threads, channels, inputs, num_channels, &accepted);
+    if (base_time == 0.0) {
+      base_time = elapsed_s;
+    }
+
+    printf("channels=%u threads=%u time=%.3f s rate=%.2f Msamples/s speedup=%.2f accepted=%u\n",
+           num_channels, threads, elapsed_s, total_samples / elapsed_s / 1e6, base_time / elapsed_s, accepted);
+
+    if (threads == num_threads) {
+      break;
+    }
+    threads = (threads * 2 > num_threads) ? num_threads : threads * 2;
+  }
+
+  free(inputs);
+  arena_destroy(&arena);
+  free(recording);
+  return 0;
+}
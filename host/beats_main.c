@@ -0,0 +1,106 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* user headers */
+#include "io/beat_file.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define DEFAULT_COUNT 10u  /* records printed from the seek position */
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void usage(const char* prog)
+{
+  fprintf(stderr,
+          "usage: %s [-t seconds] [-n count] [-a file.atr [-c channel]] file.ecgb\n"
+          "  -t seconds  print records starting at this time (default 0)\n"
+          "  -n count    records to print (default %u)\n"
+          "  -a file     export the R peaks as WFDB annotations\n"
+          "  -c channel  channel to export (default 0)\n",
+          prog, DEFAULT_COUNT);
+}
+
+/******************************************************************************
+ * MAIN FUNCTION
+ *****************************************************************************/
+int main(int argc, char** argv) {
+  double seconds = 0.0;
+  uint64_t count = DEFAULT_COUNT;
+  const char* atr_path = NULL;
+  uint32_t channel_id = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:n:a:c:h")) != -1) {
+    switch (opt) {
+      case 't':
+        seconds = strtod(optarg, NULL);
+        break;
+      case 'n':
+        count = strtoull(optarg, NULL, 0);
+        break;
+      case 'a':
+        atr_path = optarg;
+        break;
+      case 'c':
+        channel_id = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  beat_reader_t reader;
+  if (!beat_reader_open(&reader, argv[optind])) {
+    fprintf(stderr, "failed to open %s\n", argv[optind]);
+    return 1;
+  }
+  printf("records=%llu index=%llu sample_freq=%u\n", (unsigned long long)reader.num_records,
+         (unsigned long long)reader.index_count, reader.sample_freq);
+
+  /* seek by time through the sparse index */
+  uint64_t number = beat_reader_seek(&reader, (uint64_t)(seconds * reader.sample_freq));
+  for (; number < reader.num_records && count > 0; number++, count--) {
+    beat_record_t record;
+    beat_reader_get(&reader, number, &record);
+    printf("%llu: t=%.3f s ch=%u wave=%u R=%d mV PR=%d QRS=%d QT=%d RR=%d ms HR=%d q=%u",
+           (unsigned long long)number, (double)record.r_sample / reader.sample_freq, record.channel_id, record.wave,
+           (int)record.points.r_val, (int)record.intervals.pr_interval, (int)record.intervals.qrs_duration,
+           (int)record.intervals.qt_interval, (int)record.intervals.rr_interval, (int)record.heart_rate,
+           record.quality);
+    if (record.beat_class != MORPH_CLASS_NONE) {
+      printf(" class=%s cluster=%u", morph_class_name(record.beat_class), record.cluster);
+    }
+    if (record.sqi != SQI_NONE) {
+      printf(" sqi=%u", record.sqi);
+    }
+    printf("\n");
+  }
+
+  if (atr_path) {
+    int64_t written = beat_reader_export_atr(&reader, channel_id, atr_path);
+    if (written < 0) {
+      fprintf(stderr, "failed to export %s\n", atr_path);
+      beat_reader_close(&reader);
+      return 1;
+    }
+    printf("annotations=%lld\n", (long long)written);
+  }
+
+  beat_reader_close(&reader);
+  return 0;
+}
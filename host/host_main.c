@@ -0,0 +1,344 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* user headers */
+#include "QRS_Dat_in.h"
+#include "config/config.h"
+#include "buffers/buffer.h"
+#include "osal/osal.h"
+#include "app/ecg_app.h"
+#include "io/beat_file.h"
+#include "metrics/ecg_metrics.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define DEFAULT_NUM_WAVES NUM_OF_WAVES /* waves of QRS_IN to replay */
+#define DEFAULT_SPEED     1000u        /* multiple of real-time (0 = as fast as possible) */
+#define METRICS_PERIOD_NS 1000000000ull /* metrics file rewrite period while replaying */
+#define POLL_PERIOD_NS    1000000ull    /* subscribers poll the beat ring every 1 ms when they are up to date */
+#define HR_TREND_WAVES    8             /* accepted waves averaged by the heart rate trend */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* a consumer of the detected waves on its own thread */
+typedef struct {
+  const char* name;
+  uint32_t id;                                                   /* subscriber id */
+  uint32_t delay_us;                                             /* emulated time spent per wave */
+  void (*on_beat)(void* user, const ecg_wave_result_t* result);  /* called for every wave read */
+  void* user;
+} subscriber_t;
+
+/* moving average of the heart rate over the last HR_TREND_WAVES accepted waves */
+typedef struct {
+  float hr[HR_TREND_WAVES];
+  uint32_t count;
+  float last;
+  float min;
+  float max;
+} hr_trend_t;
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* thread entry points - the host equivalent of the tasks created in app.cfg */
+static void preprocessing_thread(void* arg)
+{
+  (void)arg;
+  ecg_app_preprocessing_task();
+}
+
+static void feature_detect_thread(void* arg)
+{
+  (void)arg;
+  ecg_app_feature_detect_task();
+}
+
+static void logger_thread(void* arg)
+{
+  (void)arg;
+  ecg_app_logger_task();
+}
+
+/* reads every wave published after it subscribed at its own pace and returns once the stream ended */
+static void subscriber_thread(void* arg)
+{
+  subscriber_t* sub = (subscriber_t*)arg;
+  ecg_wave_result_t result;
+
+  while (1) {
+    uint8_t done = ecg_app_beats_done();
+    if (ecg_app_read_beat(sub->id, &result)) {
+      if (sub->delay_us) {
+        osal_sleep_until_ns(osal_time_ns() + sub->delay_us * 1000ull);
+      }
+      sub->on_beat(sub->user, &result);
+      continue;
+    }
+    if (done) {
+      break;
+    }
+    osal_sleep_until_ns(osal_time_ns() + POLL_PERIOD_NS);
+  }
+}
+
+/* backpressure subscriber - the beat file must not lose waves */
+static void write_beat(void* user, const ecg_wave_result_t* result)
+{
+  beat_writer_write((beat_writer_t*)user, result);
+}
+
+static void update_hr_trend(void* user, const ecg_wave_result_t* result)
+{
+  hr_trend_t* trend = (hr_trend_t*)user;
+
+  if (result->quality < MIN_WAVE_QUALITY) {
+    return;
+  }
+  trend->hr[trend->count++ % HR_TREND_WAVES] = ecg_calculate_heart_rate(&result->intervals);
+  uint32_t n = MIN(trend->count, HR_TREND_WAVES);
+  float sum = 0.0f;
+  for (uint32_t i = 0; i < n; i++) {
+    sum += trend->hr[i];
+  }
+  trend->last = sum / (float)n;
+  if (trend->count >= HR_TREND_WAVES) {
+    trend->min = (trend->count == HR_TREND_WAVES) ? trend->last : MIN(trend->min, trend->last);
+    trend->max = (trend->count == HR_TREND_WAVES) ? trend->last : MAX(trend->max, trend->last);
+  }
+}
+
+/* network exporter stand-in - only the delay per wave */
+static void export_beat(void* user, const ecg_wave_result_t* result)
+{
+  (void)user;
+  (void)result;
+}
+
+static void print_subscriber(const subscriber_t* sub)
+{
+  beat_ring_stats_t stats;
+  ecg_app_get_beat_stats(sub->id, &stats);
+  fprintf(stderr, "%s: delivered=%u dropped=%u stalls=%u max_lag=%u\n", sub->name, stats.delivered,
+          stats.dropped, stats.stalls, stats.max_lag);
+}
+
+/* blocks the producer while the tasks are about to be overrun - only used
+ * when running unpaced, the board relies on the tasks keeping up with the timer */
+static void wait_for_pipeline(void)
+{
+  ecg_app_stats_t stats;
+
+  while (1) {
+    ecg_app_get_stats(&stats);
+    uint32_t pending_samples = stats.samples_pushed - stats.samples_filtered;
+    uint32_t pending_waves = stats.waves_posted - stats.waves_detected;
+    if (pending_samples < BUFFER_SIZE && pending_waves < NUM_OF_WAVES - 1) {
+      break;
+    }
+    sched_yield();
+  }
+}
+
+static void usage(const char* prog)
+{
+  fprintf(stderr,
+          "usage: %s [-w waves] [-x speed] [-f frame] [-g gain] [-o beats] [-m metrics] [-e us] [-B] [-q]\n"
+          "  -w waves  number of QRS_IN waves to replay (default %d)\n"
+          "  -x speed  multiple of real-time, 0 runs as fast as possible (default %u)\n"
+          "  -f frame  samples filtered per preprocessing wakeup (default %d)\n"
+          "  -g gain   scale QRS_IN, emulates a lead with a different gain (default 1.0)\n"
+          "  -o beats  write every detected wave to a binary beat file\n"
+          "  -m file   write the pipeline metrics as Prometheus text every second and at exit (- for stdout at exit)\n"
+          "  -e us     add an exporter stand-in subscriber that takes us per wave (drops the oldest waves)\n"
+          "  -B        the exporter applies backpressure instead of dropping waves\n"
+          "  -q        do not print detected waves\n",
+          prog, DEFAULT_NUM_WAVES, DEFAULT_SPEED, FRAME_SIZE);
+}
+
+/******************************************************************************
+ * MAIN FUNCTION
+ *****************************************************************************/
+int main(int argc, char** argv) {
+  uint32_t num_waves = DEFAULT_NUM_WAVES;
+  uint32_t speed = DEFAULT_SPEED;
+  uint16_t frame_size = FRAME_SIZE;
+  float gain = 1.0f;
+  const char* beats_path = NULL;
+  const char* metrics_path = NULL;
+  uint8_t log_results = 1;
+  int32_t export_us = -1;
+  beat_ring_policy_t export_policy = BEAT_RING_DROP_OLDEST;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "w:x:f:g:o:m:e:Bqh")) != -1) {
+    switch (opt) {
+      case 'w':
+        num_waves = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'x':
+        speed = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'f':
+        frame_size = (uint16_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'g':
+        gain = strtof(optarg, NULL);
+        break;
+      case 'o':
+        beats_path = optarg;
+        break;
+      case 'm':
+        metrics_path = optarg;
+        break;
+      case 'e':
+        export_us = (int32_t)strtol(optarg, NULL, 0);
+        break;
+      case 'B':
+        export_policy = BEAT_RING_BACKPRESSURE;
+        break;
+      case 'q':
+        log_results = 0;
+        break;
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+
+  ecg_app_config_t config;
+  config.sample_ready_sem = osal_sem_create(0);
+  config.wave_ready_sem = osal_sem_create(0);
+  config.beat_ready_sem = osal_sem_create(0);
+  config.beat_space_sem = osal_sem_create(0);
+  config.frame_size = frame_size;
+  config.log_results = log_results;
+  config.stages = NULL;
+  config.num_stages = 0;
+  config.min_sqi = 0;
+  if (!config.sample_ready_sem || !config.wave_ready_sem || !config.beat_ready_sem || !config.beat_space_sem) {
+    fprintf(stderr, "failed to create semaphores\n");
+    return 1;
+  }
+  beat_writer_t* writer = NULL;
+  if (beats_path) {
+    writer = beat_writer_open(beats_path, SAMPLE_FREQ);
+    if (!writer) {
+      fprintf(stderr, "failed to create %s\n", beats_path);
+      return 1;
+    }
+  }
+  if (!ecg_app_init(&config)) {
+    fprintf(stderr, "failed to init the ecg app\n");
+    if (writer) {
+      beat_writer_close(writer);
+    }
+    return 1;
+  }
+
+  /* consumers of the detected waves - each reads at its own pace on its own thread */
+  hr_trend_t trend = { { 0.0f }, 0, 0.0f, 0.0f, 0.0f };
+  subscriber_t subs[3];
+  uint32_t num_subs = 0;
+  if (writer) {
+    subs[num_subs] = (subscriber_t){ "beat file", 0, 0, write_beat, writer };
+    ecg_app_subscribe(BEAT_RING_BACKPRESSURE, &subs[num_subs++].id);
+  }
+  subs[num_subs] = (subscriber_t){ "hr trend", 0, 0, update_hr_trend, &trend };
+  ecg_app_subscribe(BEAT_RING_DROP_OLDEST, &subs[num_subs++].id);
+  if (export_us >= 0) {
+    subs[num_subs] = (subscriber_t){ "exporter", 0, (uint32_t)export_us, export_beat, NULL };
+    ecg_app_subscribe(export_policy, &subs[num_subs++].id);
+  }
+
+  osal_thread_t preprocessing = osal_thread_create(preprocessing_thread, NULL, "ecg_preproc");
+  osal_thread_t feature_detect = osal_thread_create(feature_detect_thread, NULL, "ecg_features");
+  osal_thread_t logger = osal_thread_create(logger_thread, NULL, "ecg_logger");
+  osal_thread_t sub_threads[3];
+  uint8_t threads_ok = preprocessing && feature_detect && logger;
+  for (uint32_t s = 0; s < num_subs; s++) {
+    sub_threads[s] = osal_thread_create(subscriber_thread, &subs[s], "ecg_subscriber");
+    threads_ok = threads_ok && sub_threads[s];
+  }
+  if (!threads_ok) {
+    fprintf(stderr, "failed to create threads\n");
+    return 1;
+  }
+
+  /* the producer plays the role of the Timer64P0 ISR */
+  uint64_t period_ns = speed ? (1000000000ull / SAMPLE_FREQ) / speed : 0;
+  uint64_t start_ns = osal_time_ns();
+  uint64_t deadline_ns = start_ns;
+  uint64_t metrics_ns = start_ns + METRICS_PERIOD_NS;
+  uint32_t num_samples = num_waves * QRS_BUFFER_SIZE;
+  uint32_t i = 0;
+
+  for (; i < num_samples; i++) {
+    if (period_ns) {
+      deadline_ns += period_ns;
+      osal_sleep_until_ns(deadline_ns);
+    } else {
+      wait_for_pipeline();
+    }
+    ecg_app_push_sample(gain * buffer_read(QRS_IN, (uint16_t)(i % QRS_BUFFER_SIZE), QRS_BUFFER_SIZE));
+
+    /* periodic scrape file, e.g. for the node exporter textfile collector */
+    if (metrics_path && strcmp(metrics_path, "-") != 0 && (i & 0xFF) == 0 && osal_time_ns() >= metrics_ns) {
+      ecg_metrics_write_file(metrics_path);
+      metrics_ns += METRICS_PERIOD_NS;
+    }
+  }
+
+  /* drain the pipeline */
+  ecg_app_stop();
+  osal_thread_join(preprocessing);
+  osal_thread_join(feature_detect);
+  osal_thread_join(logger);
+  for (uint32_t s = 0; s < num_subs; s++) {
+    osal_thread_join(sub_threads[s]);
+  }
+  uint64_t elapsed_ns = osal_time_ns() - start_ns;
+
+  ecg_app_stats_t stats;
+  ecg_app_get_stats(&stats);
+
+  double elapsed_s = (double)elapsed_ns / 1e9;
+  double signal_s = (double)stats.samples_pushed / SAMPLE_FREQ;
+  fprintf(stderr,
+          "samples=%u dropped=%u filtered=%u waves=%u accepted=%u time=%.3f s (%.1fx real-time)\n",
+          stats.samples_pushed, stats.samples_dropped, stats.samples_filtered, stats.waves_detected,
+          stats.waves_accepted, elapsed_s, elapsed_s > 0.0 ? signal_s / elapsed_s : 0.0);
+  fprintf(stderr, "published=%u stalled=%u\n", stats.beats_published, stats.beats_stalled);
+  for (uint32_t s = 0; s < num_subs; s++) {
+    print_subscriber(&subs[s]);
+  }
+  if (trend.count >= HR_TREND_WAVES) {
+    fprintf(stderr, "hr trend: last=%.1f min=%.1f max=%.1f bpm\n", trend.last, trend.min, trend.max);
+  }
+
+  if (metrics_path && !ecg_metrics_write_file(metrics_path)) {
+    fprintf(stderr, "failed to write %s\n", metrics_path);
+    return 1;
+  }
+  if (writer && !beat_writer_close(writer)) {
+    fprintf(stderr, "failed to write %s\n", beats_path);
+    return 1;
+  }
+  osal_sem_delete(config.sample_ready_sem);
+  osal_sem_delete(config.wave_ready_sem);
+  osal_sem_delete(config.beat_ready_sem);
+  osal_sem_delete(config.beat_space_sem);
+  return 0;
+}
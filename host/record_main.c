@@ -0,0 +1,397 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* user headers */
+#include "config/config.h"
+#include "osal/osal.h"
+#include "channel/ecg_channel.h"
+#include "batch/ecg_batch.h"
+#include "filters/ecg_filters.h"
+#include "filters/preprocess.h"
+#include "filters/zero_phase.h"
+#include "feature_extract/hrv.h"
+#include "io/ecg_record.h"
+#include "io/beat_file.h"
+#include "sched/thread_pool.h"
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* HRV of one signal - the last window and the averages over every window of the record */
+typedef struct {
+  hrv_t hrv;
+  uint64_t next_window;         /* R sample that closes the current window */
+  uint32_t num_windows;         /* windows closed */
+  double sdnn_sum;              /* sum of the SDNN of every window (SDNN index) */
+  uint32_t num_freq;            /* windows with a spectral estimate */
+  double lf_hf_sum;             /* sum of their LF/HF */
+} signal_hrv_t;
+
+/* beats of one signal per morphology class */
+typedef struct {
+  uint64_t classes[MORPH_CLASS_ARTIFACT + 1]; /* indexed by morph_class_t */
+} signal_morph_t;
+
+/* result sinks of every signal - the waves of a signal are delivered by one pool thread at a
+ * time, so the pool threads never share a writer or an HRV state */
+typedef struct {
+  beat_writer_t* writers[ECG_RECORD_MAX_SIGNALS];
+  signal_hrv_t* hrv;            /* one per signal, NULL without -H */
+  signal_morph_t* morph;        /* one per signal, NULL without -M */
+} sinks_t;
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* O(1) per beat - the spectrum is only estimated once per closed window */
+static void update_hrv(signal_hrv_t* sig, const ecg_wave_result_t* result)
+{
+  hrv_time_t time;
+  hrv_freq_t freq;
+
+  if (result->quality < MIN_WAVE_QUALITY) {
+    return;
+  }
+  if (sig->next_window == 0) {
+    sig->next_window = result->r_sample + sig->hrv.window;
+  }
+  if (result->r_sample >= sig->next_window) {
+    hrv_get_time(&sig->hrv, &time);
+    if (time.num_rr > 1) {
+      sig->sdnn_sum += time.sdnn;
+      sig->num_windows++;
+    }
+    if (hrv_get_freq(&sig->hrv, &freq)) {
+      sig->lf_hf_sum += freq.lf_hf;
+      sig->num_freq++;
+    }
+    sig->next_window += sig->hrv.window;
+  }
+  hrv_add_beat(&sig->hrv, result->r_sample, result->intervals.rr_interval);
+}
+
+static void on_beat(void* user, const ecg_wave_result_t* result)
+{
+  sinks_t* sinks = (sinks_t*)user;
+  if (sinks->writers[result->channel_id]) {
+    beat_writer_write(sinks->writers[result->channel_id], result);
+  }
+  if (sinks->hrv) {
+    update_hrv(&sinks->hrv[result->channel_id], result);
+  }
+  if (sinks->morph && result->morph.beat_class <= MORPH_CLASS_ARTIFACT) {
+    sinks->morph[result->channel_id].classes[result->morph.beat_class]++;
+  }
+}
+
+static void print_hrv(uint16_t signal, signal_hrv_t* sig)
+{
+  hrv_time_t time;
+  hrv_freq_t freq;
+
+  hrv_get_time(&sig->hrv, &time);
+  hrv_get_freq(&sig->hrv, &freq);
+  printf("signal %u: hrv nn=%u mean_rr=%.1f ms sdnn=%.1f ms rmssd=%.1f ms pnn50=%.1f%% lf=%.0f hf=%.0f ms^2 "
+         "lf/hf=%.2f | windows=%u sdnn_index=%.1f ms mean_lf/hf=%.2f\n",
+         signal, time.num_rr, time.mean_rr, time.sdnn, time.rmssd, time.pnn50, freq.lf, freq.hf, freq.lf_hf,
+         sig->num_windows, sig->num_windows ? sig->sdnn_sum / sig->num_windows : 0.0,
+         sig->num_freq ? sig->lf_hf_sum / sig->num_freq : 0.0);
+}
+
+static void print_morph(uint16_t signal, const signal_morph_t* sig, const ecg_channel_t* channel)
+{
+  printf("signal %u: morphology normal=%llu ectopic=%llu artifact=%llu learning=%llu templates=%u isa=%s\n", signal,
+         (unsigned long long)sig->classes[MORPH_CLASS_NORMAL], (unsigned long long)sig->classes[MORPH_CLASS_ECTOPIC],
+         (unsigned long long)sig->classes[MORPH_CLASS_ARTIFACT], (unsigned long long)sig->classes[MORPH_CLASS_LEARNING],
+         channel->morph.num_templates, biquad_isa_name(channel->morph.isa));
+}
+
+static void usage(const char* prog)
+{
+  fprintf(stderr,
+          "usage: %s -r record.hea | -i file [-F i16|f32] [-n signals] [-s freq] [-G gain] [-t threads] [-z | -p stages | -X] [-B] [-S shards [-W s]] [-o prefix [-a]] [-H] [-M] [-Q min] [-L] [-v]\n"
+          "  -r record.hea  WFDB record (format 16 or 212)\n"
+          "  -i file        raw interleaved little-endian samples\n"
+          "  -F i16|f32     raw sample type (default i16)\n"
+          "  -n signals     raw signals per frame (default 1)\n"
+          "  -s freq        raw sampling frequency in Hz (default %d)\n"
+          "  -G gain        raw int16 ADC units per mV (default 200)\n"
+          "  -t threads     number of threads, 0 uses every core (default 0)\n"
+          "  -z             zero-phase (forward-backward) baseline filter for offline analysis\n"
+          "  -p stages      preprocessing chain instead of the baseline filter, e.g. hp,notch:50,lp:40,diff,sq,mwi:150\n"
+          "  -X             fixed-point (int16) baseline filter and delineation at the ADC resolution of the record\n"
+          "  -B             restart the baseline filter every block, for records of the looped QRS_IN\n"
+          "  -S shards      split every signal into time shards run in parallel, 0 for one per thread\n"
+          "  -W s           warm-up in front of every shard in s (default %d)\n"
+          "  -o prefix      write the beats of signal N to prefix_N.ecgb\n"
+          "  -a             also export prefix_N.atr WFDB annotations\n"
+          "  -H             print the HRV of every signal - the last %d s and the averages over all windows\n"
+          "  -M             classify every beat by its shape against learned templates and print the classes\n"
+          "  -Q min         score the signal quality of every block, skip the beats of blocks below min (e.g. %d)\n"
+          "  -L             back the channels with huge pages\n"
+          "  -v             print the counters of every signal\n",
+          prog, SAMPLE_FREQ, ECG_SHARD_WARMUP_S, HRV_WINDOW_S, SQI_MIN_USABLE);
+}
+
+/******************************************************************************
+ * MAIN FUNCTION
+ *****************************************************************************/
+int main(int argc, char** argv) {
+  const char* hea_path = NULL;
+  const char* raw_path = NULL;
+  ecg_record_format_t raw_format = ECG_RECORD_FORMAT_16;
+  uint16_t raw_signals = 1;
+  uint16_t raw_freq = SAMPLE_FREQ;
+  float raw_gain = 200.0f;
+  uint32_t num_threads = 0;
+  const char* out_prefix = NULL;
+  uint8_t export_atr = 0;
+  uint8_t verbose = 0;
+  uint8_t with_hrv = 0;
+  uint8_t with_morph = 0;
+  uint8_t min_sqi = 0;
+  uint8_t zero_phase = 0;
+  uint8_t restart_filter = 0;
+  uint8_t fixed_point = 0;
+  uint8_t hugepages = 0;
+  arena_t arena;
+  int64_t num_shards = -1;
+  uint32_t warmup_s = ECG_SHARD_WARMUP_S;
+  ecg_shard_stats_t shard_stats;
+  preprocess_stage_t stages[PREPROCESS_MAX_STAGES];
+  uint8_t num_stages = 0;
+  char path[512];
+  int opt;
+  uint16_t i = 0;
+
+  while ((opt = getopt(argc, argv, "r:i:F:n:s:G:t:zp:XBS:W:o:aHMQ:Lvh")) != -1) {
+    switch (opt) {
+      case 'r':
+        hea_path = optarg;
+        break;
+      case 'i':
+        raw_path = optarg;
+        break;
+      case 'F':
+        raw_format = (strcmp(optarg, "f32") == 0) ? ECG_RECORD_FORMAT_F32 : ECG_RECORD_FORMAT_16;
+        break;
+      case 'n':
+        raw_signals = (uint16_t)strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        raw_freq = (uint16_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'G':
+        raw_gain = strtof(optarg, NULL);
+        break;
+      case 't':
+        num_threads = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'z':
+        zero_phase = 1;
+        break;
+      case 'p':
+        if (!preprocess_parse(optarg, stages, &num_stages)) {
+          fprintf(stderr, "invalid stage list %s\n", optarg);
+          return 1;
+        }
+        break;
+      case 'X':
+        fixed_point = 1;
+        break;
+      case 'B':
+        restart_filter = 1;
+        break;
+      case 'S':
+        num_shards = (int64_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'W':
+        warmup_s = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'o':
+        out_prefix = optarg;
+        break;
+      case 'a':
+        export_atr = 1;
+        break;
+      case 'H':
+        with_hrv = 1;
+        break;
+      case 'M':
+        with_morph = 1;
+        break;
+      case 'Q':
+        min_sqi = (uint8_t)MIN(strtoul(optarg, NULL, 0), 100ul);
+        break;
+      case 'L':
+        hugepages = 1;
+        break;
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+  if (!hea_path == !raw_path || (zero_phase && (num_stages > 0 || num_shards >= 0)) ||
+      (fixed_point && (zero_phase || num_stages > 0))) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  ecg_record_t record;
+  uint8_t opened = hea_path ? ecg_record_open_wfdb(&record, hea_path)
+                            : ecg_record_open_raw(&record, raw_path, raw_format, raw_signals, raw_freq, raw_gain);
+  if (!opened) {
+    fprintf(stderr, "failed to open %s\n", hea_path ? hea_path : raw_path);
+    return 1;
+  }
+  if (record.sample_freq == 0 || record.sample_freq > ECG_MAX_SAMPLE_FREQ) {
+    fprintf(stderr, "record is %u Hz, the channels run at up to %d Hz\n", record.sample_freq, ECG_MAX_SAMPLE_FREQ);
+    ecg_record_close(&record);
+    return 1;
+  }
+  if (fixed_point && record.format == ECG_RECORD_FORMAT_F32) {
+    fprintf(stderr, "the fixed-point path needs ADC samples, not f32\n");
+    ecg_record_close(&record);
+    return 1;
+  }
+
+  thread_pool_t* pool = thread_pool_create(num_threads);
+  ecg_channel_t* channels = NULL;
+  if (arena_create(&arena, ecg_channel_footprint(record.num_signals, (uint16_t)record.sample_freq), hugepages)) {
+    channels = ecg_channels_create(&arena, record.num_signals, (uint16_t)record.sample_freq);
+    arena_seal(&arena);
+  }
+  sinks_t sinks = { { NULL }, NULL, NULL };
+  if (with_hrv) {
+    sinks.hrv = (signal_hrv_t*)calloc(record.num_signals, sizeof(signal_hrv_t));
+  }
+  if (with_morph) {
+    sinks.morph = (signal_morph_t*)calloc(record.num_signals, sizeof(signal_morph_t));
+  }
+  if (!pool || !channels || (with_hrv && !sinks.hrv) || (with_morph && !sinks.morph)) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  for (i = 0; i < record.num_signals; i++) {
+    if (num_stages > 0 && !ecg_channel_set_preprocess(&channels[i], stages, num_stages)) {
+      fprintf(stderr,
+              "the stage chain does not fit %u Hz - a corner at or above %u Hz, a filter stage after a feature "
+              "stage, two integrators or more than %d sections\n",
+              record.sample_freq, record.sample_freq / 2, PREPROCESS_MAX_SECTIONS);
+      return 1;
+    }
+    if (fixed_point && !ecg_channel_set_q15(&channels[i], record.scale[i])) {
+      fprintf(stderr, "the baseline filter of %u Hz does not fit the fixed-point cascade\n", record.sample_freq);
+      return 1;
+    }
+    ecg_channel_set_filter_restart(&channels[i], restart_filter);
+    ecg_channel_set_morphology(&channels[i], with_morph);
+    ecg_channel_set_sqi(&channels[i], min_sqi);
+    if (out_prefix) {
+      snprintf(path, sizeof(path), "%s_%u.ecgb", out_prefix, i);
+      sinks.writers[i] = beat_writer_open(path, record.sample_freq);
+      if (!sinks.writers[i]) {
+        fprintf(stderr, "failed to create %s\n", path);
+        return 1;
+      }
+    }
+    if (with_hrv) {
+      hrv_init(&sinks.hrv[i].hrv, (uint16_t)record.sample_freq, HRV_WINDOW_S);
+    }
+  }
+  ecg_wave_result_fn sink = (out_prefix || with_hrv || with_morph) ? on_beat : NULL;
+
+  uint64_t start_ns = osal_time_ns();
+  if (zero_phase) {
+    /* every channel runs at the record rate - the filter of the first one is the filter of all */
+    zero_phase_t zp;
+    if (!zero_phase_init(&zp, channels[0].filter_rate.num, channels[0].filter_rate.den, BASELINE_STATE_STAGES,
+                         0.0f) ||
+        !ecg_batch_run_record_zero_phase(pool, channels, &record, &zp, sink, &sinks)) {
+      fprintf(stderr, "zero-phase filtering failed\n");
+      return 1;
+    }
+  } else if (num_shards >= 0) {
+    /* 0 shards - as many shards of every signal as the pool has threads */
+    uint32_t shards = num_shards ? (uint32_t)num_shards : thread_pool_size(pool);
+    if (!ecg_batch_run_record_sharded(pool, channels, &record, shards, (uint64_t)warmup_s * record.sample_freq,
+                                      sink, &sinks, &shard_stats)) {
+      fprintf(stderr, "sharded run failed\n");
+      return 1;
+    }
+  } else {
+    ecg_batch_run_record(pool, channels, &record, sink, &sinks);
+  }
+  for (i = 0; i < record.num_signals && out_prefix; i++) {
+    if (!beat_writer_close(sinks.writers[i])) {
+      fprintf(stderr, "failed to write the beats of signal %u\n", i);
+      return 1;
+    }
+  }
+  double elapsed_s = (double)(osal_time_ns() - start_ns) / 1e9;
+
+  /* annotation export reads the beat files back */
+  for (i = 0; i < record.num_signals && out_prefix && export_atr; i++) {
+    beat_reader_t reader;
+    snprintf(path, sizeof(path), "%s_%u.ecgb", out_prefix, i);
+    uint8_t opened_beats = beat_reader_open(&reader, path);
+    snprintf(path, sizeof(path), "%s_%u.atr", out_prefix, i);
+    if (!opened_beats || beat_reader_export_atr(&reader, i, path) < 0) {
+      fprintf(stderr, "failed to export %s\n", path);
+      return 1;
+    }
+    beat_reader_close(&reader);
+  }
+
+  uint64_t detected = 0;
+  uint64_t accepted = 0;
+  for (i = 0; i < record.num_signals; i++) {
+    detected += channels[i].stats.waves_detected;
+    accepted += channels[i].stats.waves_accepted;
+    if (verbose) {
+      printf("signal %u: waves=%u accepted=%u dropped=%u late=%u\n", i, channels[i].stats.waves_detected,
+             channels[i].stats.waves_accepted, channels[i].stats.beats_dropped, channels[i].stats.beats_late);
+    }
+    if (with_hrv) {
+      print_hrv(i, &sinks.hrv[i]);
+    }
+    if (with_morph) {
+      print_morph(i, &sinks.morph[i], &channels[i]);
+    }
+    if (min_sqi > 0) {
+      printf("signal %u: sqi blocks=%u unusable=%u skipped=%u\n", i, channels[i].stats.blocks_scored,
+             channels[i].stats.blocks_unusable, channels[i].stats.beats_skipped);
+    }
+  }
+
+  if (num_shards >= 0) {
+    printf("shards=%u seams exact=%u rerun=%u\n", shard_stats.num_shards, shard_stats.seams_exact,
+           shard_stats.seams_rerun);
+  }
+
+  double total_samples = (double)record.num_frames * record.num_signals;
+  double signal_s = (double)record.num_frames / record.sample_freq;
+  printf("signals=%u frames=%llu (%.2f h) threads=%u time=%.3f s rate=%.2f Msamples/s (%.0fx real-time) "
+         "waves=%llu accepted=%llu\n",
+         record.num_signals, (unsigned long long)record.num_frames, signal_s / 3600.0, thread_pool_size(pool),
+         elapsed_s, total_samples / elapsed_s / 1e6, signal_s / elapsed_s, (unsigned long long)detected,
+         (unsigned long long)accepted);
+
+  free(sinks.hrv);
+  free(sinks.morph);
+  arena_destroy(&arena);
+  thread_pool_destroy(pool);
+  ecg_record_close(&record);
+  return 0;
+}
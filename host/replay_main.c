@@ -0,0 +1,505 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* user headers */
+#include "config/config.h"
+#include "osal/osal.h"
+#include "channel/ecg_channel.h"
+#include "batch/ecg_batch.h"
+#include "filters/biquad_bank.h"
+#include "filters/ecg_filters.h"
+#include "filters/preprocess.h"
+#include "filters/zero_phase.h"
+#include "io/ecg_record.h"
+#include "io/beat_file.h"
+#include "io/wfdb_annotation.h"
+#include "eval/beat_match.h"
+#include "sched/thread_pool.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define FNV_OFFSET 0xcbf29ce484222325ull  /* FNV-1a 64 */
+#define FNV_PRIME  0x100000001b3ull
+#define NO_DIFF    UINT64_MAX             /* no record differs */
+
+/* se and ppv a fixed-point run needs against the float golden files, in % - it is not bit-exact */
+#define FIXED_POINT_MIN_AGREEMENT 98.0
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* pipeline options, the same for every record */
+typedef struct {
+  uint8_t zero_phase;
+  preprocess_stage_t stages[PREPROCESS_MAX_STAGES];
+  uint8_t num_stages;
+  int64_t num_shards;           /* -1 unsharded */
+  uint32_t warmup_s;
+  uint8_t with_morph;
+  biquad_isa_t isa;             /* morphology kernel */
+  uint8_t min_sqi;
+  uint8_t fixed_point;          /* int16 baseline filter and delineation */
+} pipeline_t;
+
+/* scoring and golden file options */
+typedef struct {
+  const char* ann_ext;          /* reference annotator */
+  uint32_t window_ms;
+  uint32_t learn_s;
+  uint8_t accepted_only;
+  const char* out_dir;          /* golden beat files to write */
+  const char* golden_dir;       /* golden beat files to compare with */
+} replay_t;
+
+/* state of one signal - its waves are delivered by one pool thread at a time */
+typedef struct {
+  beat_match_t match;
+  uint64_t num_beats;           /* waves delivered */
+  uint64_t digest;              /* FNV-1a 64 of the encoded records */
+  beat_writer_t* writer;        /* NULL without -o */
+  beat_reader_t golden;         /* mapped golden file, golden.map is NULL without -g */
+  uint64_t num_diff;            /* records that differ from the golden file */
+  uint64_t first_diff;          /* first of them, NO_DIFF if none */
+  uint32_t diff_byte;           /* first differing byte of that record */
+  uint64_t diff_sample;         /* R sample of that record in this run */
+  wfdb_ann_t* golden_beats;     /* R peaks of the golden file, fixed-point runs only */
+  beat_match_t golden_match;    /* the beats of a fixed-point run against them */
+} signal_replay_t;
+
+typedef struct {
+  const replay_t* replay;
+  signal_replay_t* signals;
+} sinks_t;
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void on_beat(void* user, const ecg_wave_result_t* result)
+{
+  sinks_t* sinks = (sinks_t*)user;
+  signal_replay_t* sig = &sinks->signals[result->channel_id];
+  uint8_t record[BEAT_FILE_RECORD_SIZE];
+  uint32_t i = 0;
+
+  /* the golden files hold every wave, the score may only count the accepted ones */
+  beat_file_encode(record, result);
+  for (i = 0; i < BEAT_FILE_RECORD_SIZE; i++) {
+    sig->digest = (sig->digest ^ record[i]) * FNV_PRIME;
+  }
+  if (sig->writer) {
+    beat_writer_write(sig->writer, result);
+  }
+  if (sig->golden_beats) {
+    beat_match_add(&sig->golden_match, result->r_sample);
+  } else if (sig->golden.map) {
+    uint8_t differs = sig->num_beats >= sig->golden.num_records;
+    for (i = 0; i < BEAT_FILE_RECORD_SIZE && !differs; i++) {
+      differs = record[i] != sig->golden.records[sig->num_beats * BEAT_FILE_RECORD_SIZE + i];
+    }
+    if (differs && sig->num_diff++ == 0) {
+      sig->first_diff = sig->num_beats;
+      sig->diff_byte = (sig->num_beats < sig->golden.num_records) ? i - 1 : 0;
+      sig->diff_sample = result->r_sample;
+    }
+  }
+  if (!sinks->replay->accepted_only || result->quality >= MIN_WAVE_QUALITY) {
+    beat_match_add(&sig->match, result->r_sample);
+  }
+  sig->num_beats++;
+}
+
+/* header path without the .hea extension, and the record name without the directory */
+static void record_base(const char* hea_path, char* base, size_t size, const char** name)
+{
+  snprintf(base, size, "%s", hea_path);
+  char* ext = strrchr(base, '.');
+  if (ext && strcmp(ext, ".hea") == 0) {
+    *ext = '\0';
+  }
+  *name = strrchr(base, '/');
+  *name = *name ? *name + 1 : base;
+}
+
+static void print_counts(const char* label, const beat_match_counts_t* counts)
+{
+  beat_match_stats_t stats;
+  char se_v[16];
+
+  /* a reference without ventricular beats has no se_v, not a perfect one */
+  beat_match_get_stats(counts, &stats);
+  if (counts->ref_v > 0) {
+    snprintf(se_v, sizeof(se_v), "%.2f%%", stats.se_v);
+  } else {
+    snprintf(se_v, sizeof(se_v), "n/a");
+  }
+  printf("%s tp=%llu fn=%llu fp=%llu se=%.2f%% ppv=%.2f%% se_v=%s (%llu) r_err=%+.1f/%.1f/%.1f ms "
+         "rr_err=%+.1f/%.1f ms\n",
+         label, (unsigned long long)counts->tp, (unsigned long long)counts->fn, (unsigned long long)counts->fp,
+         stats.se, stats.ppv, se_v, (unsigned long long)counts->ref_v, stats.r_err_mean, stats.r_err_rms,
+         stats.r_err_max, stats.rr_err_mean, stats.rr_err_rms);
+}
+
+/* replays one record, adds its counts to total - returns 0 on an error, sets *diff on a golden file mismatch */
+static uint8_t replay_record(thread_pool_t* pool, const char* hea_path, const pipeline_t* pipe,
+                             const replay_t* replay, beat_match_counts_t* total, uint8_t* diff)
+{
+  ecg_record_t record;
+  wfdb_annotations_t ref;
+  ecg_shard_stats_t shard_stats;
+  beat_match_counts_t counts;
+  char base[512];
+  const char* name = NULL;
+  char path[600];
+  uint8_t ok = 1;
+  uint16_t i = 0;
+
+  record_base(hea_path, base, sizeof(base), &name);
+  if (!ecg_record_open_wfdb(&record, hea_path)) {
+    fprintf(stderr, "failed to open %s\n", hea_path);
+    return 0;
+  }
+  if (record.sample_freq == 0 || record.sample_freq > ECG_MAX_SAMPLE_FREQ) {
+    fprintf(stderr, "%s is %u Hz, the channels run at up to %d Hz\n", name, record.sample_freq, ECG_MAX_SAMPLE_FREQ);
+    ecg_record_close(&record);
+    return 0;
+  }
+
+  /* the reference annotator sits next to the header */
+  snprintf(path, sizeof(path), "%s.%s", base, replay->ann_ext);
+  if (!wfdb_annotations_read(&ref, path)) {
+    fprintf(stderr, "failed to read the reference annotations %s\n", path);
+    ecg_record_close(&record);
+    return 0;
+  }
+
+  arena_t arena;
+  ecg_channel_t* channels = NULL;
+  if (arena_create(&arena, ecg_channel_footprint(record.num_signals, record.sample_freq), 0)) {
+    channels = ecg_channels_create(&arena, record.num_signals, record.sample_freq);
+    arena_seal(&arena);
+  }
+  signal_replay_t* signals = (signal_replay_t*)calloc(record.num_signals, sizeof(signal_replay_t));
+  sinks_t sinks = { replay, signals };
+  if (!channels || !signals) {
+    fprintf(stderr, "out of memory\n");
+    ok = 0;
+  }
+  for (i = 0; i < record.num_signals && ok; i++) {
+    signal_replay_t* sig = &signals[i];
+
+    if (pipe->num_stages > 0 && !ecg_channel_set_preprocess(&channels[i], pipe->stages, pipe->num_stages)) {
+      fprintf(stderr,
+              "the stage chain does not fit %u Hz - a corner at or above %u Hz, a filter stage after a feature "
+              "stage, two integrators or more than %d sections\n",
+              record.sample_freq, record.sample_freq / 2, PREPROCESS_MAX_SECTIONS);
+      ok = 0;
+      break;
+    }
+    if (pipe->fixed_point && !ecg_channel_set_q15(&channels[i], record.scale[i])) {
+      fprintf(stderr, "the baseline filter of %u Hz does not fit the fixed-point cascade\n", record.sample_freq);
+      ok = 0;
+      break;
+    }
+    ecg_channel_set_morphology(&channels[i], pipe->with_morph);
+    morph_select_isa(&channels[i].morph, pipe->isa);
+    ecg_channel_set_sqi(&channels[i], pipe->min_sqi);
+
+    /* the reference labels the record, every signal is scored against it */
+    beat_match_init(&sig->match, ref.items, ref.count, record.sample_freq, replay->window_ms,
+                    (uint64_t)replay->learn_s * record.sample_freq);
+    sig->digest = FNV_OFFSET;
+    sig->first_diff = NO_DIFF;
+    if (replay->out_dir) {
+      snprintf(path, sizeof(path), "%s/%s_%u.ecgb", replay->out_dir, name, i);
+      sig->writer = beat_writer_open(path, record.sample_freq);
+      if (!sig->writer) {
+        fprintf(stderr, "failed to create %s\n", path);
+        ok = 0;
+      }
+    }
+    if (replay->golden_dir && ok) {
+      snprintf(path, sizeof(path), "%s/%s_%u.ecgb", replay->golden_dir, name, i);
+      if (!beat_reader_open(&sig->golden, path)) {
+        fprintf(stderr, "failed to open the golden file %s\n", path);
+        ok = 0;
+      }
+    }
+
+    /* a fixed-point run is matched against the R peaks of the float golden file instead of bit for bit */
+    if (pipe->fixed_point && sig->golden.map) {
+      beat_record_t golden;
+      uint64_t n = 0;
+      sig->golden_beats = (wfdb_ann_t*)calloc(sig->golden.num_records + 1, sizeof(wfdb_ann_t));
+      if (!sig->golden_beats) {
+        fprintf(stderr, "out of memory\n");
+        ok = 0;
+        continue;
+      }
+      for (n = 0; n < sig->golden.num_records; n++) {
+        beat_reader_get(&sig->golden, n, &golden);
+        sig->golden_beats[n].sample = golden.r_sample;
+        sig->golden_beats[n].type = WFDB_ANN_NORMAL;
+      }
+      beat_match_init(&sig->golden_match, sig->golden_beats, sig->golden.num_records, record.sample_freq,
+                      replay->window_ms, 0);
+    }
+  }
+
+  uint64_t start_ns = osal_time_ns();
+  if (!ok) {
+    /* nothing to run */
+  } else if (pipe->zero_phase) {
+    /* every channel runs at the record rate - the filter of the first one is the filter of all */
+    zero_phase_t zp;
+    ok = zero_phase_init(&zp, channels[0].filter_rate.num, channels[0].filter_rate.den, BASELINE_STATE_STAGES, 0.0f) &&
+         ecg_batch_run_record_zero_phase(pool, channels, &record, &zp, on_beat, &sinks);
+    if (!ok) {
+      fprintf(stderr, "zero-phase filtering failed\n");
+    }
+  } else if (pipe->num_shards >= 0) {
+    uint32_t shards = pipe->num_shards ? (uint32_t)pipe->num_shards : thread_pool_size(pool);
+    ok = ecg_batch_run_record_sharded(pool, channels, &record, shards, (uint64_t)pipe->warmup_s * record.sample_freq,
+                                      on_beat, &sinks, &shard_stats);
+    if (!ok) {
+      fprintf(stderr, "sharded run failed\n");
+    }
+  } else {
+    ecg_batch_run_record(pool, channels, &record, on_beat, &sinks);
+  }
+  double elapsed_s = (double)(osal_time_ns() - start_ns) / 1e9;
+
+  if (ok) {
+    double signal_s = (double)record.num_frames / record.sample_freq;
+    printf("record %s: signals=%u %.2f h at %u Hz, %llu reference annotations, time=%.3f s (%.0fx real-time)\n", name,
+           record.num_signals, signal_s / 3600.0, record.sample_freq, (unsigned long long)ref.count, elapsed_s,
+           signal_s * record.num_signals / elapsed_s);
+    if (pipe->num_shards >= 0) {
+      printf("  shards=%u seams exact=%u rerun=%u\n", shard_stats.num_shards, shard_stats.seams_exact,
+             shard_stats.seams_rerun);
+    }
+  }
+  memset(&counts, 0, sizeof(counts));
+  for (i = 0; i < record.num_signals && signals; i++) {
+    signal_replay_t* sig = &signals[i];
+    char label[64];
+
+    if (ok) {
+      beat_match_finish(&sig->match);
+      beat_match_merge(&counts, &sig->match.counts);
+      snprintf(label, sizeof(label), "  signal %u: beats=%llu", i, (unsigned long long)sig->num_beats);
+      print_counts(label, &sig->match.counts);
+      printf("  signal %u: digest=%016llx\n", i, (unsigned long long)sig->digest);
+    }
+    if (sig->golden_beats) {
+      beat_match_stats_t stats;
+      beat_match_finish(&sig->golden_match);
+      beat_match_get_stats(&sig->golden_match.counts, &stats);
+      if (ok) {
+        snprintf(label, sizeof(label), "  signal %u: fixed point vs golden", i);
+        print_counts(label, &sig->golden_match.counts);
+        *diff |= stats.se < FIXED_POINT_MIN_AGREEMENT || stats.ppv < FIXED_POINT_MIN_AGREEMENT;
+      }
+      free(sig->golden_beats);
+      beat_reader_close(&sig->golden);
+    } else if (sig->golden.map) {
+      /* golden records the run did not reach differ too */
+      if (ok && sig->golden.num_records > sig->num_beats) {
+        if (sig->num_diff == 0) {
+          sig->first_diff = sig->num_beats;
+        }
+        sig->num_diff += sig->golden.num_records - sig->num_beats;
+      }
+      if (ok && sig->num_diff > 0) {
+        printf("  signal %u: DIFF %llu records (%llu run, %llu golden), first at record %llu",
+               i, (unsigned long long)sig->num_diff, (unsigned long long)sig->num_beats,
+               (unsigned long long)sig->golden.num_records, (unsigned long long)sig->first_diff);
+        if (sig->first_diff < MIN(sig->num_beats, sig->golden.num_records)) {
+          printf(" byte %u (r_sample %llu)", sig->diff_byte, (unsigned long long)sig->diff_sample);
+        }
+        printf("\n");
+        *diff = 1;
+      }
+      beat_reader_close(&sig->golden);
+    }
+    if (sig->writer && !beat_writer_close(sig->writer)) {
+      fprintf(stderr, "failed to write the beats of %s signal %u\n", name, i);
+      ok = 0;
+    }
+  }
+  if (ok) {
+    print_counts("  record:", &counts);
+    beat_match_merge(total, &counts);
+  }
+
+  free(signals);
+  arena_destroy(&arena);
+  wfdb_annotations_free(&ref);
+  ecg_record_close(&record);
+  return ok;
+}
+
+static uint8_t parse_isa(const char* text, biquad_isa_t* isa)
+{
+  static const biquad_isa_t isas[] = { BIQUAD_ISA_AUTO, BIQUAD_ISA_SCALAR, BIQUAD_ISA_SSE, BIQUAD_ISA_AVX2,
+                                       BIQUAD_ISA_NEON };
+  uint32_t i = 0;
+
+  for (; i < sizeof(isas) / sizeof(isas[0]); i++) {
+    if (strcmp(text, biquad_isa_name(isas[i])) == 0) {
+      *isa = isas[i];
+      return isas[i] == BIQUAD_ISA_AUTO || biquad_isa_supported(isas[i]);
+    }
+  }
+  return 0;
+}
+
+static void usage(const char* prog)
+{
+  fprintf(stderr,
+          "usage: %s [-a ext] [-w ms] [-l s] [-q] [-t threads] [-z | -p stages | -X] [-S shards [-W s]] [-M [-I isa]] [-Q min] [-o dir] [-g dir] [-m se,ppv] record.hea ...\n"
+          "  -a ext         reference annotator next to every header (default atr)\n"
+          "  -w ms          match window (default %d)\n"
+          "  -l s           learning period at the start of every record that is not scored (default 300)\n"
+          "  -q             score the accepted waves only (quality >= %d)\n"
+          "  -t threads     number of threads, 0 uses every core (default 0)\n"
+          "  -z             zero-phase (forward-backward) baseline filter\n"
+          "  -p stages      preprocessing chain instead of the baseline filter, e.g. hp,notch:50,lp:40,diff,sq,mwi:150\n"
+          "  -X             fixed-point (int16) baseline filter and delineation, -g matches the beats within the\n"
+          "                 window and needs %.0f%% se and ppv\n"
+          "  -S shards      split every signal into time shards run in parallel, 0 for one per thread\n"
+          "  -W s           warm-up in front of every shard in s (default %d)\n"
+          "  -M             classify every beat by its shape\n"
+          "  -I isa         morphology kernel: auto, scalar, sse, avx2 or neon (default auto)\n"
+          "  -Q min         skip the beats of blocks with a signal quality below min\n"
+          "  -o dir         write the beats of every signal as golden files dir/record_N.ecgb\n"
+          "  -g dir         compare every beat record bit for bit with the golden files in dir\n"
+          "  -m se,ppv      minimum gross sensitivity and positive predictivity in %% - se_v is reported, not gated\n"
+          "exit status 0 pass, 2 below the minimum or a golden file mismatch, 1 error\n",
+          prog, BEAT_MATCH_WINDOW_MS, MIN_WAVE_QUALITY, FIXED_POINT_MIN_AGREEMENT, ECG_SHARD_WARMUP_S);
+}
+
+/******************************************************************************
+ * MAIN FUNCTION
+ *****************************************************************************/
+int main(int argc, char** argv) {
+  pipeline_t pipe = { 0, { { PREPROCESS_BASELINE, 0.0f } }, 0, -1, ECG_SHARD_WARMUP_S, 0, BIQUAD_ISA_AUTO, 0, 0 };
+  replay_t replay = { "atr", BEAT_MATCH_WINDOW_MS, 300, 0, NULL, NULL };
+  uint32_t num_threads = 0;
+  double min_se = 0.0;
+  double min_ppv = 0.0;
+  beat_match_counts_t total;
+  uint8_t diff = 0;
+  uint8_t ok = 1;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "a:w:l:qt:zp:XS:W:MI:Q:o:g:m:h")) != -1) {
+    switch (opt) {
+      case 'a':
+        replay.ann_ext = optarg;
+        break;
+      case 'w':
+        replay.window_ms = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'l':
+        replay.learn_s = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'q':
+        replay.accepted_only = 1;
+        break;
+      case 't':
+        num_threads = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'z':
+        pipe.zero_phase = 1;
+        break;
+      case 'p':
+        if (!preprocess_parse(optarg, pipe.stages, &pipe.num_stages)) {
+          fprintf(stderr, "invalid stage list %s\n", optarg);
+          return 1;
+        }
+        break;
+      case 'X':
+        pipe.fixed_point = 1;
+        break;
+      case 'S':
+        pipe.num_shards = (int64_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'W':
+        pipe.warmup_s = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'M':
+        pipe.with_morph = 1;
+        break;
+      case 'I':
+        if (!parse_isa(optarg, &pipe.isa)) {
+          fprintf(stderr, "%s is not supported by this CPU or build\n", optarg);
+          return 1;
+        }
+        break;
+      case 'Q':
+        pipe.min_sqi = (uint8_t)MIN(strtoul(optarg, NULL, 0), 100ul);
+        break;
+      case 'o':
+        replay.out_dir = optarg;
+        break;
+      case 'g':
+        replay.golden_dir = optarg;
+        break;
+      case 'm':
+        if (sscanf(optarg, "%lf,%lf", &min_se, &min_ppv) != 2) {
+          fprintf(stderr, "invalid minimum %s\n", optarg);
+          return 1;
+        }
+        break;
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+  if (optind == argc || (pipe.zero_phase && (pipe.num_stages > 0 || pipe.num_shards >= 0)) ||
+      (pipe.fixed_point && (pipe.zero_phase || pipe.num_stages > 0))) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  thread_pool_t* pool = thread_pool_create(num_threads);
+  if (!pool) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  memset(&total, 0, sizeof(total));
+  for (; optind < argc && ok; optind++) {
+    ok = replay_record(pool, argv[optind], &pipe, &replay, &total, &diff);
+  }
+  thread_pool_destroy(pool);
+  if (!ok) {
+    return 1;
+  }
+
+  /* gross statistics - every beat of every record weighs the same */
+  beat_match_stats_t stats;
+  beat_match_get_stats(&total, &stats);
+  print_counts("gross:", &total);
+
+  /* se and ppv only - se_v has no value for a reference without ventricular beats */
+  if (stats.se < min_se || stats.ppv < min_ppv) {
+    printf("FAIL: se %.2f%% ppv %.2f%%, minimum %.2f%% %.2f%%\n", stats.se, stats.ppv, min_se, min_ppv);
+    return 2;
+  }
+  if (diff) {
+    printf("FAIL: beat records differ from the golden files\n");
+    return 2;
+  }
+  printf("PASS\n");
+  return 0;
+}
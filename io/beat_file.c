@@ -0,0 +1,381 @@
+#include "beat_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osal/osal.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define WRITER_BUFFER_RECORDS 1024  /* records per write call (120 KB) */
+#define INDEX_ENTRY_SIZE      16    /* r_sample u64 + record number u64 */
+
+/* WFDB annotation codes (ecgcodes.h) */
+#define ATR_NORMAL  1               /* normal beat */
+#define ATR_UNKNOWN 13              /* unclassifiable beat (Q) */
+#define ATR_SKIP    59              /* the next 4 bytes hold a long interval */
+#define ATR_MAX_INTERVAL 1023       /* 10 bit interval field */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+struct beat_writer {
+  FILE* file;
+  uint32_t sample_freq;
+  uint32_t index_interval;      /* samples per index entry */
+  uint64_t num_records;         /* records written so far */
+  uint8_t* buffer;              /* WRITER_BUFFER_RECORDS records */
+  uint32_t buffered;            /* records in buffer */
+  uint64_t* index;              /* r_sample, record number pairs */
+  uint64_t index_count;
+  uint64_t index_capacity;
+  uint8_t failed;               /* a write failed */
+};
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* little-endian encoding - independent of the host byte order and struct padding */
+static void put_u16(uint8_t* p, uint16_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t v)
+{
+  put_u16(p, (uint16_t)v);
+  put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void put_u64(uint8_t* p, uint64_t v)
+{
+  put_u32(p, (uint32_t)v);
+  put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static void put_f32(uint8_t* p, float v)
+{
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  put_u32(p, bits);
+}
+
+static uint16_t get_u16(const uint8_t* p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+  return (uint32_t)get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static uint64_t get_u64(const uint8_t* p)
+{
+  return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static float get_f32(const uint8_t* p)
+{
+  uint32_t bits = get_u32(p);
+  float v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+static void decode_record(const uint8_t* p, beat_record_t* record)
+{
+  wave_points_t* points = &record->points;
+  wave_intervals_t* intervals = &record->intervals;
+
+  record->r_sample = get_u64(p + 0);
+  record->channel_id = get_u32(p + 8);
+  record->wave = get_u32(p + 12);
+  points->p_idx = get_u64(p + 16);
+  points->q_idx = get_u64(p + 24);
+  points->r_idx = get_u64(p + 32);
+  points->s_idx = get_u64(p + 40);
+  points->t_idx = get_u64(p + 48);
+  points->prev_p_idx = get_u64(p + 56);
+  points->prev_r_idx = get_u64(p + 64);
+  points->p_val = get_f32(p + 72);
+  points->q_val = get_f32(p + 76);
+  points->r_val = get_f32(p + 80);
+  points->s_val = get_f32(p + 84);
+  points->t_val = get_f32(p + 88);
+  intervals->pr_interval = get_f32(p + 92);
+  intervals->qrs_duration = get_f32(p + 96);
+  intervals->qt_interval = get_f32(p + 100);
+  intervals->rr_interval = get_f32(p + 104);
+  intervals->pp_interval = get_f32(p + 108);
+  record->heart_rate = get_f32(p + 112);
+  record->quality = p[116];
+  record->beat_class = p[117];
+  record->cluster = p[118];
+  record->sqi = p[119] ? (uint8_t)(p[119] - 1) : SQI_NONE;
+}
+
+static void writer_flush(beat_writer_t* writer)
+{
+  size_t bytes = (size_t)writer->buffered * BEAT_FILE_RECORD_SIZE;
+  if (bytes && fwrite(writer->buffer, 1, bytes, writer->file) != bytes) {
+    writer->failed = 1;
+  }
+  writer->buffered = 0;
+}
+
+/* adds an index entry, the array doubles when full */
+static void writer_index(beat_writer_t* writer, uint64_t r_sample)
+{
+  if (writer->index_count == writer->index_capacity) {
+    uint64_t capacity = writer->index_capacity ? writer->index_capacity * 2 : 256;
+    uint64_t* index = (uint64_t*)realloc(writer->index, (size_t)capacity * 2 * sizeof(uint64_t));
+    if (!index) {
+      writer->failed = 1;
+      return;
+    }
+    writer->index = index;
+    writer->index_capacity = capacity;
+  }
+  writer->index[writer->index_count * 2] = r_sample;
+  writer->index[writer->index_count * 2 + 1] = writer->num_records;
+  writer->index_count++;
+}
+
+/* writes a 16 bit annotation word, low byte first */
+static uint8_t atr_put_word(FILE* file, uint16_t word)
+{
+  uint8_t bytes[2];
+  put_u16(bytes, word);
+  return fwrite(bytes, 1, 2, file) == 2;
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+void beat_file_encode(uint8_t* p, const ecg_wave_result_t* result)
+{
+  const wave_points_t* points = &result->points;
+  const wave_intervals_t* intervals = &result->intervals;
+
+  put_u64(p + 0, result->r_sample);
+  put_u32(p + 8, result->channel_id);
+  put_u32(p + 12, result->wave);
+  put_u64(p + 16, points->p_idx);
+  put_u64(p + 24, points->q_idx);
+  put_u64(p + 32, points->r_idx);
+  put_u64(p + 40, points->s_idx);
+  put_u64(p + 48, points->t_idx);
+  put_u64(p + 56, points->prev_p_idx);
+  put_u64(p + 64, points->prev_r_idx);
+  put_f32(p + 72, points->p_val);
+  put_f32(p + 76, points->q_val);
+  put_f32(p + 80, points->r_val);
+  put_f32(p + 84, points->s_val);
+  put_f32(p + 88, points->t_val);
+  put_f32(p + 92, intervals->pr_interval);
+  put_f32(p + 96, intervals->qrs_duration);
+  put_f32(p + 100, intervals->qt_interval);
+  put_f32(p + 104, intervals->rr_interval);
+  put_f32(p + 108, intervals->pp_interval);
+  put_f32(p + 112, ecg_calculate_heart_rate(intervals));
+  p[116] = result->quality;
+  p[117] = result->morph.beat_class;
+  p[118] = result->morph.cluster;
+  p[119] = (result->sqi == SQI_NONE) ? 0 : (uint8_t)(result->sqi + 1);  /* 0 in files written without SQI */
+}
+
+beat_writer_t* beat_writer_open(const char* path, uint32_t sample_freq)
+{
+  uint8_t header[BEAT_FILE_HEADER_SIZE];
+
+  beat_writer_t* writer = (beat_writer_t*)calloc(1, sizeof(*writer));
+  if (!writer) {
+    return NULL;
+  }
+  writer->buffer = (uint8_t*)malloc(WRITER_BUFFER_RECORDS * BEAT_FILE_RECORD_SIZE);
+  writer->file = fopen(path, "wb");
+  if (!writer->buffer || !writer->file) {
+    if (writer->file) {
+      fclose(writer->file);
+    }
+    free(writer->buffer);
+    free(writer);
+    return NULL;
+  }
+  writer->sample_freq = sample_freq;
+  writer->index_interval = MAX(1u, sample_freq * BEAT_FILE_INDEX_SECONDS);
+
+  memset(header, 0, sizeof(header));
+  memcpy(header, "ECGB", 4);
+  put_u16(header + 4, BEAT_FILE_VERSION);
+  put_u16(header + 6, BEAT_FILE_RECORD_SIZE);
+  put_u32(header + 8, writer->sample_freq);
+  put_u32(header + 12, writer->index_interval);
+  if (fwrite(header, 1, sizeof(header), writer->file) != sizeof(header)) {
+    writer->failed = 1;
+  }
+  return writer;
+}
+
+uint8_t beat_writer_write(beat_writer_t* writer, const ecg_wave_result_t* result)
+{
+  /* first record of a new index interval */
+  uint64_t slot = result->r_sample / writer->index_interval;
+  if (writer->index_count == 0 || slot > writer->index[(writer->index_count - 1) * 2] / writer->index_interval) {
+    writer_index(writer, result->r_sample);
+  }
+
+  beat_file_encode(&writer->buffer[(size_t)writer->buffered * BEAT_FILE_RECORD_SIZE], result);
+  writer->num_records++;
+  if (++writer->buffered == WRITER_BUFFER_RECORDS) {
+    writer_flush(writer);
+  }
+  return !writer->failed;
+}
+
+uint8_t beat_writer_close(beat_writer_t* writer)
+{
+  uint8_t entry[INDEX_ENTRY_SIZE];
+  uint8_t footer[BEAT_FILE_FOOTER_SIZE];
+  uint64_t i = 0;
+
+  writer_flush(writer);
+
+  /* index and footer behind the records */
+  for (i = 0; i < writer->index_count && !writer->failed; i++) {
+    put_u64(entry, writer->index[i * 2]);
+    put_u64(entry + 8, writer->index[i * 2 + 1]);
+    writer->failed |= (fwrite(entry, 1, sizeof(entry), writer->file) != sizeof(entry));
+  }
+  memset(footer, 0, sizeof(footer));
+  put_u64(footer, BEAT_FILE_HEADER_SIZE + writer->num_records * BEAT_FILE_RECORD_SIZE);
+  put_u64(footer + 8, writer->index_count);
+  memcpy(footer + 16, "ECGI", 4);
+  writer->failed |= (fwrite(footer, 1, sizeof(footer), writer->file) != sizeof(footer));
+  writer->failed |= (fclose(writer->file) != 0);
+
+  uint8_t ok = !writer->failed;
+  free(writer->index);
+  free(writer->buffer);
+  free(writer);
+  return ok;
+}
+
+uint8_t beat_reader_open(beat_reader_t* reader, const char* path)
+{
+  memset(reader, 0, sizeof(*reader));
+  reader->map = osal_file_map(path, &reader->map_size);
+  if (!reader->map) {
+    return 0;
+  }
+
+  const uint8_t* data = (const uint8_t*)reader->map;
+  if (reader->map_size < BEAT_FILE_HEADER_SIZE || memcmp(data, "ECGB", 4) != 0 ||
+      get_u16(data + 4) != BEAT_FILE_VERSION || get_u16(data + 6) != BEAT_FILE_RECORD_SIZE) {
+    beat_reader_close(reader);
+    return 0;
+  }
+  reader->sample_freq = get_u32(data + 8);
+  reader->index_interval = get_u32(data + 12);
+  reader->records = data + BEAT_FILE_HEADER_SIZE;
+
+  /* closed files end with a footer, the records stop where the index starts */
+  uint64_t records_end = reader->map_size;
+  const uint8_t* footer = data + reader->map_size - BEAT_FILE_FOOTER_SIZE;
+  if (reader->map_size >= BEAT_FILE_HEADER_SIZE + BEAT_FILE_FOOTER_SIZE && memcmp(footer + 16, "ECGI", 4) == 0) {
+    uint64_t index_offset = get_u64(footer);
+    uint64_t index_count = get_u64(footer + 8);
+    if (index_offset >= BEAT_FILE_HEADER_SIZE &&
+        index_offset + index_count * INDEX_ENTRY_SIZE + BEAT_FILE_FOOTER_SIZE == reader->map_size) {
+      records_end = index_offset;
+      reader->index = data + index_offset;
+      reader->index_count = index_count;
+    }
+  }
+  reader->num_records = (records_end - BEAT_FILE_HEADER_SIZE) / BEAT_FILE_RECORD_SIZE;
+  return 1;
+}
+
+void beat_reader_close(beat_reader_t* reader)
+{
+  osal_file_unmap(reader->map, reader->map_size);
+  memset(reader, 0, sizeof(*reader));
+}
+
+void beat_reader_get(const beat_reader_t* reader, uint64_t number, beat_record_t* record)
+{
+  decode_record(reader->records + number * BEAT_FILE_RECORD_SIZE, record);
+}
+
+uint64_t beat_reader_seek(const beat_reader_t* reader, uint64_t sample)
+{
+  uint64_t number = 0;
+
+  if (reader->index_count > 0) {
+    /* last index entry at or before the sample - binary search */
+    uint64_t lo = 0;
+    uint64_t hi = reader->index_count;
+    while (hi - lo > 1) {
+      uint64_t mid = lo + (hi - lo) / 2;
+      if (get_u64(reader->index + mid * INDEX_ENTRY_SIZE) <= sample) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    number = get_u64(reader->index + lo * INDEX_ENTRY_SIZE + 8);
+  }
+
+  /* scan the rest of the interval */
+  while (number < reader->num_records && get_u64(reader->records + number * BEAT_FILE_RECORD_SIZE) < sample) {
+    number++;
+  }
+  return number;
+}
+
+int64_t beat_reader_export_atr(const beat_reader_t* reader, uint32_t channel_id, const char* path)
+{
+  beat_record_t record;
+  uint64_t prev_sample = 0;
+  int64_t count = 0;
+  uint64_t i = 0;
+  uint8_t ok = 1;
+
+  FILE* file = fopen(path, "wb");
+  if (!file) {
+    return -1;
+  }
+
+  /* MIT format: type in the upper 6 bits, samples since the previous annotation in the lower 10 */
+  for (i = 0; i < reader->num_records && ok; i++) {
+    beat_reader_get(reader, i, &record);
+    if (record.channel_id != channel_id || record.r_sample < prev_sample) {
+      continue;
+    }
+
+    uint64_t interval = record.r_sample - prev_sample;
+    uint16_t type = (record.quality >= MIN_WAVE_QUALITY) ? ATR_NORMAL : ATR_UNKNOWN;
+    if (interval > ATR_MAX_INTERVAL) {
+      /* SKIP word followed by the 32 bit interval, high half first */
+      ok = atr_put_word(file, ATR_SKIP << 10) && atr_put_word(file, (uint16_t)(interval >> 16)) &&
+           atr_put_word(file, (uint16_t)interval) && atr_put_word(file, (uint16_t)(type << 10));
+    } else {
+      ok = atr_put_word(file, (uint16_t)((type << 10) | interval));
+    }
+    prev_sample = record.r_sample;
+    count++;
+  }
+
+  /* end of file marker */
+  ok = ok && atr_put_word(file, 0);
+  ok = (fclose(file) == 0) && ok;
+  return ok ? count : -1;
+}
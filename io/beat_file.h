@@ -0,0 +1,156 @@
+#ifndef BEAT_FILE_H
+#define BEAT_FILE_H
+
+#include <stdint.h>
+
+#include "channel/ecg_channel.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define BEAT_FILE_VERSION       2    /* 2: points as absolute u64 samples */
+#define BEAT_FILE_HEADER_SIZE   32   /* bytes in front of the first record */
+#define BEAT_FILE_RECORD_SIZE   120  /* bytes per beat record */
+#define BEAT_FILE_FOOTER_SIZE   24   /* bytes after the index */
+#define BEAT_FILE_INDEX_SECONDS 60   /* one index entry per minute of signal */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/*
+ * file layout, all little-endian:
+ *   header  "ECGB", version u16, record size u16, sample freq u32, index interval u32 (samples), 16 reserved
+ *   records fixed size, in the order they were written
+ *   index   r_sample u64 + record number u64 of the first record of every index interval
+ *   footer  index offset u64, index entries u64, "ECGI", 4 reserved
+ * a file that was not closed has no index and no footer, its records are still readable.
+ */
+
+/* one beat record */
+typedef struct {
+  uint64_t r_sample;            /* absolute sample of the R peak */
+  uint32_t channel_id;          /* channel the beat belongs to */
+  uint32_t wave;                /* beat number inside the channel */
+  wave_points_t points;         /* detected P Q R S T points, absolute samples */
+  wave_intervals_t intervals;   /* calculated intervals */
+  float heart_rate;             /* heart rate in BPM, 0 if not available */
+  uint8_t quality;              /* detection quality (0-100) */
+  uint8_t beat_class;           /* morph_class_t, MORPH_CLASS_NONE in files written without morphology */
+  uint8_t cluster;              /* morphology template of the beat */
+  uint8_t sqi;                  /* signal quality of the block of the beat, SQI_NONE in files written without SQI */
+} beat_record_t;
+
+/* opaque buffered writer */
+typedef struct beat_writer beat_writer_t;
+
+/* memory mapped beat file */
+typedef struct {
+  const uint8_t* records;       /* first record */
+  uint64_t num_records;         /* records in the file */
+  uint32_t sample_freq;         /* sampling frequency of r_sample */
+  uint32_t index_interval;      /* samples per index entry */
+  const uint8_t* index;         /* sparse time index, NULL for unclosed files */
+  uint64_t index_count;         /* index entries */
+  const void* map;              /* whole mapped file */
+  uint64_t map_size;            /* mapped bytes */
+} beat_reader_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Encode a detected wave as a beat record
+ *
+ * the bytes a beat writer stores, e.g. to compare a run with a beat file bit for bit.
+ *
+ * @param p      - BEAT_FILE_RECORD_SIZE bytes
+ * @param result - detected wave
+ */
+void beat_file_encode(uint8_t* p, const ecg_wave_result_t* result);
+
+/*!
+ * @brief Create a beat file
+ *
+ * records are collected in a buffer and written in large blocks. the writer
+ * is not thread safe, one writer per thread or serialized calls.
+ *
+ * @param path        - file to create
+ * @param sample_freq - sampling frequency of the R sample numbers
+ * @return writer or NULL on failure
+ */
+beat_writer_t* beat_writer_open(const char* path, uint32_t sample_freq);
+
+/*!
+ * @brief Append a detected wave
+ *
+ * records are expected in time order, the index points at the first record
+ * of every index interval.
+ *
+ * @param writer - writer handle
+ * @param result - detected wave
+ * @return 1 on success, 0 on a write error
+ */
+uint8_t beat_writer_write(beat_writer_t* writer, const ecg_wave_result_t* result);
+
+/*!
+ * @brief Flush the records, write the index and close the file
+ *
+ * @param writer - writer handle, freed
+ * @return 1 on success, 0 on a write error
+ */
+uint8_t beat_writer_close(beat_writer_t* writer);
+
+/*!
+ * @brief Map a beat file
+ *
+ * @param reader - filled with the reader
+ * @param path   - beat file
+ * @return 1 on success, 0 on failure
+ */
+uint8_t beat_reader_open(beat_reader_t* reader, const char* path);
+
+/*!
+ * @brief Unmap a beat file
+ *
+ * @param reader - reader to close
+ */
+void beat_reader_close(beat_reader_t* reader);
+
+/*!
+ * @brief Decode one record
+ *
+ * @param reader - pointer to the reader
+ * @param number - record number (0 .. num_records - 1)
+ * @param record - filled with the record
+ */
+void beat_reader_get(const beat_reader_t* reader, uint64_t number, beat_record_t* record);
+
+/*!
+ * @brief Find the first record at or after a sample
+ *
+ * the sparse index narrows the search to one index interval, which is then
+ * scanned. files without an index are scanned from the start.
+ *
+ * @param reader - pointer to the reader
+ * @param sample - absolute sample, e.g. 3600 * sample_freq for the second hour
+ * @return record number, num_records if every record is earlier
+ */
+uint64_t beat_reader_seek(const beat_reader_t* reader, uint64_t sample);
+
+/*!
+ * @brief Export the R peaks of one channel as a WFDB annotation file (.atr)
+ *
+ * accepted beats (quality >= MIN_WAVE_QUALITY) are written as NORMAL, the
+ * rest as UNKNOWN (Q) so annotation viewers show them too.
+ *
+ * @param reader     - pointer to the reader
+ * @param channel_id - channel to export
+ * @param path       - annotation file to create
+ * @return number of annotations written, -1 on failure
+ */
+int64_t beat_reader_export_atr(const beat_reader_t* reader, uint32_t channel_id, const char* path);
+
+#endif /* BEAT_FILE_H */
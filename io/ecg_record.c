@@ -0,0 +1,268 @@
+#include "ecg_record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osal/osal.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define HEA_LINE_SIZE   512  /* longest header line */
+#define HEA_MAX_TOKENS  10   /* fields of a header line that are looked at */
+#define WFDB_DEFAULT_GAIN 200.0f  /* ADC units per mV when the header has none */
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* splits a line into whitespace separated tokens in place, returns the count */
+static uint8_t split_tokens(char* line, char** tokens)
+{
+  uint8_t count = 0;
+  char* p = line;
+
+  while (count < HEA_MAX_TOKENS) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+      p++;
+    }
+    if (*p == '\0' || *p == '#') {
+      break;
+    }
+    tokens[count++] = p;
+    while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+      p++;
+    }
+    if (*p != '\0') {
+      *p++ = '\0';
+    }
+  }
+  return count;
+}
+
+/* next header line with at least one token, 0 at the end of the file */
+static uint8_t read_hea_line(FILE* file, char* line, char** tokens)
+{
+  uint8_t count = 0;
+
+  while (count == 0 && fgets(line, HEA_LINE_SIZE, file)) {
+    count = split_tokens(line, tokens);
+  }
+  return count;
+}
+
+/* samples per signal that fit into size bytes */
+static uint64_t frames_in(ecg_record_format_t format, uint16_t num_signals, uint64_t size)
+{
+  switch (format) {
+    case ECG_RECORD_FORMAT_16:
+      return size / (2u * num_signals);
+    case ECG_RECORD_FORMAT_212:
+      return (size / 3u * 2u + (size % 3u) / 2u) / num_signals;
+    case ECG_RECORD_FORMAT_F32:
+    default:
+      return size / (4u * num_signals);
+  }
+}
+
+/* maps path and points record->data at offset bytes into it */
+static uint8_t map_data(ecg_record_t* record, const char* path, uint64_t offset)
+{
+  record->map = osal_file_map(path, &record->map_size);
+  if (!record->map || offset >= record->map_size) {
+    ecg_record_close(record);
+    return 0;
+  }
+  record->data = (const uint8_t*)record->map + offset;
+
+  uint64_t frames = frames_in(record->format, record->num_signals, record->map_size - offset);
+  if (record->num_frames == 0 || record->num_frames > frames) {
+    record->num_frames = frames;
+  }
+  return 1;
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+uint8_t ecg_record_open_wfdb(ecg_record_t* record, const char* hea_path)
+{
+  char line[HEA_LINE_SIZE];
+  char* tokens[HEA_MAX_TOKENS];
+  char dat_name[HEA_LINE_SIZE] = "";
+  uint64_t offset = 0;
+  uint16_t i = 0;
+
+  memset(record, 0, sizeof(*record));
+  FILE* file = fopen(hea_path, "r");
+  if (!file) {
+    return 0;
+  }
+
+  /* record line: name nsig [fs[/counter][(base)] [nsamp ...]] */
+  uint8_t count = read_hea_line(file, line, tokens);
+  if (count < 2 || strchr(tokens[0], '/')) {
+    /* multi-segment records name their segment count after a slash */
+    fclose(file);
+    return 0;
+  }
+  unsigned long num_signals = strtoul(tokens[1], NULL, 10);
+  double sample_freq = (count > 2) ? strtod(tokens[2], NULL) : 250.0;
+  record->num_frames = (count > 3) ? strtoull(tokens[3], NULL, 10) : 0;
+  if (num_signals == 0 || num_signals > ECG_RECORD_MAX_SIGNALS || sample_freq < 1.0 || sample_freq > 65535.0) {
+    fclose(file);
+    return 0;
+  }
+  record->num_signals = (uint16_t)num_signals;
+  record->sample_freq = (uint16_t)(sample_freq + 0.5);
+
+  /* signal lines: file format[xspf][:skew][+offset] [gain[(baseline)][/units] [adcres [adczero ...]]] */
+  for (i = 0; i < record->num_signals; i++) {
+    char* end = NULL;
+
+    count = read_hea_line(file, line, tokens);
+    if (count < 2 || (i > 0 && strcmp(dat_name, tokens[0]) != 0)) {
+      /* every signal has to live in the same data file */
+      fclose(file);
+      return 0;
+    }
+    snprintf(dat_name, sizeof(dat_name), "%s", tokens[0]);
+
+    unsigned long format = strtoul(tokens[1], &end, 10);
+    ecg_record_format_t record_format = (format == 212) ? ECG_RECORD_FORMAT_212 : ECG_RECORD_FORMAT_16;
+    if ((format != 16 && format != 212) || (i > 0 && record_format != record->format)) {
+      fclose(file);
+      return 0;
+    }
+    record->format = record_format;
+    if (*end == 'x' && strtoul(end + 1, &end, 10) != 1) {
+      /* more than one sample per frame for a signal */
+      fclose(file);
+      return 0;
+    }
+    if (*end == ':') {
+      strtol(end + 1, &end, 10); /* skew is ignored */
+    }
+    if (*end == '+') {
+      offset = strtoull(end + 1, &end, 10);
+    }
+
+    /* physical value = (adc - baseline) / gain in units, baseline defaults to adczero */
+    float gain = WFDB_DEFAULT_GAIN;
+    float baseline = (count > 4) ? strtof(tokens[4], NULL) : 0.0f;
+    float units_to_v = 1e-3f;
+    if (count > 2) {
+      gain = strtof(tokens[2], &end);
+      if (*end == '(') {
+        baseline = strtof(end + 1, &end);
+        end += (*end == ')');
+      }
+      if (*end == '/') {
+        units_to_v = (strncmp(end + 1, "uV", 2) == 0) ? 1e-6f : (strcmp(end + 1, "V") == 0) ? 1.0f : 1e-3f;
+      }
+      gain = (gain == 0.0f) ? WFDB_DEFAULT_GAIN : gain;
+    }
+    record->scale[i] = units_to_v / gain;
+    record->baseline[i] = baseline;
+  }
+  fclose(file);
+
+  /* the data file lives next to the header */
+  const char* slash = strrchr(hea_path, '/');
+  int dir_len = slash ? (int)(slash - hea_path + 1) : 0;
+  int path_len = snprintf(line, sizeof(line), "%.*s%s", dir_len, hea_path, dat_name);
+  if (path_len < 0 || (size_t)path_len >= sizeof(line)) {
+    /* a truncated path would open another file */
+    return 0;
+  }
+  return map_data(record, line, offset);
+}
+
+uint8_t ecg_record_open_raw(ecg_record_t* record, const char* path, ecg_record_format_t format,
+                            uint16_t num_signals, uint16_t sample_freq, float adc_gain)
+{
+  uint16_t i = 0;
+
+  memset(record, 0, sizeof(*record));
+  if (format == ECG_RECORD_FORMAT_212 || num_signals == 0 || num_signals > ECG_RECORD_MAX_SIGNALS ||
+      sample_freq == 0) {
+    return 0;
+  }
+  record->format = format;
+  record->num_signals = num_signals;
+  record->sample_freq = sample_freq;
+  for (i = 0; i < num_signals; i++) {
+    record->scale[i] = (format == ECG_RECORD_FORMAT_F32) ? 1.0f : 1e-3f / ((adc_gain > 0.0f) ? adc_gain : WFDB_DEFAULT_GAIN);
+    record->baseline[i] = 0.0f;
+  }
+  return map_data(record, path, 0);
+}
+
+void ecg_record_close(ecg_record_t* record)
+{
+  osal_file_unmap(record->map, record->map_size);
+  record->map = NULL;
+  record->data = NULL;
+  record->num_frames = 0;
+}
+
+uint32_t ecg_record_read(const ecg_record_t* record, uint16_t signal, uint64_t first_frame, float* out,
+                         uint32_t num_frames)
+{
+  const uint16_t stride = record->num_signals;
+  const float scale = record->scale[signal];
+  const float baseline = record->baseline[signal];
+  uint32_t i = 0;
+
+  if (first_frame >= record->num_frames) {
+    return 0;
+  }
+  if (num_frames > record->num_frames - first_frame) {
+    num_frames = (uint32_t)(record->num_frames - first_frame);
+  }
+
+  uint64_t k = first_frame * stride + signal; /* sample index inside the interleaved data */
+  switch (record->format) {
+    case ECG_RECORD_FORMAT_16: {
+      const uint8_t* p = record->data + k * 2u;
+      for (i = 0; i < num_frames; i++, p += 2u * stride) {
+        int16_t adc = (int16_t)(uint16_t)(p[0] | (p[1] << 8));
+        out[i] = ((float)adc - baseline) * scale;
+      }
+      break;
+    }
+    case ECG_RECORD_FORMAT_212:
+      /* sample pairs share 3 bytes: low byte of each sample plus a byte of both high nibbles */
+      for (i = 0; i < num_frames; i++, k += stride) {
+        const uint8_t* p = record->data + (k >> 1) * 3u;
+        int32_t adc = (k & 1u) ? (p[2] | ((p[1] & 0xF0) << 4)) : (p[0] | ((p[1] & 0x0F) << 8));
+        adc -= (adc & 0x800) << 1; /* sign extend 12 bits */
+        out[i] = ((float)adc - baseline) * scale;
+      }
+      break;
+    case ECG_RECORD_FORMAT_F32:
+    default: {
+      /* the host and the board are both little-endian */
+      const uint8_t* p = record->data + k * 4u;
+      for (i = 0; i < num_frames; i++, p += 4u * stride) {
+        float value;
+        memcpy(&value, p, sizeof(value));
+        out[i] = value * scale;
+      }
+      break;
+    }
+  }
+  return num_frames;
+}
+
+const float* ecg_record_view(const ecg_record_t* record, uint64_t first_frame)
+{
+  if (record->format != ECG_RECORD_FORMAT_F32 || record->num_signals != 1 || record->scale[0] != 1.0f ||
+      ((uintptr_t)record->data & (sizeof(float) - 1)) != 0 || first_frame >= record->num_frames) {
+    return NULL;
+  }
+  return (const float*)record->data + first_frame;
+}
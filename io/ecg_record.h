@@ -0,0 +1,98 @@
+#ifndef ECG_RECORD_H
+#define ECG_RECORD_H
+
+#include <stdint.h>
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define ECG_RECORD_MAX_SIGNALS 16  /* signals (leads) per record */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* sample encoding of the data file - all little-endian */
+typedef enum {
+  ECG_RECORD_FORMAT_16,       /* WFDB format 16 / raw int16 */
+  ECG_RECORD_FORMAT_212,      /* WFDB format 212 - two 12 bit samples in 3 bytes */
+  ECG_RECORD_FORMAT_F32       /* raw float32, already in V */
+} ecg_record_format_t;
+
+/* memory mapped record - signals are interleaved frame by frame (one sample of
+ * every signal per frame), samples are decoded on demand and never copied as a whole */
+typedef struct {
+  ecg_record_format_t format;               /* sample encoding */
+  uint16_t num_signals;                     /* interleaved signals per frame */
+  uint16_t sample_freq;                     /* sampling frequency in Hz */
+  uint64_t num_frames;                      /* samples per signal */
+  float scale[ECG_RECORD_MAX_SIGNALS];      /* V per ADC unit */
+  float baseline[ECG_RECORD_MAX_SIGNALS];   /* ADC value of 0 V */
+  const uint8_t* data;                      /* first sample inside the mapping */
+  const void* map;                          /* whole mapped file */
+  uint64_t map_size;                        /* mapped bytes */
+} ecg_record_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Open a WFDB record (format 16 or 212)
+ *
+ * parses the .hea header and maps the .dat file next to it. all signals have
+ * to share one data file and one format, multi-segment records are not supported.
+ *
+ * @param record   - filled with the record
+ * @param hea_path - path of the .hea header
+ * @return 1 on success, 0 on failure
+ */
+uint8_t ecg_record_open_wfdb(ecg_record_t* record, const char* hea_path);
+
+/*!
+ * @brief Open a raw interleaved int16 or float32 file
+ *
+ * @param record      - filled with the record
+ * @param path        - data file
+ * @param format      - ECG_RECORD_FORMAT_16 or ECG_RECORD_FORMAT_F32
+ * @param num_signals - interleaved signals per frame
+ * @param sample_freq - sampling frequency in Hz
+ * @param adc_gain    - int16 only, ADC units per mV
+ * @return 1 on success, 0 on failure
+ */
+uint8_t ecg_record_open_raw(ecg_record_t* record, const char* path, ecg_record_format_t format,
+                            uint16_t num_signals, uint16_t sample_freq, float adc_gain);
+
+/*!
+ * @brief Unmap a record
+ *
+ * @param record - record to close
+ */
+void ecg_record_close(ecg_record_t* record);
+
+/*!
+ * @brief Decode a chunk of one signal
+ *
+ * the record is read-only, so any number of threads can decode at once.
+ *
+ * @param record      - pointer to the record
+ * @param signal      - signal to decode
+ * @param first_frame - first frame of the chunk
+ * @param out         - filled with the samples in V
+ * @param num_frames  - chunk length
+ * @return number of samples decoded, less than num_frames at the end of the record
+ */
+uint32_t ecg_record_read(const ecg_record_t* record, uint16_t signal, uint64_t first_frame, float* out,
+                         uint32_t num_frames);
+
+/*!
+ * @brief Zero-copy access to a single signal float32 record
+ *
+ * @param record      - pointer to the record
+ * @param first_frame - first frame
+ * @return samples inside the mapping, NULL when the record needs decoding
+ */
+const float* ecg_record_view(const ecg_record_t* record, uint64_t first_frame);
+
+#endif /* ECG_RECORD_H */
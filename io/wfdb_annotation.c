@@ -0,0 +1,148 @@
+#include "wfdb_annotation.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "osal/osal.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+/* pseudo-annotation codes of the MIT format */
+#define MIT_SKIP 59                 /* the next 4 bytes hold a long interval */
+#define MIT_NUM  60                 /* sets the num field */
+#define MIT_SUB  61                 /* sets the subtype */
+#define MIT_CHN  62                 /* sets the signal */
+#define MIT_AUX  63                 /* the interval field is the length of an AUX string */
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* 16 bit words, low byte first */
+static uint16_t get_word(const uint8_t* p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+uint8_t wfdb_annotations_read(wfdb_annotations_t* anns, const char* path)
+{
+  uint64_t size = 0;
+  uint64_t pos = 0;
+  uint64_t time = 0;
+  uint8_t chan = 0;
+  uint8_t num = 0;
+  uint8_t done = 0;
+
+  memset(anns, 0, sizeof(*anns));
+  const uint8_t* data = (const uint8_t*)osal_file_map(path, &size);
+  if (!data) {
+    return 0;
+  }
+
+  /* every annotation takes a word at least */
+  anns->items = (wfdb_ann_t*)malloc((size_t)(size / 2 + 1) * sizeof(wfdb_ann_t));
+  if (!anns->items) {
+    osal_file_unmap(data, size);
+    return 0;
+  }
+
+  /* type in the upper 6 bits, the interval (or the modifier value) in the lower 10 */
+  while (pos + 2 <= size && !done) {
+    uint16_t word = get_word(&data[pos]);
+    uint8_t type = (uint8_t)(word >> 10);
+    uint16_t value = word & 0x3FF;
+    wfdb_ann_t* last = anns->count ? &anns->items[anns->count - 1] : NULL;
+    pos += 2;
+
+    switch (type) {
+      case MIT_SKIP:
+        /* 32 bit interval, high half first */
+        if (pos + 4 > size) {
+          done = 2;
+          break;
+        }
+        time += (uint64_t)(int64_t)(int32_t)(((uint32_t)get_word(&data[pos]) << 16) | get_word(&data[pos + 2]));
+        pos += 4;
+        break;
+      case MIT_NUM:
+        num = (uint8_t)value;
+        if (last) {
+          last->num = num;
+        }
+        break;
+      case MIT_SUB:
+        if (last) {
+          last->sub = (uint8_t)value;
+        }
+        break;
+      case MIT_CHN:
+        chan = (uint8_t)value;
+        if (last) {
+          last->chan = chan;
+        }
+        break;
+      case MIT_AUX:
+        /* length byte count, padded to a word */
+        pos += (uint64_t)(value + 1) & ~1ull;
+        break;
+      default:
+        if (type == 0 && value == 0) {
+          done = 1;
+          break;
+        }
+        time += value;
+        anns->items[anns->count].sample = time;
+        anns->items[anns->count].type = type;
+        anns->items[anns->count].sub = 0;
+        anns->items[anns->count].chan = chan;
+        anns->items[anns->count].num = num;
+        anns->count++;
+        break;
+    }
+  }
+
+  osal_file_unmap(data, size);
+  if (done != 1 || pos > size) {
+    wfdb_annotations_free(anns);
+    return 0;
+  }
+  return 1;
+}
+
+void wfdb_annotations_free(wfdb_annotations_t* anns)
+{
+  free(anns->items);
+  anns->items = NULL;
+  anns->count = 0;
+}
+
+uint8_t wfdb_ann_is_beat(uint8_t type)
+{
+  /* N L R a V F J A S E j / Q, B, ?, e, n, f, r */
+  switch (type) {
+    case 1: case 2: case 3: case 4: case 5: case 6: case 7: case 8: case 9: case 10: case 11: case 12: case 13:
+    case 25: case 30: case 34: case 35: case 38: case 41:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+uint8_t wfdb_ann_is_ventricular(uint8_t type)
+{
+  return type == WFDB_ANN_PVC || type == WFDB_ANN_VESC || type == WFDB_ANN_RONT;
+}
+
+char wfdb_ann_mnemonic(uint8_t type)
+{
+  /* ecgmap.h order, code 0 is NOTQRS */
+  static const char mnemonics[] = "NLRaVFJASEj/Q~?|?sT*D\"=pB^t+u?![]en@xf()r";
+
+  return (type >= 1 && type <= sizeof(mnemonics) - 1) ? mnemonics[type - 1] : '?';
+}
@@ -0,0 +1,85 @@
+#ifndef WFDB_ANNOTATION_H
+#define WFDB_ANNOTATION_H
+
+#include <stdint.h>
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+/* WFDB annotation codes (ecgcodes.h) */
+#define WFDB_ANN_NORMAL  1          /* normal beat */
+#define WFDB_ANN_PVC     5          /* premature ventricular contraction */
+#define WFDB_ANN_VESC    10         /* ventricular escape beat */
+#define WFDB_ANN_UNKNOWN 13         /* unclassifiable beat (Q) */
+#define WFDB_ANN_RONT    41         /* R-on-T premature ventricular contraction */
+#define WFDB_ANN_MAX     49         /* highest annotation code, the codes above are pseudo-annotations */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* one annotation */
+typedef struct {
+  uint64_t sample;              /* absolute sample of the annotation */
+  uint8_t type;                 /* annotation code, e.g. WFDB_ANN_NORMAL */
+  uint8_t sub;                  /* subtype */
+  uint8_t chan;                 /* signal the annotation belongs to */
+  uint8_t num;                  /* annotator number field */
+} wfdb_ann_t;
+
+/* annotations of one annotator file, in file order */
+typedef struct {
+  wfdb_ann_t* items;
+  uint64_t count;
+} wfdb_annotations_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Read a WFDB annotation file in MIT format (.atr and friends)
+ *
+ * SKIP words (long intervals), NUM/SUB/CHN modifiers and AUX strings are
+ * handled, the AUX text is not kept. like in the WFDB library, NUM and CHN
+ * carry over to the following annotations.
+ *
+ * @param anns - filled with the annotations
+ * @param path - annotation file
+ * @return 1 on success, 0 on failure or a truncated file
+ */
+uint8_t wfdb_annotations_read(wfdb_annotations_t* anns, const char* path);
+
+/*!
+ * @brief Free the annotations
+ *
+ * @param anns - annotations to free
+ */
+void wfdb_annotations_free(wfdb_annotations_t* anns);
+
+/*!
+ * @brief Check if an annotation code labels a beat (isqrs() of the WFDB library)
+ *
+ * @param type - annotation code
+ * @return 1 for beat labels, 0 for rhythm, noise, comment and other annotations
+ */
+uint8_t wfdb_ann_is_beat(uint8_t type);
+
+/*!
+ * @brief Check if an annotation code labels a ventricular ectopic beat (V, E, r)
+ *
+ * @param type - annotation code
+ * @return 1 for ventricular ectopic beats, 0 otherwise
+ */
+uint8_t wfdb_ann_is_ventricular(uint8_t type);
+
+/*!
+ * @brief Mnemonic of an annotation code, e.g. 'N' or 'V'
+ *
+ * @param type - annotation code
+ * @return the mnemonic, '?' for unknown codes
+ */
+char wfdb_ann_mnemonic(uint8_t type);
+
+#endif /* WFDB_ANNOTATION_H */
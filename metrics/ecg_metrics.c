@@ -0,0 +1,281 @@
+#include "ecg_metrics.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(ECG_OSAL_POSIX)
+#include <stdlib.h>
+#endif
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* live histogram - written by the one writer of its stage */
+typedef struct {
+  osal_atomic_u32_t buckets[ECG_METRICS_BUCKETS];
+  osal_atomic_u64_t count;
+  osal_atomic_u64_t sum;
+  osal_atomic_u32_t max;
+} live_histogram_t;
+
+/******************************************************************************
+ * GLOBAL VARIABLES
+ *****************************************************************************/
+
+static live_histogram_t g_stages[ECG_STAGE_COUNT];
+static osal_atomic_u64_t g_counters[ECG_COUNTER_COUNT];
+static osal_atomic_u32_t g_gauges[ECG_GAUGE_COUNT];
+static osal_atomic_u32_t g_gauges_max[ECG_GAUGE_COUNT];
+
+static const char* const g_stage_names[ECG_STAGE_COUNT] = {
+  "sample_isr",
+  "preprocess",
+  "feature_detect",
+};
+
+static const char* const g_counter_names[ECG_COUNTER_COUNT] = {
+  "ecg_samples_dropped_total",
+  "ecg_beats_dropped_total",
+  "ecg_preprocess_wakeups_total",
+  "ecg_frames_total",
+  "ecg_frames_late_total",
+  "ecg_feature_wakeups_total",
+  "ecg_beat_ring_stalls_total",
+};
+
+static const char* const g_counter_help[ECG_COUNTER_COUNT] = {
+  "Samples lost because the input ring was full",
+  "Beats lost because the beat queue was full",
+  "Wakeups of the preprocessing task",
+  "Frames filtered by the preprocessing task",
+  "Frames found behind the first one of a wakeup",
+  "Wakeups of the feature detection task",
+  "Publishes refused by a backpressure subscriber of the beat ring",
+};
+
+static const char* const g_gauge_names[ECG_GAUGE_COUNT] = {
+  "ecg_input_ring_samples",
+  "ecg_wave_backlog",
+  "ecg_beat_ring_lag",
+};
+
+static const char* const g_gauge_help[ECG_GAUGE_COUNT] = {
+  "Raw samples waiting in the input ring",
+  "Waves posted to the feature detection task but not yet detected",
+  "Waves published but not read by the slowest subscriber",
+};
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/* bucket of a duration - number of significant bits */
+static uint32_t bucket_of(uint32_t cycles)
+{
+  if (cycles == 0) {
+    return 0;
+  }
+#if defined(__TI_COMPILER_VERSION__)
+  return 32u - _lmbd(1, cycles);
+#elif defined(__GNUC__)
+  return 32u - (uint32_t)__builtin_clz(cycles);
+#else
+  uint32_t bits = 0;
+  while (cycles) {
+    bits++;
+    cycles >>= 1;
+  }
+  return bits;
+#endif
+}
+
+/* appends to out like snprintf, keeps track of the full length */
+static void append(char* out, size_t size, size_t* length, const char* format, ...)
+{
+  va_list args;
+  size_t offset = (*length < size) ? *length : size;
+
+  va_start(args, format);
+  int written = vsnprintf(out ? out + offset : NULL, size - offset, format, args);
+  va_end(args);
+  if (written > 0) {
+    *length += (size_t)written;
+  }
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+void ecg_metrics_init(void)
+{
+  uint32_t i = 0;
+  uint32_t b = 0;
+
+  for (i = 0; i < ECG_STAGE_COUNT; i++) {
+    for (b = 0; b < ECG_METRICS_BUCKETS; b++) {
+      osal_atomic_store_relaxed(&g_stages[i].buckets[b], 0);
+    }
+    osal_atomic_store_u64(&g_stages[i].count, 0);
+    osal_atomic_store_u64(&g_stages[i].sum, 0);
+    osal_atomic_store_relaxed(&g_stages[i].max, 0);
+  }
+  for (i = 0; i < ECG_COUNTER_COUNT; i++) {
+    osal_atomic_store_u64(&g_counters[i], 0);
+  }
+  for (i = 0; i < ECG_GAUGE_COUNT; i++) {
+    osal_atomic_store_relaxed(&g_gauges[i], 0);
+    osal_atomic_store_relaxed(&g_gauges_max[i], 0);
+  }
+}
+
+void ecg_metrics_observe(ecg_stage_t stage, uint32_t cycles)
+{
+  live_histogram_t* hist = &g_stages[stage];
+  uint32_t b = bucket_of(cycles);
+
+  /* single writer - plain load + store instead of a read-modify-write */
+  if (b >= ECG_METRICS_BUCKETS) {
+    b = ECG_METRICS_BUCKETS - 1;
+  }
+  osal_atomic_store_relaxed(&hist->buckets[b], osal_atomic_load_relaxed(&hist->buckets[b]) + 1);
+  osal_atomic_store_u64(&hist->sum, osal_atomic_load_u64(&hist->sum) + cycles);
+  osal_atomic_store_u64(&hist->count, osal_atomic_load_u64(&hist->count) + 1);
+  if (cycles > osal_atomic_load_relaxed(&hist->max)) {
+    osal_atomic_store_relaxed(&hist->max, cycles);
+  }
+}
+
+void ecg_metrics_count(ecg_counter_t counter, uint32_t n)
+{
+  osal_atomic_store_u64(&g_counters[counter], osal_atomic_load_u64(&g_counters[counter]) + n);
+}
+
+void ecg_metrics_gauge(ecg_gauge_t gauge, uint32_t value)
+{
+  osal_atomic_store_relaxed(&g_gauges[gauge], value);
+  if (value > osal_atomic_load_relaxed(&g_gauges_max[gauge])) {
+    osal_atomic_store_relaxed(&g_gauges_max[gauge], value);
+  }
+}
+
+void ecg_metrics_snapshot(ecg_metrics_snapshot_t* snapshot)
+{
+  uint32_t i = 0;
+  uint32_t b = 0;
+
+  snapshot->cycles_hz = osal_cycles_hz();
+  for (i = 0; i < ECG_STAGE_COUNT; i++) {
+    ecg_histogram_t* hist = &snapshot->stages[i];
+    for (b = 0; b < ECG_METRICS_BUCKETS; b++) {
+      hist->buckets[b] = osal_atomic_load_relaxed(&g_stages[i].buckets[b]);
+    }
+    hist->count = osal_atomic_load_u64(&g_stages[i].count);
+    hist->sum = osal_atomic_load_u64(&g_stages[i].sum);
+    hist->max = osal_atomic_load_relaxed(&g_stages[i].max);
+  }
+  for (i = 0; i < ECG_COUNTER_COUNT; i++) {
+    snapshot->counters[i] = osal_atomic_load_u64(&g_counters[i]);
+  }
+  for (i = 0; i < ECG_GAUGE_COUNT; i++) {
+    snapshot->gauges[i] = osal_atomic_load_relaxed(&g_gauges[i]);
+    snapshot->gauges_max[i] = osal_atomic_load_relaxed(&g_gauges_max[i]);
+  }
+}
+
+size_t ecg_metrics_format_prometheus(const ecg_metrics_snapshot_t* snapshot, char* out, size_t size)
+{
+  double seconds_per_cycle = (snapshot->cycles_hz > 0) ? 1.0 / (double)snapshot->cycles_hz : 0.0;
+  size_t length = 0;
+  uint32_t i = 0;
+  uint32_t b = 0;
+
+  if (out && size > 0) {
+    out[0] = '\0';
+  }
+
+  append(out, size, &length, "# HELP ecg_stage_duration_seconds Time spent in one pass of a pipeline stage\n"
+                             "# TYPE ecg_stage_duration_seconds histogram\n");
+  for (i = 0; i < ECG_STAGE_COUNT; i++) {
+    const ecg_histogram_t* hist = &snapshot->stages[i];
+    uint64_t cumulative = 0;
+
+    /* every bucket, so the series are the same in every scrape - the count is
+     * taken from the buckets so it matches them even if the snapshot raced with an observation */
+    for (b = 0; b < ECG_METRICS_BUCKETS; b++) {
+      cumulative += hist->buckets[b];
+      append(out, size, &length, "ecg_stage_duration_seconds_bucket{stage=\"%s\",le=\"%.9g\"} %llu\n",
+             g_stage_names[i], (double)(1ull << b) * seconds_per_cycle, (unsigned long long)cumulative);
+    }
+    append(out, size, &length,
+           "ecg_stage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n"
+           "ecg_stage_duration_seconds_sum{stage=\"%s\"} %.9g\n"
+           "ecg_stage_duration_seconds_count{stage=\"%s\"} %llu\n",
+           g_stage_names[i], (unsigned long long)cumulative, g_stage_names[i],
+           (double)hist->sum * seconds_per_cycle, g_stage_names[i], (unsigned long long)cumulative);
+  }
+
+  append(out, size, &length, "# HELP ecg_stage_duration_max_seconds Longest pass of a pipeline stage\n"
+                             "# TYPE ecg_stage_duration_max_seconds gauge\n");
+  for (i = 0; i < ECG_STAGE_COUNT; i++) {
+    append(out, size, &length, "ecg_stage_duration_max_seconds{stage=\"%s\"} %.9g\n", g_stage_names[i],
+           (double)snapshot->stages[i].max * seconds_per_cycle);
+  }
+
+  for (i = 0; i < ECG_COUNTER_COUNT; i++) {
+    append(out, size, &length, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", g_counter_names[i],
+           g_counter_help[i], g_counter_names[i], g_counter_names[i], (unsigned long long)snapshot->counters[i]);
+  }
+
+  for (i = 0; i < ECG_GAUGE_COUNT; i++) {
+    append(out, size, &length, "# HELP %s %s\n# TYPE %s gauge\n%s %u\n", g_gauge_names[i], g_gauge_help[i],
+           g_gauge_names[i], g_gauge_names[i], snapshot->gauges[i]);
+    append(out, size, &length, "# HELP %s_max High-water mark of %s\n# TYPE %s_max gauge\n%s_max %u\n",
+           g_gauge_names[i], g_gauge_names[i], g_gauge_names[i], g_gauge_names[i], snapshot->gauges_max[i]);
+  }
+  return length;
+}
+
+#if defined(ECG_OSAL_POSIX)
+uint8_t ecg_metrics_write_file(const char* path)
+{
+  ecg_metrics_snapshot_t snapshot;
+  char tmp_path[4096];
+  uint8_t ok = 1;
+
+  ecg_metrics_snapshot(&snapshot);
+  size_t length = ecg_metrics_format_prometheus(&snapshot, NULL, 0);
+  char* text = (char*)malloc(length + 1);
+  if (!text) {
+    return 0;
+  }
+  ecg_metrics_format_prometheus(&snapshot, text, length + 1);
+
+  if (strcmp(path, "-") == 0) {
+    ok = (fwrite(text, 1, length, stdout) == length);
+    free(text);
+    return ok;
+  }
+
+  /* write a temporary file and rename it over the target */
+  if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+    free(text);
+    return 0;
+  }
+  FILE* file = fopen(tmp_path, "w");
+  if (!file) {
+    free(text);
+    return 0;
+  }
+  ok = (fwrite(text, 1, length, file) == length);
+  ok &= (fclose(file) == 0);
+  ok = ok && (rename(tmp_path, path) == 0);
+  if (!ok) {
+    remove(tmp_path);
+  }
+  free(text);
+  return ok;
+}
+#endif
@@ -0,0 +1,159 @@
+#ifndef ECG_METRICS_H
+#define ECG_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "osal/osal.h"
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define ECG_METRICS_BUCKETS 32   /* log2 cycle buckets - bucket n counts durations below 2^n cycles */
+
+/*
+ * probes - ECG_METRICS enables them (host CMake option, predefined symbol in
+ * the CCS project). without it every probe expands to nothing, so the hot path
+ * is the same as before the instrumentation.
+ *
+ *   ECG_PROBE_START(t);
+ *   ... measured code ...
+ *   ECG_PROBE_STOP(ECG_STAGE_PREPROCESS, t);
+ */
+#ifdef ECG_METRICS
+#define ECG_PROBE_START(name)           uint32_t name = osal_cycles()
+#define ECG_PROBE_STOP(stage, name)     ecg_metrics_observe((stage), osal_cycles() - (name))
+#define ECG_METRICS_COUNT(counter, n)   ecg_metrics_count((counter), (n))
+#define ECG_METRICS_GAUGE(gauge, value) ecg_metrics_gauge((gauge), (value))
+#else
+#define ECG_PROBE_START(name)           do { } while (0)
+#define ECG_PROBE_STOP(stage, name)     do { } while (0)
+#define ECG_METRICS_COUNT(counter, n)   ((void)sizeof(n))      /* not evaluated, only keeps the operands used */
+#define ECG_METRICS_GAUGE(gauge, value) ((void)sizeof(value))
+#endif
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* timed stages - every stage has one writer (the ISR or one task) */
+typedef enum {
+  ECG_STAGE_SAMPLE_ISR,       /* ecg_app_push_sample() */
+  ECG_STAGE_PREPROCESS,       /* one frame in ECG_PreprocessingTask */
+  ECG_STAGE_FEATURE_DETECT,   /* one wave in ECG_FeatureDetectTask */
+  ECG_STAGE_COUNT
+} ecg_stage_t;
+
+/* monotonic event counters - one writer each */
+typedef enum {
+  ECG_COUNTER_SAMPLES_DROPPED,    /* samples lost because the input ring was full */
+  ECG_COUNTER_BEATS_DROPPED,      /* beats lost because the beat queue was full */
+  ECG_COUNTER_PREPROCESS_WAKEUPS, /* sample_ready_sem pends that returned */
+  ECG_COUNTER_FRAMES,             /* frames filtered */
+  ECG_COUNTER_FRAMES_LATE,        /* frames found behind the first one of a wakeup - the task fell behind the timer */
+  ECG_COUNTER_FEATURE_WAKEUPS,    /* wave_ready_sem pends that returned */
+  ECG_COUNTER_BEATS_STALLED,      /* publishes refused by a backpressure subscriber of the beat ring */
+  ECG_COUNTER_COUNT
+} ecg_counter_t;
+
+/* sampled levels - last value and high-water mark, one writer each */
+typedef enum {
+  ECG_GAUGE_INPUT_RING,       /* raw samples waiting in the input ring */
+  ECG_GAUGE_WAVE_BACKLOG,     /* waves posted but not yet detected */
+  ECG_GAUGE_BEAT_LAG,         /* waves published but not read by the slowest subscriber */
+  ECG_GAUGE_COUNT
+} ecg_gauge_t;
+
+/* latency histogram of one stage in cycles */
+typedef struct {
+  uint32_t buckets[ECG_METRICS_BUCKETS];  /* bucket n: 2^(n-1) <= cycles < 2^n (bucket 0: 0 cycles) */
+  uint64_t count;                         /* observations */
+  uint64_t sum;                           /* sum of all observations */
+  uint32_t max;                           /* longest observation */
+} ecg_histogram_t;
+
+/* copy of every metric, see ecg_metrics_snapshot() */
+typedef struct {
+  uint64_t cycles_hz;                             /* osal_cycles() frequency */
+  ecg_histogram_t stages[ECG_STAGE_COUNT];        /* per stage durations */
+  uint64_t counters[ECG_COUNTER_COUNT];           /* event counters */
+  uint32_t gauges[ECG_GAUGE_COUNT];               /* last gauge values */
+  uint32_t gauges_max[ECG_GAUGE_COUNT];           /* gauge high-water marks */
+} ecg_metrics_snapshot_t;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/*!
+ * @brief Clear every metric
+ *
+ * must be called before the sampling ISR or any of the tasks are started.
+ */
+void ecg_metrics_init(void);
+
+/*!
+ * @brief Add one duration to a stage histogram (use ECG_PROBE_STOP)
+ *
+ * lock-free: relaxed stores of the single writer, readers may see a
+ * histogram that is one observation ahead in some fields.
+ *
+ * @param stage  - measured stage
+ * @param cycles - duration in osal_cycles() units
+ */
+void ecg_metrics_observe(ecg_stage_t stage, uint32_t cycles);
+
+/*!
+ * @brief Add to an event counter (use ECG_METRICS_COUNT)
+ *
+ * @param counter - counter to increment
+ * @param n       - increment
+ */
+void ecg_metrics_count(ecg_counter_t counter, uint32_t n);
+
+/*!
+ * @brief Set a gauge and raise its high-water mark (use ECG_METRICS_GAUGE)
+ *
+ * @param gauge - gauge to set
+ * @param value - current level
+ */
+void ecg_metrics_gauge(ecg_gauge_t gauge, uint32_t value);
+
+/*!
+ * @brief Copy every metric
+ *
+ * safe from any task or thread while the writers keep running. calibrates the
+ * cycle counter on the first call on x86 hosts (10 ms).
+ *
+ * @param snapshot - filled with the metrics
+ */
+void ecg_metrics_snapshot(ecg_metrics_snapshot_t* snapshot);
+
+/*!
+ * @brief Format a snapshot in the Prometheus text exposition format
+ *
+ * durations are reported in seconds. like snprintf the output is truncated
+ * to size but the full length is returned.
+ *
+ * @param snapshot - metrics to format
+ * @param out      - output buffer (may be NULL if size is 0)
+ * @param size     - size of out in bytes
+ * @return length of the full text without the terminating 0
+ */
+size_t ecg_metrics_format_prometheus(const ecg_metrics_snapshot_t* snapshot, char* out, size_t size);
+
+#if defined(ECG_OSAL_POSIX)
+/*!
+ * @brief Write a fresh snapshot as Prometheus text to a file (host only)
+ *
+ * the file is written next to path and renamed over it, so a scraper
+ * (e.g. the node exporter textfile collector) never reads a partial file.
+ *
+ * @param path - file to write, "-" for stdout
+ * @return 1 on success, 0 on failure
+ */
+uint8_t ecg_metrics_write_file(const char* path);
+#endif
+
+#endif /* ECG_METRICS_H */
@@ -0,0 +1,325 @@
+#ifndef OSAL_H
+#define OSAL_H
+
+#include <stdint.h>
+
+/******************************************************************************
+ * BACKEND SELECTION
+ *****************************************************************************/
+
+/* the TI code generation tools always define __TI_COMPILER_VERSION__,
+ * so the board build picks TI-RTOS and every other compiler picks POSIX */
+#if !defined(ECG_OSAL_TIRTOS) && !defined(ECG_OSAL_POSIX)
+#if defined(__TI_COMPILER_VERSION__)
+#define ECG_OSAL_TIRTOS
+#else
+#define ECG_OSAL_POSIX
+#endif
+#endif
+
+#define OSAL_WAIT_FOREVER 0xFFFFFFFFu /* timeout value for blocking forever */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* 32 bit word shared between an ISR/thread and another task/thread - only
+ * accessed through the osal_atomic_* functions */
+#if defined(ECG_OSAL_POSIX)
+#include <stdatomic.h>
+typedef _Atomic uint32_t osal_atomic_u32_t;
+typedef _Atomic uint64_t osal_atomic_u64_t;
+#else
+typedef volatile uint32_t osal_atomic_u32_t;
+typedef volatile uint64_t osal_atomic_u64_t;
+#endif
+
+/* opaque handles - each backend defines what they point at */
+typedef struct osal_sem* osal_sem_t;
+typedef struct osal_thread* osal_thread_t;
+
+/* thread entry point */
+typedef void (*osal_thread_fn_t)(void* arg);
+
+/******************************************************************************
+ * SEMAPHORES
+ *****************************************************************************/
+
+/*!
+ * @brief Create a counting semaphore
+ *
+ * on TI-RTOS runtime creates are disabled (BIOS.runtimeCreatesEnabled = false),
+ * so the semaphores are created statically in app.cfg and handed over with
+ * osal_sem_from_native(). this function returns NULL on that backend.
+ *
+ * @param initial_count - initial semaphore count
+ * @return semaphore handle or NULL on failure
+ */
+osal_sem_t osal_sem_create(uint32_t initial_count);
+
+/*!
+ * @brief Wrap a native semaphore handle (Semaphore_Handle / sem_t*)
+ *
+ * @param native - native backend semaphore handle
+ * @return semaphore handle usable with the rest of the osal_sem_* API
+ */
+osal_sem_t osal_sem_from_native(void* native);
+
+/*!
+ * @brief Delete a semaphore created with osal_sem_create()
+ *
+ * @param sem - semaphore handle
+ */
+void osal_sem_delete(osal_sem_t sem);
+
+/*!
+ * @brief Wait on a semaphore
+ *
+ * @param sem        - semaphore handle
+ * @param timeout_us - timeout in microseconds or OSAL_WAIT_FOREVER
+ * @return 1 if the semaphore was taken, 0 on timeout
+ */
+uint8_t osal_sem_pend(osal_sem_t sem, uint32_t timeout_us);
+
+/*!
+ * @brief Signal a semaphore
+ *
+ * safe to call from interrupt context on TI-RTOS and from any thread on POSIX.
+ *
+ * @param sem - semaphore handle
+ */
+void osal_sem_post(osal_sem_t sem);
+
+/******************************************************************************
+ * ATOMICS
+ *****************************************************************************/
+
+/*
+ * acquire/release accesses for lock-free handoffs. a release store makes every
+ * write before it visible to the thread whose acquire load reads the stored value.
+ * POSIX maps them to C11 atomics. the C674x is a single in-order core where
+ * aligned 32 bit accesses are atomic, so the TI-RTOS backend only has to keep
+ * the compiler from moving memory accesses across them (out of line calls).
+ */
+#if defined(ECG_OSAL_POSIX)
+
+static inline uint32_t osal_atomic_load_acquire(osal_atomic_u32_t* value)
+{
+  return atomic_load_explicit(value, memory_order_acquire);
+}
+
+static inline uint32_t osal_atomic_load_relaxed(osal_atomic_u32_t* value)
+{
+  return atomic_load_explicit(value, memory_order_relaxed);
+}
+
+static inline void osal_atomic_store_release(osal_atomic_u32_t* value, uint32_t new_value)
+{
+  atomic_store_explicit(value, new_value, memory_order_release);
+}
+
+static inline void osal_atomic_store_relaxed(osal_atomic_u32_t* value, uint32_t new_value)
+{
+  atomic_store_explicit(value, new_value, memory_order_relaxed);
+}
+
+/* stores new_value only if value still holds expected - returns 1 if it did.
+ * acquire and release, used where two threads may move the same index */
+static inline uint8_t osal_atomic_cas(osal_atomic_u32_t* value, uint32_t expected, uint32_t new_value)
+{
+  return (uint8_t)atomic_compare_exchange_strong_explicit(value, &expected, new_value, memory_order_acq_rel,
+                                                          memory_order_acquire);
+}
+
+/* 64 bit words - a single access on 64 bit hosts */
+static inline uint64_t osal_atomic_load_u64(osal_atomic_u64_t* value)
+{
+  return atomic_load_explicit(value, memory_order_relaxed);
+}
+
+static inline void osal_atomic_store_u64(osal_atomic_u64_t* value, uint64_t new_value)
+{
+  atomic_store_explicit(value, new_value, memory_order_relaxed);
+}
+
+/* full fence - no memory access moves across it, for plain data checked against a relaxed counter */
+static inline void osal_atomic_fence(void)
+{
+  atomic_thread_fence(memory_order_seq_cst);
+}
+
+#else
+
+uint32_t osal_atomic_load_acquire(osal_atomic_u32_t* value);
+uint32_t osal_atomic_load_relaxed(osal_atomic_u32_t* value);
+void osal_atomic_store_release(osal_atomic_u32_t* value, uint32_t new_value);
+void osal_atomic_store_relaxed(osal_atomic_u32_t* value, uint32_t new_value);
+
+/* compare and swap - done with interrupts disabled on the single core */
+uint8_t osal_atomic_cas(osal_atomic_u32_t* value, uint32_t expected, uint32_t new_value);
+
+/* 64 bit words are two accesses on the C674x - done with interrupts disabled */
+uint64_t osal_atomic_load_u64(osal_atomic_u64_t* value);
+void osal_atomic_store_u64(osal_atomic_u64_t* value, uint64_t new_value);
+
+/* full fence - a compiler barrier on the single in-order core */
+void osal_atomic_fence(void);
+
+#endif
+
+/******************************************************************************
+ * THREADS
+ *****************************************************************************/
+
+/*!
+ * @brief Create and start a thread
+ *
+ * tasks on TI-RTOS are created statically in app.cfg, so this returns NULL there.
+ *
+ * @param fn   - thread entry point
+ * @param arg  - argument passed to fn
+ * @param name - thread name (used for debugging only, may be NULL)
+ * @return thread handle or NULL on failure
+ */
+osal_thread_t osal_thread_create(osal_thread_fn_t fn, void* arg, const char* name);
+
+/*!
+ * @brief Wait for a thread to finish and release its handle
+ *
+ * @param thread - thread handle returned by osal_thread_create()
+ */
+void osal_thread_join(osal_thread_t thread);
+
+/*!
+ * @brief Number of CPU cores available to the process
+ *
+ * @return number of cores (1 on the single core C674x)
+ */
+uint32_t osal_cpu_count(void);
+
+/******************************************************************************
+ * TIME
+ *****************************************************************************/
+
+/*!
+ * @brief Monotonic time in nanoseconds
+ *
+ * @return monotonic time since an arbitrary point in nanoseconds
+ */
+uint64_t osal_time_ns(void);
+
+/*!
+ * @brief Sleep until an absolute monotonic time
+ *
+ * @param deadline_ns - absolute time in osal_time_ns() units
+ */
+void osal_sleep_until_ns(uint64_t deadline_ns);
+
+/*!
+ * @brief Free running 32 bit cycle counter for probes
+ *
+ * TSC on x86 hosts, TSCL on the C674x (started by the BIOS timestamp
+ * provider), the monotonic clock in ns on other hosts. differences of two
+ * reads are valid across one wrap of the counter.
+ *
+ * @return current counter value
+ */
+#if defined(ECG_OSAL_POSIX) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+static inline uint32_t osal_cycles(void)
+{
+  return (uint32_t)__rdtsc();
+}
+#elif defined(ECG_OSAL_POSIX)
+static inline uint32_t osal_cycles(void)
+{
+  return (uint32_t)osal_time_ns();
+}
+#else
+#include <c6x.h>
+static inline uint32_t osal_cycles(void)
+{
+  return TSCL;
+}
+#endif
+
+/*!
+ * @brief Frequency of osal_cycles()
+ *
+ * the TSC is calibrated against the monotonic clock on the first call (10 ms),
+ * so call it outside of the hot path.
+ *
+ * @return counter increments per second
+ */
+uint64_t osal_cycles_hz(void);
+
+/******************************************************************************
+ * FILES
+ *****************************************************************************/
+
+/*!
+ * @brief Map a whole file read-only into memory
+ *
+ * pages are loaded on first access and can be dropped again by the OS, so
+ * files larger than the heap (24 h Holter records) can be read in place. the
+ * mapping is hinted for sequential access. there is no file system on the
+ * board, so this returns NULL on TI-RTOS.
+ *
+ * @param path - file to map
+ * @param size - filled with the file size in bytes
+ * @return start of the mapping or NULL on failure (empty files fail too)
+ */
+const void* osal_file_map(const char* path, uint64_t* size);
+
+/*!
+ * @brief Unmap a file mapped with osal_file_map()
+ *
+ * @param data - start of the mapping
+ * @param size - file size returned by osal_file_map()
+ */
+void osal_file_unmap(const void* data, uint64_t size);
+
+/******************************************************************************
+ * MEMORY
+ *****************************************************************************/
+
+/*!
+ * @brief Map a zeroed, page aligned block of anonymous memory
+ *
+ * for long lived blocks that are carved up at init (arena_create()). with
+ * hugepages the size is rounded up to 2 MB and explicit huge pages are
+ * tried first, then transparent huge pages are requested for a normal
+ * mapping. the board creates nothing at runtime, so this returns NULL on
+ * TI-RTOS - use a static block there.
+ *
+ * @param size      - bytes to map, rounded up to the page size
+ * @param hugepages - back the block with 2 MB pages if the OS can
+ * @return start of the block or NULL on failure
+ */
+void* osal_mem_map(uint64_t* size, uint8_t hugepages);
+
+/*!
+ * @brief Unmap a block mapped with osal_mem_map()
+ *
+ * @param data - start of the block
+ * @param size - size returned by osal_mem_map()
+ */
+void osal_mem_unmap(void* data, uint64_t size);
+
+/******************************************************************************
+ * OUTPUT
+ *****************************************************************************/
+
+/*!
+ * @brief printf to the system console (System_printf on TI-RTOS, stdout on POSIX)
+ *
+ * @param format - printf style format string
+ */
+void osal_printf(const char* format, ...);
+
+/*!
+ * @brief Flush buffered console output
+ */
+void osal_flush(void);
+
+#endif /* OSAL_H */
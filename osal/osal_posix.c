@@ -0,0 +1,276 @@
+#include "osal.h"
+
+#if defined(ECG_OSAL_POSIX)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* POSIX semaphore wrapper - owned tells delete whether to destroy the sem_t */
+struct osal_sem {
+  sem_t sem;
+  sem_t* native;
+  uint8_t owned;
+};
+
+struct osal_thread {
+  pthread_t thread;
+  osal_thread_fn_t fn;
+  void* arg;
+};
+
+osal_sem_t osal_sem_create(uint32_t initial_count)
+{
+  osal_sem_t sem = (osal_sem_t)malloc(sizeof(*sem));
+  if (!sem) {
+    return NULL;
+  }
+
+  if (sem_init(&sem->sem, 0, initial_count) != 0) {
+    free(sem);
+    return NULL;
+  }
+  sem->native = &sem->sem;
+  sem->owned = 1;
+  return sem;
+}
+
+osal_sem_t osal_sem_from_native(void* native)
+{
+  osal_sem_t sem = (osal_sem_t)malloc(sizeof(*sem));
+  if (!sem) {
+    return NULL;
+  }
+
+  sem->native = (sem_t*)native;
+  sem->owned = 0;
+  return sem;
+}
+
+void osal_sem_delete(osal_sem_t sem)
+{
+  if (!sem) {
+    return;
+  }
+
+  if (sem->owned) {
+    sem_destroy(&sem->sem);
+  }
+  free(sem);
+}
+
+uint8_t osal_sem_pend(osal_sem_t sem, uint32_t timeout_us)
+{
+  int rc;
+
+  if (timeout_us == OSAL_WAIT_FOREVER) {
+    /* retry when interrupted by a signal */
+    do {
+      rc = sem_wait(sem->native);
+    } while (rc != 0 && errno == EINTR);
+    return (rc == 0);
+  }
+
+  /* sem_timedwait takes an absolute CLOCK_REALTIME deadline */
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += timeout_us / 1000000u;
+  deadline.tv_nsec += (long)(timeout_us % 1000000u) * 1000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  do {
+    rc = sem_timedwait(sem->native, &deadline);
+  } while (rc != 0 && errno == EINTR);
+  return (rc == 0);
+}
+
+void osal_sem_post(osal_sem_t sem)
+{
+  sem_post(sem->native);
+}
+
+static void* osal_thread_trampoline(void* arg)
+{
+  osal_thread_t thread = (osal_thread_t)arg;
+  thread->fn(thread->arg);
+  return NULL;
+}
+
+osal_thread_t osal_thread_create(osal_thread_fn_t fn, void* arg, const char* name)
+{
+  osal_thread_t thread = (osal_thread_t)malloc(sizeof(*thread));
+  if (!thread) {
+    return NULL;
+  }
+
+  thread->fn = fn;
+  thread->arg = arg;
+  if (pthread_create(&thread->thread, NULL, osal_thread_trampoline, thread) != 0) {
+    free(thread);
+    return NULL;
+  }
+
+#if defined(__linux__) && defined(_GNU_SOURCE)
+  /* linux limits thread names to 15 characters plus terminator */
+  if (name) {
+    char short_name[16];
+    snprintf(short_name, sizeof(short_name), "%s", name);
+    pthread_setname_np(thread->thread, short_name);
+  }
+#else
+  (void)name;
+#endif
+
+  return thread;
+}
+
+void osal_thread_join(osal_thread_t thread)
+{
+  if (!thread) {
+    return;
+  }
+
+  pthread_join(thread->thread, NULL);
+  free(thread);
+}
+
+uint32_t osal_cpu_count(void)
+{
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return (count > 0) ? (uint32_t)count : 1u;
+}
+
+uint64_t osal_time_ns(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+uint64_t osal_cycles_hz(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  /* invariant TSC - measured once against the monotonic clock */
+  static osal_atomic_u64_t hz;
+  uint64_t result = osal_atomic_load_u64(&hz);
+  if (result == 0) {
+    uint64_t start_ns = osal_time_ns();
+    uint32_t start = osal_cycles();
+    uint64_t elapsed_ns = 0;
+    while ((elapsed_ns = osal_time_ns() - start_ns) < 10000000ull) {
+    }
+    result = (uint64_t)(uint32_t)(osal_cycles() - start) * 1000000000ull / elapsed_ns;
+    osal_atomic_store_u64(&hz, result);
+  }
+  return result;
+#else
+  /* osal_cycles() counts ns */
+  return 1000000000ull;
+#endif
+}
+
+void osal_sleep_until_ns(uint64_t deadline_ns)
+{
+  struct timespec deadline;
+  deadline.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+  deadline.tv_nsec = (long)(deadline_ns % 1000000000ull);
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+  }
+}
+
+const void* osal_file_map(const char* path, uint64_t* size)
+{
+  struct stat st;
+  void* data = NULL;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      data = NULL;
+    }
+  }
+  /* the mapping keeps its own reference to the file */
+  close(fd);
+
+  if (!data) {
+    return NULL;
+  }
+  /* records are decoded front to back - read ahead aggressively */
+  madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+  *size = (uint64_t)st.st_size;
+  return data;
+}
+
+void osal_file_unmap(const void* data, uint64_t size)
+{
+  if (data) {
+    munmap((void*)data, (size_t)size);
+  }
+}
+
+void* osal_mem_map(uint64_t* size, uint8_t hugepages)
+{
+  const uint64_t huge_page = 2ull << 20;
+  uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+  void* data = MAP_FAILED;
+
+  if (hugepages) {
+    *size = (*size + huge_page - 1) / huge_page * huge_page;
+#if defined(MAP_HUGETLB)
+    /* reserved huge pages (vm.nr_hugepages), usually none */
+    data = mmap(NULL, (size_t)*size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+  } else {
+    *size = (*size + page - 1) / page * page;
+  }
+  if (data == MAP_FAILED) {
+    data = mmap(NULL, (size_t)*size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+      return NULL;
+    }
+#if defined(MADV_HUGEPAGE)
+    if (hugepages) {
+      madvise(data, (size_t)*size, MADV_HUGEPAGE);
+    }
+#endif
+  }
+  return data;
+}
+
+void osal_mem_unmap(void* data, uint64_t size)
+{
+  if (data) {
+    munmap(data, (size_t)size);
+  }
+}
+
+void osal_printf(const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+}
+
+void osal_flush(void)
+{
+  fflush(stdout);
+}
+
+#endif /* ECG_OSAL_POSIX */
@@ -0,0 +1,195 @@
+#include "osal.h"
+
+#if defined(ECG_OSAL_TIRTOS)
+
+#include <stdarg.h>
+
+/* XDCtools header files */
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
+
+/* BIOS header files */
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+/* the osal handle is the Semaphore_Handle itself - no wrapper object is
+ * needed and nothing is allocated since runtime creates are disabled */
+
+osal_sem_t osal_sem_create(uint32_t initial_count)
+{
+  (void)initial_count;
+  return NULL;
+}
+
+osal_sem_t osal_sem_from_native(void* native)
+{
+  return (osal_sem_t)native;
+}
+
+void osal_sem_delete(osal_sem_t sem)
+{
+  (void)sem;
+}
+
+uint8_t osal_sem_pend(osal_sem_t sem, uint32_t timeout_us)
+{
+  /* BIOS.clockEnabled = false - there is no tick to time out on,
+   * so anything other than forever degrades to a non-blocking poll */
+  UInt timeout = (timeout_us == OSAL_WAIT_FOREVER) ? BIOS_WAIT_FOREVER : BIOS_NO_WAIT;
+  return (uint8_t)Semaphore_pend((Semaphore_Handle)sem, timeout);
+}
+
+void osal_sem_post(osal_sem_t sem)
+{
+  Semaphore_post((Semaphore_Handle)sem);
+}
+
+/* calls act as compiler barriers - keep them out of line even with -pm */
+#pragma FUNC_CANNOT_INLINE(osal_atomic_load_acquire)
+#pragma FUNC_CANNOT_INLINE(osal_atomic_load_relaxed)
+#pragma FUNC_CANNOT_INLINE(osal_atomic_store_release)
+#pragma FUNC_CANNOT_INLINE(osal_atomic_store_relaxed)
+#pragma FUNC_CANNOT_INLINE(osal_atomic_fence)
+
+uint32_t osal_atomic_load_acquire(osal_atomic_u32_t* value)
+{
+  return *value;
+}
+
+uint32_t osal_atomic_load_relaxed(osal_atomic_u32_t* value)
+{
+  return *value;
+}
+
+void osal_atomic_store_release(osal_atomic_u32_t* value, uint32_t new_value)
+{
+  *value = new_value;
+}
+
+void osal_atomic_store_relaxed(osal_atomic_u32_t* value, uint32_t new_value)
+{
+  *value = new_value;
+}
+
+uint8_t osal_atomic_cas(osal_atomic_u32_t* value, uint32_t expected, uint32_t new_value)
+{
+  UInt key = Hwi_disable();
+  uint8_t swapped = (*value == expected);
+  if (swapped) {
+    *value = new_value;
+  }
+  Hwi_restore(key);
+  return swapped;
+}
+
+uint64_t osal_atomic_load_u64(osal_atomic_u64_t* value)
+{
+  UInt key = Hwi_disable();
+  uint64_t result = *value;
+  Hwi_restore(key);
+  return result;
+}
+
+void osal_atomic_store_u64(osal_atomic_u64_t* value, uint64_t new_value)
+{
+  UInt key = Hwi_disable();
+  *value = new_value;
+  Hwi_restore(key);
+}
+
+void osal_atomic_fence(void)
+{
+}
+
+osal_thread_t osal_thread_create(osal_thread_fn_t fn, void* arg, const char* name)
+{
+  /* tasks are created statically in app.cfg */
+  (void)fn;
+  (void)arg;
+  (void)name;
+  return NULL;
+}
+
+void osal_thread_join(osal_thread_t thread)
+{
+  (void)thread;
+}
+
+uint32_t osal_cpu_count(void)
+{
+  return 1u;
+}
+
+uint64_t osal_time_ns(void)
+{
+  Types_Timestamp64 ts;
+  Types_FreqHz freq;
+
+  Timestamp_get64(&ts);
+  Timestamp_getFreq(&freq);
+
+  uint64_t ticks = ((uint64_t)ts.hi << 32) | ts.lo;
+  uint64_t hz = ((uint64_t)freq.hi << 32) | freq.lo;
+  return (ticks / hz) * 1000000000ull + ((ticks % hz) * 1000000000ull) / hz;
+}
+
+uint64_t osal_cycles_hz(void)
+{
+  /* the c64p timestamp provider counts TSCL, so its frequency is the CPU clock */
+  Types_FreqHz freq;
+  Timestamp_getFreq(&freq);
+  return ((uint64_t)freq.hi << 32) | freq.lo;
+}
+
+void osal_sleep_until_ns(uint64_t deadline_ns)
+{
+  /* no clock module - busy wait on the timestamp counter */
+  while (osal_time_ns() < deadline_ns) {
+  }
+}
+
+const void* osal_file_map(const char* path, uint64_t* size)
+{
+  /* no file system on the board */
+  (void)path;
+  (void)size;
+  return NULL;
+}
+
+void osal_file_unmap(const void* data, uint64_t size)
+{
+  (void)data;
+  (void)size;
+}
+
+void* osal_mem_map(uint64_t* size, uint8_t hugepages)
+{
+  /* BIOS.runtimeCreatesEnabled = false - static blocks only */
+  (void)size;
+  (void)hugepages;
+  return NULL;
+}
+
+void osal_mem_unmap(void* data, uint64_t size)
+{
+  (void)data;
+  (void)size;
+}
+
+void osal_printf(const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  System_vprintf(format, args);
+  va_end(args);
+}
+
+void osal_flush(void)
+{
+  System_flush();
+}
+
+#endif /* ECG_OSAL_TIRTOS */
@@ -0,0 +1,297 @@
+#include "thread_pool.h"
+
+#include "osal/osal.h"
+
+#if defined(ECG_OSAL_POSIX)
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************
+ * DEFINES & MACROS
+ *****************************************************************************/
+
+#define CACHE_LINE_SIZE 64  /* keeps the deques of different threads apart */
+#define DEQUE_CAPACITY  64  /* a range of 2^32 items splits at most 32 times */
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+typedef struct {
+  uint32_t begin;
+  uint32_t end;
+} range_t;
+
+/* per thread deque - the owner pushes/pops at the bottom, thieves take from
+ * the top. critical sections are a few loads/stores so a spinlock is enough */
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_flag lock;
+  uint32_t top;
+  uint32_t bottom;
+  range_t ranges[DEQUE_CAPACITY];
+} deque_t;
+
+typedef struct {
+  thread_pool_t* pool;
+  osal_thread_t thread;
+  osal_sem_t wake;
+  uint32_t id;
+  uint32_t seed;      /* xorshift state for picking steal victims */
+} worker_t;
+
+struct thread_pool {
+  uint32_t num_threads;
+  worker_t* workers;  /* [0] is the thread calling parallel_for */
+  deque_t* deques;
+  osal_sem_t done;
+
+  /* current job */
+  thread_pool_range_fn fn;
+  void* ctx;
+  uint32_t grain;
+  atomic_uint remaining;
+  atomic_bool shutdown;
+};
+
+/******************************************************************************
+ * DEQUE
+ *****************************************************************************/
+
+static void deque_lock(deque_t* deque)
+{
+  while (atomic_flag_test_and_set_explicit(&deque->lock, memory_order_acquire)) {
+  }
+}
+
+static void deque_unlock(deque_t* deque)
+{
+  atomic_flag_clear_explicit(&deque->lock, memory_order_release);
+}
+
+static void deque_push_bottom(deque_t* deque, range_t range)
+{
+  deque_lock(deque);
+  deque->ranges[deque->bottom % DEQUE_CAPACITY] = range;
+  deque->bottom++;
+  deque_unlock(deque);
+}
+
+static uint8_t deque_pop_bottom(deque_t* deque, range_t* range)
+{
+  uint8_t found = 0;
+
+  deque_lock(deque);
+  if (deque->bottom != deque->top) {
+    deque->bottom--;
+    *range = deque->ranges[deque->bottom % DEQUE_CAPACITY];
+    found = 1;
+  }
+  deque_unlock(deque);
+  return found;
+}
+
+static uint8_t deque_steal_top(deque_t* deque, range_t* range)
+{
+  uint8_t found = 0;
+
+  deque_lock(deque);
+  if (deque->bottom != deque->top) {
+    *range = deque->ranges[deque->top % DEQUE_CAPACITY];
+    deque->top++;
+    found = 1;
+  }
+  deque_unlock(deque);
+  return found;
+}
+
+/******************************************************************************
+ * WORKERS
+ *****************************************************************************/
+
+static uint32_t next_random(worker_t* worker)
+{
+  uint32_t x = worker->seed;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  worker->seed = x;
+  return x;
+}
+
+static uint8_t steal(thread_pool_t* pool, worker_t* worker, range_t* range)
+{
+  uint32_t start = next_random(worker) % pool->num_threads;
+  uint32_t i = 0;
+
+  for (; i < pool->num_threads; i++) {
+    uint32_t victim = (start + i) % pool->num_threads;
+    if (victim != worker->id && deque_steal_top(&pool->deques[victim], range)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* works on the current job until every item has been processed */
+static void run_job(thread_pool_t* pool, worker_t* worker)
+{
+  deque_t* own = &pool->deques[worker->id];
+  range_t range;
+
+  while (atomic_load(&pool->remaining) > 0) {
+    if (!deque_pop_bottom(own, &range) && !steal(pool, worker, &range)) {
+      sched_yield();
+      continue;
+    }
+
+    /* split down to grain so idle threads have something to steal */
+    while (range.end - range.begin > pool->grain) {
+      range_t upper;
+      upper.begin = range.begin + (range.end - range.begin) / 2;
+      upper.end = range.end;
+      deque_push_bottom(own, upper);
+      range.end = upper.begin;
+    }
+
+    pool->fn(pool->ctx, range.begin, range.end);
+
+    uint32_t count = range.end - range.begin;
+    if (atomic_fetch_sub(&pool->remaining, count) == count) {
+      osal_sem_post(pool->done);
+    }
+  }
+}
+
+static void worker_main(void* arg)
+{
+  worker_t* worker = (worker_t*)arg;
+  thread_pool_t* pool = worker->pool;
+
+  while (1) {
+    osal_sem_pend(worker->wake, OSAL_WAIT_FOREVER);
+    if (atomic_load(&pool->shutdown)) {
+      break;
+    }
+    run_job(pool, worker);
+  }
+}
+
+/******************************************************************************
+ * FUNCTION IMPLEMENTATIONS
+ *****************************************************************************/
+
+thread_pool_t* thread_pool_create(uint32_t num_threads)
+{
+  thread_pool_t* pool = (thread_pool_t*)calloc(1, sizeof(*pool));
+  uint32_t i = 0;
+
+  if (!pool) {
+    return NULL;
+  }
+
+  pool->num_threads = num_threads ? num_threads : osal_cpu_count();
+  pool->workers = (worker_t*)calloc(pool->num_threads, sizeof(worker_t));
+  pool->deques = (deque_t*)aligned_alloc(CACHE_LINE_SIZE, pool->num_threads * sizeof(deque_t));
+  pool->done = osal_sem_create(0);
+  atomic_init(&pool->remaining, 0);
+  atomic_init(&pool->shutdown, 0);
+  if (!pool->workers || !pool->deques || !pool->done) {
+    thread_pool_destroy(pool);
+    return NULL;
+  }
+
+  for (i = 0; i < pool->num_threads; i++) {
+    memset(&pool->deques[i], 0, sizeof(deque_t));
+    atomic_flag_clear(&pool->deques[i].lock);
+
+    worker_t* worker = &pool->workers[i];
+    worker->pool = pool;
+    worker->id = i;
+    worker->seed = 0x9E3779B9u * (i + 1);
+  }
+
+  /* worker 0 is the caller of parallel_for, start threads for the rest */
+  for (i = 1; i < pool->num_threads; i++) {
+    worker_t* worker = &pool->workers[i];
+    worker->wake = osal_sem_create(0);
+    worker->thread = worker->wake ? osal_thread_create(worker_main, worker, "ecg_worker") : NULL;
+    if (!worker->thread) {
+      thread_pool_destroy(pool);
+      return NULL;
+    }
+  }
+
+  return pool;
+}
+
+void thread_pool_destroy(thread_pool_t* pool)
+{
+  uint32_t i = 0;
+
+  if (!pool) {
+    return;
+  }
+
+  atomic_store(&pool->shutdown, 1);
+  if (pool->workers) {
+    for (i = 1; i < pool->num_threads; i++) {
+      worker_t* worker = &pool->workers[i];
+      if (worker->thread) {
+        osal_sem_post(worker->wake);
+        osal_thread_join(worker->thread);
+      }
+      osal_sem_delete(worker->wake);
+    }
+  }
+
+  osal_sem_delete(pool->done);
+  free(pool->deques);
+  free(pool->workers);
+  free(pool);
+}
+
+uint32_t thread_pool_size(const thread_pool_t* pool)
+{
+  return pool->num_threads;
+}
+
+void thread_pool_parallel_for(thread_pool_t* pool, uint32_t count, uint32_t grain,
+                              thread_pool_range_fn fn, void* ctx)
+{
+  uint32_t i = 0;
+
+  if (count == 0) {
+    return;
+  }
+
+  pool->fn = fn;
+  pool->ctx = ctx;
+  pool->grain = grain ? grain : 1;
+
+  /* the job is published before its first range - a worker still spinning in run_job() of the last job may
+   * steal a range as soon as it is pushed, its decrement must land on the new count. fn, ctx and grain reach
+   * it through the deque lock the range is taken under */
+  atomic_store_explicit(&pool->remaining, count, memory_order_release);
+
+  /* deal one contiguous slice to every thread */
+  for (i = 0; i < pool->num_threads; i++) {
+    range_t range;
+    range.begin = (uint32_t)(((uint64_t)count * i) / pool->num_threads);
+    range.end = (uint32_t)(((uint64_t)count * (i + 1)) / pool->num_threads);
+    if (range.end > range.begin) {
+      deque_push_bottom(&pool->deques[i], range);
+    }
+  }
+
+  for (i = 1; i < pool->num_threads; i++) {
+    osal_sem_post(pool->workers[i].wake);
+  }
+
+  run_job(pool, &pool->workers[0]);
+  osal_sem_pend(pool->done, OSAL_WAIT_FOREVER);
+}
+
+#endif /* ECG_OSAL_POSIX */
@@ -0,0 +1,58 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdint.h>
+
+/* opaque work-stealing thread pool */
+typedef struct thread_pool thread_pool_t;
+
+/* processes items [begin, end) of a parallel_for range */
+typedef void (*thread_pool_range_fn)(void* ctx, uint32_t begin, uint32_t end);
+
+/*!
+ * @brief Create a work-stealing thread pool
+ *
+ * the thread calling thread_pool_parallel_for() takes part in the work,
+ * so num_threads - 1 worker threads are created.
+ *
+ * @param num_threads - total number of threads, 0 uses every core
+ * @return pool handle or NULL on failure
+ */
+thread_pool_t* thread_pool_create(uint32_t num_threads);
+
+/*!
+ * @brief Stop the workers and free the pool
+ *
+ * @param pool - pool handle
+ */
+void thread_pool_destroy(thread_pool_t* pool);
+
+/*!
+ * @brief Number of threads working on a parallel_for (workers + caller)
+ *
+ * @param pool - pool handle
+ * @return number of threads
+ */
+uint32_t thread_pool_size(const thread_pool_t* pool);
+
+/*!
+ * @brief Run fn over [0, count) on all threads and wait for completion
+ *
+ * the range is split evenly across the per thread deques. every thread pops
+ * the newest range of its own deque, splits it in halves down to grain items
+ * (pushing the upper halves back) and steals the oldest, largest ranges of the
+ * other deques once its own deque is empty - so uneven item costs get balanced
+ * without any central queue.
+ *
+ * must not be called concurrently or from inside fn.
+ *
+ * @param pool  - pool handle
+ * @param count - number of items
+ * @param grain - smallest range handed to fn (0 is treated as 1)
+ * @param fn    - called for every range, concurrently from several threads
+ * @param ctx   - context passed to fn
+ */
+void thread_pool_parallel_for(thread_pool_t* pool, uint32_t count, uint32_t grain,
+                              thread_pool_range_fn fn, void* ctx);
+
+#endif /* THREAD_POOL_H */